@@ -1,443 +1,157 @@
 #include <GL/glut.h>
 #include <GL/glu.h>
+#include <GL/glx.h>
+#include <X11/Xlib.h>
 #include <math.h>
+#include "anim.h"
+#include "inertia.h"
+#include "viewcube.h"
+#include "glstate.h"
+#include "trace.h"
+#include "latency.h"
+#include "meshgl.h"
+#include "pointgl.h"
+#include "fit.h"
+#include "renderthread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
 float view_rot_x = 35.264f, view_rot_y = 45.0f, view_rot_z = 0;
-float cube_rot_x = 35.264f, cube_rot_y = 45.0f, cube_rot_z = 0;
-int dragging = 0, dragging_main = 0, last_x, last_y;
-int drag_mode = 0; // 0: xy, 1: z
-
-// Hover 狀態
-int hover_type = 0; // 0:無, 1:面, 2:邊, 3:角
-int hover_id = -1;
-
-// 方向向量表與對應旋轉
-float face_dirs[6][3] = {
-    { 1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0,-1, 0}, {0, 0, 1}, {0, 0,-1}
-};
-float face_angles[6][2] = {
-    { 0, 90}, { 0,-90}, {-90, 0}, {90, 0}, {0, 0}, {0, 180}
-};
-
-// 每個面的四個頂點（順序：左下、右下、右上、左上）
-const float face_vertices[6][4][3] = {
-    // +X
-    { {0.5,-0.5,-0.5}, {0.5,0.5,-0.5}, {0.5,0.5,0.5}, {0.5,-0.5,0.5} },
-    // -X
-    { {-0.5,-0.5,0.5}, {-0.5,0.5,0.5}, {-0.5,0.5,-0.5}, {-0.5,-0.5,-0.5} },
-    // +Y
-    { {-0.5,0.5,-0.5}, {0.5,0.5,-0.5}, {0.5,0.5,0.5}, {-0.5,0.5,0.5} },
-    // -Y
-    { {-0.5,-0.5,0.5}, {0.5,-0.5,0.5}, {0.5,-0.5,-0.5}, {-0.5,-0.5,-0.5} },
-    // +Z
-    { {-0.5,-0.5,0.5}, {0.5,-0.5,0.5}, {0.5,0.5,0.5}, {-0.5,0.5,0.5} },
-    // -Z
-    { {0.5,-0.5,-0.5}, {-0.5,-0.5,-0.5}, {-0.5,0.5,-0.5}, {0.5,0.5,-0.5} }
-};
-
-// 每個面的顏色
-const float face_colors[6][3] = {
-    {0.8,0.8,0.8},    // +X 灰
-    {0.8,0.8,0.8},    // -X 灰
-    {0.8,0.8,0.8},    // +Y 灰
-    {0.8,0.8,0.8},    // -Y 灰
-    {0.8,0.8,0.8},    // +Z 灰
-    {0.8,0.8,0.8}     // -Z 灰
-};
-
-// --- 新增：細分面區域 ---
-#define SUBDIV_CELLS 54  // 6面 x 9格
-#define EDGE_DIV 4      // 分割點數量
-#define FACE_SUBDIV_X 3
-#define FACE_SUBDIV_Y 3
-#define FACE_CELLS (FACE_SUBDIV_X * FACE_SUBDIV_Y)
-
-// 定義分割比例
-const float subdiv_ratios[4] = {
-    0.0f,   // 開始
-    0.1f,   // 1/10
-    0.9f,   // 9/10
-    1.0f    // 結束
-};
-
-// 儲存預計算的頂點
-typedef struct {
-    float vertices[4][3];  // 每個小面的四個頂點
-} SubdivCell;
+int dragging_main = 0, last_x, last_y;
+
+// ViewCube 元件（狀態都在實例中，見 libviewcube.c）
+viewcube_t *cube = NULL;
+
+// 慣性旋轉（按 m 切換）：放開滑鼠後依拖曳速度繼續轉動並逐漸減速
+Inertia inertia;
+int momentum_enabled = 0;
+int tick_timer_pending = 0;
+
+// 延遲量測的合成輸入：以固定間隔送出拖曳事件，跑完後印出統計
+#define SYNTH_EVENTS 600
+#define SYNTH_INTERVAL_MS 8
+int synth_remaining = 0;
+int synth_exit_when_done = 0;
+
+// --model 載入的模型；沒有模型時畫佔位立方體
+MeshGL model_gl;
+int model_loaded = 0;
+MeshDrawStats model_stats;
+int model_timer_pending = 0;
+
+// 遮蔽查詢的結果在之後的畫格才讀；有被遮住的叢集重新露出時再畫一次
+void modelTick(int value) {
+    model_timer_pending = 0;
+    int r = meshgl_poll(&model_gl);
+    if (r > 0) {
+        glutPostRedisplay();
+    } else if (r == 0) {
+        model_timer_pending = 1;
+        glutTimerFunc(16, modelTick, 0);
+    }
+}
 
-static SubdivCell subdivided_faces[SUBDIV_CELLS];
+// 視圖框選：相機平移與距離。ViewCube 轉到某面時一起動畫到新的框選，f 立即框選
+FitFrame view_frame = { { 0, 0 }, 8 }, frame_from, frame_to;
+int framing = 0;
 
-// 新增 hover 狀態
-int hover_face = -1; // 0~5
-int hover_cell = -1; // 0~8 (3x3)
+// --points 載入的點雲：八元樹節點在背景執行緒串流讀入，節點到達後重繪
+PointGL points_gl;
+int points_loaded = 0;
+PointDrawStats points_stats;
+int points_timer_pending = 0;
 
-// 雙線性插值
-void lerp_face_vertex(const float v[4][3], float u, float vval, float out[3]) {
-    float a[3], b[3];
-    for (int i = 0; i < 3; ++i) {
-        a[i] = v[0][i] * (1-u) + v[1][i] * u;
-        b[i] = v[3][i] * (1-u) + v[2][i] * u;
-        out[i] = a[i] * (1-vval) + b[i] * vval;
+void pointsTick(int value) {
+    points_timer_pending = 0;
+    int r = pointgl_poll(&points_gl);
+    if (r > 0) {
+        glutPostRedisplay();
+    } else if (r == 0) {
+        points_timer_pending = 1;
+        glutTimerFunc(16, pointsTick, 0);
     }
 }
 
-// 生成細分頂點
-void generateSubdividedVertices() {
-    for (int face = 0; face < 6; face++) {
-        for (int y = 0; y < 3; y++) {
-            for (int x = 0; x < 3; x++) {
-                int cell_idx = face * 9 + y * 3 + x;
-                float x1 = subdiv_ratios[x];
-                float x2 = subdiv_ratios[x + 1];
-                float y1 = subdiv_ratios[y];
-                float y2 = subdiv_ratios[y + 1];
-                
-                lerp_face_vertex(face_vertices[face], x1, y1, subdivided_faces[cell_idx].vertices[0]);
-                lerp_face_vertex(face_vertices[face], x2, y1, subdivided_faces[cell_idx].vertices[1]);
-                lerp_face_vertex(face_vertices[face], x2, y2, subdivided_faces[cell_idx].vertices[2]);
-                lerp_face_vertex(face_vertices[face], x1, y2, subdivided_faces[cell_idx].vertices[3]);
-            }
-        }
-    }
+// --render-thread：GLUT 執行緒只處理輸入，把視圖狀態寫成快照發布（三重緩衝），
+// 由獨立的渲染執行緒持有 GL context 畫最新的快照；需要 GL 的按鍵經無鎖佇列轉過去
+typedef struct {
+    float rot[3];
+    FitFrame frame;
+    int win_w, win_h;
+    viewcube_t *cube;       // 輸入端 cube 的複本
+} ViewSnapshot;
+
+enum { RENDER_KEY, RENDER_SYNTH_START, RENDER_SYNTH_DONE };
+
+int render_thread = 0;
+RenderThread renderer;
+RtQueue render_queue;
+RtTriple snapshots;
+ViewSnapshot snapshot_slots[3];
+double input_pending = -1;          // 輸入執行緒：還沒發布的最舊輸入
+_Atomic double undrawn_input = -1;  // 已發布、還沒畫出的最舊輸入；渲染執行緒取走時清成 -1
+Display *glx_display;
+GLXDrawable glx_drawable;
+GLXContext glx_context;
+
+// 輸入時間戳：單執行緒時直接交給延遲量測，否則在下一個快照發布後交給渲染執行緒
+void noteInput(double t) {
+    if (!render_thread) latency_input(t);
+    else if (input_pending < 0) input_pending = t;
 }
 
-// 繪製單一 cell
-void drawFaceCell(int face, int cell, int highlight) {
-    int cell_idx = face * 9 + cell;
-    
-    if (highlight)
-        glColor3f(1, 0.8, 0.2);
-    else
-        glColor3fv(face_colors[face]);
-        
-    glBegin(GL_QUADS);
-    for (int i = 0; i < 4; i++) {
-        glVertex3fv(subdivided_faces[cell_idx].vertices[i]);
-    }
-    glEnd();
+void pushRender(int type, int a) {
+    RtEvent e = { type, a, 0, anim_now() };
+    if (!rt_queue_push(&render_queue, &e))
+        fprintf(stderr, "渲染佇列已滿，丟棄事件 %d\n", type);
+    renderthread_wake(&renderer);
 }
 
 void drawCube(float size) {
-    glutSolidCube(size);
-}
-
-// 輔助：將螢幕座標轉換為 ViewCube 內部的 3D 空間座標
-void screenToViewCubeLocal(int x, int y, int winWidth, int winHeight, int size, float *out) {
-    int vx = winWidth - size - 10;
-    int vy = winHeight - size - 10;
-    
-    // 將鼠標位置轉換到 NDC 空間 [-1, 1]
-    float fx = (2.0f * (x - vx) / (float)size) - 1.0f;
-    float fy = (2.0f * (y - vy) / (float)size) - 1.0f;
-    
-    // 視點在 z = 5
-    float eye_z = 5.0f;
-    float near_z = 1.0f;
-    float fov = 30.0f * M_PI / 180.0f;
-    float tan_half_fov = tanf(fov * 0.5f);
-    
-    // 計算近平面上的點
-    float near_x = fx * near_z * tan_half_fov;
-    float near_y = fy * near_z * tan_half_fov;
-    
-    // 從視點(0,0,eye_z)到近平面上的點(near_x,near_y,near_z)形成射線
-    float dx = near_x;
-    float dy = near_y;
-    float dz = near_z - eye_z;
-    
-    // 單位化射線方向
-    float len = sqrtf(dx*dx + dy*dy + dz*dz);
-    dx /= len;
-    dy /= len;
-    dz /= len;
-    
-    // 計算旋轉角度（與 drawViewCube 中的順序相反）
-    float ry = -cube_rot_y * M_PI / 180.0f;  // Y軸
-    float rx = -cube_rot_x * M_PI / 180.0f;  // X軸
-    float rz = -cube_rot_z * M_PI / 180.0f;  // Z軸
-    
-    // 先旋轉 Y 軸
-    float x1 = dx * cosf(ry) - dz * sinf(ry);
-    float y1 = dy;
-    float z1 = dx * sinf(ry) + dz * cosf(ry);
-    
-    // 再旋轉 X 軸
-    float x2 = x1;
-    float y2 = y1 * cosf(rx) - z1 * sinf(rx);
-    float z2 = y1 * sinf(rx) + z1 * cosf(rx);
-    
-    // 最後旋轉 Z 軸
-    float x3 = x2 * cosf(rz) - y2 * sinf(rz);
-    float y3 = x2 * sinf(rz) + y2 * cosf(rz);
-    float z3 = z2;
-    
-    // 輸出轉換後的方向向量
-    out[0] = x3;
-    out[1] = y3;
-    out[2] = z3;
+    if (points_loaded) pointgl_draw(&points_gl, size, &points_stats);
+    else if (model_loaded) meshgl_draw(&model_gl, size, &model_stats);
+    else glutSolidCube(size);
 }
 
-// 更新後的 hover 判斷
-void checkViewCubeHover(int x, int y, int winWidth, int winHeight, int size) {
-    hover_face = -1;
-    hover_cell = -1;
-    hover_type = 0;
-    hover_id = -1;
-    int vx = winWidth - size - 10;
-    int vy = winHeight - size - 10;
-    if (x < vx || x > vx + size || y < vy || y > vy + size) return;
-
-    float local[3];
-    screenToViewCubeLocal(x, y, winWidth, winHeight, size, local);
-    float lx = local[0], ly = local[1], lz = local[2];
-
-    // 判斷最近的面
-    float max_dot = -1.0f;
-    int max_face = -1;
-    float threshold = 0.3f; // 調整閾值，使檢測更寬鬆
-    
-    // 檢查與每個面的交點
-    for (int i = 0; i < 6; ++i) {
-        float nx = face_dirs[i][0];
-        float ny = face_dirs[i][1];
-        float nz = face_dirs[i][2];
-        
-        // 計算射線與面法向量的夾角余弦值
-        float dot = lx * nx + ly * ny + lz * nz;
-        
-        // 只考慮朝向攝像機的面（dot < 0）
-        if (dot < 0.0f && -dot > max_dot) {
-            max_dot = -dot;
-            max_face = i;
-        }
-    }
-    
-    // 如果沒有找到合適的面
-    if (max_face < 0) {
-        return;
-    }
-
-    // 計算面上的 UV 座標
-    float u = 0.0f, vcell = 0.0f;
-    if (max_face >= 0) {
-        float scale = 1.0f / max_dot;  // 投影到面上的縮放因子
-        
-        switch (max_face) {
-            case 0: // +X
-                u = (-lz * scale + 0.5f);
-                vcell = (ly * scale + 0.5f);
-                break;
-            case 1: // -X
-                u = (lz * scale + 0.5f);
-                vcell = (ly * scale + 0.5f);
-                break;
-            case 2: // +Y
-                u = (lx * scale + 0.5f);
-                vcell = (-lz * scale + 0.5f);
-                break;
-            case 3: // -Y
-                u = (lx * scale + 0.5f);
-                vcell = (lz * scale + 0.5f);
-                break;
-            case 4: // +Z
-                u = (lx * scale + 0.5f);
-                vcell = (ly * scale + 0.5f);
-                break;
-            case 5: // -Z
-                u = (-lx * scale + 0.5f);
-                vcell = (ly * scale + 0.5f);
-                break;
-        }
-    }
-
-    // 判斷 cell 位置
-    int cell_x = -1, cell_y = -1;
-    // 檢查是否在有效範圍內（加入容差）
-    float tolerance = 0.05f;  // 增加容差值
-    if (u >= -tolerance && u <= 1.0f + tolerance &&
-        vcell >= -tolerance && vcell <= 1.0f + tolerance) {
-        
-        // 限制在有效範圍內
-        u = fmaxf(0.0f, fminf(1.0f, u));
-        vcell = fmaxf(0.0f, fminf(1.0f, vcell));
-        
-        // 判斷 cell_x
-        for (int i = 0; i < FACE_SUBDIV_X; ++i) {
-            float x1 = subdiv_ratios[i];
-            float x2 = subdiv_ratios[i+1];
-            if (u >= x1 - tolerance && u <= x2 + tolerance) {
-                cell_x = i;
-                break;
-            }
-        }
-        // 判斷 cell_y
-        for (int i = 0; i < FACE_SUBDIV_Y; ++i) {
-            float y1 = subdiv_ratios[i];
-            float y2 = subdiv_ratios[i+1];
-            if (vcell >= y1 - tolerance && vcell <= y2 + tolerance) {
-                cell_y = i;
-                break;
-            }
-        }
-        
-        if (cell_x >= 0 && cell_y >= 0) {
-            hover_face = max_face;
-            hover_cell = cell_y * FACE_SUBDIV_X + cell_x;
-            hover_type = 1;
-            hover_id = hover_face * FACE_CELLS + hover_cell;
-            return;
+// 計算指定方向下剛好容納模型（或佔位立方體）的框選
+void computeFrame(const float euler[3], FitFrame *out) {
+    float rot[9], lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    fit_rotation(euler, rot);
+    if (points_loaded) {
+        pointgl_view_extent(&points_gl, 2.0f, rot, lo, hi);
+    } else if (model_loaded) {
+        meshgl_view_extent(&model_gl, 2.0f, rot, lo, hi);
+    } else {
+        float corners[24];
+        for (int i = 0; i < 8; ++i) {
+            corners[3 * i] = (i & 1) ? 1.0f : -1.0f;
+            corners[3 * i + 1] = (i & 2) ? 1.0f : -1.0f;
+            corners[3 * i + 2] = (i & 4) ? 1.0f : -1.0f;
         }
+        fit_extent_points(corners, 8, rot, lo, hi);
     }
-    
-    // 如果沒有找到合適的 cell
-    hover_type = 0;
-    hover_id = -1;
-
-    // 其他類型的 hover 檢測（邊和角）可以在這裡添加
-    hover_type = 0;
-    hover_id = -1;
+    int w = glutGet(GLUT_WINDOW_WIDTH), h = glutGet(GLUT_WINDOW_HEIGHT);
+    fit_frame(lo, hi, 45, h > 0 ? (float)w / h : 1.0f, out);
 }
 
-void drawViewCube(int winWidth, int winHeight, int size) {
-    glViewport(winWidth - size - 10, winHeight - size - 10, size, size);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(30, 1, 1, 10);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(0,0,5, 0,0,0, 0,1,0);
-
-    glPushMatrix();
-    glRotatef(cube_rot_z, 0, 0, 1); // 新增
-    glRotatef(cube_rot_x, 1, 0, 0);
-    glRotatef(cube_rot_y, 0, 1, 0);
-
-    // 每個面細分 3x3
-    for (int f = 0; f < 6; ++f) {
-        for (int cell = 0; cell < FACE_CELLS; ++cell) {
-            int highlight = (hover_type == 1 && hover_face == f && hover_cell == cell);
-            drawFaceCell(f, cell, highlight);
-        }
-    }
-
-    // --- 中文標籤 ---
-    const char* face_labels_zh[6] = {"右", "左", "上", "下", "前", "後"};
-    float label_pos_zh[6][3] = {
-        {0.5f, 0.0f, 0.0f},   // +X 右
-        {-0.5f, 0.0f, 0.0f},  // -X 左
-        {0.0f, 0.5f, 0.0f},   // +Y 上
-        {0.0f, -0.5f, 0.0f},  // -Y 下
-        {0.0f, 0.0f, 0.5f},   // +Z 前
-        {0.0f, 0.0f, -0.5f}   // -Z 後
-    };
-    float label_normal[6][3] = {
-        {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}
-    };
-    float label_up[6][3] = {
-        {0,1,0}, {0,1,0}, {0,0,-1}, {0,0,1}, {0,1,0}, {0,1,0}
-    };
-    glColor3f(0,0,0);
-    for (int f = 0; f < 6; ++f) {
-        glPushMatrix();
-        // 1. 先移動到面中心
-        glTranslatef(label_pos_zh[f][0], label_pos_zh[f][1], label_pos_zh[f][2]);
-        // 2. 讓文字面朝外且平貼在面上
-        float nx = label_normal[f][0], ny = label_normal[f][1], nz = label_normal[f][2];
-        float ux = label_up[f][0], uy = label_up[f][1], uz = label_up[f][2];
-        // 計算旋轉矩陣
-        float fx = uy * nz - uz * ny;
-        float fy = uz * nx - ux * nz;
-        float fz = ux * ny - uy * nx;
-        float m[16] = {
-            fx,  ux,  nx, 0,
-            fy,  uy,  ny, 0,
-            fz,  uz,  nz, 0,
-            0,   0,   0,  1
-        };
-        glMultMatrixf(m);
-        // 3. 可選：縮小字體，避免超出面
-        glScalef(0.0015f, 0.0015f, 1.0f);
-        // 4. 畫文字
-        glRasterPos3f(0, 0, 0.01f); // 貼在面上
-        const char* p = face_labels_zh[f];
-        while (*p) {
-            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *p);
-            ++p;
-        }
-        glPopMatrix();
-    }
-
-    // --- 英文標籤 ---
-    const char* face_labels[6] = {"R", "L", "U", "D", "F", "B"};
-    float label_pos[6][3] = {
-        {0.6f, 0.0f, 0.0f},   // +X 右 (Right)
-        {-0.7f, 0.0f, 0.0f},  // -X 左 (Left)
-        {0.0f, 0.6f, 0.0f},   // +Y 上 (Up)
-        {0.0f, -0.7f, 0.0f},  // -Y 下 (Down)
-        {0.0f, 0.0f, 0.6f},   // +Z 前 (Front)
-        {0.0f, 0.0f, -0.7f}   // -Z 後 (Back)
-    };
-    glColor3f(0,0,0);
-    for (int f = 0; f < 6; ++f) {
-        glRasterPos3f(label_pos[f][0], label_pos[f][1], label_pos[f][2]);
-        const char* p = face_labels[f];
-        while (*p) {
-            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *p);
-            ++p;
-        }
-    }
-
-    // 邊高亮
-    static const int edge_indices[12][2] = {
-        {0,1},{1,2},{2,3},{3,0}, // +Z 面
-        {4,5},{5,6},{6,7},{7,4}, // -Z 面
-        {0,4},{1,5},{2,6},{3,7}  // 側邊
-    };
-    static const float edge_vertices[8][3] = {
-        {-0.5,-0.5, 0.5}, {0.5,-0.5, 0.5}, {0.5,0.5, 0.5}, {-0.5,0.5, 0.5},
-        {-0.5,-0.5,-0.5}, {0.5,-0.5,-0.5}, {0.5,0.5,-0.5}, {-0.5,0.5,-0.5}
-    };
-    glLineWidth(4.0f);
-    for (int i = 0; i < 12; ++i) {
-        if (hover_type == 2 && hover_id == i)
-            glColor3f(0.2, 1, 0.2); // 邊高亮
-        else
-            glColor3f(0.5, 0.5, 0.5);
-        glBegin(GL_LINES);
-        glVertex3fv(edge_vertices[edge_indices[i][0]]);
-        glVertex3fv(edge_vertices[edge_indices[i][1]]);
-        glEnd();
-    }
-    glLineWidth(1.0f);
-
-    // 角高亮
-    for (int i = 0; i < 8; ++i) {
-        if (hover_type == 3 && hover_id == i)
-            glColor3f(1, 0.2, 0.2); // 角高亮
-        else
-            glColor3f(0.8, 0.8, 0.8);
-        glPointSize(10.0f);
-        glBegin(GL_POINTS);
-        glVertex3fv(edge_vertices[i]);
-        glEnd();
-    }
-    glPointSize(1.0f);
-
-    glPopMatrix();
-    glViewport(0, 0, winWidth, winHeight);
+// 讓主視圖跟隨 ViewCube 的方向
+void syncViewFromCube() {
+    float r[3];
+    viewcube_get_orientation(cube, r);
+    view_rot_x = r[0];
+    view_rot_y = r[1];
+    view_rot_z = r[2];
 }
 
-void display() {
+// 畫一格：主視圖加 ViewCube（不交換緩衝）
+void renderView(const float rot[3], const FitFrame *frame, int win_w, int win_h, viewcube_t *vc) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    int win_w = glutGet(GLUT_WINDOW_WIDTH);
-    int win_h = glutGet(GLUT_WINDOW_HEIGHT);
-    int size = 100;
-
     // 主視圖
     glViewport(0, 0, win_w, win_h);
     glMatrixMode(GL_PROJECTION);
@@ -445,140 +159,471 @@ void display() {
     gluPerspective(45, (float)win_w/win_h, 1, 100);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
-    gluLookAt(0,0,8, 0,0,0, 0,1,0);
+    glTranslatef(-frame->pan[0], -frame->pan[1], -frame->distance);
 
     glPushMatrix();
-    glRotatef(view_rot_z, 0, 0, 1); // 新增
-    glRotatef(view_rot_x, 1, 0, 0);
-    glRotatef(view_rot_y, 0, 1, 0);
+    glRotatef(rot[2], 0, 0, 1); // 新增
+    glRotatef(rot[0], 1, 0, 0);
+    glRotatef(rot[1], 0, 1, 0);
     glColor3f(1,1,1);
     drawCube(2.0);
     glPopMatrix();
 
     // ViewCube
-    drawViewCube(win_w, win_h, size);
+    viewcube_render(vc);
+}
 
-    glutSwapBuffers();
+// 渲染執行緒模式的 display：只把目前的視圖寫進快照發布，叫醒渲染執行緒
+void publishView() {
+    ViewSnapshot *s = rt_triple_back(&snapshots);
+    s->rot[0] = view_rot_x;
+    s->rot[1] = view_rot_y;
+    s->rot[2] = view_rot_z;
+    s->frame = view_frame;
+    s->win_w = glutGet(GLUT_WINDOW_WIDTH);
+    s->win_h = glutGet(GLUT_WINDOW_HEIGHT);
+    viewcube_copy(s->cube, cube);
+    rt_triple_publish(&snapshots);
+    // 發布之後才交出時間戳，渲染執行緒拿到它時包含這個輸入的快照已經發布；
+    // 還有更舊的沒畫出就留著舊的
+    if (input_pending >= 0) {
+        double none = -1;
+        atomic_compare_exchange_strong(&undrawn_input, &none, input_pending);
+        input_pending = -1;
+    }
+    renderthread_wake(&renderer);
 }
 
-void mouse(int button, int state, int x, int y) {
-    int win_w = glutGet(GLUT_WINDOW_WIDTH);
-    int win_h = glutGet(GLUT_WINDOW_HEIGHT);
-    int size = 100;
-    y = win_h - y; // 修正座標
-    checkViewCubeHover(x, y, win_w, win_h, size);
-
-    // 新增：處理點擊 ViewCube cell
-    if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
-        if (hover_type == 1 && hover_face >= 0 && hover_cell >= 0) {
-            cube_rot_x = face_angles[hover_face][0];
-            cube_rot_y = face_angles[hover_face][1];
-            cube_rot_z = 0;
-            view_rot_x = cube_rot_x;
-            view_rot_y = cube_rot_y;
-            view_rot_z = cube_rot_z;
-            glutPostRedisplay();
-            return;
-        }
+void display() {
+    TRACE_SCOPE("display");
+    if (render_thread) {
+        publishView();
+        return;
+    }
+    latency_frame_begin();
+    float rot[3] = { view_rot_x, view_rot_y, view_rot_z };
+    renderView(rot, &view_frame, glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT), cube);
+
+    // 還有節點在路上：等它們到達再重繪
+    if (points_loaded && points_stats.pending && !points_timer_pending) {
+        points_timer_pending = 1;
+        glutTimerFunc(16, pointsTick, 0);
+    }
+    if (model_loaded && model_stats.pending && !model_timer_pending) {
+        model_timer_pending = 1;
+        glutTimerFunc(16, modelTick, 0);
     }
 
-    int vx = win_w - size - 10;
-    int vy = 10;
-    if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
-        if (x >= vx && x <= vx + size && y >= vy && y <= vy + size) {
-            dragging = 1;
-            dragging_main = 0;
-            last_x = x;
-            last_y = y;
-            int mods = glutGetModifiers();
-            drag_mode = (mods & GLUT_ACTIVE_SHIFT) ? 1 : 0;
+    {
+        TRACE_SCOPE("glutSwapBuffers");
+        glutSwapBuffers();
+        if (latency_enabled() && latency_strict())
+            glFinish();
+        latency_frame_presented(anim_now());
+    }
+    gls_frame_end();
+}
+
+// 動畫 / 慣性計時器：只在仍有動作時排程下一格，停下後程式完全閒置
+void tick(int value) {
+    TRACE_SCOPE("tick");
+    double now = anim_now();
+    int running = 0;
+    tick_timer_pending = 0;
+
+    int r = viewcube_tick(cube, now);
+    if (r & VIEWCUBE_EVENT_ORIENTATION) syncViewFromCube();
+    if (r & VIEWCUBE_EVENT_REDRAW) glutPostRedisplay();
+    if (r & VIEWCUBE_EVENT_ANIMATING) running = 1;
+
+    // 框選跟著轉面動畫的進度走；轉面結束（或被取消）時停在終點
+    if (framing) {
+        float p;
+        if (viewcube_get_snap(cube, now, NULL, &p)) {
+            fit_lerp(&frame_from, &frame_to, p, &view_frame);
         } else {
-            dragging = 0;
-            dragging_main = 1;
-            last_x = x;
-            last_y = y;
+            view_frame = frame_to;
+            framing = 0;
         }
+        glutPostRedisplay();
+    }
+
+    // 主視圖拖曳的慣性
+    if (inertia.active) {
+        float e[3];
+        if (inertia_update(&inertia, now, e)) running = 1;
+        view_rot_x = e[0];
+        view_rot_y = e[1];
+        view_rot_z = e[2];
+        viewcube_set_orientation(cube, e[0], e[1], e[2]);
+        glutPostRedisplay();
     }
-    if (button == GLUT_LEFT_BUTTON && state == GLUT_UP) {
-        dragging = 0;
-        dragging_main = 0;
-        view_rot_x = cube_rot_x;
-        view_rot_y = cube_rot_y;
+
+    if (running) {
+        tick_timer_pending = 1;
+        glutTimerFunc(16, tick, 0);
     }
 }
 
-void motion(int x, int y) {
-    int win_w = glutGet(GLUT_WINDOW_WIDTH);
-    int win_h = glutGet(GLUT_WINDOW_HEIGHT);
-    y = win_h - y; // 修正座標
-    if (dragging) {
-        if (drag_mode == 0) {
-            // LMB: xy 旋轉
-            cube_rot_y += (x - last_x);
-            cube_rot_x += (y - last_y);
-        } else {
-            // Shift+LMB: z 軸旋轉
-            cube_rot_z += (x - last_x); // 只用 x 拖曳控制 z 軸
+// 依 viewcube 回傳的事件旗標重繪 / 啟動計時器
+void handleCubeEvents(int r) {
+    if (r & VIEWCUBE_EVENT_ORIENTATION) syncViewFromCube();
+    if (r & VIEWCUBE_EVENT_REDRAW) glutPostRedisplay();
+    if ((r & VIEWCUBE_EVENT_ANIMATING) && !tick_timer_pending) {
+        tick_timer_pending = 1;
+        glutTimerFunc(0, tick, 0);
+    }
+}
+
+void mouse(int button, int state, int x, int y) {
+    TRACE_SCOPE("mouse");
+    if (button != GLUT_LEFT_BUTTON) return;
+
+    if (state == GLUT_DOWN) {
+        int mods = (glutGetModifiers() & GLUT_ACTIVE_SHIFT) ? VIEWCUBE_MOD_SHIFT : 0;
+        int r = viewcube_pointer_down(cube, x, y, mods);
+        if (r & VIEWCUBE_EVENT_CONSUMED) {
+            inertia_stop(&inertia);
+            float target[3];
+            if (viewcube_get_snap(cube, anim_now(), target, NULL)) {
+                frame_from = view_frame;
+                computeFrame(target, &frame_to);
+                framing = 1;
+            } else {
+                framing = 0;  // 拖曳 ViewCube：停在目前的框選
+            }
+            handleCubeEvents(r);
+            return;
         }
+        // 主視圖拖曳
+        inertia_stop(&inertia);
+        framing = 0;
+        viewcube_set_orientation(cube, view_rot_x, view_rot_y, view_rot_z);
+        dragging_main = 1;
         last_x = x;
-        last_y = y;
-        // 讓主視圖同步
-        view_rot_x = cube_rot_x;
-        view_rot_y = cube_rot_y;
-        view_rot_z = cube_rot_z;
-        glutPostRedisplay();
-    } else if (dragging_main) {
+        last_y = glutGet(GLUT_WINDOW_HEIGHT) - y; // 修正座標
+    } else {
+        handleCubeEvents(viewcube_pointer_up(cube, x, y));
+
+        if (dragging_main) {
+            dragging_main = 0;
+            float pos[3] = { view_rot_x, view_rot_y, view_rot_z };
+            if (momentum_enabled && inertia_release(&inertia, anim_now(), pos) &&
+                !tick_timer_pending) {
+                tick_timer_pending = 1;
+                glutTimerFunc(16, tick, 0);
+            }
+        }
+    }
+}
+
+void motion(int x, int y) {
+    TRACE_SCOPE("motion");
+    noteInput(anim_now());
+    if (dragging_main) {
+        y = glutGet(GLUT_WINDOW_HEIGHT) - y; // 修正座標
         // 主視圖拖曳
         view_rot_y += (x - last_x);
         view_rot_x += (y - last_y);
         last_x = x;
         last_y = y;
         // 讓 ViewCube 同步
-        cube_rot_x = view_rot_x;
-        cube_rot_y = view_rot_y;
-        cube_rot_z = view_rot_z;
+        viewcube_set_orientation(cube, view_rot_x, view_rot_y, view_rot_z);
+        float pos[3] = { view_rot_x, view_rot_y, view_rot_z };
+        inertia_drag_sample(&inertia, anim_now(), pos);
         glutPostRedisplay();
+        return;
     }
+    handleCubeEvents(viewcube_pointer_move(cube, x, y));
 }
 
 void passiveMotion(int x, int y) {
+    TRACE_SCOPE("passiveMotion");
+    handleCubeEvents(viewcube_pointer_move(cube, x, y));
+}
+
+void reshape(int w, int h) {
+    TRACE_SCOPE("reshape");
+    // 渲染執行緒模式下 context 不在這個執行緒，視埠由 renderView 設定
+    if (!render_thread) glViewport(0, 0, w, h);
+    viewcube_resize(cube, w, h);
+}
+
+// 合成輸入產生器：在主視圖上畫圓拖曳，每次呼叫送出一個 motion 事件
+void synthInput(int value) {
     int win_w = glutGet(GLUT_WINDOW_WIDTH);
     int win_h = glutGet(GLUT_WINDOW_HEIGHT);
-    int size = 100;
-    y = win_h - y; // 修正座標
-    
-    int prev_hover_face = hover_face;
-    int prev_hover_cell = hover_cell;
-    int prev_hover_type = hover_type;
-    
-    checkViewCubeHover(x, y, win_w, win_h, size);
-    
-    if (prev_hover_face != hover_face || 
-        prev_hover_cell != hover_cell || 
-        prev_hover_type != hover_type) {
+    int i = SYNTH_EVENTS - synth_remaining;
+    int x = win_w / 3 + (int)(80 * cos(i * 0.05));
+    int y = win_h / 2 + (int)(80 * sin(i * 0.05));
+
+    if (i == 0) {
+        mouse(GLUT_LEFT_BUTTON, GLUT_DOWN, x, y);
+    } else {
+        motion(x, y);
+    }
+
+    if (--synth_remaining > 0) {
+        glutTimerFunc(SYNTH_INTERVAL_MS, synthInput, 0);
+        return;
+    }
+
+    mouse(GLUT_LEFT_BUTTON, GLUT_UP, x, y);
+    if (render_thread) {
+        pushRender(RENDER_SYNTH_DONE, synth_exit_when_done);
+        return;
+    }
+    latency_print(latency_strict() ? "[strict]" : NULL);
+    if (synth_exit_when_done) exit(0);
+}
+
+void startSynthInput() {
+    if (render_thread) {
+        pushRender(RENDER_SYNTH_START, 0);
+    } else {
+        latency_reset();
+        latency_set_enabled(1);
+    }
+    synth_remaining = SYNTH_EVENTS;
+    glutTimerFunc(SYNTH_INTERVAL_MS, synthInput, 0);
+}
+
+// 動到繪製端狀態（統計、延遲量測、模型的剔除與 LOD 開關）的按鍵，在持有 context 的
+// 執行緒上執行；回傳是否需要重繪
+int renderKey(unsigned char key) {
+    int redraw = 0;
+    if (key == 's' || key == 'S') {
+        GlsCounters c = gls_last_frame();
+        printf("上一格狀態呼叫：送出 %u，略過 %u\n", c.issued, c.elided);
+        if (model_loaded)
+            printf("模型：可見 %u / %u 叢集（LOD 0/1/2/3：%u/%u/%u/%u），%zu 三角形，%u 次繪製\n",
+                   model_stats.clusters_visible, model_stats.clusters_total,
+                   model_stats.clusters_at_level[0], model_stats.clusters_at_level[1],
+                   model_stats.clusters_at_level[2], model_stats.clusters_at_level[3],
+                   model_stats.triangles_drawn, model_stats.draw_calls);
+        if (model_loaded && model_stats.meshlets_tested)
+            printf("背面剔除：%u / %u 個 meshlet 背對鏡頭\n",
+                   model_stats.meshlets_backfacing, model_stats.meshlets_tested);
+        if (model_loaded && model_gl.occlusion.target)
+            printf("遮蔽剔除：略過 %u 個被遮住的叢集，送出 %u 個查詢\n",
+                   model_stats.clusters_occluded, model_stats.occlusion_queries);
+        if (points_loaded)
+            printf("點雲：畫 %u 節點 %zu 點，常駐 %u 節點 %zu 點（預算 %zu），待讀 %u 節點\n",
+                   points_stats.nodes_drawn, points_stats.points_drawn, points_stats.nodes_resident,
+                   points_stats.points_resident, points_gl.budget, points_stats.nodes_wanted);
+    }
+    // l：延遲量測開關（關閉時印出統計），L：strict 模式（swap 後 glFinish），g：合成輸入
+    if (key == 'l') {
+        if (latency_enabled()) latency_print(NULL);
+        else latency_reset();
+        latency_set_enabled(!latency_enabled());
+    }
+    if (key == 'L') latency_set_strict(!latency_strict());
+    // u：模型視錐剔除開關，o：LOD 開關（關閉時全部畫最細層），b：背面剔除開關，h：遮蔽剔除開關
+    if ((key == 'u' || key == 'U') && model_loaded) {
+        model_gl.culling = !model_gl.culling;
+        redraw = 1;
+    }
+    if ((key == 'o' || key == 'O') && model_loaded) {
+        model_gl.lod_pixel_error = model_gl.lod_pixel_error > 0 ? 0.0f : 1.0f;
+        redraw = 1;
+    }
+    if ((key == 'b' || key == 'B') && model_loaded) {
+        model_gl.backface_culling = !model_gl.backface_culling;
+        redraw = 1;
+    }
+    if ((key == 'h' || key == 'H') && model_loaded) {
+        model_gl.occlusion_culling = !model_gl.occlusion_culling;
+        redraw = 1;
+    }
+    return redraw;
+}
+
+void keyboard(unsigned char key, int x, int y) {
+    TRACE_SCOPE("keyboard");
+    if (key && strchr("sSlLuUoObBhH", key)) {
+        if (render_thread) pushRender(RENDER_KEY, key);
+        else if (renderKey(key)) glutPostRedisplay();
+        return;
+    }
+    if (key == 'm' || key == 'M') {
+        momentum_enabled = !momentum_enabled;
+        viewcube_set_momentum(cube, momentum_enabled);
+        if (!momentum_enabled) inertia_stop(&inertia);
+    }
+    if (key == 'g' && synth_remaining == 0) startSynthInput();
+    // f：以目前方向立即框選
+    if (key == 'f' || key == 'F') {
+        float e[3] = { view_rot_x, view_rot_y, view_rot_z };
+        framing = 0;
+        computeFrame(e, &view_frame);
         glutPostRedisplay();
     }
+    // t：開始 / 停止追蹤，停止時輸出 Chrome trace JSON
+    if (key == 't' || key == 'T') {
+        if (!trace_recording) {
+            trace_clear();
+            trace_set_recording(1);
+        } else {
+            trace_set_recording(0);
+            if (trace_dump_json("viewcube_trace.json") == 0)
+                printf("trace 已寫入 viewcube_trace.json\n");
+        }
+    }
 }
 
-void reshape(int w, int h) {
-    glViewport(0, 0, w, h);
+// 渲染執行緒：先處理佇列中的按鍵，再畫最新的快照；點雲節點、遮蔽查詢等還在路上時
+// 回傳 1，讓執行緒每 RENDERTHREAD_POLL_MS 回來輪詢
+int renderFrame(void *user) {
+    TRACE_SCOPE("renderFrame");
+    int redraw = 0, synth_done = 0;
+    RtEvent e;
+    while (rt_queue_pop(&render_queue, &e)) {
+        if (e.type == RENDER_KEY) {
+            redraw |= renderKey((unsigned char)e.a);
+        } else if (e.type == RENDER_SYNTH_START) {
+            latency_reset();
+            latency_set_enabled(1);
+        } else if (e.type == RENDER_SYNTH_DONE) {
+            synth_done = 1 + e.a;
+        }
+    }
+    // 先取時間戳再取快照，畫出的快照一定包含那個輸入；快照已經畫過就重畫一次量它
+    double input = atomic_exchange(&undrawn_input, -1);
+    if (rt_triple_acquire(&snapshots) || input >= 0) redraw = 1;
+    if (points_loaded && points_stats.pending && pointgl_poll(&points_gl) > 0) redraw = 1;
+    if (model_loaded && model_stats.pending && meshgl_poll(&model_gl) > 0) redraw = 1;
+
+    if (redraw) {
+        ViewSnapshot *s = rt_triple_front(&snapshots);
+        if (input >= 0) latency_input(input);
+        latency_frame_begin();
+        renderView(s->rot, &s->frame, s->win_w, s->win_h, s->cube);
+        {
+            TRACE_SCOPE("glXSwapBuffers");
+            glXSwapBuffers(glx_display, glx_drawable);
+            if (latency_enabled() && latency_strict())
+                glFinish();
+            latency_frame_presented(anim_now());
+        }
+        gls_frame_end();
+    }
+    if (synth_done) {
+        latency_print(latency_strict() ? "[strict]" : NULL);
+        if (synth_done > 1) exit(0);
+    }
+    return (points_loaded && points_stats.pending) || (model_loaded && model_stats.pending);
+}
+
+int renderBegin(void *user) {
+    if (!glXMakeCurrent(glx_display, glx_drawable, glx_context)) {
+        fprintf(stderr, "渲染執行緒無法取得 GL context\n");
+        return -1;
+    }
+    return 0;
+}
+
+// 把 GLUT 視窗的 context 交給渲染執行緒；失敗時 context 留在原執行緒，照單執行緒方式畫
+int startRenderThread() {
+    glx_display = glXGetCurrentDisplay();
+    glx_drawable = glXGetCurrentDrawable();
+    glx_context = glXGetCurrentContext();
+    if (!glx_display || !glx_context) {
+        fprintf(stderr, "--render-thread 需要 GLX context\n");
+        return -1;
+    }
+    for (int i = 0; i < 3; ++i) {
+        ViewSnapshot *s = &snapshot_slots[i];
+        s->rot[0] = view_rot_x;
+        s->rot[1] = view_rot_y;
+        s->rot[2] = view_rot_z;
+        s->frame = view_frame;
+        s->win_w = glutGet(GLUT_WINDOW_WIDTH);
+        s->win_h = glutGet(GLUT_WINDOW_HEIGHT);
+        s->cube = viewcube_create();
+        viewcube_copy(s->cube, cube);
+    }
+    rt_queue_init(&render_queue);
+    rt_triple_init(&snapshots, &snapshot_slots[0], &snapshot_slots[1], &snapshot_slots[2]);
+
+    glXMakeCurrent(glx_display, None, NULL);
+    if (renderthread_start(&renderer, renderBegin, renderFrame, NULL, NULL) != 0) {
+        glXMakeCurrent(glx_display, glx_drawable, glx_context);
+        for (int i = 0; i < 3; ++i) viewcube_destroy(snapshot_slots[i].cube);
+        return -1;
+    }
+    return 0;
 }
 
 int main(int argc, char** argv) {
+    // --render-thread：繪製與 GLUT 的輸入處理分在兩個執行緒；Xlib 必須在任何 X 呼叫之前開啟執行緒支援
+    for (int i = 1; i < argc; ++i)
+        if (strcmp(argv[i], "--render-thread") == 0) render_thread = 1;
+    if (render_thread && !XInitThreads()) {
+        fprintf(stderr, "XInitThreads 失敗，改用單執行緒繪製\n");
+        render_thread = 0;
+    }
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(800, 600);
     glutCreateWindow("3D View with ViewCube");
-    glEnable(GL_DEPTH_TEST);
-    
-    generateSubdividedVertices();  // 初始化細分頂點
+    gls_enable(GL_DEPTH_TEST);
+
+    cube = viewcube_create();
+    viewcube_resize(cube, 800, 600);
+    inertia_init(&inertia);
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutMouseFunc(mouse);
     glutMotionFunc(motion);
     glutPassiveMotionFunc(passiveMotion);
+    glutKeyboardFunc(keyboard);
+
+    // --latency-bench [--strict]：無人值守跑一次合成輸入量測後結束
+    // --model FILE：以 STL/OBJ/PLY 模型取代主視圖的立方體（--no-cache 不讀寫 .vcmesh 快取）
+    // --points FILE：LAS/PLY/XYZ 點雲，第一次開啟時轉成 .vcpts 八元樹；--point-budget N：常駐點數上限（百萬）
+    const char *model_path = NULL, *points_path = NULL;
+    double point_budget = 0;
+    int use_cache = 1, latency_bench = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--strict") == 0) latency_set_strict(1);
+        if (strcmp(argv[i], "--latency-bench") == 0) latency_bench = 1;
+        if (strcmp(argv[i], "--no-cache") == 0) use_cache = 0;
+        if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) model_path = argv[++i];
+        if (strcmp(argv[i], "--points") == 0 && i + 1 < argc) points_path = argv[++i];
+        if (strcmp(argv[i], "--point-budget") == 0 && i + 1 < argc) point_budget = atof(argv[++i]);
+    }
+    if (model_path) {
+        MeshLoadStats st;
+        if (meshgl_load(&model_gl, model_path, use_cache, &st) != 0) return 1;
+        printf("模型 %s（%s）：%zu 頂點，%d 三角形，%.1f MB 於 %.3f 秒（%.1f MB/s，%d 執行緒）\n",
+               model_path, st.format, model_gl.vertex_count, model_gl.index_count / 3,
+               st.bytes / 1e6, st.seconds, st.bytes / 1e6 / st.seconds, st.threads);
+        if (model_gl.acmr_after > 0)
+            printf("頂點快取 ACMR：%.3f → %.3f\n", model_gl.acmr_before, model_gl.acmr_after);
+        if (!model_gl.backface_culling)
+            printf("模型不是封閉且方向一致的曲面，不剔除背面（b 可強制開啟）\n");
+        model_loaded = 1;
+    }
+    if (points_path) {
+        PointCloudStats st;
+        if (pointgl_open(&points_gl, points_path, (size_t)(point_budget * 1e6), &st) != 0) return 1;
+        printf("點雲 %s（%s）：%llu 點，%llu 節點，%.1f MB 於 %.3f 秒（%d 執行緒）\n",
+               points_path, st.format, (unsigned long long)st.points,
+               (unsigned long long)points_gl.cloud.header.node_count, st.bytes / 1e6, st.seconds, st.threads);
+        points_loaded = 1;
+    }
+    if (render_thread && startRenderThread() != 0) {
+        fprintf(stderr, "改用單執行緒繪製\n");
+        render_thread = 0;
+    }
+    if (latency_bench) {
+        synth_exit_when_done = 1;
+        startSynthInput();
+    }
 
     glutMainLoop();
+    viewcube_destroy(cube);
     return 0;
-}
\ No newline at end of file
+}
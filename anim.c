@@ -0,0 +1,155 @@
+// anim.c
+#define _POSIX_C_SOURCE 199309L
+#include "anim.h"
+
+#include <math.h>
+#include <time.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define DEG2RAD ((float)M_PI / 180.0f)
+#define RAD2DEG (180.0f / (float)M_PI)
+
+double anim_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static Quat quat_mul(Quat a, Quat b) {
+    Quat r;
+    r.w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z;
+    r.x = a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y;
+    r.y = a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x;
+    r.z = a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w;
+    return r;
+}
+
+static Quat quat_axis(float deg, float ax, float ay, float az) {
+    float h = deg * DEG2RAD * 0.5f;
+    float s = sinf(h);
+    Quat q = { cosf(h), ax * s, ay * s, az * s };
+    return q;
+}
+
+Quat quat_from_euler(float rx, float ry, float rz) {
+    Quat qz = quat_axis(rz, 0, 0, 1);
+    Quat qx = quat_axis(rx, 1, 0, 0);
+    Quat qy = quat_axis(ry, 0, 1, 0);
+    return quat_mul(quat_mul(qz, qx), qy);
+}
+
+void quat_to_euler(Quat q, float *rx, float *ry, float *rz) {
+    // R = Rz(c) * Rx(a) * Ry(b):
+    //   R21 = sin a, R20 = -cos a sin b, R22 = cos a cos b,
+    //   R01 = -sin c cos a, R11 = cos c cos a
+    float r21 = 2.0f * (q.y*q.z + q.w*q.x);
+    float r20 = 2.0f * (q.x*q.z - q.w*q.y);
+    float r22 = 1.0f - 2.0f * (q.x*q.x + q.y*q.y);
+    float r01 = 2.0f * (q.x*q.y - q.w*q.z);
+    float r11 = 1.0f - 2.0f * (q.x*q.x + q.z*q.z);
+
+    if (r21 > 1.0f) r21 = 1.0f;
+    if (r21 < -1.0f) r21 = -1.0f;
+    *rx = asinf(r21) * RAD2DEG;
+
+    if (fabsf(r21) < 0.9999f) {
+        *ry = atan2f(-r20, r22) * RAD2DEG;
+        *rz = atan2f(-r01, r11) * RAD2DEG;
+    } else {
+        // Looking straight up/down: y and z share an axis, keep y = 0.
+        float r10 = 2.0f * (q.x*q.y + q.w*q.z);
+        float r00 = 1.0f - 2.0f * (q.y*q.y + q.z*q.z);
+        *ry = 0.0f;
+        *rz = atan2f(r10, r00) * RAD2DEG;
+    }
+}
+
+Quat quat_slerp(Quat a, Quat b, float t) {
+    float d = a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z;
+    // Take the short way round
+    if (d < 0.0f) {
+        d = -d;
+        b.w = -b.w; b.x = -b.x; b.y = -b.y; b.z = -b.z;
+    }
+
+    float wa, wb;
+    if (d > 0.9995f) {
+        // Nearly parallel: nlerp is accurate and avoids dividing by ~0
+        wa = 1.0f - t;
+        wb = t;
+    } else {
+        float theta = acosf(d);
+        float s = sinf(theta);
+        wa = sinf((1.0f - t) * theta) / s;
+        wb = sinf(t * theta) / s;
+    }
+
+    Quat r = { wa*a.w + wb*b.w, wa*a.x + wb*b.x, wa*a.y + wb*b.y, wa*a.z + wb*b.z };
+    float len = sqrtf(r.w*r.w + r.x*r.x + r.y*r.y + r.z*r.z);
+    r.w /= len; r.x /= len; r.y /= len; r.z /= len;
+    return r;
+}
+
+float anim_ease(EaseType ease, float t) {
+    if (t <= 0.0f) return 0.0f;
+    if (t >= 1.0f) return 1.0f;
+    switch (ease) {
+        case EASE_IN_OUT_CUBIC:
+            return t < 0.5f ? 4.0f*t*t*t
+                            : 1.0f - powf(-2.0f*t + 2.0f, 3.0f) * 0.5f;
+        case EASE_OUT_CUBIC:
+            return 1.0f - powf(1.0f - t, 3.0f);
+        case EASE_IN_OUT_SINE:
+            return 0.5f - 0.5f * cosf((float)M_PI * t);
+        case EASE_LINEAR:
+        default:
+            return t;
+    }
+}
+
+void anim_start(OrientAnim *a, const float from[3], const float to[3],
+                double duration, EaseType ease) {
+    anim_start_at(a, anim_now(), from, to, duration, ease);
+}
+
+void anim_start_at(OrientAnim *a, double now, const float from[3], const float to[3],
+                   double duration, EaseType ease) {
+    a->from = quat_from_euler(from[0], from[1], from[2]);
+    a->to = quat_from_euler(to[0], to[1], to[2]);
+    a->to_euler[0] = to[0];
+    a->to_euler[1] = to[1];
+    a->to_euler[2] = to[2];
+    a->start_time = now;
+    a->duration = duration;
+    a->ease = ease;
+    a->active = 1;
+}
+
+int anim_update(OrientAnim *a, double now, float out[3]) {
+    if (!a->active) return 0;
+
+    float t = a->duration > 0.0 ? (float)((now - a->start_time) / a->duration) : 1.0f;
+    if (t >= 1.0f) {
+        out[0] = a->to_euler[0];
+        out[1] = a->to_euler[1];
+        out[2] = a->to_euler[2];
+        a->active = 0;
+        return 0;
+    }
+
+    Quat q = quat_slerp(a->from, a->to, anim_ease(a->ease, t));
+    quat_to_euler(q, &out[0], &out[1], &out[2]);
+    return 1;
+}
+
+float anim_progress(const OrientAnim *a, double now) {
+    float t = a->duration > 0.0 ? (float)((now - a->start_time) / a->duration) : 1.0f;
+    return anim_ease(a->ease, t);
+}
+
+void anim_cancel(OrientAnim *a) {
+    a->active = 0;
+}
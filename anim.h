@@ -0,0 +1,58 @@
+// anim.h
+// Orientation animation: quaternion slerp between two Euler orientations,
+// driven by a monotonic clock.
+//
+// Euler angles follow the convention used by the ViewCube renderers:
+//   glRotatef(z, 0,0,1); glRotatef(x, 1,0,0); glRotatef(y, 0,1,0);
+// i.e. R = Rz * Rx * Ry, angles in degrees.
+#ifndef ANIM_H
+#define ANIM_H
+
+typedef struct {
+    float w, x, y, z;
+} Quat;
+
+typedef enum {
+    EASE_LINEAR,
+    EASE_IN_OUT_CUBIC,
+    EASE_OUT_CUBIC,
+    EASE_IN_OUT_SINE
+} EaseType;
+
+typedef struct {
+    int active;
+    double start_time;  // seconds, anim_now() clock
+    double duration;    // seconds
+    EaseType ease;
+    Quat from, to;
+    float to_euler[3];  // exact target, written on the final step
+} OrientAnim;
+
+// Monotonic clock in seconds.
+double anim_now(void);
+
+Quat quat_from_euler(float rx, float ry, float rz);
+void quat_to_euler(Quat q, float *rx, float *ry, float *rz);
+Quat quat_slerp(Quat a, Quat b, float t);
+
+float anim_ease(EaseType ease, float t);
+
+// Start (or restart) an animation from the currently displayed orientation.
+// Restarting while active is jump-free as long as `from` is what is on screen.
+void anim_start(OrientAnim *a, const float from[3], const float to[3],
+                double duration, EaseType ease);
+// Same, starting at `now` instead of anim_now() (replays on a virtual clock).
+void anim_start_at(OrientAnim *a, double now, const float from[3], const float to[3],
+                   double duration, EaseType ease);
+
+// Sample the animation at `now` into out[3] (x, y, z degrees).
+// Returns 1 while more frames are needed, 0 once the target has been written.
+int anim_update(OrientAnim *a, double now, float out[3]);
+
+// Eased fraction of the animation done at `now`, 0..1, for things that
+// move in step with it.
+float anim_progress(const OrientAnim *a, double now);
+
+void anim_cancel(OrientAnim *a);
+
+#endif
@@ -0,0 +1,178 @@
+// bench_headless.c
+// Headless rendering benchmark: draws the ViewCube.c scene (main view +
+// libviewcube) into an offscreen framebuffer for every combination of
+// orientation, ViewCube size and hover state, and prints one JSON object
+// per combination plus a summary line.
+//
+// Usage: bench_headless [--frames N] [--width W] [--height H] [--warmup N]
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "anim.h"
+#include "glstate.h"
+#include "headless.h"
+#include "viewcube.h"
+
+static const float orientations[][3] = {
+    {  0,   90, 0}, {  0,  -90, 0}, {-90,    0, 0}, { 90,    0, 0},  // 面
+    {  0,    0, 0}, {  0,  180, 0},
+    { 35.264f,  45, 0}, { 35.264f, 135, 0}, { 35.264f, -45, 0}, { 35.264f, -135, 0},  // 角
+    {-35.264f,  45, 0}, {-35.264f, 135, 0}, {-35.264f, -45, 0}, {-35.264f, -135, 0},
+    { 20, -25, 30}, { 60, 200, -15}                                    // 任意
+};
+#define NUM_ORIENTATIONS (int)(sizeof(orientations) / sizeof(orientations[0]))
+
+static const int cube_sizes[] = { 80, 100, 200, 400 };
+#define NUM_SIZES (int)(sizeof(cube_sizes) / sizeof(cube_sizes[0]))
+
+enum { HOVER_NONE, HOVER_CENTER, HOVER_OFF_CENTER, NUM_HOVER };
+static const char *hover_names[NUM_HOVER] = { "none", "center", "off_center" };
+
+// glutSolidCube needs glutInit, so draw the same cube directly
+static void drawSolidCube(float size) {
+    static const float n[6][3] = { {1,0,0},{-1,0,0},{0,1,0},{0,-1,0},{0,0,1},{0,0,-1} };
+    static const float v[6][4][3] = {
+        { { 1,-1,-1}, { 1, 1,-1}, { 1, 1, 1}, { 1,-1, 1} },
+        { {-1,-1, 1}, {-1, 1, 1}, {-1, 1,-1}, {-1,-1,-1} },
+        { {-1, 1,-1}, {-1, 1, 1}, { 1, 1, 1}, { 1, 1,-1} },
+        { {-1,-1, 1}, {-1,-1,-1}, { 1,-1,-1}, { 1,-1, 1} },
+        { {-1,-1, 1}, { 1,-1, 1}, { 1, 1, 1}, {-1, 1, 1} },
+        { { 1,-1,-1}, {-1,-1,-1}, {-1, 1,-1}, { 1, 1,-1} }
+    };
+    float s = size * 0.5f;
+    glBegin(GL_QUADS);
+    for (int f = 0; f < 6; ++f) {
+        glNormal3fv(n[f]);
+        for (int i = 0; i < 4; ++i)
+            glVertex3f(v[f][i][0] * s, v[f][i][1] * s, v[f][i][2] * s);
+    }
+    glEnd();
+}
+
+// ViewCube.c display() without GLUT
+static void renderFrame(viewcube_t *cube, int w, int h, const float rot[3]) {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glViewport(0, 0, w, h);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(45, (float)w / h, 1, 100);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    gluLookAt(0,0,8, 0,0,0, 0,1,0);
+
+    glPushMatrix();
+    glRotatef(rot[2], 0, 0, 1);
+    glRotatef(rot[0], 1, 0, 0);
+    glRotatef(rot[1], 0, 1, 0);
+    glColor3f(1,1,1);
+    drawSolidCube(2.0f);
+    glPopMatrix();
+
+    viewcube_render(cube);
+    gls_frame_end();
+}
+
+static int cmpDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv) {
+    int frames = 200, warmup = 10;
+    int width = 800, height = 600;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) height = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--frames N] [--warmup N] [--width W] [--height H]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (frames < 1) frames = 1;
+
+    if (headless_init(width, height) != 0)
+        return 1;
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0, 0, 0, 1);
+
+    viewcube_t *cube = viewcube_create();
+    viewcube_set_text_renderer(cube, viewcube_text_builtin, NULL);
+    viewcube_resize(cube, width, height);
+
+    double *times = malloc(sizeof(double) * frames);
+    long total_frames = 0;
+    double total_time = 0;
+    double bench_start = anim_now();
+
+    for (int si = 0; si < NUM_SIZES; ++si) {
+        int size = cube_sizes[si];
+        int margin = 10;
+        viewcube_set_layout(cube, size, margin);
+
+        for (int oi = 0; oi < NUM_ORIENTATIONS; ++oi) {
+            const float *rot = orientations[oi];
+            viewcube_set_orientation(cube, rot[0], rot[1], rot[2]);
+
+            for (int hv = 0; hv < NUM_HOVER; ++hv) {
+                // Pointer in window coordinates (top-left origin)
+                int cx = width - margin - size / 2, cy = margin + size / 2;
+                if (hv == HOVER_NONE) viewcube_pointer_move(cube, 0, height - 1);
+                else if (hv == HOVER_CENTER) viewcube_pointer_move(cube, cx, cy);
+                else viewcube_pointer_move(cube, cx - size * 4 / 25, cy - size * 4 / 25);
+
+                for (int f = 0; f < warmup; ++f)
+                    renderFrame(cube, width, height, rot);
+                glFinish();
+
+                double submit = 0;
+                for (int f = 0; f < frames; ++f) {
+                    double t0 = anim_now();
+                    renderFrame(cube, width, height, rot);
+                    double t1 = anim_now();
+                    glFinish();
+                    double t2 = anim_now();
+                    submit += t1 - t0;
+                    times[f] = (t2 - t0) * 1e3;
+                }
+
+                double sum = 0;
+                for (int f = 0; f < frames; ++f) sum += times[f];
+                qsort(times, frames, sizeof(double), cmpDouble);
+                int hover_type, hover_id;
+                viewcube_get_hover(cube, &hover_type, &hover_id);
+
+                printf("{\"size\":%d,\"orientation\":[%.3f,%.3f,%.3f],\"hover\":\"%s\","
+                       "\"hover_id\":%d,\"frames\":%d,\"fps\":%.1f,\"mean_ms\":%.4f,"
+                       "\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"min_ms\":%.4f,\"max_ms\":%.4f,"
+                       "\"submit_ms\":%.4f}\n",
+                       size, rot[0], rot[1], rot[2], hover_names[hv], hover_id, frames,
+                       frames / (sum * 1e-3), sum / frames,
+                       times[frames / 2], times[(int)(frames * 0.95)],
+                       times[0], times[frames - 1], submit * 1e3 / frames);
+
+                total_frames += frames;
+                total_time += sum * 1e-3;
+            }
+        }
+    }
+
+    GlsCounters gc = gls_last_frame();
+    printf("{\"summary\":true,\"renderer\":\"%s\",\"width\":%d,\"height\":%d,"
+           "\"configs\":%d,\"frames\":%ld,\"fps\":%.1f,\"wall_s\":%.3f,"
+           "\"state_calls_issued\":%u,\"state_calls_elided\":%u}\n",
+           headless_renderer(), width, height, NUM_SIZES * NUM_ORIENTATIONS * NUM_HOVER,
+           total_frames, total_frames / total_time, anim_now() - bench_start,
+           gc.issued, gc.elided);
+
+    free(times);
+    viewcube_destroy(cube);
+    headless_shutdown();
+    return 0;
+}
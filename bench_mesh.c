@@ -0,0 +1,214 @@
+// bench_mesh.c
+// Mesh loader throughput: writes a synthetic UV sphere as binary STL, ASCII
+// STL, OBJ, ASCII PLY and binary PLY, loads each one and prints a JSON line
+// with the load time and MB/s, then the time to write and reopen its
+// .vcmesh cache. With file arguments, loads those instead (their caches
+// are left in place).
+//
+// Usage: bench_mesh [--segments N] [--threads N] [--dir DIR] [--runs N] [FILE...]
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mesh.h"
+#include "meshcache.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+    float *v;
+    unsigned *f;
+    size_t nv, nf;
+} Sphere;
+
+static void makeSphere(Sphere *s, int seg) {
+    int rings = seg / 2;
+    s->nv = (size_t)(rings + 1) * (seg + 1);
+    s->nf = (size_t)rings * seg * 2;
+    s->v = malloc(sizeof(float) * 3 * s->nv);
+    s->f = malloc(sizeof(unsigned) * 3 * s->nf);
+    size_t k = 0;
+    for (int r = 0; r <= rings; ++r) {
+        double th = M_PI * r / rings;
+        for (int i = 0; i <= seg; ++i) {
+            double ph = 2 * M_PI * (i % seg) / seg;   // seam shares positions
+            s->v[k++] = (float)(sin(th) * cos(ph));
+            s->v[k++] = (float)cos(th);
+            s->v[k++] = (float)(sin(th) * sin(ph));
+        }
+    }
+    k = 0;
+    for (int r = 0; r < rings; ++r) {
+        for (int i = 0; i < seg; ++i) {
+            unsigned a = r * (seg + 1) + i, b = a + seg + 1;
+            s->f[k++] = a; s->f[k++] = b; s->f[k++] = a + 1;
+            s->f[k++] = a + 1; s->f[k++] = b; s->f[k++] = b + 1;
+        }
+    }
+}
+
+static FILE *create(const char *dir, const char *name, char *path, size_t n) {
+    snprintf(path, n, "%s/%s", dir, name);
+    FILE *fp = fopen(path, "wb");
+    if (!fp) fprintf(stderr, "cannot write %s\n", path);
+    return fp;
+}
+
+static int writeFiles(const Sphere *s, const char *dir, char paths[5][512]) {
+    FILE *fp;
+    if (!(fp = create(dir, "bench_sphere.stl", paths[0], 512))) return -1;
+    char header[80] = "bench_mesh sphere";
+    uint32_t n = (uint32_t)s->nf;
+    fwrite(header, 1, 80, fp);
+    fwrite(&n, 4, 1, fp);
+    for (size_t t = 0; t < s->nf; ++t) {
+        float rec[12] = {0};
+        uint16_t attr = 0;
+        for (int c = 0; c < 3; ++c) memcpy(rec + 3 + 3 * c, s->v + 3 * s->f[3 * t + c], 12);
+        fwrite(rec, 4, 12, fp);
+        fwrite(&attr, 2, 1, fp);
+    }
+    fclose(fp);
+
+    if (!(fp = create(dir, "bench_sphere_ascii.stl", paths[1], 512))) return -1;
+    fprintf(fp, "solid sphere\n");
+    for (size_t t = 0; t < s->nf; ++t) {
+        fprintf(fp, "  facet normal 0 0 0\n    outer loop\n");
+        for (int c = 0; c < 3; ++c) {
+            const float *v = s->v + 3 * s->f[3 * t + c];
+            fprintf(fp, "      vertex %.7g %.7g %.7g\n", v[0], v[1], v[2]);
+        }
+        fprintf(fp, "    endloop\n  endfacet\n");
+    }
+    fprintf(fp, "endsolid sphere\n");
+    fclose(fp);
+
+    if (!(fp = create(dir, "bench_sphere.obj", paths[2], 512))) return -1;
+    for (size_t i = 0; i < s->nv; ++i)
+        fprintf(fp, "v %.7g %.7g %.7g\n", s->v[3 * i], s->v[3 * i + 1], s->v[3 * i + 2]);
+    for (size_t t = 0; t < s->nf; ++t)
+        fprintf(fp, "f %u %u %u\n", s->f[3 * t] + 1, s->f[3 * t + 1] + 1, s->f[3 * t + 2] + 1);
+    fclose(fp);
+
+    for (int binary = 0; binary < 2; ++binary) {
+        if (!(fp = create(dir, binary ? "bench_sphere_binary.ply" : "bench_sphere.ply", paths[3 + binary], 512)))
+            return -1;
+        fprintf(fp, "ply\nformat %s 1.0\nelement vertex %zu\nproperty float x\nproperty float y\n"
+                    "property float z\nelement face %zu\nproperty list uchar int vertex_indices\nend_header\n",
+                binary ? "binary_little_endian" : "ascii", s->nv, s->nf);
+        for (size_t i = 0; i < s->nv; ++i) {
+            if (binary) fwrite(s->v + 3 * i, 4, 3, fp);
+            else fprintf(fp, "%.7g %.7g %.7g\n", s->v[3 * i], s->v[3 * i + 1], s->v[3 * i + 2]);
+        }
+        for (size_t t = 0; t < s->nf; ++t) {
+            const unsigned *f = s->f + 3 * t;
+            if (binary) {
+                unsigned char three = 3;
+                fwrite(&three, 1, 1, fp);
+                fwrite(f, 4, 3, fp);
+            } else {
+                fprintf(fp, "3 %u %u %u\n", f[0], f[1], f[2]);
+            }
+        }
+        fclose(fp);
+    }
+    return 0;
+}
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int bench(const char *path, int runs, size_t expect_tris) {
+    Mesh m;
+    MeshLoadStats st;
+    double best = 1e30;
+    for (int r = 0; r < runs; ++r) {
+        if (mesh_load(path, &m, &st) != 0) return -1;
+        if (st.seconds < best) best = st.seconds;
+        if (r + 1 < runs) mesh_free(&m);
+    }
+    int ok = !expect_tris || m.triangle_count == expect_tris;
+    if (!ok) fprintf(stderr, "%s: expected %zu triangles\n", path, expect_tris);
+
+    // Cache: write once, then time the validated reopen (hash included)
+    double t0 = seconds();
+    if (meshcache_write(path, &m) != 0) ok = 0;
+    double write_s = seconds() - t0, open_s = 1e30;
+    MeshCache c = {0};
+    for (int r = 0; r < runs && ok; ++r) {
+        t0 = seconds();
+        if (meshcache_open(path, &c) != 0) {
+            fprintf(stderr, "%s: cache did not validate\n", path);
+            ok = 0;
+            break;
+        }
+        if (seconds() - t0 < open_s) open_s = seconds() - t0;
+        if (r + 1 < runs) meshcache_close(&c);
+    }
+    printf("{\"file\":\"%s\",\"format\":\"%s\",\"threads\":%d,\"bytes\":%zu,\"vertices\":%zu,"
+           "\"triangles\":%zu,\"seconds\":%.4f,\"mb_per_s\":%.1f",
+           path, st.format, st.threads, st.bytes, m.vertex_count, m.triangle_count,
+           best, st.bytes / best / 1e6);
+    if (c.header)
+        printf(",\"cache_bytes\":%zu,\"cache_vertices\":%llu,\"cache_triangles\":%llu,"
+               "\"cache_dropped_triangles\":%llu,"
+               "\"cache_write_s\":%.4f,\"cache_open_s\":%.4f,\"speedup\":%.1f,"
+               "\"acmr_before\":%.3f,\"acmr_after\":%.3f",
+               c.map_size, (unsigned long long)c.header->vertex_count,
+               (unsigned long long)c.header->triangle_count,
+               (unsigned long long)(m.triangle_count - c.header->triangle_count),
+               write_s, open_s, best / open_s,
+               c.header->acmr_before, c.header->acmr_after);
+    printf("}\n");
+    meshcache_close(&c);
+    mesh_free(&m);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    int segments = 512, runs = 3, nfiles = 0;
+    const char *dir = "/tmp";
+    const char *files[64];
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--segments") == 0 && i + 1 < argc) segments = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) mesh_set_threads(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && nfiles < 64) files[nfiles++] = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [--segments N] [--threads N] [--dir DIR] [--runs N] [FILE...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (runs < 1) runs = 1;
+    if (segments < 4) segments = 4;
+
+    int failed = 0;
+    if (nfiles) {
+        for (int i = 0; i < nfiles; ++i) failed |= bench(files[i], runs, 0) != 0;
+        return failed;
+    }
+
+    Sphere s;
+    char paths[5][512];
+    makeSphere(&s, segments);
+    if (writeFiles(&s, dir, paths) != 0) return 1;
+    for (int i = 0; i < 5; ++i) failed |= bench(paths[i], runs, s.nf) != 0;
+    for (int i = 0; i < 5; ++i) {
+        char cache[600];
+        remove(paths[i]);
+        if (meshcache_path(paths[i], cache, sizeof(cache)) == 0) remove(cache);
+    }
+    free(s.v);
+    free(s.f);
+    return failed;
+}
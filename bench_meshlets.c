@@ -0,0 +1,278 @@
+// bench_meshlets.c
+// Meshlet backface culling from the 26 ViewCube directions (6 faces, 12
+// edges, 8 corners): prepares a UV sphere and a finely tessellated box the
+// way meshgl_upload does (normals, Morton clusters, meshopt), builds
+// meshlets and prints a JSON line per shape with their average size, the
+// build time, whether meshlet_closed lets the mesh be culled at all, the
+// cull cost per meshlet and, per kind of direction, the
+// share of triangles rejected against the share that truly face away.
+// Every rejected triangle is checked against the camera; one that faces it
+// fails the run. With file arguments, measures those instead.
+//
+// Usage: bench_meshlets [--triangles N] [--threads N] [FILE...]
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bvh.h"
+#include "mesh.h"
+#include "meshcache.h"
+#include "meshlet.h"
+#include "meshopt.h"
+#include "parallel.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int alloc(Mesh *m, size_t nv, size_t nf) {
+    memset(m, 0, sizeof(*m));
+    m->vertex_count = nv;
+    m->triangle_count = nf;
+    m->positions = malloc(sizeof(float) * 3 * nv);
+    m->indices = malloc(sizeof(unsigned) * 3 * nf);
+    return m->positions && m->indices ? 0 : -1;
+}
+
+static void setBounds(Mesh *m) {
+    for (int a = 0; a < 3; ++a) {
+        m->bounds_min[a] = INFINITY;
+        m->bounds_max[a] = -INFINITY;
+    }
+    for (size_t i = 0; i < 3 * m->vertex_count; ++i) {
+        if (m->positions[i] < m->bounds_min[i % 3]) m->bounds_min[i % 3] = m->positions[i];
+        if (m->positions[i] > m->bounds_max[i % 3]) m->bounds_max[i % 3] = m->positions[i];
+    }
+}
+
+// Unit sphere, counter-clockwise from outside
+static int makeSphere(Mesh *m, size_t triangles) {
+    int seg = (int)ceil(sqrt((double)triangles));
+    if (seg < 8) seg = 8;
+    int rings = seg / 2;
+    if (alloc(m, (size_t)(rings + 1) * (seg + 1), (size_t)rings * seg * 2) != 0) return -1;
+    size_t k = 0;
+    for (int r = 0; r <= rings; ++r) {
+        double th = M_PI * r / rings;
+        double st = r == rings ? 0 : sin(th);    // sin(M_PI) is not 0: one south pole
+        for (int i = 0; i <= seg; ++i) {
+            double ph = 2 * M_PI * (i % seg) / seg;
+            m->positions[k++] = (float)(st * cos(ph));
+            m->positions[k++] = (float)cos(th);
+            m->positions[k++] = (float)(st * sin(ph));
+        }
+    }
+    k = 0;
+    for (int r = 0; r < rings; ++r) {
+        for (int i = 0; i < seg; ++i) {
+            unsigned a = r * (seg + 1) + i, b = a + seg + 1;
+            m->indices[k++] = a; m->indices[k++] = a + 1; m->indices[k++] = b;
+            m->indices[k++] = a + 1; m->indices[k++] = b + 1; m->indices[k++] = b;
+        }
+    }
+    setBounds(m);
+    return 0;
+}
+
+// 2 x 1 x 0.5 box, each face an n x n grid, counter-clockwise from outside
+static int makeBox(Mesh *m, size_t triangles) {
+    int n = (int)ceil(sqrt(triangles / 12.0));
+    if (n < 1) n = 1;
+    size_t per_face = (size_t)(n + 1) * (n + 1);
+    if (alloc(m, 6 * per_face, 12 * (size_t)n * n) != 0) return -1;
+    static const float half[3] = { 1.0f, 0.5f, 0.25f };
+    size_t v = 0, k = 0;
+    for (int f = 0; f < 6; ++f) {
+        int axis = f / 2, u = (axis + 1) % 3, w = (axis + 2) % 3;
+        float side = f & 1 ? -1.0f : 1.0f;
+        unsigned base = (unsigned)v;
+        for (int j = 0; j <= n; ++j) {
+            for (int i = 0; i <= n; ++i, ++v) {
+                float *p = m->positions + 3 * v;
+                p[axis] = side * half[axis];
+                p[u] = half[u] * (2.0f * i / n - 1);
+                p[w] = half[w] * (2.0f * j / n - 1);
+            }
+        }
+        // u x w is +axis: flip the winding on the negative side
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                unsigned a = base + j * (n + 1) + i, b = a + n + 1;
+                unsigned q[6] = { a, a + 1, b + 1, a, b + 1, b };
+                if (side < 0) {
+                    q[1] = b + 1; q[2] = a + 1;
+                    q[4] = b; q[5] = b + 1;
+                }
+                for (int t = 0; t < 6; ++t) m->indices[k++] = q[t];
+            }
+        }
+    }
+    setBounds(m);
+    return 0;
+}
+
+// What meshgl_upload does before its clusters are fixed
+static int prepare(Mesh *m) {
+    if (mesh_compute_normals(m, MESH_CREASE_DEGREES) != 0) return -1;
+    bvh_sort_triangles(m->positions, m->indices, m->triangle_count, m->bounds_min, m->bounds_max);
+    return meshopt_optimize(m, MESHCACHE_CHUNK_TRIANGLES, NULL);
+}
+
+// Cosine between triangle t's normal and the direction to the camera
+// (homogeneous, as for meshlet_cull); 0 for zero-area triangles
+static double facing(const Mesh *m, size_t t, const float eye[4]) {
+    const float *p0 = m->positions + 3 * (size_t)m->indices[3 * t];
+    const float *p1 = m->positions + 3 * (size_t)m->indices[3 * t + 1];
+    const float *p2 = m->positions + 3 * (size_t)m->indices[3 * t + 2];
+    double e1[3], e2[3], v[3];
+    for (int a = 0; a < 3; ++a) {
+        e1[a] = (double)p1[a] - p0[a];
+        e2[a] = (double)p2[a] - p0[a];
+        v[a] = eye[a] - (double)eye[3] * p0[a];
+    }
+    double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+    double len = sqrt((n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+    return len > 0 ? (n[0] * v[0] + n[1] * v[1] + n[2] * v[2]) / len : 0;
+}
+
+static int bench(const char *name, Mesh *m) {
+    if (prepare(m) != 0) return -1;
+    uint32_t clusters = (uint32_t)((m->triangle_count + MESHCACHE_CHUNK_TRIANGLES - 1) / MESHCACHE_CHUNK_TRIANGLES);
+    uint32_t *first = malloc(sizeof(uint32_t) * ((size_t)clusters + 1));
+    MeshletSet s;
+    double t0 = seconds();
+    if (first)
+        for (uint32_t c = 0; c <= clusters; ++c)
+            first[c] = (uint32_t)(c == clusters ? m->triangle_count : (size_t)c * MESHCACHE_CHUNK_TRIANGLES);
+    if (!first || meshlet_build(&s, m->positions, m->indices, first, clusters) != 0) {
+        fprintf(stderr, "%s: out of memory building meshlets\n", name);
+        free(first);
+        return -1;
+    }
+    double build_s = seconds() - t0;
+    free(first);
+    t0 = seconds();
+    int closed = meshlet_closed(m->positions, m->vertex_count, m->indices, m->triangle_count);
+    double closed_s = seconds() - t0;
+
+    // Average distinct vertices per meshlet, and per cluster: meshlets never
+    // cross a cluster, so the latter bounds how full they can get
+    size_t vertex_total = 0, cluster_vertex_total = 0;
+    unsigned *stamp = calloc(m->vertex_count ? m->vertex_count : 1, sizeof(unsigned));
+    for (uint32_t i = 0; stamp && i < s.count; ++i) {
+        for (size_t k = 3 * (size_t)s.first[i]; k < 3 * (size_t)s.first[i + 1]; ++k) {
+            if (stamp[m->indices[k]] == i + 1) continue;
+            stamp[m->indices[k]] = i + 1;
+            vertex_total++;
+        }
+    }
+    for (uint32_t c = 0; stamp && c < clusters; ++c) {
+        size_t end = c + 1 == clusters ? m->triangle_count : (size_t)(c + 1) * MESHCACHE_CHUNK_TRIANGLES;
+        for (size_t k = 3 * (size_t)c * MESHCACHE_CHUNK_TRIANGLES; k < 3 * end; ++k) {
+            if (stamp[m->indices[k]] == s.count + 1 + c) continue;
+            stamp[m->indices[k]] = s.count + 1 + c;
+            cluster_vertex_total++;
+        }
+    }
+    free(stamp);
+
+    // Camera at three times the bounding radius, looking at the centre
+    float c[3], radius = 0;
+    for (int a = 0; a < 3; ++a) {
+        c[a] = 0.5f * (m->bounds_min[a] + m->bounds_max[a]);
+        float h = 0.5f * (m->bounds_max[a] - m->bounds_min[a]);
+        radius += h * h;
+    }
+    radius = sqrtf(radius);
+    unsigned char *front = malloc(s.count ? s.count : 1);
+    double culled[3] = { 0 }, backfacing[3] = { 0 }, cull_s = 0;
+    int views[3] = { 0 }, errors = 0;
+    for (int d = 0; d < 27 && front; ++d) {
+        int dir[3] = { d % 3 - 1, d / 3 % 3 - 1, d / 9 - 1 };
+        int kind = abs(dir[0]) + abs(dir[1]) + abs(dir[2]) - 1;   // face, edge, corner
+        if (kind < 0) continue;
+        float len = sqrtf((float)(kind + 1)), eye[4] = { 0, 0, 0, 1 };
+        for (int a = 0; a < 3; ++a) eye[a] = c[a] + 3 * radius * dir[a] / len;
+
+        t0 = seconds();
+        int reps = 0;
+        do {
+            meshlet_cull(&s, eye, 0, s.count, front);
+            reps++;
+        } while (seconds() - t0 < 0.02);
+        cull_s += (seconds() - t0) / reps;
+
+        size_t rejected = 0, away = 0;
+        for (uint32_t i = 0; i < s.count; ++i) {
+            for (size_t t = s.first[i]; t < s.first[i + 1]; ++t) {
+                double f = facing(m, t, eye);
+                if (f <= 0) away++;
+                if (front[i]) continue;
+                rejected++;
+                if (f > 1e-6) errors++;
+            }
+        }
+        culled[kind] += (double)rejected / m->triangle_count;
+        backfacing[kind] += (double)away / m->triangle_count;
+        views[kind]++;
+    }
+    free(front);
+    if (errors) fprintf(stderr, "%s: %d front-facing triangles rejected\n", name, errors);
+
+    printf("{\"shape\":\"%s\",\"threads\":%d,\"triangles\":%zu,\"meshlets\":%u,\"avg_vertices\":%.1f,"
+           "\"avg_triangles\":%.1f,\"avg_cluster_vertices\":%.1f,\"build_ms\":%.2f,\"closed\":%d,\"closed_ms\":%.2f,"
+           "\"cull_ns_per_meshlet\":%.2f",
+           name, parallel_threads(), m->triangle_count, s.count, s.count ? (double)vertex_total / s.count : 0,
+           s.count ? (double)m->triangle_count / s.count : 0,
+           clusters ? (double)cluster_vertex_total / clusters : 0, build_s * 1e3, closed, closed_s * 1e3,
+           s.count ? cull_s / 26 / s.count * 1e9 : 0);
+    static const char *kinds[3] = { "face", "edge", "corner" };
+    for (int k = 0; k < 3; ++k)
+        printf(",\"%s_rejected\":%.3f,\"%s_backfacing\":%.3f", kinds[k], culled[k] / views[k],
+               kinds[k], backfacing[k] / views[k]);
+    printf(",\"errors\":%d}\n", errors);
+    meshlet_free(&s);
+    return errors ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+    size_t triangles = 1000000;
+    int files = 0, failed = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) triangles = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) parallel_set_threads(atoi(argv[++i]));
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--triangles N] [--threads N] [FILE...]\n", argv[0]);
+            return 2;
+        } else {
+            Mesh m;
+            if (mesh_load(argv[i], &m, NULL) != 0) {
+                failed = 1;
+                continue;
+            }
+            failed |= bench(argv[i], &m) != 0;
+            mesh_free(&m);
+            files = 1;
+        }
+    }
+    if (files || failed) return failed;
+
+    Mesh m;
+    if (makeSphere(&m, triangles) != 0) return 1;
+    failed |= bench("sphere", &m) != 0;
+    mesh_free(&m);
+    if (makeBox(&m, triangles) != 0) return 1;
+    failed |= bench("box", &m) != 0;
+    mesh_free(&m);
+    return failed;
+}
@@ -0,0 +1,140 @@
+// bench_normals.c
+// Normal generation scaling: builds a UV sphere with its poles flattened
+// into caps (so the rims are 60 degree creases that must split), then
+// times normals_compute at 1, 2, 4, ... threads up to --threads and prints
+// a JSON line per count with the time, Mtri/s and speedup over one thread.
+// Every run must give byte-identical output; a mismatch fails the run.
+//
+// Usage: bench_normals [--triangles N] [--threads N] [--crease DEG] [--runs N]
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "normals.h"
+#include "parallel.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+typedef struct {
+    float *x, *y, *z;
+    unsigned *f;
+    size_t nv, nf;
+} Shape;
+
+static int makeShape(Shape *s, size_t triangles) {
+    int seg = (int)ceil(sqrt((double)triangles));
+    if (seg < 8) seg = 8;
+    int rings = seg / 2;
+    s->nv = (size_t)(rings + 1) * (seg + 1);
+    s->nf = (size_t)rings * seg * 2;
+    s->x = malloc(sizeof(float) * s->nv);
+    s->y = malloc(sizeof(float) * s->nv);
+    s->z = malloc(sizeof(float) * s->nv);
+    s->f = malloc(sizeof(unsigned) * 3 * s->nf);
+    if (!s->x || !s->y || !s->z || !s->f) return -1;
+    size_t k = 0;
+    for (int r = 0; r <= rings; ++r) {
+        double th = M_PI * r / rings, y = cos(th);
+        for (int i = 0; i <= seg; ++i, ++k) {
+            double ph = 2 * M_PI * (i % seg) / seg;
+            s->x[k] = (float)(sin(th) * cos(ph));
+            s->y[k] = (float)(y > 0.5 ? 0.5 : y < -0.5 ? -0.5 : y);
+            s->z[k] = (float)(sin(th) * sin(ph));
+        }
+    }
+    k = 0;
+    for (int r = 0; r < rings; ++r) {
+        for (int i = 0; i < seg; ++i) {
+            unsigned a = r * (seg + 1) + i, b = a + seg + 1;
+            s->f[k++] = a; s->f[k++] = b; s->f[k++] = a + 1;
+            s->f[k++] = a + 1; s->f[k++] = b; s->f[k++] = b + 1;
+        }
+    }
+    return 0;
+}
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t fnv(uint64_t h, const void *p, size_t n) {
+    const unsigned char *b = p;
+    for (size_t i = 0; i < n; ++i) h = (h ^ b[i]) * 0x100000001b3ull;
+    return h;
+}
+
+static uint64_t digest(const NormalsOutput *o, size_t nf) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    h = fnv(h, o->indices, sizeof(unsigned) * 3 * nf);
+    h = fnv(h, o->source, sizeof(unsigned) * o->vertex_count);
+    h = fnv(h, o->nx, sizeof(float) * o->vertex_count);
+    h = fnv(h, o->ny, sizeof(float) * o->vertex_count);
+    return fnv(h, o->nz, sizeof(float) * o->vertex_count);
+}
+
+int main(int argc, char **argv) {
+    size_t triangles = 10000000;
+    int max_threads = parallel_threads(), runs = 3;
+    float crease = 45.0f;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) triangles = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) max_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--crease") == 0 && i + 1 < argc) crease = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--triangles N] [--threads N] [--crease DEG] [--runs N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (runs < 1) runs = 1;
+    if (max_threads < 1) max_threads = 1;
+
+    Shape s;
+    if (makeShape(&s, triangles) != 0) {
+        fprintf(stderr, "out of memory building %zu triangles\n", triangles);
+        return 1;
+    }
+    NormalsInput in = { s.x, s.y, s.z, s.nv, s.f, s.nf };
+
+    double base = 0;
+    uint64_t expect = 0;
+    int failed = 0;
+    for (int threads = 1;; threads *= 2) {
+        if (threads > max_threads) threads = max_threads;
+        parallel_set_threads(threads);
+        double best = 1e30;
+        NormalsOutput out;
+        for (int r = 0; r < runs; ++r) {
+            double t0 = seconds();
+            if (normals_compute(&in, crease, &out) != 0) return 1;
+            double t = seconds() - t0;
+            if (t < best) best = t;
+            uint64_t h = digest(&out, s.nf);
+            if (!expect) expect = h;
+            if (h != expect) {
+                fprintf(stderr, "output differs at %d threads\n", threads);
+                failed = 1;
+            }
+            if (r + 1 < runs) normals_free(&out);
+        }
+        if (threads == 1) base = best;
+        printf("{\"threads\":%d,\"triangles\":%zu,\"vertices_in\":%zu,\"vertices_out\":%zu,"
+               "\"seconds\":%.4f,\"mtri_per_s\":%.1f,\"speedup\":%.2f}\n",
+               threads, s.nf, s.nv, out.vertex_count, best, s.nf / best / 1e6, base / best);
+        normals_free(&out);
+        if (threads == max_threads) break;
+    }
+    free(s.x);
+    free(s.y);
+    free(s.z);
+    free(s.f);
+    return failed;
+}
@@ -0,0 +1,346 @@
+// bench_occlusion.c
+// Occlusion culling on a synthetic assembly: a closed housing around a
+// grid of densely tessellated parts, the case where most of the model is
+// hidden. Renders headless (EGL, llvmpipe without a GPU) through
+// meshgl_draw, full detail, in two passes:
+//
+// - static views from the 26 ViewCube directions: drawn until every
+//   cluster has been queried from there, then timed with occlusion culling on and off; the settled
+//   image must match the one drawn without it pixel for pixel;
+// - an orbit around the model, one step per frame: every frame is drawn
+//   with and without occlusion culling and compared, so the pixels lost to
+//   results arriving a frame late are counted.
+//
+// Prints a JSON line per pass with the clusters skipped and triangles
+// drawn per frame, and the frame times. A static view whose image differs
+// fails the run. With file arguments, measures those models instead.
+//
+// Usage: bench_occlusion [--triangles N] [--width W] [--height H] [--frames N] [FILE...]
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "glstate.h"
+#include "headless.h"
+#include "meshgl.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define ORBIT_STEPS 90
+#define SETTLE_FRAMES (OCCLUSION_RETEST_FRAMES + 2)
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// --- Assembly ---
+
+typedef struct {
+    Mesh *m;
+    size_t v, t;
+} Builder;
+
+static void setBounds(Mesh *m) {
+    for (int a = 0; a < 3; ++a) {
+        m->bounds_min[a] = INFINITY;
+        m->bounds_max[a] = -INFINITY;
+    }
+    for (size_t i = 0; i < 3 * m->vertex_count; ++i) {
+        if (m->positions[i] < m->bounds_min[i % 3]) m->bounds_min[i % 3] = m->positions[i];
+        if (m->positions[i] > m->bounds_max[i % 3]) m->bounds_max[i % 3] = m->positions[i];
+    }
+}
+
+// Box with the given centre and half extents, each face an n x n grid,
+// counter-clockwise from outside
+static void addBox(Builder *b, const float c[3], const float half[3], int n) {
+    for (int f = 0; f < 6; ++f) {
+        int axis = f / 2, u = (axis + 1) % 3, w = (axis + 2) % 3;
+        float side = f & 1 ? -1.0f : 1.0f;
+        unsigned base = (unsigned)b->v;
+        for (int j = 0; j <= n; ++j) {
+            for (int i = 0; i <= n; ++i) {
+                float *p = b->m->positions + 3 * b->v++;
+                p[axis] = c[axis] + side * half[axis];
+                p[u] = c[u] + half[u] * (2.0f * i / n - 1);
+                p[w] = c[w] + half[w] * (2.0f * j / n - 1);
+            }
+        }
+        // u x w is +axis: flip the winding on the negative side
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                unsigned a = base + j * (n + 1) + i, d = a + n + 1;
+                unsigned q[6] = { a, a + 1, d + 1, a, d + 1, d };
+                if (side < 0) {
+                    q[1] = d + 1; q[2] = a + 1;
+                    q[4] = d; q[5] = d + 1;
+                }
+                memcpy(b->m->indices + 3 * b->t, q, sizeof(q));
+                b->t += 2;
+            }
+        }
+    }
+}
+
+// UV sphere with seg segments and seg / 2 rings, counter-clockwise from outside
+static void addSphere(Builder *b, const float c[3], float r, int seg) {
+    int rings = seg / 2;
+    unsigned base = (unsigned)b->v;
+    for (int k = 0; k <= rings; ++k) {
+        double th = M_PI * k / rings;
+        double st = k == rings ? 0 : sin(th);    // sin(M_PI) is not 0: one south pole
+        for (int i = 0; i <= seg; ++i) {
+            double ph = 2 * M_PI * (i % seg) / seg;
+            float *p = b->m->positions + 3 * b->v++;
+            p[0] = c[0] + r * (float)(st * cos(ph));
+            p[1] = c[1] + r * (float)cos(th);
+            p[2] = c[2] + r * (float)(st * sin(ph));
+        }
+    }
+    for (int k = 0; k < rings; ++k) {
+        for (int i = 0; i < seg; ++i) {
+            unsigned a = base + k * (seg + 1) + i, d = a + seg + 1;
+            unsigned q[6] = { a, a + 1, d, a + 1, d + 1, d };
+            memcpy(b->m->indices + 3 * b->t, q, sizeof(q));
+            b->t += 2;
+        }
+    }
+}
+
+// Housing of 2 x 1.2 x 1.6 with a 5 x 3 x 4 grid of parts inside; about a
+// tenth of the triangles are the housing's
+static int makeAssembly(Mesh *m, size_t triangles) {
+    enum { PX = 5, PY = 3, PZ = 4 };
+    int n = (int)ceil(sqrt(triangles * 0.1 / 12));
+    int seg = (int)ceil(sqrt(triangles * 0.9 / (PX * PY * PZ)));
+    if (n < 1) n = 1;
+    if (seg < 8) seg = 8;
+    seg &= ~1;
+    size_t nv = 6 * (size_t)(n + 1) * (n + 1) + (size_t)PX * PY * PZ * (seg / 2 + 1) * (seg + 1);
+    size_t nf = 12 * (size_t)n * n + (size_t)PX * PY * PZ * seg * seg;
+    memset(m, 0, sizeof(*m));
+    m->positions = malloc(sizeof(float) * 3 * nv);
+    m->indices = malloc(sizeof(unsigned) * 3 * nf);
+    if (!m->positions || !m->indices) return -1;
+    m->vertex_count = nv;
+    m->triangle_count = nf;
+
+    Builder b = { m, 0, 0 };
+    const float origin[3] = { 0, 0, 0 }, half[3] = { 1.0f, 0.6f, 0.8f };
+    addBox(&b, origin, half, n);
+    for (int z = 0; z < PZ; ++z) {
+        for (int y = 0; y < PY; ++y) {
+            for (int x = 0; x < PX; ++x) {
+                float c[3] = { -0.72f + 0.36f * x, -0.36f + 0.36f * y, -0.54f + 0.36f * z };
+                addSphere(&b, c, 0.15f, seg);
+            }
+        }
+    }
+    setBounds(m);
+    return 0;
+}
+
+// --- Rendering ---
+
+typedef struct {
+    int width, height;
+    unsigned char *image, *reference;
+} Target;
+
+// The ViewCube.c main view, looking at the model from eye
+static double drawFrame(MeshGL *g, const float eye[3], MeshDrawStats *st) {
+    double t0 = seconds();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    // Straight up or down: any other up vector will do
+    int vertical = fabsf(eye[0]) < 1e-4f && fabsf(eye[2]) < 1e-4f;
+    gluLookAt(eye[0], eye[1], eye[2], 0, 0, 0, 0, vertical ? 0 : 1, vertical ? -1 : 0);
+    glColor3f(1, 1, 1);
+    meshgl_draw(g, 2.0f, st);
+    glFinish();
+    gls_frame_end();
+    return seconds() - t0;
+}
+
+static size_t differing(const Target *t) {
+    size_t n = 0;
+    for (size_t i = 0; i < (size_t)t->width * t->height; ++i)
+        n += memcmp(t->image + 4 * i, t->reference + 4 * i, 4) != 0;
+    return n;
+}
+
+typedef struct {
+    double ms, triangles, occluded, queries, visible;
+    int frames;
+} Tally;
+
+static void count(Tally *t, double s, const MeshDrawStats *st) {
+    t->ms += s * 1e3;
+    t->triangles += (double)st->triangles_drawn;
+    t->occluded += st->clusters_occluded;
+    t->queries += st->occlusion_queries;
+    t->visible += st->clusters_visible;
+    t->frames++;
+}
+
+static void printTally(const char *key, const Tally *t) {
+    int n = t->frames ? t->frames : 1;
+    printf(",\"%s\":{\"ms\":%.2f,\"triangles\":%.0f,\"clusters_in_frustum\":%.1f,\"clusters_occluded\":%.1f,"
+           "\"queries\":%.1f}",
+           key, t->ms / n, t->triangles / n, t->visible / n, t->occluded / n, t->queries / n);
+}
+
+static int bench(const char *name, Mesh *m, Target *t, int frames) {
+    MeshGL g;
+    double t0 = seconds();
+    if (meshgl_upload(&g, m) != 0) return -1;
+    double upload_s = seconds() - t0;
+    if (!g.occlusion.target) {
+        fprintf(stderr, "%s: no occlusion queries in this context\n", name);
+        meshgl_free(&g);
+        return -1;
+    }
+    g.lod_pixel_error = 0;      // full detail: the passes differ only in occlusion culling
+    const float distance = 5;
+
+    // Static views
+    Tally on = { 0 }, off = { 0 };
+    int failed_views = 0, max_settle = 0;
+    for (int d = 0; d < 27; ++d) {
+        int dir[3] = { d % 3 - 1, d / 3 % 3 - 1, d / 9 - 1 };
+        if (!dir[0] && !dir[1] && !dir[2]) continue;
+        float len = sqrtf((float)(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2])), eye[3];
+        for (int a = 0; a < 3; ++a) eye[a] = distance * dir[a] / len;
+        MeshDrawStats st;
+
+        g.occlusion_culling = 0;
+        drawFrame(&g, eye, &st);
+        for (int f = 0; f < frames; ++f) count(&off, drawFrame(&g, eye, &st), &st);
+        headless_read_rgba(t->reference);
+
+        // Until every visible cluster has been retested; settled when the
+        // skipped count stops changing
+        g.occlusion_culling = 1;
+        unsigned last = UINT32_MAX;
+        int settle = 0;
+        for (int f = 1; f <= SETTLE_FRAMES; ++f) {
+            drawFrame(&g, eye, &st);
+            if (st.clusters_occluded != last) settle = f;
+            last = st.clusters_occluded;
+        }
+        if (settle > max_settle) max_settle = settle;
+        for (int f = 0; f < frames; ++f) count(&on, drawFrame(&g, eye, &st), &st);
+        headless_read_rgba(t->image);
+        size_t diff = differing(t);
+        if (diff) {
+            fprintf(stderr, "%s: view (%d, %d, %d) differs in %zu pixels with occlusion culling\n",
+                    name, dir[0], dir[1], dir[2], diff);
+            failed_views++;
+        }
+    }
+    printf("{\"model\":\"%s\",\"pass\":\"static\",\"triangles\":%zu,\"clusters\":%u,\"query_target\":\"%s\","
+           "\"upload_ms\":%.1f,\"views\":26,\"frames_to_settle\":%d",
+           name, m->triangle_count, g.bvh.cluster_count,
+           g.occlusion.target == GL_SAMPLES_PASSED ? "samples_passed" : "any_samples_passed",
+           upload_s * 1e3, max_settle);
+    printTally("occlusion_on", &on);
+    printTally("occlusion_off", &off);
+    printf(",\"views_differing\":%d}\n", failed_views);
+
+    // Orbit: one step per frame, each frame also drawn without occlusion culling
+    Tally orbit_on = { 0 }, orbit_off = { 0 };
+    int frames_differing = 0;
+    size_t max_diff = 0;
+    for (int i = 0; i < ORBIT_STEPS; ++i) {
+        double a = 2 * M_PI * i / ORBIT_STEPS;
+        float eye[3] = { distance * (float)(cos(a) * 0.8), distance * 0.45f, distance * (float)(sin(a) * 0.8) };
+        MeshDrawStats st;
+        g.occlusion_culling = 0;
+        count(&orbit_off, drawFrame(&g, eye, &st), &st);
+        headless_read_rgba(t->reference);
+        g.occlusion_culling = 1;
+        count(&orbit_on, drawFrame(&g, eye, &st), &st);
+        headless_read_rgba(t->image);
+        size_t diff = differing(t);
+        frames_differing += diff != 0;
+        if (diff > max_diff) max_diff = diff;
+    }
+    printf("{\"model\":\"%s\",\"pass\":\"orbit\",\"frames\":%d,\"degrees_per_frame\":%.1f",
+           name, ORBIT_STEPS, 360.0 / ORBIT_STEPS);
+    printTally("occlusion_on", &orbit_on);
+    printTally("occlusion_off", &orbit_off);
+    printf(",\"frames_differing\":%d,\"max_pixels_differing\":%zu}\n", frames_differing, max_diff);
+
+    meshgl_free(&g);
+    return failed_views ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+    size_t triangles = 1000000;
+    int frames = 5, files = 0, failed = 0;
+    Target t = { 800, 600, NULL, NULL };
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) triangles = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) t.width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) t.height = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--triangles N] [--width W] [--height H] [--frames N] [FILE...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (t.width <= 0 || t.height <= 0 || frames < 1) {
+        fprintf(stderr, "bad size or frame count\n");
+        return 2;
+    }
+    if (headless_init(t.width, t.height) != 0) return 1;
+    t.image = malloc(4 * (size_t)t.width * t.height);
+    t.reference = malloc(4 * (size_t)t.width * t.height);
+    if (!t.image || !t.reference) return 1;
+    fprintf(stderr, "renderer: %s\n", headless_renderer());
+
+    glViewport(0, 0, t.width, t.height);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(45, (double)t.width / t.height, 1, 100);
+    gls_enable(GL_DEPTH_TEST);
+
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-') {
+            i++;
+            continue;
+        }
+        Mesh m;
+        if (mesh_load(argv[i], &m, NULL) != 0) {
+            failed = 1;
+            continue;
+        }
+        failed |= bench(argv[i], &m, &t, frames) != 0;
+        mesh_free(&m);
+        files = 1;
+    }
+    if (!files && !failed) {
+        Mesh m;
+        if (makeAssembly(&m, triangles) != 0) {
+            fprintf(stderr, "out of memory building the assembly\n");
+            return 1;
+        }
+        failed = bench("assembly", &m, &t, frames) != 0;
+        mesh_free(&m);
+    }
+    free(t.image);
+    free(t.reference);
+    headless_shutdown();
+    return failed;
+}
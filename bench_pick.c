@@ -0,0 +1,329 @@
+// bench_pick.c
+// GL-free picking benchmark: feeds random (cursor, orientation, cube size)
+// samples to the hit tests in pick.c, times them, and checks every answer
+// against a double-precision ray/box intersection with the geometry the
+// renderers actually draw, sampled at the pixel centre.
+//
+// The batched hover (pick_viewcube_hover_batch) is timed separately, with
+// runs of --batch points sharing one orientation as in a replayed drag,
+// for every implementation this CPU supports, and checked against the
+// single-point call.
+//
+// Usage: bench_pick [--samples N] [--seed S] [--batch N]
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "anim.h"
+#include "pick.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define WIN_W 1920
+#define WIN_H 1080
+
+typedef struct {
+    float rot[3];
+    int vx, vy, size;   // cube rect, GL window coordinates
+    int x, y;           // cursor, GL window coordinates
+} Sample;
+
+// Oracle regions: where the pixel centre really lands
+enum { REGION_OUTSIDE, REGION_BACKGROUND, REGION_CENTER, REGION_EDGE, REGION_CORNER, REGION_COUNT };
+static const char *region_names[REGION_COUNT] = { "outside", "background", "face centre", "edge band", "corner" };
+
+typedef struct {
+    int face, cell;     // -1 when nothing is hit
+    int region;
+    double dir[3];      // view ray in cube space (unit)
+} Truth;
+
+static unsigned long long rng_state = 0x9e3779b97f4a7c15ull;
+
+static double rnd(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (rng_state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void generate(Sample *s, int n) {
+    for (int i = 0; i < n; ++i) {
+        for (int k = 0; k < 3; ++k) s[i].rot[k] = (float)(rnd() * 360.0 - 180.0);
+        if (rnd() < 0.5) s[i].rot[2] = 0;   // the usual case: no roll
+        s[i].size = 40 + (int)(rnd() * 361);
+        int margin = (int)(rnd() * 51);
+        s[i].vx = WIN_W - s[i].size - margin;
+        s[i].vy = WIN_H - s[i].size - margin;
+        // Cursor over the rect plus a 10% border
+        int pad = s[i].size / 10;
+        s[i].x = s[i].vx - pad + (int)(rnd() * (s[i].size + 2 * pad + 1));
+        s[i].y = s[i].vy - pad + (int)(rnd() * (s[i].size + 2 * pad + 1));
+    }
+}
+
+// --- Oracle ---
+
+// v = (Rz * Rx * Ry)^-1 * v
+static void inverseRotate(const float rot[3], double v[3]) {
+    double az = -rot[2] * M_PI / 180.0, ax = -rot[0] * M_PI / 180.0, ay = -rot[1] * M_PI / 180.0;
+    double x = v[0], y = v[1], z = v[2], t;
+    t = x * cos(az) - y * sin(az); y = x * sin(az) + y * cos(az); x = t;
+    t = y * cos(ax) - z * sin(ax); z = y * sin(ax) + z * cos(ax); y = t;
+    t = x * cos(ay) + z * sin(ay); z = -x * sin(ay) + z * cos(ay); x = t;
+    v[0] = x; v[1] = y; v[2] = z;
+}
+
+// libviewcube's face corners (v0, v1, v3 of each quad; u runs v0->v1, v runs v0->v3)
+static const double vc_face_uv[6][3][3] = {
+    { { 0.5,-0.5,-0.5}, { 0.5, 0.5,-0.5}, { 0.5,-0.5, 0.5} },
+    { {-0.5,-0.5, 0.5}, {-0.5, 0.5, 0.5}, {-0.5,-0.5,-0.5} },
+    { {-0.5, 0.5,-0.5}, { 0.5, 0.5,-0.5}, {-0.5, 0.5, 0.5} },
+    { {-0.5,-0.5, 0.5}, { 0.5,-0.5, 0.5}, {-0.5,-0.5,-0.5} },
+    { {-0.5,-0.5, 0.5}, { 0.5,-0.5, 0.5}, {-0.5, 0.5, 0.5} },
+    { { 0.5,-0.5,-0.5}, {-0.5,-0.5,-0.5}, { 0.5, 0.5,-0.5} }
+};
+
+static int bandOf(double t) {      // 0.1 / 0.8 / 0.1 split used by the cells
+    return t < 0.1 ? 0 : t < 0.9 ? 1 : 2;
+}
+
+static int regionOfCell(int cell) {
+    if (cell == 4) return REGION_CENTER;
+    return (cell & 1) ? REGION_EDGE : REGION_CORNER;
+}
+
+// Ray through the centre of pixel (x, y) of a square gluPerspective(30, 1)
+// viewport, camera `dist` in front of an axis-aligned cube of half-size h.
+// Returns the entry face (+X -X +Y -Y +Z -Z) or -1, and the hit point.
+static int rayBox(const Sample *s, double dist, double h, double hit[3], double dir_out[3]) {
+    double tan_half = tan(15.0 * M_PI / 180.0);
+    double ndcX = (s->x + 0.5 - s->vx) / s->size * 2.0 - 1.0;
+    double ndcY = (s->y + 0.5 - s->vy) / s->size * 2.0 - 1.0;
+    double o[3] = { 0, 0, dist };
+    double d[3] = { ndcX * tan_half, ndcY * tan_half, -1.0 };
+    inverseRotate(s->rot, o);
+    inverseRotate(s->rot, d);
+    double len = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    for (int k = 0; k < 3; ++k) dir_out[k] = d[k] / len;
+
+    // Slabs
+    double t_enter = -1e300, t_exit = 1e300;
+    int face = -1;
+    for (int k = 0; k < 3; ++k) {
+        if (fabs(d[k]) < 1e-15) {
+            if (fabs(o[k]) > h) return -1;
+            continue;
+        }
+        double t0 = (-h - o[k]) / d[k], t1 = (h - o[k]) / d[k];
+        int f0 = k * 2 + 1, f1 = k * 2;     // entering through -h or +h
+        if (t0 > t1) { double t = t0; t0 = t1; t1 = t; int f = f0; f0 = f1; f1 = f; }
+        if (t0 > t_enter) { t_enter = t0; face = f0; }
+        if (t1 < t_exit) t_exit = t1;
+    }
+    if (t_enter > t_exit || t_exit < 0) return -1;
+    for (int k = 0; k < 3; ++k) hit[k] = o[k] + t_enter * d[k];
+    return face;
+}
+
+static void oracleViewCube(const Sample *s, Truth *t) {
+    double hit[3];
+    t->face = t->cell = -1;
+    if (s->x < s->vx || s->x > s->vx + s->size || s->y < s->vy || s->y > s->vy + s->size) {
+        t->region = REGION_OUTSIDE;
+        rayBox(s, 5.0, 0.5, hit, t->dir);
+        return;
+    }
+    // gluLookAt(0,0,5, ...) in front of the unit cube
+    int f = rayBox(s, 5.0, 0.5, hit, t->dir);
+    if (f < 0) {
+        t->region = REGION_BACKGROUND;
+        return;
+    }
+    const double (*q)[3] = vc_face_uv[f];
+    double u = 0, v = 0;
+    for (int k = 0; k < 3; ++k) {
+        u += (hit[k] - q[0][k]) * (q[1][k] - q[0][k]);
+        v += (hit[k] - q[0][k]) * (q[2][k] - q[0][k]);
+    }
+    t->face = f;
+    t->cell = bandOf(v) * 3 + bandOf(u);
+    t->region = regionOfCell(t->cell);
+}
+
+static void oracleCubeChars(const Sample *s, Truth *t) {
+    double hit[3];
+    t->face = t->cell = -1;
+    if (s->x < s->vx || s->x > s->vx + s->size || s->y < s->vy || s->y > s->vy + s->size) {
+        t->region = REGION_OUTSIDE;
+        return;
+    }
+    // drawViewCube: glTranslatef(0, 0, -8), faces at +-0.7
+    int f = rayBox(s, 8.0, 0.7, hit, t->dir);
+    if (f < 0) {
+        t->region = REGION_BACKGROUND;
+        return;
+    }
+    // Face-local coordinates in [0, 1] along the two other axes
+    int a = (f / 2 + 1) % 3, b = (f / 2 + 2) % 3;
+    double u = (hit[a] + 0.7) / 1.4, v = (hit[b] + 0.7) / 1.4;
+    t->face = f;
+    t->region = regionOfCell(bandOf(v) * 3 + bandOf(u));
+}
+
+// --- Benchmark ---
+
+typedef struct {
+    long n[REGION_COUNT], wrong[REGION_COUNT];
+} Agreement;
+
+static void printAgreement(const char *label, const Agreement *a) {
+    long n = 0, wrong = 0;
+    printf("%s\n", label);
+    for (int r = 0; r < REGION_COUNT; ++r) {
+        if (!a->n[r]) continue;
+        printf("  %-12s %10ld samples  %10ld disagree  %7.3f%%\n",
+               region_names[r], a->n[r], a->wrong[r], 100.0 * a->wrong[r] / a->n[r]);
+        n += a->n[r];
+        wrong += a->wrong[r];
+    }
+    printf("  %-12s %10ld samples  %10ld disagree  %7.3f%%\n", "all", n, wrong, 100.0 * wrong / n);
+}
+
+static volatile long sink;
+
+static void benchBatch(const Sample *s, int samples, int batch) {
+    int *x = malloc(sizeof(int) * samples), *y = malloc(sizeof(int) * samples);
+    int *ref = malloc(sizeof(int) * samples), *ids = malloc(sizeof(int) * samples);
+
+    // Points of each run fall in the rect of the run's first sample
+    for (int i = 0; i < samples; ++i) {
+        const Sample *g = &s[i - i % batch];
+        int pad = g->size / 10;
+        x[i] = g->vx - pad + (int)(rnd() * (g->size + 2 * pad + 1));
+        y[i] = g->vy - pad + (int)(rnd() * (g->size + 2 * pad + 1));
+    }
+
+    double t0 = anim_now();
+    for (int i = 0; i < samples; ++i) {
+        const Sample *g = &s[i - i % batch];
+        PickHover h;
+        pick_viewcube_hover(g->rot, g->vx, g->vy, g->size, x[i], y[i], &h);
+        ref[i] = h.id;
+    }
+    double scalar = anim_now() - t0;
+
+    printf("batched hover, runs of %d points sharing an orientation:\n", batch);
+    printf("  %-22s %10.1f ns/point %10.2f ms total\n", "pick_viewcube_hover",
+           scalar * 1e9 / samples, scalar * 1e3);
+
+    const PickImpl impls[] = { PICK_IMPL_SCALAR, PICK_IMPL_SSE2, PICK_IMPL_AVX2 };
+    for (int k = 0; k < 3; ++k) {
+        if (pick_set_impl(impls[k]) != 0) continue;
+        double t = anim_now();
+        for (int i = 0; i < samples; i += batch) {
+            int n = samples - i < batch ? samples - i : batch;
+            pick_viewcube_hover_batch(s[i].rot, s[i].vx, s[i].vy, s[i].size, x + i, y + i, n, ids + i);
+        }
+        t = anim_now() - t;
+        long mismatch = 0;
+        for (int i = 0; i < samples; ++i) mismatch += ids[i] != ref[i];
+        char label[32];
+        snprintf(label, sizeof(label), "batch (%s)", pick_impl_name());
+        printf("  %-22s %10.1f ns/point %10.2f ms total  x%.1f  %ld mismatches\n",
+               label, t * 1e9 / samples, t * 1e3, scalar / t, mismatch);
+    }
+    pick_set_impl(PICK_IMPL_AUTO);
+
+    free(x); free(y); free(ref); free(ids);
+}
+
+int main(int argc, char **argv) {
+    int samples = 2000000, batch = 1024;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) samples = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batch = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) rng_state = strtoull(argv[++i], NULL, 0) | 1;
+        else {
+            fprintf(stderr, "usage: %s [--samples N] [--seed S] [--batch N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (samples < 1) samples = 1;
+    if (batch < 1) batch = 1;
+
+    Sample *s = malloc(sizeof(Sample) * samples);
+    Truth *vc_truth = malloc(sizeof(Truth) * samples);
+    Truth *cc_truth = malloc(sizeof(Truth) * samples);
+    int *hover_id = malloc(sizeof(int) * samples);
+    int *face = malloc(sizeof(int) * samples);
+    float (*local)[3] = malloc(sizeof(float[3]) * samples);
+    generate(s, samples);
+
+    // Timed passes: results go to arrays so the checks below see them
+    double t0 = anim_now();
+    for (int i = 0; i < samples; ++i)
+        pick_screen_to_local(s[i].rot, s[i].vx, s[i].vy, s[i].size, s[i].x, s[i].y, local[i]);
+    double t1 = anim_now();
+    for (int i = 0; i < samples; ++i) {
+        PickHover h;
+        pick_viewcube_hover(s[i].rot, s[i].vx, s[i].vy, s[i].size, s[i].x, s[i].y, &h);
+        hover_id[i] = h.id;
+    }
+    double t2 = anim_now();
+    for (int i = 0; i < samples; ++i)
+        face[i] = pick_cube_face(s[i].x, s[i].y, s[i].vx, s[i].vy, s[i].size, s[i].rot);
+    double t3 = anim_now();
+    for (int i = 0; i < samples; ++i)
+        oracleViewCube(&s[i], &vc_truth[i]);
+    double t4 = anim_now();
+    for (int i = 0; i < samples; ++i)
+        oracleCubeChars(&s[i], &cc_truth[i]);
+    double t5 = anim_now();
+
+    printf("%d samples, cube sizes 40-400 px, random orientation (half with no roll)\n\n", samples);
+    printf("%-24s %10s %12s\n", "function", "ns/query", "Mqueries/s");
+    const char *names[] = { "pick_screen_to_local", "pick_viewcube_hover", "pick_cube_face",
+                            "oracle (libviewcube)", "oracle (cube_chars)" };
+    double times[] = { t1 - t0, t2 - t1, t3 - t2, t4 - t3, t5 - t4 };
+    for (int k = 0; k < 5; ++k)
+        printf("%-24s %10.1f %12.2f\n", names[k], times[k] * 1e9 / samples, samples / times[k] * 1e-6);
+    printf("\n");
+
+    // screenToViewCubeLocal: angle between its ray and the true one
+    double max_err = 0, sum_err = 0;
+    long over = 0;
+    for (int i = 0; i < samples; ++i) {
+        double dot = local[i][0] * vc_truth[i].dir[0] + local[i][1] * vc_truth[i].dir[1] +
+                     local[i][2] * vc_truth[i].dir[2];
+        double err = acos(dot > 1 ? 1 : dot < -1 ? -1 : dot) * 180.0 / M_PI;
+        sum_err += err;
+        if (err > max_err) max_err = err;
+        if (err > 0.1) over++;
+    }
+    printf("pick_screen_to_local vs true ray: mean %.3f deg, max %.3f deg, %.3f%% off by > 0.1 deg\n\n",
+           sum_err / samples, max_err, 100.0 * over / samples);
+
+    Agreement hover = {{0}}, pick = {{0}};
+    for (int i = 0; i < samples; ++i) {
+        int want = vc_truth[i].face < 0 ? -1 : vc_truth[i].face * 9 + vc_truth[i].cell;
+        hover.n[vc_truth[i].region]++;
+        hover.wrong[vc_truth[i].region] += hover_id[i] != want;
+
+        pick.n[cc_truth[i].region]++;
+        pick.wrong[cc_truth[i].region] += face[i] != cc_truth[i].face;
+        sink += hover_id[i] + face[i];
+    }
+    printAgreement("pick_viewcube_hover (face cell id) vs oracle, by true region:", &hover);
+    printf("\n");
+    printAgreement("pick_cube_face (face) vs oracle, by true region:", &pick);
+    printf("\n");
+
+    benchBatch(s, samples, batch);
+
+    free(s); free(vc_truth); free(cc_truth); free(hover_id); free(face); free(local);
+    return 0;
+}
@@ -0,0 +1,161 @@
+// bench_points.c
+// Point cloud conversion throughput: writes a synthetic terrain (a rolling
+// surface with a raised disc, coloured by position) as a LAS 1.2 file in
+// survey-sized coordinates, converts it to a .vcpts octree and prints a
+// JSON line with the time, Mpts/s, octree shape and peak RSS (which should
+// stay flat as --points grows), then one for reading every node back.
+// With file arguments, converts those instead (their octrees are left in
+// place).
+//
+// Usage: bench_points [--points N] [--threads N] [--dir DIR] [FILE...]
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "parallel.h"
+#include "pointcloud.h"
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void put16(unsigned char *p, unsigned v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); }
+static void put32(unsigned char *p, uint32_t v) { put16(p, v & 0xffff); put16(p + 2, v >> 16); }
+static void putd(unsigned char *p, double d) {
+    uint64_t u;
+    memcpy(&u, &d, 8);
+    put32(p, (uint32_t)u);
+    put32(p + 4, (uint32_t)(u >> 32));
+}
+
+// 1 km square at 1 cm resolution, written in 64K-point blocks
+static int writeTerrain(const char *path, size_t n) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return -1;
+    }
+    unsigned char h[227] = { 0 };
+    memcpy(h, "LASF", 4);
+    h[24] = 1;
+    h[25] = 2;
+    put16(h + 94, 227);
+    put32(h + 96, 227);
+    h[104] = 2;
+    put16(h + 105, 26);
+    put32(h + 107, (uint32_t)n);
+    const double off[3] = { 500000, 4000000, 0 };
+    for (int a = 0; a < 3; ++a) {
+        putd(h + 131 + 8 * a, 0.01);
+        putd(h + 155 + 8 * a, off[a]);
+    }
+    const double lo[3] = { 0, 0, -30 }, hi[3] = { 1000, 1000, 230 };
+    for (int a = 0; a < 3; ++a) {
+        putd(h + 179 + 16 * a, off[a] + hi[a]);
+        putd(h + 187 + 16 * a, off[a] + lo[a]);
+    }
+    fwrite(h, 1, sizeof(h), fp);
+
+    enum { BLOCK = 65536 };
+    unsigned char *rec = calloc(BLOCK, 26);
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; rec && i < n; i += BLOCK) {
+        size_t m = n - i < BLOCK ? n - i : BLOCK;
+        for (size_t k = 0; k < m; ++k) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            double x = (state >> 11 & 0xfffff) / (double)0xfffff * 1000;
+            double y = (state >> 33 & 0x7fffffff) / (double)0x7fffffff * 1000;
+            double z = 30 * sin(x / 80) * cos(y / 120) + ((x - 500) * (x - 500) + (y - 500) * (y - 500) < 2500 ? 200 : 0);
+            unsigned char *r = rec + 26 * k;
+            put32(r, (uint32_t)(int32_t)lround(x * 100));
+            put32(r + 4, (uint32_t)(int32_t)lround(y * 100));
+            put32(r + 8, (uint32_t)(int32_t)lround(z * 100));
+            put16(r + 20, (unsigned)(x * 65.535));
+            put16(r + 22, (unsigned)(y * 65.535));
+            put16(r + 24, 32768);
+        }
+        fwrite(rec, 26, m, fp);
+    }
+    free(rec);
+    int bad = !rec || ferror(fp);
+    if (fclose(fp) != 0 || bad) {
+        fprintf(stderr, "write failed: %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int bench(const char *path) {
+    PointCloudStats st;
+    if (pointcloud_convert(path, &st) != 0) return -1;
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+
+    PointCloud pc;
+    if (pointcloud_open(path, &pc) != 0) {
+        fprintf(stderr, "%s: octree did not validate\n", path);
+        return -1;
+    }
+    const PointCloudHeader *h = &pc.header;
+    uint32_t depth = 0, largest = 0;
+    for (uint64_t i = 0; i < h->node_count; ++i) {
+        if (pc.nodes[i].level > depth) depth = pc.nodes[i].level;
+        if (pc.nodes[i].count > largest) largest = pc.nodes[i].count;
+    }
+    printf("{\"file\":\"%s\",\"format\":\"%s\",\"threads\":%d,\"points\":%llu,\"nodes\":%llu,"
+           "\"records\":%llu,\"depth\":%u,\"largest_node\":%u,\"seconds\":%.3f,\"mpts_per_s\":%.2f,"
+           "\"peak_rss_mb\":%.1f}\n",
+           path, st.format, st.threads, (unsigned long long)h->point_count, (unsigned long long)h->node_count,
+           (unsigned long long)h->record_count, depth, largest, st.seconds, h->point_count / st.seconds / 1e6,
+           ru.ru_maxrss / 1024.0);
+
+    // Every node back, as the streaming loaders read them
+    PointRecord *buf = malloc(sizeof(PointRecord) * (largest ? largest : 1));
+    double t0 = seconds();
+    int ok = buf != NULL;
+    for (uint64_t i = 0; ok && i < h->node_count; ++i) ok = pointcloud_read_node(&pc, (uint32_t)i, buf) == 0;
+    double t = seconds() - t0;
+    if (ok)
+        printf("{\"file\":\"%s\",\"read_all_nodes_seconds\":%.3f,\"mb_per_s\":%.1f}\n",
+               path, t, h->record_count * sizeof(PointRecord) / t / 1e6);
+    else
+        fprintf(stderr, "%s: reading the nodes back failed\n", path);
+    free(buf);
+    pointcloud_close(&pc);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    size_t points = 20000000;
+    const char *dir = "/tmp";
+    int files = 0, failed = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--points") == 0 && i + 1 < argc) points = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) parallel_set_threads(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) dir = argv[++i];
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--points N] [--threads N] [--dir DIR] [FILE...]\n", argv[0]);
+            return 2;
+        } else {
+            failed |= bench(argv[i]) != 0;
+            files = 1;
+        }
+    }
+    if (files) return failed;
+
+    char path[512], octree[520];
+    snprintf(path, sizeof(path), "%s/bench_terrain.las", dir);
+    if (writeTerrain(path, points) != 0) return 1;
+    failed = bench(path) != 0;
+    pointcloud_path(path, octree, sizeof(octree));
+    remove(path);
+    remove(octree);
+    return failed;
+}
@@ -0,0 +1,307 @@
+// bench_renderthread.c
+// Input handling with and without a render thread, on a scene slow enough
+// to draw that a frame spans many input events. A stream of drag events
+// (one every --interval-ms, as ViewCube --latency-bench sends them) turns
+// the main view and the ViewCube, and is handled two ways:
+//
+// - inline: as under glutMainLoop, the thread that handles events also
+//   draws, so events that arrive during a frame wait for it to finish;
+// - thread: the input thread only updates the view state and publishes it
+//   through a triple buffer (renderthread.h); a render thread that owns
+//   the context draws the latest snapshot.
+//
+// Prints a JSON line per mode: how late events were handled after they
+// arrived (dispatch), how long the handler took, the frames drawn and
+// their cost, and input-to-present latency as measured by latency.c.
+// Renders headless (EGL, llvmpipe without a GPU); frames end in glFinish.
+//
+// Usage: bench_renderthread [--triangles N] [--events N] [--interval-ms N] [FILE]
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "glstate.h"
+#include "headless.h"
+#include "latency.h"
+#include "meshgl.h"
+#include "renderthread.h"
+#include "viewcube.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define WIDTH 800
+#define HEIGHT 600
+
+static double seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sleepUntil(double t) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {}
+}
+
+// Unit sphere, counter-clockwise from outside
+static int makeSphere(Mesh *m, size_t triangles) {
+    int seg = (int)ceil(sqrt((double)triangles));
+    if (seg < 8) seg = 8;
+    int rings = seg / 2;
+    memset(m, 0, sizeof(*m));
+    m->vertex_count = (size_t)(rings + 1) * (seg + 1);
+    m->triangle_count = (size_t)rings * seg * 2;
+    m->positions = malloc(sizeof(float) * 3 * m->vertex_count);
+    m->indices = malloc(sizeof(unsigned) * 3 * m->triangle_count);
+    if (!m->positions || !m->indices) return -1;
+    size_t k = 0;
+    for (int r = 0; r <= rings; ++r) {
+        double th = M_PI * r / rings;
+        double st = r == rings ? 0 : sin(th);    // sin(M_PI) is not 0: one south pole
+        for (int i = 0; i <= seg; ++i) {
+            double ph = 2 * M_PI * (i % seg) / seg;
+            m->positions[k++] = (float)(st * cos(ph));
+            m->positions[k++] = (float)cos(th);
+            m->positions[k++] = (float)(st * sin(ph));
+        }
+    }
+    k = 0;
+    for (int r = 0; r < rings; ++r) {
+        for (int i = 0; i < seg; ++i) {
+            unsigned a = r * (seg + 1) + i, b = a + seg + 1;
+            m->indices[k++] = a; m->indices[k++] = a + 1; m->indices[k++] = b;
+            m->indices[k++] = a + 1; m->indices[k++] = b + 1; m->indices[k++] = b;
+        }
+    }
+    for (int a = 0; a < 3; ++a) {
+        m->bounds_min[a] = -1;
+        m->bounds_max[a] = 1;
+    }
+    return 0;
+}
+
+// --- View state, as ViewCube.c keeps it ---
+
+typedef struct {
+    float rot[3];
+    viewcube_t *cube;
+} View;
+
+typedef struct {
+    MeshGL *g;
+    View input;             // owned by the input side
+    View slots[3];
+    RtTriple views;
+    _Atomic double undrawn_input;   // oldest published input not yet drawn, < 0: none
+    int frames;
+    double frame_s;
+} Scene;
+
+static void drawView(Scene *s, View *v) {
+    double t0 = seconds();
+    latency_frame_begin();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(45, (double)WIDTH / HEIGHT, 1, 100);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0, 0, -5);
+    glPushMatrix();
+    glRotatef(v->rot[2], 0, 0, 1);
+    glRotatef(v->rot[0], 1, 0, 0);
+    glRotatef(v->rot[1], 0, 1, 0);
+    glColor3f(1, 1, 1);
+    meshgl_draw(s->g, 2.0f, NULL);
+    glPopMatrix();
+    viewcube_render(v->cube);
+    glFinish();
+    latency_frame_presented(seconds());
+    gls_frame_end();
+    s->frames++;
+    s->frame_s += seconds() - t0;
+}
+
+// The ViewCube.c drag handler: event i of a circle drawn in the main view
+static void handleEvent(View *v, int i) {
+    int x = WIDTH / 3 + (int)(80 * cos(i * 0.05)), y = HEIGHT / 2 + (int)(80 * sin(i * 0.05));
+    int px = WIDTH / 3 + (int)(80 * cos((i - 1) * 0.05)), py = HEIGHT / 2 + (int)(80 * sin((i - 1) * 0.05));
+    v->rot[1] += x - px;
+    v->rot[0] += py - y;
+    viewcube_set_orientation(v->cube, v->rot[0], v->rot[1], v->rot[2]);
+    viewcube_pointer_move(v->cube, x, y);
+}
+
+static int renderFrame(void *user) {
+    Scene *s = user;
+    // Input time first: the view acquired after it is one that shows the input,
+    // or that view was drawn already and is drawn again to measure it
+    double input = atomic_exchange(&s->undrawn_input, -1);
+    if (!rt_triple_acquire(&s->views) && input < 0) return 0;
+    if (input >= 0) latency_input(input);
+    drawView(s, rt_triple_front(&s->views));
+    return 0;
+}
+
+static int renderBegin(void *user) {
+    return headless_make_current(1);
+}
+
+static void renderEnd(void *user) {
+    headless_make_current(0);
+}
+
+// Publishes the input view, then hands over its input time unless an older
+// one is still waiting to be drawn
+static void publish(Scene *s, double input_time) {
+    View *v = rt_triple_back(&s->views);
+    memcpy(v->rot, s->input.rot, sizeof(v->rot));
+    viewcube_copy(v->cube, s->input.cube);
+    rt_triple_publish(&s->views);
+    double none = -1;
+    atomic_compare_exchange_strong(&s->undrawn_input, &none, input_time);
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void printPercentiles(const char *key, double *v, int n, double scale) {
+    qsort(v, n, sizeof(double), compareDouble);
+    printf(",\"%s\":{\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f}", key, v[n / 2] * scale,
+           v[(int)(n * 0.99)] * scale, v[n - 1] * scale);
+}
+
+static int run(Scene *s, int threaded, int events, double interval) {
+    double *delay = malloc(sizeof(double) * events), *handle = malloc(sizeof(double) * events);
+    if (!delay || !handle) return -1;
+    RenderThread rt;
+    s->input.rot[0] = 35.264f;
+    s->input.rot[1] = 45.0f;
+    s->input.rot[2] = 0;
+    viewcube_set_orientation(s->input.cube, s->input.rot[0], s->input.rot[1], s->input.rot[2]);
+    s->frames = 0;
+    s->frame_s = 0;
+    atomic_init(&s->undrawn_input, -1);
+    latency_reset();
+    latency_set_enabled(1);
+
+    if (threaded) {
+        for (int i = 0; i < 3; ++i) {
+            memcpy(s->slots[i].rot, s->input.rot, sizeof(s->input.rot));
+            viewcube_copy(s->slots[i].cube, s->input.cube);
+        }
+        rt_triple_init(&s->views, &s->slots[0], &s->slots[1], &s->slots[2]);
+        headless_make_current(0);
+        if (renderthread_start(&rt, renderBegin, renderFrame, renderEnd, s) != 0) {
+            headless_make_current(1);
+            free(delay);
+            free(handle);
+            return -1;
+        }
+    }
+
+    double t0 = seconds() + 0.05, wall = seconds();
+    int i = 0;
+    while (i < events) {
+        double due = t0 + i * interval;
+        if (seconds() < due) sleepUntil(due);
+        // Everything that has arrived, then (inline) one frame
+        do {
+            double start = seconds();
+            handleEvent(&s->input, i + 1);
+            if (threaded) {
+                publish(s, due);
+                renderthread_wake(&rt);
+            } else {
+                latency_input(due);
+            }
+            double end = seconds();
+            delay[i] = start - due;
+            handle[i] = end - start;
+            due = t0 + ++i * interval;
+        } while (i < events && seconds() >= due);
+        if (!threaded) drawView(s, &s->input);
+    }
+    if (threaded) {
+        renderthread_stop(&rt);
+        headless_make_current(1);
+    }
+    wall = seconds() - wall;
+
+    LatencyReport r = latency_report();
+    printf("{\"mode\":\"%s\",\"events\":%d,\"interval_ms\":%.1f,\"frames\":%d,\"frame_ms\":%.2f,\"wall_s\":%.2f",
+           threaded ? "thread" : "inline", events, interval * 1e3, s->frames,
+           s->frames ? s->frame_s / s->frames * 1e3 : 0, wall);
+    printPercentiles("dispatch_ms", delay, events, 1e3);
+    printPercentiles("handler_us", handle, events, 1e6);
+    printf(",\"latency_ms\":{\"samples\":%ld,\"p50\":%.2f,\"p99\":%.2f,\"max\":%.2f}}\n",
+           r.count, r.p50, r.p99, r.max);
+    latency_set_enabled(0);
+    free(delay);
+    free(handle);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    size_t triangles = 1000000;
+    int events = 300;
+    double interval_ms = 8;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--triangles") == 0 && i + 1 < argc) triangles = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) events = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) interval_ms = atof(argv[++i]);
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--triangles N] [--events N] [--interval-ms N] [FILE]\n", argv[0]);
+            return 2;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (events < 2 || interval_ms <= 0) {
+        fprintf(stderr, "bad event count or interval\n");
+        return 2;
+    }
+    if (headless_init(WIDTH, HEIGHT) != 0) return 1;
+    fprintf(stderr, "renderer: %s\n", headless_renderer());
+    gls_enable(GL_DEPTH_TEST);
+
+    Mesh m;
+    if (path ? mesh_load(path, &m, NULL) != 0 : makeSphere(&m, triangles) != 0) {
+        fprintf(stderr, "cannot build the scene\n");
+        return 1;
+    }
+    MeshGL g;
+    if (meshgl_upload(&g, &m) != 0) return 1;
+    mesh_free(&m);
+    g.lod_pixel_error = 0;      // full detail: a frame stays slow whatever the view
+
+    Scene s;
+    memset(&s, 0, sizeof(s));
+    s.g = &g;
+    s.input.cube = viewcube_create();
+    viewcube_resize(s.input.cube, WIDTH, HEIGHT);
+    viewcube_set_text_renderer(s.input.cube, viewcube_text_builtin, NULL);
+    for (int i = 0; i < 3; ++i) s.slots[i].cube = viewcube_create();
+
+    int failed = run(&s, 0, events, interval_ms * 1e-3) != 0;
+    failed |= run(&s, 1, events, interval_ms * 1e-3) != 0;
+
+    for (int i = 0; i < 3; ++i) viewcube_destroy(s.slots[i].cube);
+    viewcube_destroy(s.input.cube);
+    meshgl_free(&g);
+    headless_shutdown();
+    return failed;
+}
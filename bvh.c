@@ -0,0 +1,303 @@
+// bvh.c
+#include "bvh.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// --- Morton ordering ---
+
+static uint32_t spread10(uint32_t v) {     // 10 bits -> every third bit
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+typedef struct {
+    const float *positions;
+    const unsigned *indices;
+    float origin[3], scale[3];
+    uint32_t *keys, *order;
+} MortonJob;
+
+static void morton_range(void *ctx, size_t begin, size_t end) {
+    MortonJob *j = ctx;
+    for (size_t t = begin; t < end; ++t) {
+        uint32_t q[3];
+        for (int a = 0; a < 3; ++a) {
+            float c = (j->positions[3 * j->indices[3 * t] + a] + j->positions[3 * j->indices[3 * t + 1] + a] +
+                       j->positions[3 * j->indices[3 * t + 2] + a]) * (1.0f / 3);
+            float v = (c - j->origin[a]) * j->scale[a];
+            q[a] = v <= 0 ? 0 : v >= 1023 ? 1023 : (uint32_t)v;
+        }
+        j->keys[t] = spread10(q[0]) | spread10(q[1]) << 1 | spread10(q[2]) << 2;
+        j->order[t] = (uint32_t)t;
+    }
+}
+
+void bvh_sort_triangles(const float *positions, unsigned *indices, size_t triangle_count,
+                        const float bounds_min[3], const float bounds_max[3]) {
+    size_t n = triangle_count;
+    uint32_t *keys = malloc(sizeof(uint32_t) * 2 * (n ? n : 1));
+    uint32_t *order = malloc(sizeof(uint32_t) * 2 * (n ? n : 1));
+    unsigned *sorted = malloc(sizeof(unsigned) * 3 * (n ? n : 1));
+    if (!keys || !order || !sorted) {
+        free(keys); free(order); free(sorted);
+        return;   // unsorted still renders; culling is just coarser
+    }
+
+    MortonJob job = { positions, indices, { 0 }, { 0 }, keys, order };
+    for (int a = 0; a < 3; ++a) {
+        float e = bounds_max[a] - bounds_min[a];
+        job.origin[a] = bounds_min[a];
+        job.scale[a] = e > 0 ? 1024 / e : 0;
+    }
+    parallel_for(n, 65536, morton_range, &job);
+
+    // LSD radix sort on 30-bit keys, 8 bits per pass (stable)
+    uint32_t *k0 = keys, *k1 = keys + n, *o0 = order, *o1 = order + n;
+    for (int shift = 0; shift < 32; shift += 8) {
+        size_t count[257] = { 0 };
+        for (size_t i = 0; i < n; ++i) count[((k0[i] >> shift) & 0xff) + 1]++;
+        for (int d = 0; d < 256; ++d) count[d + 1] += count[d];
+        for (size_t i = 0; i < n; ++i) {
+            size_t at = count[(k0[i] >> shift) & 0xff]++;
+            k1[at] = k0[i];
+            o1[at] = o0[i];
+        }
+        uint32_t *t = k0; k0 = k1; k1 = t;
+        t = o0; o0 = o1; o1 = t;
+    }
+
+    for (size_t i = 0; i < n; ++i) memcpy(sorted + 3 * i, indices + 3 * (size_t)o0[i], 3 * sizeof(unsigned));
+    memcpy(indices, sorted, sizeof(unsigned) * 3 * n);
+    free(keys);
+    free(order);
+    free(sorted);
+}
+
+// --- Build ---
+
+typedef struct {
+    const float *positions;
+    const unsigned *indices;
+    size_t triangle_count;
+    uint32_t cluster_triangles;
+    BvhBox *out;
+} BoundsJob;
+
+static void bounds_range(void *ctx, size_t begin, size_t end) {
+    BoundsJob *j = ctx;
+    for (size_t c = begin; c < end; ++c) {
+        BvhBox *b = &j->out[c];
+        size_t t0 = c * j->cluster_triangles, t1 = t0 + j->cluster_triangles;
+        if (t1 > j->triangle_count) t1 = j->triangle_count;
+        for (int a = 0; a < 3; ++a) {
+            b->min[a] = INFINITY;
+            b->max[a] = -INFINITY;
+        }
+        for (size_t i = 3 * t0; i < 3 * t1; ++i) {
+            const float *p = j->positions + 3 * (size_t)j->indices[i];
+            for (int a = 0; a < 3; ++a) {
+                if (p[a] < b->min[a]) b->min[a] = p[a];
+                if (p[a] > b->max[a]) b->max[a] = p[a];
+            }
+        }
+    }
+}
+
+void bvh_cluster_bounds(const float *positions, const unsigned *indices, size_t triangle_count,
+                        uint32_t cluster_triangles, BvhBox *out) {
+    BoundsJob job = { positions, indices, triangle_count, cluster_triangles, out };
+    size_t n = (triangle_count + cluster_triangles - 1) / cluster_triangles;
+    parallel_for(n, 64, bounds_range, &job);
+}
+
+static void set_child(BvhNode *node, int k, const BvhBox *box, int32_t child, uint32_t first, uint32_t count) {
+    node->cx[k] = 0.5f * (box->min[0] + box->max[0]);
+    node->cy[k] = 0.5f * (box->min[1] + box->max[1]);
+    node->cz[k] = 0.5f * (box->min[2] + box->max[2]);
+    node->ex[k] = 0.5f * (box->max[0] - box->min[0]);
+    node->ey[k] = 0.5f * (box->max[1] - box->min[1]);
+    node->ez[k] = 0.5f * (box->max[2] - box->min[2]);
+    node->child[k] = child;
+    node->first[k] = first;
+    node->count[k] = count;
+}
+
+static BvhBox node_bounds(const BvhNode *node) {
+    BvhBox b = { { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+    for (int k = 0; k < 4; ++k) {
+        if (!node->count[k]) continue;
+        float c[3] = { node->cx[k], node->cy[k], node->cz[k] }, e[3] = { node->ex[k], node->ey[k], node->ez[k] };
+        for (int a = 0; a < 3; ++a) {
+            if (c[a] - e[a] < b.min[a]) b.min[a] = c[a] - e[a];
+            if (c[a] + e[a] > b.max[a]) b.max[a] = c[a] + e[a];
+        }
+    }
+    return b;
+}
+
+typedef struct {
+    BvhNode *nodes;
+    const BvhBox *clusters;
+    uint32_t cluster_count;
+    int level_start, prev_start, prev_count;
+} BuildJob;
+
+static void build_leaves(void *ctx, size_t begin, size_t end) {
+    BuildJob *j = ctx;
+    for (size_t i = begin; i < end; ++i) {
+        BvhNode *node = &j->nodes[j->level_start + i];
+        memset(node, 0, sizeof(*node));
+        for (int k = 0; k < 4; ++k) {
+            uint32_t c = (uint32_t)(4 * i + k);
+            if (c < j->cluster_count) set_child(node, k, &j->clusters[c], -1, c, 1);
+        }
+    }
+}
+
+static void build_inner(void *ctx, size_t begin, size_t end) {
+    BuildJob *j = ctx;
+    for (size_t i = begin; i < end; ++i) {
+        BvhNode *node = &j->nodes[j->level_start + i];
+        memset(node, 0, sizeof(*node));
+        for (int k = 0; k < 4; ++k) {
+            int c = (int)(4 * i + k);
+            if (c >= j->prev_count) break;
+            const BvhNode *child = &j->nodes[j->prev_start + c];
+            BvhBox box = node_bounds(child);
+            uint32_t first = child->first[0], count = 0;
+            for (int m = 0; m < 4; ++m) count += child->count[m];
+            set_child(node, k, &box, j->prev_start + c, first, count);
+        }
+    }
+}
+
+int bvh_build(Bvh *b, const BvhBox *clusters, uint32_t count) {
+    memset(b, 0, sizeof(*b));
+    b->root = -1;
+    b->cluster_count = count;
+    if (!count) return 0;
+
+    int total = 0;
+    for (uint32_t n = count;;) {
+        n = (n + 3) / 4;
+        total += (int)n;
+        if (n == 1) break;
+    }
+    b->nodes = malloc(sizeof(BvhNode) * total);
+    if (!b->nodes) return -1;
+
+    // Leaves over consecutive clusters, then each level groups four nodes
+    // of the one below; Morton order keeps the groups compact
+    BuildJob job = { b->nodes, clusters, count, 0, 0, 0 };
+    int n = (int)((count + 3) / 4);
+    parallel_for((size_t)n, 256, build_leaves, &job);
+    int start = 0;
+    while (n > 1) {
+        job.prev_start = start;
+        job.prev_count = n;
+        job.level_start = start + n;
+        start += n;
+        n = (n + 3) / 4;
+        parallel_for((size_t)n, 256, build_inner, &job);
+    }
+    b->node_count = total;
+    b->root = total - 1;
+    return 0;
+}
+
+void bvh_free(Bvh *b) {
+    free(b->nodes);
+    memset(b, 0, sizeof(*b));
+    b->root = -1;
+}
+
+// --- Cull ---
+
+void bvh_planes_from_matrix(const float m[16], float planes[6][4]) {
+    for (int i = 0; i < 3; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            planes[2 * i][c] = m[4 * c + 3] + m[4 * c + i];
+            planes[2 * i + 1][c] = m[4 * c + 3] - m[4 * c + i];
+        }
+    }
+}
+
+typedef struct {
+    const Bvh *b;
+    const float (*planes)[4];
+    BvhRange *ranges;
+    int range_count;
+    uint32_t visible;
+} CullState;
+
+static void emit(CullState *s, uint32_t first, uint32_t count) {
+    BvhRange *last = s->range_count ? &s->ranges[s->range_count - 1] : NULL;
+    if (last && last->first + last->count == first) last->count += count;
+    else s->ranges[s->range_count++] = (BvhRange){ first, count };
+    s->visible += count;
+}
+
+// Bit k of *outside / *straddle: child k is outside some plane / crosses one
+static void classify(const BvhNode *node, const float (*planes)[4], int *outside, int *straddle) {
+#if defined(__SSE2__)
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 cx = _mm_loadu_ps(node->cx), cy = _mm_loadu_ps(node->cy), cz = _mm_loadu_ps(node->cz);
+    __m128 ex = _mm_loadu_ps(node->ex), ey = _mm_loadu_ps(node->ey), ez = _mm_loadu_ps(node->ez);
+    __m128 out = _mm_setzero_ps(), cross = _mm_setzero_ps();
+    for (int p = 0; p < 6; ++p) {
+        __m128 a = _mm_set1_ps(planes[p][0]), b = _mm_set1_ps(planes[p][1]);
+        __m128 c = _mm_set1_ps(planes[p][2]), d = _mm_set1_ps(planes[p][3]);
+        __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)),
+                                 _mm_add_ps(_mm_mul_ps(c, cz), d));
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(a, abs_mask), ex),
+                                         _mm_mul_ps(_mm_and_ps(b, abs_mask), ey)),
+                              _mm_mul_ps(_mm_and_ps(c, abs_mask), ez));
+        out = _mm_or_ps(out, _mm_cmplt_ps(_mm_add_ps(dist, r), _mm_setzero_ps()));
+        cross = _mm_or_ps(cross, _mm_cmplt_ps(_mm_sub_ps(dist, r), _mm_setzero_ps()));
+    }
+    *outside = _mm_movemask_ps(out);
+    *straddle = _mm_movemask_ps(cross);
+#else
+    *outside = *straddle = 0;
+    for (int k = 0; k < 4; ++k) {
+        for (int p = 0; p < 6; ++p) {
+            const float *pl = planes[p];
+            float dist = pl[0] * node->cx[k] + pl[1] * node->cy[k] + pl[2] * node->cz[k] + pl[3];
+            float r = fabsf(pl[0]) * node->ex[k] + fabsf(pl[1]) * node->ey[k] + fabsf(pl[2]) * node->ez[k];
+            if (dist + r < 0) *outside |= 1 << k;
+            if (dist - r < 0) *straddle |= 1 << k;
+        }
+    }
+#endif
+}
+
+// Children in order, so emitted ranges come out sorted and merge
+static void cull_node(CullState *s, int index) {
+    const BvhNode *node = &s->b->nodes[index];
+    int outside, straddle;
+    classify(node, s->planes, &outside, &straddle);
+    for (int k = 0; k < 4; ++k) {
+        if (!node->count[k] || (outside >> k & 1)) continue;
+        if (node->child[k] < 0 || !(straddle >> k & 1)) emit(s, node->first[k], node->count[k]);
+        else cull_node(s, node->child[k]);
+    }
+}
+
+int bvh_cull(const Bvh *b, const float planes[6][4], BvhRange *ranges, uint32_t *visible) {
+    CullState s = { b, planes, ranges, 0, 0 };
+    if (b->root >= 0) cull_node(&s, b->root);
+    if (visible) *visible = s.visible;
+    return s.range_count;
+}
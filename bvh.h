@@ -0,0 +1,60 @@
+// bvh.h
+// Frustum culling for loaded meshes. Triangles are sorted along a Morton
+// curve so that consecutive runs ("clusters") are spatially compact; a
+// 4-wide BVH is built bottom-up over the cluster bounds, one tree level
+// at a time, with each level's nodes computed in parallel.
+//
+// Child boxes are stored as centre/half-extent in SoA form so the cull
+// tests all four children against a plane at once (SSE2 when available).
+// Culling returns visible clusters as merged [first, first + count) runs,
+// ready to become one draw call each.
+#ifndef BVH_H
+#define BVH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    float min[3], max[3];
+} BvhBox;
+
+typedef struct {
+    float cx[4], cy[4], cz[4];      // child box centres
+    float ex[4], ey[4], ez[4];      // child box half extents
+    int32_t child[4];               // inner node index, or -1 when the children are clusters
+    uint32_t first[4], count[4];    // clusters under each child; count 0 = empty slot
+} BvhNode;
+
+typedef struct {
+    BvhNode *nodes;
+    int node_count, root;
+    uint32_t cluster_count;
+} Bvh;
+
+typedef struct {
+    uint32_t first, count;          // cluster range
+} BvhRange;
+
+// Reorders triangles (3 indices each) by the Morton code of their centroid
+// within the given bounds.
+void bvh_sort_triangles(const float *positions, unsigned *indices, size_t triangle_count,
+                        const float bounds_min[3], const float bounds_max[3]);
+
+// Bounds of each run of cluster_triangles triangles (the last may be
+// shorter); out needs ceil(triangle_count / cluster_triangles) entries.
+void bvh_cluster_bounds(const float *positions, const unsigned *indices, size_t triangle_count,
+                        uint32_t cluster_triangles, BvhBox *out);
+
+int bvh_build(Bvh *b, const BvhBox *clusters, uint32_t count);
+void bvh_free(Bvh *b);
+
+// Frustum planes as (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside,
+// e.g. from bvh_planes_from_matrix. `ranges` needs room for
+// cluster_count entries. Returns the number of ranges; *visible gets the
+// number of visible clusters.
+int bvh_cull(const Bvh *b, const float planes[6][4], BvhRange *ranges, uint32_t *visible);
+
+// Planes of the clip volume of a column-major projection * modelview.
+void bvh_planes_from_matrix(const float m[16], float planes[6][4]);
+
+#endif
@@ -1,164 +1,243 @@
 // cube_chars.c
-// Compile: gcc cube_chars.c -o cube_chars -lGL -lGLU -lglut -lm
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
+// Compile: gcc cube_chars.c cube_chars_draw.c pick.c inputlog.c mesh.c meshcache.c meshgl.c meshopt.c fit.c bvh.c lod.c meshlet.c occlusion.c normals.c parallel.c anim.c inertia.c glstate.c hud.c trace.c -o cube_chars -pthread -lGL -lGLU -lglut -lm
 #include <GL/glut.h>
+#include <math.h>
 #include <stdio.h>
-
-GLuint texIDs[6];
-const char* filenames[6] = {
-    "up.png",    // +Z in our scene
-    "down.png",  // -Z
-    "left.png",  // -X
-    "right.png", // +X
-    "front.png", // +Y
-    "back.png"   // -Y
-};
+#include <stdlib.h>
+#include <string.h>
+#include "anim.h"
+#include "cube_chars_draw.h"
+#include "fit.h"
+#include "inertia.h"
+#include "inputlog.h"
+#include "meshgl.h"
+#include "pick.h"
+#include "glstate.h"
+#include "hud.h"
+#include "trace.h"
 
 float rotX = 20.0f; // main scene rotation
 float rotY = -25.0f;
+float rotZ = 0.0f;  // only non-zero while a snap animation passes between faces
 int lastX = 0, lastY = 0;
 int dragging = 0;
 int cubeDragging = 0;
 float zoom = 6.0f; // initial camera distance
+float panX = 0.0f, panY = 0.0f; // camera offset from fit view ('f')
 
 int hoverInCube = 0;
 int hoverScreenX = 0, hoverScreenY = 0; // in pixels, relative to hovered viewport
 
-typedef enum {
-    FACE_NONE = -1,
-    FACE_POS_X,
-    FACE_NEG_X,
-    FACE_POS_Y,
-    FACE_NEG_Y,
-    FACE_POS_Z,
-    FACE_NEG_Z
-} FaceID;
 FaceID hoveredFace = FACE_NONE;
 
+// --model FILE: drawn at the origin, fitted to this edge length, with the axes on top
+MeshGL modelGL;
+int modelLoaded = 0;
+float modelSize = 2.0f;
+int modelTimerPending = 0;
+
 // torus parameters (tweak to taste)
 float torusInnerRadius = 0.12f; // tube radius
 float torusOuterRadius = 1.6f;  // distance from origin to tube center
 int   torusSides = 32;
 int   torusRings = 48;
 
-GLuint texDonut[4]; // 0:East, 1:West, 2:South, 3:North
+// Snap animation (face click -> slerp to the face orientation)
+OrientAnim snapAnim;
+double snapDuration = 0.35; // seconds
+EaseType snapEase = EASE_IN_OUT_CUBIC;
+int snapTimerPending = 0;
+int framing = 0;              // the snap also moves the camera from frameFrom to frameTo
+FitFrame frameFrom, frameTo;
+
+// Momentum mode ('m' toggles): keep orbiting after release, damped
+Inertia inertia;
+int momentumEnabled = 0;
+int inertiaTimerPending = 0;
+
+// Input record/replay: --record FILE logs the GLUT input callbacks,
+// --replay FILE [--fast] feeds a log back through the same handlers.
+// With --fast events are dispatched back to back and animations run on a
+// virtual clock taken from the event timestamps, so runs are repeatable.
+InputLog replayLog;
+int replaying = 0;
+int replayFast = 0;
+int replayNext = 0;
+double replayStart = 0;   // anim_now() when the replay began
+double replayClock = 0;   // virtual time (--fast)
+long replayFrames = 0;
+
+// Time base for animation and inertia
+double sceneNow(void) {
+    return replaying && replayFast ? replayClock : anim_now();
+}
+
+// Redisplay only when something on screen would change: requestRedisplay
+// fingerprints the render-relevant state and skips the redraw when it
+// matches the last frame drawn. 'c' hides the pointer readout, so passive
+// motion over the window stops costing a frame per move.
+int showPointerCoords = 1;
+unsigned long long drawnFingerprint = 0;
+long redisplaysRequested = 0, redisplaysSkipped = 0;
+
+void formatStatus(char *buf, size_t size) {
+    if (showPointerCoords)
+        snprintf(buf, size, "%s: (%d, %d) px",
+                 hoverInCube ? "ViewCube" : "Main", hoverScreenX, hoverScreenY);
+    else
+        snprintf(buf, size, "%s", hoverInCube ? "ViewCube" : "Main");
+}
 
-GLuint loadTextureFromFile(const char* filename) {
-    int w, h, channels;
-    unsigned char* data = stbi_load(filename, &w, &h, &channels, 4);
-    if (!data) {
-        fprintf(stderr, "Failed to load %s\n", filename);
-        return 0;
+static unsigned long long fnv1a(unsigned long long h, const void *data, size_t n) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
     }
+    return h;
+}
 
-    GLuint texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+unsigned long long renderFingerprint(void) {
+    struct {
+        float rot[3], zoom, pan[2];
+        int hovered, win_w, win_h;
+        unsigned hud_mask;
+    } key;
+    char status[128];
+
+    memset(&key, 0, sizeof(key));
+    key.rot[0] = rotX; key.rot[1] = rotY; key.rot[2] = rotZ;
+    key.zoom = zoom;
+    key.pan[0] = panX; key.pan[1] = panY;
+    key.hovered = hoveredFace;
+    key.win_w = glutGet(GLUT_WINDOW_WIDTH);
+    key.win_h = glutGet(GLUT_WINDOW_HEIGHT);
+    for (int m = 0; m < HUD_METRIC_COUNT; ++m)
+        if (hud_enabled((HudMetric)m)) key.hud_mask |= 1u << m;
+    formatStatus(status, sizeof(status));
+
+    unsigned long long h = fnv1a(0xcbf29ce484222325ull, &key, sizeof(key));
+    return fnv1a(h, status, strlen(status));
+}
 
-    stbi_image_free(data);
-    return texID;
+void requestRedisplay(void) {
+    redisplaysRequested++;
+    if (renderFingerprint() == drawnFingerprint) {
+        redisplaysSkipped++;
+        return;
+    }
+    glutPostRedisplay();
 }
 
+// Face under the mouse (GL window coordinates); the math lives in pick.c
 FaceID pickCubeFace(int mx, int my, int winW, int winH,
                     int cubeX, int cubeY, int cubeSize,
-                    float rotX_deg, float rotY_deg)
+                    float rotX_deg, float rotY_deg, float rotZ_deg)
 {
-    // Convert mouse to normalized device coords in cube viewport
-    if (mx < cubeX || mx > cubeX + cubeSize ||
-        my < cubeY || my > cubeY + cubeSize)
-        return FACE_NONE;
+    TRACE_SCOPE("pickCubeFace");
+    float rot[3] = { rotX_deg, rotY_deg, rotZ_deg };
+    return (FaceID)pick_cube_face(mx, my, cubeX, cubeY, cubeSize, rot);
+}
 
-    double ndcX = ((mx - cubeX) / (double)cubeSize) * 2.0 - 1.0;
-    double ndcY = ((my - cubeY) / (double)cubeSize) * 2.0 - 1.0;
-    ndcY = -ndcY; // OpenGL Y is opposite to window Y
+// Camera that frames the model (or the axes without one) at this orientation
+void computeFrame(const float euler[3], FitFrame *out) {
+    float rot[9], lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    fit_rotation(euler, rot);
+    if (modelLoaded) {
+        meshgl_view_extent(&modelGL, modelSize, rot, lo, hi);
+    } else {
+        static const float axes[] = { 0, 0, 0,  1, 0, 0,  0, 1, 0,  0, 0, 1 };
+        fit_extent_points(axes, 4, rot, lo, hi);
+    }
+    int w = glutGet(GLUT_WINDOW_WIDTH), h = glutGet(GLUT_WINDOW_HEIGHT);
+    fit_frame(lo, hi, 45.0f, h > 0 ? (float)w / h : 1.0f, out);
+}
 
-    // Build cube rotation matrix
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    glTranslatef(0.0f, 0.0f, -6.0f);
-    glRotatef(rotX_deg, 1, 0, 0);
-    glRotatef(rotY_deg, 0, 1, 0);
+void setFrame(const FitFrame *f) {
+    panX = f->pan[0];
+    panY = f->pan[1];
+    zoom = f->distance;
+}
 
-    double model[16], proj[16];
-    int viewport[4] = {0, 0, cubeSize, cubeSize};
-    glGetDoublev(GL_MODELVIEW_MATRIX, model);
-    glGetDoublev(GL_PROJECTION_MATRIX, proj);
+// Camera half of a snap, at the same eased progress as the rotation
+void stepFraming(double now) {
+    if (!framing) return;
+    FitFrame f;
+    fit_lerp(&frameFrom, &frameTo, anim_progress(&snapAnim, now), &f);
+    setFrame(&f);
+    if (!snapAnim.active) framing = 0;
+}
 
-    glPopMatrix();
+// Timer callback; only re-armed while the animation is running
+void snapAnimTick(int value) {
+    TRACE_SCOPE("snapAnimTick");
+    float e[3];
+    snapTimerPending = 0;
+    if (!snapAnim.active) return; // cancelled by a drag
+    int running = anim_update(&snapAnim, sceneNow(), e);
+    rotX = e[0]; rotY = e[1]; rotZ = e[2];
+    stepFraming(sceneNow());
+    requestRedisplay();
+    if (running) {
+        snapTimerPending = 1;
+        glutTimerFunc(16, snapAnimTick, 0);
+    }
+}
 
-    // Ray in object space
-    GLdouble ox, oy, oz;
-    GLdouble tx, ty, tz;
-    gluUnProject((mx - cubeX), (my - cubeY), 0.0, model, proj, viewport, &ox, &oy, &oz);
-    gluUnProject((mx - cubeX), (my - cubeY), 1.0, model, proj, viewport, &tx, &ty, &tz);
-
-    double dirX = tx - ox;
-    double dirY = ty - oy;
-    double dirZ = tz - oz;
-
-    // Normalize dir
-    double len = sqrt(dirX*dirX + dirY*dirY + dirZ*dirZ);
-    dirX /= len; dirY /= len; dirZ /= len;
-
-    // Cube is centered at origin with half-size s
-    double s = 0.8;
-    FaceID hitFace = FACE_NONE;
-    double nearestT = 1e9;
-
-    // Test each face
-    struct { FaceID id; double nx, ny, nz, px, py, pz; } faces[6] = {
-        { FACE_POS_X,  1, 0, 0,  s, 0, 0 },
-        { FACE_NEG_X, -1, 0, 0, -s, 0, 0 },
-        { FACE_POS_Y,  0, 1, 0, 0,  s, 0 },
-        { FACE_NEG_Y,  0,-1, 0, 0, -s, 0 },
-        { FACE_POS_Z,  0, 0, 1, 0, 0,  s },
-        { FACE_NEG_Z,  0, 0,-1, 0, 0, -s }
-    };
-
-    for (int i = 0; i < 6; i++) {
-        double denom = faces[i].nx*dirX + faces[i].ny*dirY + faces[i].nz*dirZ;
-        if (fabs(denom) < 1e-6) continue; // parallel
-
-        double t = ((faces[i].px - ox) * faces[i].nx +
-                    (faces[i].py - oy) * faces[i].ny +
-                    (faces[i].pz - oz) * faces[i].nz) / denom;
-
-        if (t > 0 && t < nearestT) {
-            // Intersection point
-            double ix = ox + t*dirX;
-            double iy = oy + t*dirY;
-            double iz = oz + t*dirZ;
-
-            // Check within bounds of face
-            if (fabs(ix - faces[i].px) <= 1e-3 || fabs(iy - faces[i].py) <= s + 1e-3 || fabs(iz - faces[i].pz) <= s + 1e-3) {
-                if (fabs(ix) <= s + 1e-3 &&
-                    fabs(iy) <= s + 1e-3 &&
-                    fabs(iz) <= s + 1e-3) {
-                    nearestT = t;
-                    hitFace = faces[i].id;
-                }
-            }
-        }
+// Fixed-step coasting; re-armed only until the motion settles
+void inertiaTick(int value) {
+    TRACE_SCOPE("inertiaTick");
+    float e[3];
+    inertiaTimerPending = 0;
+    if (!inertia.active) return;
+    int running = inertia_update(&inertia, sceneNow(), e);
+    rotX = e[0]; rotY = e[1]; rotZ = e[2];
+    requestRedisplay();
+    if (running) {
+        inertiaTimerPending = 1;
+        glutTimerFunc(16, inertiaTick, 0);
     }
+}
 
-    return hitFace;
+// Occlusion results arrive frames later; redraw when one shows a hidden
+// cluster. The view is unchanged, so this bypasses requestRedisplay
+void modelTick(int value) {
+    modelTimerPending = 0;
+    int r = meshgl_poll(&modelGL);
+    if (r > 0) {
+        glutPostRedisplay();
+    } else if (r == 0) {
+        modelTimerPending = 1;
+        glutTimerFunc(16, modelTick, 0);
+    }
 }
 
 void snapToFace(FaceID f) {
+    float tx, ty;
     switch (f) {
-        case FACE_POS_X: rotX = 0;   rotY = -90; break;
-        case FACE_NEG_X: rotX = 0;   rotY = 90;  break;
-        case FACE_POS_Y: rotX = -90; rotY = 0;   break;
-        case FACE_NEG_Y: rotX = 90;  rotY = 0;   break;
-        case FACE_POS_Z: rotX = 0;   rotY = 0;   break;
-        case FACE_NEG_Z: rotX = 0;   rotY = 180; break;
-        default: break;
+        case FACE_POS_X: tx = 0;   ty = -90; break;
+        case FACE_NEG_X: tx = 0;   ty = 90;  break;
+        case FACE_POS_Y: tx = -90; ty = 0;   break;
+        case FACE_NEG_Y: tx = 90;  ty = 0;   break;
+        case FACE_POS_Z: tx = 0;   ty = 0;   break;
+        case FACE_NEG_Z: tx = 0;   ty = 180; break;
+        default: return;
+    }
+
+    inertia_stop(&inertia);
+
+    // Start from what is on screen, so a click mid-animation does not jump
+    float from[3] = { rotX, rotY, rotZ };
+    float to[3] = { tx, ty, 0 };
+    anim_start_at(&snapAnim, sceneNow(), from, to, snapDuration, snapEase);
+    frameFrom.pan[0] = panX;
+    frameFrom.pan[1] = panY;
+    frameFrom.distance = zoom;
+    computeFrame(to, &frameTo);
+    framing = 1;
+    if (!snapTimerPending) {
+        snapTimerPending = 1;
+        glutTimerFunc(0, snapAnimTick, 0);
     }
 }
 
@@ -166,62 +245,9 @@ void snapToFace(FaceID f) {
 int cubeSize = 200;
 int cubeOffset = 20;
 
-void loadTextures() {
-    glGenTextures(6, texIDs);
-
-    for (int i = 0; i < 6; ++i) {
-        int w, h, comp;
-        unsigned char *data = stbi_load(filenames[i], &w, &h, &comp, 4);
-        if (!data) {
-            fprintf(stderr, "Failed to load %s\n", filenames[i]);
-            continue;
-        }
-        glBindTexture(GL_TEXTURE_2D, texIDs[i]);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0,
-                     GL_RGBA, GL_UNSIGNED_BYTE, data);
-        stbi_image_free(data);
-    }
-}
-
-void drawTexturedFace(GLuint tex, float size) {
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glEnable(GL_TEXTURE_2D);
-    glBegin(GL_QUADS);
-      glTexCoord2f(0.0f, 0.0f); glVertex3f(-size, -size, 0.0f);
-      glTexCoord2f(1.0f, 0.0f); glVertex3f( size, -size, 0.0f);
-      glTexCoord2f(1.0f, 1.0f); glVertex3f( size,  size, 0.0f);
-      glTexCoord2f(0.0f, 1.0f); glVertex3f(-size,  size, 0.0f);
-    glEnd();
-    glDisable(GL_TEXTURE_2D);
-}
-
-void drawDonutLabels(float innerR, float outerR, float height) {
-
-    texDonut[0] = loadTextureFromFile("east.png");  // 東 (+X)
-    texDonut[1] = loadTextureFromFile("west.png");  // 西 (-X)
-    texDonut[2] = loadTextureFromFile("south.png"); // 南 (+Z)
-    texDonut[3] = loadTextureFromFile("north.png"); // 北 (-Z)
-
-    float size =(outerR - innerR) / 2.0f; // label size
-    float pos = (outerR + innerR) / 2.0f;
-    // East (+X) West (-X) South (+Z) North (-Z)
-    glPushMatrix(); glTranslatef(pos,0.01f,0); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[0],size); glPopMatrix();
-    glPushMatrix(); glTranslatef(-pos,0.01f,0); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[1],size); glPopMatrix();
-    glPushMatrix(); glTranslatef(0,0.01f,pos); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[2],size); glPopMatrix();
-    glPushMatrix(); glTranslatef(0,0.01f,-pos); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[3],size); glPopMatrix();
-    glPushMatrix(); glTranslatef(pos,-0.01f,0); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[0],size); glPopMatrix();
-    glPushMatrix(); glTranslatef(-pos,-0.01f,0); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[1],size); glPopMatrix();
-    glPushMatrix(); glTranslatef(0,-0.01f,pos); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[2],size); glPopMatrix();
-    glPushMatrix(); glTranslatef(0,-0.01f,-pos); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[3],size); glPopMatrix();
-}
-
 void drawAxes(float length) {
-    glLineWidth(2.0f);
+    gls_line_width(2.0f);
+    hud_count_draw();
     glBegin(GL_LINES);
       glColor3f(1.0f, 0.0f, 0.0f); // X
       glVertex3f(0,0,0); glVertex3f(length,0,0);
@@ -232,90 +258,10 @@ void drawAxes(float length) {
     glEnd();
 }
 
-void highlightFaceOverlay(float size) {
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glColor4f(1.0f, 1.0f, 0.0f, 0.4f); // yellow tint
-    glBegin(GL_QUADS);
-      glVertex3f(-size, -size, 0.0f);
-      glVertex3f( size, -size, 0.0f);
-      glVertex3f( size,  size, 0.0f);
-      glVertex3f(-size,  size, 0.0f);
-    glEnd();
-    glDisable(GL_BLEND);
-}
-
-// Draw a flat 2D donut on the XZ plane (Y=0), centered at origin
-void drawFlatDonutXZ(float innerR, float outerR, int segments) {
-    float angleStep = 2.0f * M_PI / segments;
-
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= segments; i++) {
-        float angle = i * angleStep;
-        float x = cosf(angle);
-        float z = sinf(angle);
-
-        // Outer edge
-        glVertex3f(x * outerR, 0.0f, z * outerR);
-        // Inner edge
-        glVertex3f(x * innerR, 0.0f, z * innerR);
-    }
-    glEnd();
-}
-
-void drawViewCube(int winW, int winH) {
-    glViewport(winW - cubeSize - cubeOffset, winH - cubeSize - cubeOffset, cubeSize, cubeSize);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(30.0, 1.0, 1.0, 100.0);
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    glTranslatef(0, 0, -8.0f);
-    glRotatef(rotX, 1, 0, 0);
-    glRotatef(rotY, 0, 1, 0);
-
-    // draw donut on XZ plane around cube
-    glDisable(GL_TEXTURE_2D);
-    glColor3f(0.8f, 0.8f, 0.8f); // gold-ish
-    drawFlatDonutXZ(1.2f, 1.6f, 64);
-    drawDonutLabels(1.2f, 1.6f, 0.01f);
-    glEnable(GL_TEXTURE_2D);
-
-    glColor3f(0.8f, 0.8f, 0.8f); // Gray
-
-    float s = 0.7f;
-    // +X
-    glPushMatrix(); glTranslatef(s,0,0); glRotatef(-90,0,1,0); glRotatef(180,0,0,1);drawTexturedFace(texIDs[3],s); 
-    if (hoveredFace == FACE_POS_X) highlightFaceOverlay(s);
-    glPopMatrix();
-    // -X
-    glPushMatrix(); glTranslatef(-s,0,0); glRotatef(90,0,1,0); glRotatef(180,0,0,1); drawTexturedFace(texIDs[2],s); 
-    if (hoveredFace == FACE_NEG_X) highlightFaceOverlay(s);
-    glPopMatrix();
-    // +Z
-    glPushMatrix(); glTranslatef(0,s,0); glRotatef(90,1,0,0); drawTexturedFace(texIDs[0],s); 
-    if (hoveredFace == FACE_POS_Z) highlightFaceOverlay(s);
-    glPopMatrix();
-    // -Z
-    glPushMatrix(); glTranslatef(0,-s,0); glRotatef(-90,1,0,0); drawTexturedFace(texIDs[1],s); 
-    if (hoveredFace == FACE_NEG_Z) highlightFaceOverlay(s);
-    glPopMatrix();
-    // +Y
-    glPushMatrix(); glTranslatef(0,0,s);  glRotatef(180,0,1,0); glRotatef(180,0,0,1); drawTexturedFace(texIDs[4],s); 
-    if (hoveredFace == FACE_POS_Y) highlightFaceOverlay(s);
-    glPopMatrix();
-    // -Y
-    glPushMatrix(); glTranslatef(0,0,-s); glRotatef(0,0,1,0); glRotatef(180,0,0,1); drawTexturedFace(texIDs[5],s); 
-    if (hoveredFace == FACE_NEG_Y) highlightFaceOverlay(s);
-    glPopMatrix();
-}
-
 void drawStatusText() {
+    TRACE_SCOPE("drawStatusText");
     char buf[128];
-    snprintf(buf, sizeof(buf), "%s: (%d, %d) px",
-             hoverInCube ? "ViewCube" : "Main",
-             hoverScreenX, hoverScreenY);
+    formatStatus(buf, sizeof(buf));
 
     glMatrixMode(GL_PROJECTION);
     glPushMatrix();
@@ -331,6 +277,17 @@ void drawStatusText() {
     for (const char *c = buf; *c; c++)
         glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
 
+    // Performance HUD above the status line. Everything here runs after
+    // hud_frame_end(), so it is not counted in the numbers it shows.
+    char lines[HUD_MAX_LINES][64];
+    int n = hud_format_lines(lines, HUD_MAX_LINES);
+    for (int i = 0; i < n; ++i) {
+        glRasterPos2i(10, 32 + 22 * (n - 1 - i));
+        for (const char *c = lines[i]; *c; c++)
+            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
+    }
+    hud_draw_graph(10, 32 + 22 * n, 240, 60);
+
     glPopMatrix();
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
@@ -338,9 +295,14 @@ void drawStatusText() {
 }
 
 void display(void) {
+    TRACE_SCOPE("display");
     int winW = glutGet(GLUT_WINDOW_WIDTH);
     int winH = glutGet(GLUT_WINDOW_HEIGHT);
 
+    hud_frame_begin();
+    if (replaying) replayFrames++;
+    drawnFingerprint = renderFingerprint();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Main scene
@@ -350,9 +312,24 @@ void display(void) {
     gluPerspective(45.0, (float)winW/winH, 1.0, 100.0);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
-    glTranslatef(0,0,-zoom);
+    glTranslatef(-panX,-panY,-zoom);
+    glRotatef(rotZ, 0, 0, 1);
     glRotatef(rotX, 1, 0, 0);
     glRotatef(rotY, 0, 1, 0);
+    if (modelLoaded) {
+        MeshDrawStats ds;
+        glColor3f(0.75f, 0.75f, 0.8f);
+        meshgl_draw(&modelGL, modelSize, &ds);
+        for (unsigned i = 0; i < ds.draw_calls; ++i) hud_count_draw();
+        hud_count_clusters(ds.clusters_visible, ds.clusters_total);
+        hud_count_meshlets(ds.meshlets_backfacing, ds.meshlets_tested);
+        hud_count_occlusion(ds.clusters_occluded, ds.occlusion_queries);
+        hud_count_lod(ds.clusters_at_level, LOD_LEVELS);
+        if (ds.pending && !modelTimerPending) {
+            modelTimerPending = 1;
+            glutTimerFunc(16, modelTick, 0);
+        }
+    }
     drawAxes(1.0f);
 
     // ----- Status Overlay -----
@@ -370,28 +347,37 @@ void display(void) {
     glMatrixMode(GL_MODELVIEW);
 
     // Draw ViewCube
-    drawViewCube(winW, winH);
+    float rot[3] = { rotX, rotY, rotZ };
+    drawViewCube(winW - cubeSize - cubeOffset, winH - cubeSize - cubeOffset, cubeSize, rot, hoveredFace);
+
+    hud_frame_end();
 
     // Restore viewport to full window before drawing text
     glViewport(0, 0, glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
     drawStatusText();
 
-    glutSwapBuffers();
+    {
+        TRACE_SCOPE("glutSwapBuffers");
+        glutSwapBuffers();
+    }
+    gls_frame_end();
 }
 
 void reshape(int w, int h) {
+    TRACE_SCOPE("reshape");
     if (h==0) h=1;
     glViewport(0,0,w,h);
 }
 
 void mouseButton(int button, int state, int x, int y) {
+    TRACE_SCOPE("mouseButton");
     int winW = glutGet(GLUT_WINDOW_WIDTH);
     int winH = glutGet(GLUT_WINDOW_HEIGHT);
     int oglY = winH - y;
 
     // Mouse wheel zoom (Linux GLUT buttons 3 & 4)
-    if (button == 3 && state == GLUT_DOWN) { zoom -= 0.3f; if (zoom < 2) zoom = 2; glutPostRedisplay(); return; }
-    if (button == 4 && state == GLUT_DOWN) { zoom += 0.3f; if (zoom > 50) zoom = 50; glutPostRedisplay(); return; }
+    if (button == 3 && state == GLUT_DOWN) { framing = 0; zoom -= 0.3f; if (zoom < 2) zoom = 2; requestRedisplay(); return; }
+    if (button == 4 && state == GLUT_DOWN) { framing = 0; zoom += 0.3f; if (zoom > 50) zoom = 50; requestRedisplay(); return; }
 
     if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
         int cubeSize = 200;
@@ -402,24 +388,33 @@ void mouseButton(int button, int state, int x, int y) {
         if (x >= cubeX && x <= cubeX + cubeSize &&
             oglY >= cubeY && oglY <= cubeY + cubeSize) {
             // Click inside cube → pick face
-            FaceID f = pickCubeFace(x, oglY, winW, winH, cubeX, cubeY, cubeSize, rotX, rotY);
+            FaceID f = pickCubeFace(x, oglY, winW, winH, cubeX, cubeY, cubeSize, rotX, rotY, rotZ);
 
             if (f != FACE_NONE) {
                 snapToFace(f);
-                glutPostRedisplay();
                 return;
             }
         } else {
+            anim_cancel(&snapAnim);
+            framing = 0;
+            inertia_stop(&inertia);
             dragging = 1;
             lastX = x; lastY = y;
         }
     }
     if (button == GLUT_LEFT_BUTTON && state == GLUT_UP) {
+        float pos[3] = { rotX, rotY, rotZ };
+        if (dragging && momentumEnabled &&
+            inertia_release(&inertia, sceneNow(), pos) && !inertiaTimerPending) {
+            inertiaTimerPending = 1;
+            glutTimerFunc(16, inertiaTick, 0);
+        }
         dragging = 0;
     }
 }
 
 void mouseMotion(int x, int y) {
+    TRACE_SCOPE("mouseMotion");
     int winW = glutGet(GLUT_WINDOW_WIDTH);
     int winH = glutGet(GLUT_WINDOW_HEIGHT);
     int cubeSize = 200;
@@ -445,28 +440,237 @@ void mouseMotion(int x, int y) {
         rotY += (x - lastX) * 0.5f;
         rotX += (y - lastY) * 0.5f;
         lastX = x; lastY = y;
+
+        float pos[3] = { rotX, rotY, rotZ };
+        inertia_drag_sample(&inertia, sceneNow(), pos);
     }
 
-    glutPostRedisplay();
+    requestRedisplay();
+}
+
+void keyboard(unsigned char key, int x, int y) {
+    TRACE_SCOPE("keyboard");
+    if (key == 'm' || key == 'M') {
+        momentumEnabled = !momentumEnabled;
+        if (!momentumEnabled) inertia_stop(&inertia);
+    }
+    if (key == 's' || key == 'S') {
+        GlsCounters c = gls_last_frame();
+        printf("state calls last frame: %u issued, %u elided\n", c.issued, c.elided);
+        printf("redisplays: %ld requested, %ld skipped as unchanged\n",
+               redisplaysRequested, redisplaysSkipped);
+    }
+    // 'u' toggles frustum culling of the model (compare the HUD draw counts)
+    if ((key == 'u' || key == 'U') && modelLoaded) {
+        modelGL.culling = !modelGL.culling;
+        glutPostRedisplay();
+    }
+    // 'o' switches levels of detail off (full detail everywhere) and back to 1 px error
+    if ((key == 'o' || key == 'O') && modelLoaded) {
+        modelGL.lod_pixel_error = modelGL.lod_pixel_error > 0 ? 0.0f : 1.0f;
+        glutPostRedisplay();
+    }
+    // 'b' toggles backface culling of the model (meshlets on the CPU, faces in GL)
+    if ((key == 'b' || key == 'B') && modelLoaded) {
+        modelGL.backface_culling = !modelGL.backface_culling;
+        glutPostRedisplay();
+    }
+    // 'h' toggles occlusion culling of the model (hidden clusters, from last frame's queries)
+    if ((key == 'h' || key == 'H') && modelLoaded) {
+        modelGL.occlusion_culling = !modelGL.occlusion_culling;
+        glutPostRedisplay();
+    }
+    // 'f' frames the model at the current orientation
+    if (key == 'f' || key == 'F') {
+        float e[3] = { rotX, rotY, rotZ };
+        FitFrame f;
+        framing = 0;
+        computeFrame(e, &f);
+        setFrame(&f);
+        requestRedisplay();
+    }
+    if (key == 'c' || key == 'C') {
+        showPointerCoords = !showPointerCoords;
+        requestRedisplay();
+    }
+    // HUD: 1 CPU, 2 GPU, 3 draw calls, 4 state changes, 5 texture memory, 6 graph, 7 culling, 8 LOD
+    if (key >= '1' && key < '1' + HUD_METRIC_COUNT) {
+        hud_toggle((HudMetric)(key - '1'));
+        requestRedisplay();
+    }
+    // 't' starts/stops tracing; stopping writes Chrome trace JSON
+    if (key == 't' || key == 'T') {
+        if (!trace_recording) {
+            trace_clear();
+            trace_set_recording(1);
+        } else {
+            trace_set_recording(0);
+            if (trace_dump_json("cube_chars_trace.json") == 0)
+                printf("trace written to cube_chars_trace.json\n");
+        }
+    }
+}
+
+// GLUT callbacks: log the event, ignore live input during a replay
+void recMouse(int button, int state, int x, int y) {
+    if (replaying) return;
+    inputlog_record(anim_now(), INPUT_MOUSE, button, state, x, y);
+    mouseButton(button, state, x, y);
+}
+
+void recMotion(int x, int y) {
+    if (replaying) return;
+    inputlog_record(anim_now(), INPUT_MOTION, x, y, 0, 0);
+    mouseMotion(x, y);
+}
+
+void recPassiveMotion(int x, int y) {
+    if (replaying) return;
+    inputlog_record(anim_now(), INPUT_PASSIVE_MOTION, x, y, 0, 0);
+    mouseMotion(x, y);
+}
+
+void recReshape(int w, int h) {
+    if (!replaying) inputlog_record(anim_now(), INPUT_RESHAPE, w, h, 0, 0);
+    reshape(w, h);
+}
+
+void recKeyboard(unsigned char key, int x, int y) {
+    if (replaying) return;
+    inputlog_record(anim_now(), INPUT_KEY, key, x, y, 0);
+    keyboard(key, x, y);
+}
+
+void replayDispatch(const InputEvent *e) {
+    switch (e->type) {
+        case INPUT_MOUSE:          mouseButton(e->arg[0], e->arg[1], e->arg[2], e->arg[3]); break;
+        case INPUT_MOTION:
+        case INPUT_PASSIVE_MOTION: mouseMotion(e->arg[0], e->arg[1]); break;
+        case INPUT_RESHAPE:        glutReshapeWindow(e->arg[0], e->arg[1]); break;
+        case INPUT_KEY:            keyboard((unsigned char)e->arg[0], e->arg[1], e->arg[2]); break;
+        default: break;
+    }
+}
+
+// Bring animations up to the virtual clock before the next event reads rotX/Y/Z
+void replayStepAnimations(void) {
+    float e[3];
+    if (snapAnim.active) {
+        anim_update(&snapAnim, replayClock, e);
+        rotX = e[0]; rotY = e[1]; rotZ = e[2];
+        stepFraming(replayClock);
+    } else if (inertia.active) {
+        inertia_update(&inertia, replayClock, e);
+        rotX = e[0]; rotY = e[1]; rotZ = e[2];
+    }
+}
+
+void replayFinish(void) {
+    double wall = anim_now() - replayStart;
+    printf("replay: %d events, %ld frames in %.3f s (%.1f fps, %.3f ms/frame), "
+           "%ld of %ld redisplays skipped as unchanged\n",
+           replayLog.count, replayFrames, wall, replayFrames / wall,
+           replayFrames ? wall * 1e3 / replayFrames : 0.0,
+           redisplaysSkipped, redisplaysRequested);
+    inputlog_free(&replayLog);
+    exit(0);
+}
+
+// --fast: one event per idle call on the virtual clock
+void replayIdle(void) {
+    if (replayNext < replayLog.count) {
+        replayClock = replayLog.events[replayNext].t;
+        replayStepAnimations();
+        replayDispatch(&replayLog.events[replayNext++]);
+        requestRedisplay();
+        return;
+    }
+    if (snapAnim.active || inertia.active) {
+        replayClock += 1.0 / 60.0;  // let the last animation finish
+        replayStepAnimations();
+        requestRedisplay();
+        return;
+    }
+    replayFinish();
+}
+
+// Real time: dispatch what is due, then sleep until the next event is
+void replayTick(int value) {
+    double t = anim_now() - replayStart;
+    while (replayNext < replayLog.count && replayLog.events[replayNext].t <= t)
+        replayDispatch(&replayLog.events[replayNext++]);
+    if (replayNext < replayLog.count) {
+        double wait = replayLog.events[replayNext].t - t;
+        glutTimerFunc((unsigned)ceil(wait * 1e3), replayTick, 0);
+        return;
+    }
+    if (snapAnim.active || inertia.active) {
+        glutTimerFunc(16, replayTick, 0);   // their own timers drive them
+        return;
+    }
+    replayFinish();
 }
 
 void initGL() {
-    glEnable(GL_DEPTH_TEST);
+    gls_enable(GL_DEPTH_TEST);
     glClearColor(0.9f, 0.9f, 0.9f, 1.0f);
+    hud_init();
     loadTextures();
+    inertia_init(&inertia);
 }
 
 int main(int argc, char** argv) {
     glutInit(&argc, argv);
+
+    const char *recordPath = NULL, *replayPath = NULL, *modelPath = NULL;
+    int useCache = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) modelPath = argv[++i];
+        else if (strcmp(argv[i], "--no-cache") == 0) useCache = 0;
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else if (strcmp(argv[i], "--fast") == 0) replayFast = 1;
+        else {
+            fprintf(stderr, "usage: %s [--model FILE [--no-cache]] [--record FILE | --replay FILE [--fast]]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (replayPath) {
+        if (inputlog_load(replayPath, &replayLog) != 0) return 1;
+        replaying = 1;
+    } else if (recordPath) {
+        if (inputlog_record_start(recordPath, anim_now()) != 0) return 1;
+        atexit(inputlog_record_stop);
+    }
+
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(1200, 800);
     glutCreateWindow("AutoCAD-style ViewCube with Chinese Characters");
     initGL();
+    if (modelPath) {
+        // Parses on the first open and writes <model>.vcmesh; later opens map that
+        MeshLoadStats st;
+        if (meshgl_load(&modelGL, modelPath, useCache, &st) != 0) return 1;
+        printf("Loaded %s (%s): %zu vertices, %d triangles, %.1f MB in %.3f s (%.1f MB/s, %d threads)\n",
+               modelPath, st.format, modelGL.vertex_count, modelGL.index_count / 3,
+               st.bytes / 1e6, st.seconds, st.bytes / 1e6 / st.seconds, st.threads);
+        if (modelGL.acmr_after > 0)
+            printf("Vertex cache ACMR: %.3f -> %.3f\n", modelGL.acmr_before, modelGL.acmr_after);
+        if (!modelGL.backface_culling)
+            printf("Model is not closed and consistently wound; back faces are drawn ('b' forces culling)\n");
+        modelLoaded = 1;
+    }
     glutDisplayFunc(display);
-    glutReshapeFunc(reshape);
-    glutMouseFunc(mouseButton);
-    glutMotionFunc(mouseMotion);
-    glutPassiveMotionFunc(mouseMotion);
+    glutReshapeFunc(recReshape);
+    glutMouseFunc(recMouse);
+    glutMotionFunc(recMotion);
+    glutPassiveMotionFunc(recPassiveMotion);
+    glutKeyboardFunc(recKeyboard);
+    if (replaying) {
+        replayStart = anim_now();
+        if (replayFast) glutIdleFunc(replayIdle);
+        else glutTimerFunc(0, replayTick, 0);
+    }
     glutMainLoop();
     return 0;
 }
@@ -0,0 +1,197 @@
+// cube_chars_draw.c
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "cube_chars_draw.h"
+
+#include <GL/glu.h>
+#include <math.h>
+#include <stdio.h>
+#include "glstate.h"
+#include "hud.h"
+#include "trace.h"
+
+static GLuint texIDs[6];
+static const char* filenames[6] = {
+    "up.png",    // +Z in our scene
+    "down.png",  // -Z
+    "left.png",  // -X
+    "right.png", // +X
+    "front.png", // +Y
+    "back.png"   // -Y
+};
+
+static GLuint texDonut[4]; // 0:East, 1:West, 2:South, 3:North
+
+GLuint loadTextureFromFile(const char* filename) {
+    int w, h, channels;
+    unsigned char* data = stbi_load(filename, &w, &h, &channels, 4);
+    if (!data) {
+        fprintf(stderr, "Failed to load %s\n", filename);
+        return 0;
+    }
+
+    GLuint texID;
+    glGenTextures(1, &texID);
+    gls_bind_texture_2d(texID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    hud_add_texture_memory((long)w * h * 4);
+
+    stbi_image_free(data);
+    return texID;
+}
+
+void loadTextures(void) {
+    TRACE_SCOPE("loadTextures");
+    glGenTextures(6, texIDs);
+
+    for (int i = 0; i < 6; ++i) {
+        int w, h, comp;
+        unsigned char *data = stbi_load(filenames[i], &w, &h, &comp, 4);
+        if (!data) {
+            fprintf(stderr, "Failed to load %s\n", filenames[i]);
+            continue;
+        }
+        gls_bind_texture_2d(texIDs[i]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, data);
+        hud_add_texture_memory((long)w * h * 4);
+        stbi_image_free(data);
+    }
+}
+
+// Leaves GL_TEXTURE_2D enabled; untextured drawing disables it first, so
+// consecutive faces only pay for the texture bind.
+void drawTexturedFace(GLuint tex, float size) {
+    gls_bind_texture_2d(tex);
+    gls_enable(GL_TEXTURE_2D);
+    hud_count_draw();
+    glBegin(GL_QUADS);
+      glTexCoord2f(0.0f, 0.0f); glVertex3f(-size, -size, 0.0f);
+      glTexCoord2f(1.0f, 0.0f); glVertex3f( size, -size, 0.0f);
+      glTexCoord2f(1.0f, 1.0f); glVertex3f( size,  size, 0.0f);
+      glTexCoord2f(0.0f, 1.0f); glVertex3f(-size,  size, 0.0f);
+    glEnd();
+}
+
+static void drawDonutLabels(float innerR, float outerR, float height) {
+
+    // Load once; this used to create four new textures every frame
+    if (!texDonut[0]) {
+        texDonut[0] = loadTextureFromFile("east.png");  // 東 (+X)
+        texDonut[1] = loadTextureFromFile("west.png");  // 西 (-X)
+        texDonut[2] = loadTextureFromFile("south.png"); // 南 (+Z)
+        texDonut[3] = loadTextureFromFile("north.png"); // 北 (-Z)
+    }
+
+    float size =(outerR - innerR) / 2.0f; // label size
+    float pos = (outerR + innerR) / 2.0f;
+    // East (+X) West (-X) South (+Z) North (-Z)
+    glPushMatrix(); glTranslatef(pos,0.01f,0); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[0],size); glPopMatrix();
+    glPushMatrix(); glTranslatef(-pos,0.01f,0); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[1],size); glPopMatrix();
+    glPushMatrix(); glTranslatef(0,0.01f,pos); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[2],size); glPopMatrix();
+    glPushMatrix(); glTranslatef(0,0.01f,-pos); glRotatef(90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[3],size); glPopMatrix();
+    glPushMatrix(); glTranslatef(pos,-0.01f,0); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[0],size); glPopMatrix();
+    glPushMatrix(); glTranslatef(-pos,-0.01f,0); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[1],size); glPopMatrix();
+    glPushMatrix(); glTranslatef(0,-0.01f,pos); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[2],size); glPopMatrix();
+    glPushMatrix(); glTranslatef(0,-0.01f,-pos); glRotatef(-90,1,0,0); glRotatef(0,0,0,1); drawTexturedFace(texDonut[3],size); glPopMatrix();
+}
+
+// Same quad as the face just drawn, so it needs GL_LEQUAL to pass the depth
+// test; restores the face colour so later faces are not tinted too.
+static void highlightFaceOverlay(float size) {
+    gls_disable(GL_TEXTURE_2D);
+    gls_enable(GL_BLEND);
+    gls_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthFunc(GL_LEQUAL);
+    glColor4f(1.0f, 1.0f, 0.0f, 0.4f); // yellow tint
+    hud_count_draw();
+    glBegin(GL_QUADS);
+      glVertex3f(-size, -size, 0.0f);
+      glVertex3f( size, -size, 0.0f);
+      glVertex3f( size,  size, 0.0f);
+      glVertex3f(-size,  size, 0.0f);
+    glEnd();
+    glDepthFunc(GL_LESS);
+    glColor3f(0.8f, 0.8f, 0.8f);
+    gls_disable(GL_BLEND);
+}
+
+// Draw a flat 2D donut on the XZ plane (Y=0), centered at origin
+static void drawFlatDonutXZ(float innerR, float outerR, int segments) {
+    float angleStep = 2.0f * M_PI / segments;
+
+    hud_count_draw();
+    glBegin(GL_TRIANGLE_STRIP);
+    for (int i = 0; i <= segments; i++) {
+        float angle = i * angleStep;
+        float x = cosf(angle);
+        float z = sinf(angle);
+
+        // Outer edge
+        glVertex3f(x * outerR, 0.0f, z * outerR);
+        // Inner edge
+        glVertex3f(x * innerR, 0.0f, z * innerR);
+    }
+    glEnd();
+}
+
+void drawViewCube(int x, int y, int size, const float rot[3], FaceID hovered) {
+    TRACE_SCOPE("drawViewCube");
+    glViewport(x, y, size, size);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(30.0, 1.0, 1.0, 100.0);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glTranslatef(0, 0, -8.0f);
+    glRotatef(rot[2], 0, 0, 1);
+    glRotatef(rot[0], 1, 0, 0);
+    glRotatef(rot[1], 0, 1, 0);
+
+    // draw donut on XZ plane around cube
+    gls_disable(GL_TEXTURE_2D);
+    glColor3f(0.8f, 0.8f, 0.8f); // gold-ish
+    drawFlatDonutXZ(1.2f, 1.6f, 64);
+    drawDonutLabels(1.2f, 1.6f, 0.01f);
+    gls_enable(GL_TEXTURE_2D);
+
+    glColor3f(0.8f, 0.8f, 0.8f); // Gray
+
+    float s = 0.7f;
+    // +X
+    glPushMatrix(); glTranslatef(s,0,0); glRotatef(-90,0,1,0); glRotatef(180,0,0,1);drawTexturedFace(texIDs[3],s); 
+    if (hovered == FACE_POS_X) highlightFaceOverlay(s);
+    glPopMatrix();
+    // -X
+    glPushMatrix(); glTranslatef(-s,0,0); glRotatef(90,0,1,0); glRotatef(180,0,0,1); drawTexturedFace(texIDs[2],s); 
+    if (hovered == FACE_NEG_X) highlightFaceOverlay(s);
+    glPopMatrix();
+    // +Z
+    glPushMatrix(); glTranslatef(0,s,0); glRotatef(90,1,0,0); drawTexturedFace(texIDs[0],s); 
+    if (hovered == FACE_POS_Z) highlightFaceOverlay(s);
+    glPopMatrix();
+    // -Z
+    glPushMatrix(); glTranslatef(0,-s,0); glRotatef(-90,1,0,0); drawTexturedFace(texIDs[1],s); 
+    if (hovered == FACE_NEG_Z) highlightFaceOverlay(s);
+    glPopMatrix();
+    // +Y
+    glPushMatrix(); glTranslatef(0,0,s);  glRotatef(180,0,1,0); glRotatef(180,0,0,1); drawTexturedFace(texIDs[4],s); 
+    if (hovered == FACE_POS_Y) highlightFaceOverlay(s);
+    glPopMatrix();
+    // -Y
+    glPushMatrix(); glTranslatef(0,0,-s); glRotatef(0,0,1,0); glRotatef(180,0,0,1); drawTexturedFace(texIDs[5],s); 
+    if (hovered == FACE_NEG_Y) highlightFaceOverlay(s);
+    glPopMatrix();
+
+    // Untextured from here on (axes, status text)
+    gls_disable(GL_TEXTURE_2D);
+}
+
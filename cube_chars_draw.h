@@ -0,0 +1,32 @@
+// cube_chars_draw.h
+// Drawing for cube_chars' textured ViewCube: the six character faces, the
+// compass donut with its labels and the hover tint. Kept apart from the
+// GLUT program so offscreen tools (golden images) render the same code.
+//
+// Textures are loaded from the working directory (up.png ... north.png).
+#ifndef CUBE_CHARS_DRAW_H
+#define CUBE_CHARS_DRAW_H
+
+#include <GL/gl.h>
+
+typedef enum {
+    FACE_NONE = -1,
+    FACE_POS_X,
+    FACE_NEG_X,
+    FACE_POS_Y,
+    FACE_NEG_Y,
+    FACE_POS_Z,
+    FACE_NEG_Z
+} FaceID;
+
+GLuint loadTextureFromFile(const char* filename);
+void loadTextures(void);
+
+// Leaves GL_TEXTURE_2D enabled; see the definition.
+void drawTexturedFace(GLuint tex, float size);
+
+// Sets its own viewport (x, y, size: GL window coordinates) and matrices.
+// rot is the scene orientation in degrees, Euler order Z, X, Y.
+void drawViewCube(int x, int y, int size, const float rot[3], FaceID hovered);
+
+#endif
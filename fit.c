@@ -0,0 +1,172 @@
+// fit.c
+#include "fit.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "parallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define MAX_PARTS 64
+#define NODES_PER_PART 2048
+
+void fit_rotation(const float euler[3], float rot[9]) {
+    float x = euler[0] * (float)M_PI / 180, y = euler[1] * (float)M_PI / 180, z = euler[2] * (float)M_PI / 180;
+    float cx = cosf(x), sx = sinf(x), cy = cosf(y), sy = sinf(y), cz = cosf(z), sz = sinf(z);
+    // Rx * Ry, then Rz on the left
+    float a[9] = { cy, 0, sy,
+                   sx * sy, cx, -sx * cy,
+                   -cx * sy, sx, cx * cy };
+    for (int c = 0; c < 3; ++c) {
+        rot[c] = cz * a[c] - sz * a[3 + c];
+        rot[3 + c] = sz * a[c] + cz * a[3 + c];
+        rot[6 + c] = a[6 + c];
+    }
+}
+
+typedef struct {
+    const BvhNode *leaves;
+    const float *points;
+    size_t count, parts;
+    const float *rot;
+    float min[MAX_PARTS][3], max[MAX_PARTS][3];
+} ExtentJob;
+
+static void part_span(const ExtentJob *j, size_t p, size_t *begin, size_t *end) {
+    *begin = j->count * p / j->parts;
+    *end = j->count * (p + 1) / j->parts;
+}
+
+static void nodes_range(void *ctx, size_t pbegin, size_t pend) {
+    ExtentJob *j = ctx;
+    const float *r = j->rot;
+    for (size_t p = pbegin; p < pend; ++p) {
+        size_t begin, end;
+        part_span(j, p, &begin, &end);
+        for (int a = 0; a < 3; ++a) {
+#if defined(__SSE2__)
+            __m128 r0 = _mm_set1_ps(r[3 * a]), r1 = _mm_set1_ps(r[3 * a + 1]), r2 = _mm_set1_ps(r[3 * a + 2]);
+            __m128 a0 = _mm_set1_ps(fabsf(r[3 * a])), a1 = _mm_set1_ps(fabsf(r[3 * a + 1]));
+            __m128 a2 = _mm_set1_ps(fabsf(r[3 * a + 2]));
+            __m128 lo = _mm_set1_ps(INFINITY), hi = _mm_set1_ps(-INFINITY);
+            for (size_t i = begin; i < end; ++i) {
+                const BvhNode *n = &j->leaves[i];
+                __m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, _mm_loadu_ps(n->cx)), _mm_mul_ps(r1, _mm_loadu_ps(n->cy))),
+                                      _mm_mul_ps(r2, _mm_loadu_ps(n->cz)));
+                __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_loadu_ps(n->ex)), _mm_mul_ps(a1, _mm_loadu_ps(n->ey))),
+                                      _mm_mul_ps(a2, _mm_loadu_ps(n->ez)));
+                // Empty slots (count 0) must not pull the bounds to their zero box
+                __m128 used = _mm_castsi128_ps(_mm_xor_si128(
+                    _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)n->count), _mm_setzero_si128()),
+                    _mm_set1_epi32(-1)));
+                lo = _mm_min_ps(lo, _mm_or_ps(_mm_and_ps(used, _mm_sub_ps(c, e)),
+                                              _mm_andnot_ps(used, _mm_set1_ps(INFINITY))));
+                hi = _mm_max_ps(hi, _mm_or_ps(_mm_and_ps(used, _mm_add_ps(c, e)),
+                                              _mm_andnot_ps(used, _mm_set1_ps(-INFINITY))));
+            }
+            float l[4], h[4];
+            _mm_storeu_ps(l, lo);
+            _mm_storeu_ps(h, hi);
+            j->min[p][a] = fminf(fminf(l[0], l[1]), fminf(l[2], l[3]));
+            j->max[p][a] = fmaxf(fmaxf(h[0], h[1]), fmaxf(h[2], h[3]));
+#else
+            float lo = INFINITY, hi = -INFINITY;
+            for (size_t i = begin; i < end; ++i) {
+                const BvhNode *n = &j->leaves[i];
+                for (int k = 0; k < 4; ++k) {
+                    if (!n->count[k]) continue;
+                    float c = r[3 * a] * n->cx[k] + r[3 * a + 1] * n->cy[k] + r[3 * a + 2] * n->cz[k];
+                    float e = fabsf(r[3 * a]) * n->ex[k] + fabsf(r[3 * a + 1]) * n->ey[k] +
+                              fabsf(r[3 * a + 2]) * n->ez[k];
+                    lo = fminf(lo, c - e);
+                    hi = fmaxf(hi, c + e);
+                }
+            }
+            j->min[p][a] = lo;
+            j->max[p][a] = hi;
+#endif
+        }
+    }
+}
+
+static void points_range(void *ctx, size_t pbegin, size_t pend) {
+    ExtentJob *j = ctx;
+    const float *r = j->rot;
+    for (size_t p = pbegin; p < pend; ++p) {
+        size_t begin, end;
+        part_span(j, p, &begin, &end);
+        for (int a = 0; a < 3; ++a) {
+            float lo = INFINITY, hi = -INFINITY;
+            for (size_t i = begin; i < end; ++i) {
+                const float *q = j->points + 3 * i;
+                float d = r[3 * a] * q[0] + r[3 * a + 1] * q[1] + r[3 * a + 2] * q[2];
+                lo = fminf(lo, d);
+                hi = fmaxf(hi, d);
+            }
+            j->min[p][a] = lo;
+            j->max[p][a] = hi;
+        }
+    }
+}
+
+// Each part reduces privately; the partials are merged here
+static void run(ExtentJob *j, void (*fn)(void *, size_t, size_t), float min[3], float max[3]) {
+    size_t parts = j->count / NODES_PER_PART;
+    if (parts > (size_t)parallel_threads()) parts = (size_t)parallel_threads();
+    if (parts > MAX_PARTS) parts = MAX_PARTS;
+    j->parts = parts ? parts : 1;
+    parallel_for(j->parts, 1, fn, j);
+    for (size_t p = 0; p < j->parts; ++p) {
+        for (int a = 0; a < 3; ++a) {
+            min[a] = fminf(min[a], j->min[p][a]);
+            max[a] = fmaxf(max[a], j->max[p][a]);
+        }
+    }
+}
+
+void fit_extent_nodes(const BvhNode *leaves, size_t count, const float rot[9], float min[3], float max[3]) {
+    ExtentJob j;
+    memset(&j, 0, sizeof(j));
+    j.leaves = leaves;
+    j.count = count;
+    j.rot = rot;
+    run(&j, nodes_range, min, max);
+}
+
+void fit_extent_points(const float *xyz, size_t count, const float rot[9], float min[3], float max[3]) {
+    ExtentJob j;
+    memset(&j, 0, sizeof(j));
+    j.points = xyz;
+    j.count = count;
+    j.rot = rot;
+    run(&j, points_range, min, max);
+}
+
+void fit_frame(const float min[3], const float max[3], float fov_y_deg, float aspect, FitFrame *out) {
+    float t = tanf(fov_y_deg * (float)M_PI / 360);
+    float hw = 0.5f * (max[0] - min[0]), hh = 0.5f * (max[1] - min[1]);
+    if (!(hw >= 0) || !(hh >= 0)) {
+        out->pan[0] = out->pan[1] = 0;
+        out->distance = 8;
+        return;
+    }
+    // The near face is the largest on screen; fit it to both half-angles
+    float d = fmaxf(hh / t, hw / (t * (aspect > 0 ? aspect : 1))) * FIT_MARGIN;
+    if (d < FIT_MIN_GAP) d = FIT_MIN_GAP;
+    out->pan[0] = 0.5f * (min[0] + max[0]);
+    out->pan[1] = 0.5f * (min[1] + max[1]);
+    out->distance = max[2] + d;
+}
+
+void fit_lerp(const FitFrame *a, const FitFrame *b, float t, FitFrame *out) {
+    out->pan[0] = a->pan[0] + (b->pan[0] - a->pan[0]) * t;
+    out->pan[1] = a->pan[1] + (b->pan[1] - a->pan[1]) * t;
+    out->distance = a->distance + (b->distance - a->distance) * t;
+}
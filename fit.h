@@ -0,0 +1,40 @@
+// fit.h
+// Fit view: frames the model for a given orientation. The model's extent
+// along the view axes (its oriented box in view space) is reduced in
+// parallel with SSE, from the BVH leaf boxes when the model has them and
+// from raw points otherwise, then turned into a camera pan and distance
+// for the main view's perspective.
+//
+// The view is applied as glTranslatef(-pan[0], -pan[1], -distance)
+// followed by the Rz * Rx * Ry orientation (anim.h).
+#ifndef FIT_H
+#define FIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bvh.h"
+
+#define FIT_MARGIN 1.1f     // framed size over the tight size
+#define FIT_MIN_GAP 1.5f    // camera to near face; the views' near plane is 1
+
+typedef struct {
+    float pan[2];
+    float distance;
+} FitFrame;
+
+// Row-major view rotation for Euler angles in degrees (Rz * Rx * Ry).
+void fit_rotation(const float euler[3], float rot[9]);
+
+// Extent along the rows of rot, for count BVH leaf nodes (bvh.h) and for
+// count points (xyz); min/max are widened, so initialise them to
+// +INFINITY / -INFINITY before the first call.
+void fit_extent_nodes(const BvhNode *leaves, size_t count, const float rot[9], float min[3], float max[3]);
+void fit_extent_points(const float *xyz, size_t count, const float rot[9], float min[3], float max[3]);
+
+// Camera that shows the view-space box [min, max] with FIT_MARGIN to spare.
+void fit_frame(const float min[3], const float max[3], float fov_y_deg, float aspect, FitFrame *out);
+
+void fit_lerp(const FitFrame *a, const FitFrame *b, float t, FitFrame *out);
+
+#endif
@@ -0,0 +1,149 @@
+// glstate.c
+#define GL_GLEXT_PROTOTYPES
+#include "glstate.h"
+
+#include <GL/glext.h>
+
+enum {
+    CAP_DEPTH_TEST,
+    CAP_TEXTURE_2D,
+    CAP_BLEND,
+    CAP_LIGHTING,
+    CAP_CULL_FACE,
+    CAP_COUNT
+};
+
+#define UNKNOWN -1
+
+static struct {
+    int caps[CAP_COUNT];
+    long texture_2d;
+    long blend_src, blend_dst;
+    GLfloat line_width, point_size;   // < 0: unknown
+    long framebuffer;
+    GlsCounters cur, last;
+} gls = {
+    { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN },
+    UNKNOWN, UNKNOWN, UNKNOWN, -1.0f, -1.0f, UNKNOWN,
+    { 0, 0 }, { 0, 0 }
+};
+
+static int capIndex(GLenum cap) {
+    switch (cap) {
+        case GL_DEPTH_TEST: return CAP_DEPTH_TEST;
+        case GL_TEXTURE_2D: return CAP_TEXTURE_2D;
+        case GL_BLEND:      return CAP_BLEND;
+        case GL_LIGHTING:   return CAP_LIGHTING;
+        case GL_CULL_FACE:  return CAP_CULL_FACE;
+        default:            return -1;
+    }
+}
+
+void gls_invalidate(void) {
+    for (int i = 0; i < CAP_COUNT; ++i) gls.caps[i] = UNKNOWN;
+    gls.texture_2d = UNKNOWN;
+    gls.blend_src = gls.blend_dst = UNKNOWN;
+    gls.line_width = gls.point_size = -1.0f;
+    gls.framebuffer = UNKNOWN;
+}
+
+void gls_set(GLenum cap, int enabled) {
+    int i = capIndex(cap);
+    enabled = enabled ? 1 : 0;
+    if (i >= 0 && gls.caps[i] == enabled) {
+        gls.cur.elided++;
+        return;
+    }
+    if (enabled) glEnable(cap); else glDisable(cap);
+    if (i >= 0) gls.caps[i] = enabled;
+    gls.cur.issued++;
+}
+
+void gls_enable(GLenum cap) {
+    gls_set(cap, 1);
+}
+
+void gls_disable(GLenum cap) {
+    gls_set(cap, 0);
+}
+
+void gls_bind_texture_2d(GLuint tex) {
+    if (gls.texture_2d == (long)tex) {
+        gls.cur.elided++;
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, tex);
+    gls.texture_2d = tex;
+    gls.cur.issued++;
+}
+
+void gls_blend_func(GLenum sfactor, GLenum dfactor) {
+    if (gls.blend_src == (long)sfactor && gls.blend_dst == (long)dfactor) {
+        gls.cur.elided++;
+        return;
+    }
+    glBlendFunc(sfactor, dfactor);
+    gls.blend_src = sfactor;
+    gls.blend_dst = dfactor;
+    gls.cur.issued++;
+}
+
+void gls_line_width(GLfloat width) {
+    if (gls.line_width == width) {
+        gls.cur.elided++;
+        return;
+    }
+    glLineWidth(width);
+    gls.line_width = width;
+    gls.cur.issued++;
+}
+
+void gls_point_size(GLfloat size) {
+    if (gls.point_size == size) {
+        gls.cur.elided++;
+        return;
+    }
+    glPointSize(size);
+    gls.point_size = size;
+    gls.cur.issued++;
+}
+
+void gls_bind_framebuffer(GLuint fbo) {
+    if (gls.framebuffer == (long)fbo) {
+        gls.cur.elided++;
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    gls.framebuffer = fbo;
+    gls.cur.issued++;
+}
+
+void gls_assume(GLenum cap, int enabled) {
+    int i = capIndex(cap);
+    if (i >= 0) gls.caps[i] = enabled ? 1 : 0;
+}
+
+void gls_assume_line_width(GLfloat width) {
+    gls.line_width = width;
+}
+
+void gls_assume_point_size(GLfloat size) {
+    gls.point_size = size;
+}
+
+void gls_assume_framebuffer(GLuint fbo) {
+    gls.framebuffer = fbo;
+}
+
+void gls_frame_end(void) {
+    gls.last = gls.cur;
+    gls.cur.issued = gls.cur.elided = 0;
+}
+
+GlsCounters gls_last_frame(void) {
+    return gls.last;
+}
+
+GlsCounters gls_current(void) {
+    return gls.cur;
+}
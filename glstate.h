@@ -0,0 +1,47 @@
+// glstate.h
+// Thin redundant-state filter for fixed-function GL.
+//
+// Remembers the last value set for a handful of capabilities, the 2D
+// texture binding, the blend function, line width, point size and the
+// framebuffer binding, and drops calls that would not change anything.
+// Issued and elided calls are counted per frame.
+//
+// The cache starts (and after gls_invalidate is) "unknown", so the first
+// call of each kind always reaches GL. Code that changes tracked state
+// behind the cache's back must call gls_invalidate or gls_assume_*.
+// One cache per process: use it from the thread that owns the context.
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <GL/gl.h>
+
+typedef struct {
+    unsigned issued;   // calls forwarded to GL
+    unsigned elided;   // calls dropped as redundant
+} GlsCounters;
+
+void gls_invalidate(void);
+
+void gls_enable(GLenum cap);
+void gls_disable(GLenum cap);
+void gls_set(GLenum cap, int enabled);
+void gls_bind_texture_2d(GLuint tex);
+void gls_blend_func(GLenum sfactor, GLenum dfactor);
+void gls_line_width(GLfloat width);
+void gls_point_size(GLfloat size);
+void gls_bind_framebuffer(GLuint fbo);
+
+// Tell the cache what is bound without calling GL (e.g. from a host's
+// own state tracking).
+void gls_assume(GLenum cap, int enabled);
+void gls_assume_line_width(GLfloat width);
+void gls_assume_point_size(GLfloat size);
+void gls_assume_framebuffer(GLuint fbo);
+
+// Per-frame counters: gls_frame_end() moves the running counts into
+// the "last frame" slot and starts a new frame.
+void gls_frame_end(void);
+GlsCounters gls_last_frame(void);
+GlsCounters gls_current(void);
+
+#endif
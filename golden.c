@@ -0,0 +1,235 @@
+// golden.c
+// Golden-image regression check for the two ViewCube renderers: renders
+// canonical orientations and hover states offscreen and compares them with
+// the PNGs in goldens/. A pixel differs when any channel is off by more than
+// the tolerance; a case fails when more than --max-diff of its pixels
+// differ. Failing cases write <name>.actual.png and <name>.diff.png (red:
+// differing pixels over a faded copy of the golden) to the output dir.
+// A hover case also fails when it differs that little from the _none render
+// of its orientation: the pointer or face it names is not in view.
+//
+// Usage: golden [--update] [--dir DIR] [--out DIR] [--tolerance N]
+//               [--max-diff FRACTION] [--only SUBSTRING]
+// Exit status: 0 all passed, 1 a case failed or had no golden.
+#include <GL/gl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cube_chars_draw.h"
+#include "glstate.h"
+#include "headless.h"
+#include "png.h"
+#include "viewcube.h"
+
+#define IMAGE_SIZE 160
+
+// chars: faces cube_chars highlights in that orientation, all of them in view
+static const struct { const char *name; float rot[3]; FaceID chars[2]; } orientations[] = {
+    { "front",   {  0,        0,    0 }, { FACE_POS_Y, FACE_NONE } },
+    { "right",   {  0,      -90,    0 }, { FACE_POS_X, FACE_NONE } },
+    { "top",     { 90,        0,    0 }, { FACE_POS_Z, FACE_NONE } },
+    { "iso",     { 35.264f,  45,    0 }, { FACE_POS_Y, FACE_POS_Z } },
+    { "iso_low", {-35.264f, -135,   0 }, { FACE_POS_X, FACE_NEG_Y } },
+    { "tilted",  { 20,      -25,   30 }, { FACE_POS_Y, FACE_POS_X } },
+};
+#define NUM_ORIENTATIONS (int)(sizeof(orientations) / sizeof(orientations[0]))
+
+// libviewcube pointer positions, relative to the cube centre (top-left
+// origin); both land on a visible cell in every orientation above. Not the
+// exact centre: in the iso views that is the corner, under its marker.
+static const struct { const char *name; int dx, dy; } vc_hovers[] = {
+    { "none",        -1000, -1000 },
+    { "near_center", IMAGE_SIZE * 3 / 40, IMAGE_SIZE * 3 / 40 },
+    { "off_center",  -IMAGE_SIZE * 4 / 25, -IMAGE_SIZE * 4 / 25 },
+};
+
+// cube_chars case names, in FaceID order
+static const char *face_names[6] = { "pos_x", "neg_x", "pos_y", "neg_y", "pos_z", "neg_z" };
+
+static struct {
+    int update;
+    const char *dir, *out, *only;
+    int tolerance;
+    double max_diff;
+    int passed, failed, missing, written;
+} opt = { 0, "goldens", "golden_out", NULL, 8, 0.001 };
+
+static viewcube_t *vc;
+
+static void renderLibViewCube(const float rot[3], int hover) {
+    glClearColor(0.2f, 0.2f, 0.2f, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    viewcube_set_orientation(vc, rot[0], rot[1], rot[2]);
+    viewcube_pointer_move(vc, IMAGE_SIZE / 2 + vc_hovers[hover].dx,
+                          IMAGE_SIZE / 2 + vc_hovers[hover].dy);
+    viewcube_render(vc);
+}
+
+static void renderCubeChars(const float rot[3], FaceID face) {
+    glClearColor(0.9f, 0.9f, 0.9f, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    drawViewCube(0, 0, IMAGE_SIZE, rot, face);
+}
+
+static void writeImage(const char *dir, const char *name, const char *suffix,
+                       const unsigned char *rgba) {
+    char path[512];
+    mkdir(dir, 0755);
+    snprintf(path, sizeof(path), "%s/%s%s.png", dir, name, suffix);
+    if (png_write_rgba(path, IMAGE_SIZE, IMAGE_SIZE, rgba) == 0)
+        printf("  wrote %s\n", path);
+}
+
+static void capture(unsigned char *rgba) {
+    glFinish();
+    headless_read_rgba(rgba);
+    gls_frame_end();
+}
+
+// Pixels where a channel is off by more than the tolerance; marks them red
+// in diff (if given) over a faded copy of ref
+static int countDiffering(const unsigned char *actual, const unsigned char *ref,
+                          unsigned char *diff, int *worst) {
+    int bad = 0;
+    *worst = 0;
+    for (int i = 0; i < IMAGE_SIZE * IMAGE_SIZE; ++i) {
+        const unsigned char *a = actual + i * 4, *g = ref + i * 4;
+        int d = 0;
+        for (int c = 0; c < 3; ++c) {
+            int e = abs(a[c] - g[c]);
+            if (e > d) d = e;
+        }
+        if (d > *worst) *worst = d;
+        if (d > opt.tolerance) bad++;
+        if (!diff) continue;
+        unsigned char *o = diff + i * 4;
+        if (d > opt.tolerance) {
+            o[0] = 255; o[1] = 0; o[2] = 0;
+        } else {
+            unsigned char l = (unsigned char)(170 + (g[0] * 3 + g[1] * 6 + g[2]) / 30);
+            o[0] = o[1] = o[2] = l;
+        }
+        o[3] = 255;
+    }
+    return bad;
+}
+
+// none: the orientation's _none render for hover cases, which must differ
+// from it by more than --max-diff (in --update too) or the hover is not shown
+static void checkCase(const char *name, const unsigned char *actual, const unsigned char *none) {
+    char path[512];
+    int bad, worst;
+
+    if (none) {
+        bad = countDiffering(actual, none, NULL, &worst);
+        if (bad <= opt.max_diff * IMAGE_SIZE * IMAGE_SIZE) {
+            printf("FAIL    %s: hover changes only %d pixels of the _none render\n", name, bad);
+            writeImage(opt.out, name, ".actual", actual);
+            opt.failed++;
+            return;
+        }
+    }
+
+    snprintf(path, sizeof(path), "%s/%s.png", opt.dir, name);
+    if (opt.update) {
+        mkdir(opt.dir, 0755);
+        if (png_write_rgba(path, IMAGE_SIZE, IMAGE_SIZE, actual) == 0)
+            opt.written++;
+        return;
+    }
+
+    int w, h;
+    unsigned char *golden = png_read_rgba(path, &w, &h);
+    if (!golden || w != IMAGE_SIZE || h != IMAGE_SIZE) {
+        printf("MISSING %s (run with --update)\n", name);
+        writeImage(opt.out, name, ".actual", actual);
+        opt.missing++;
+        free(golden);
+        return;
+    }
+
+    static unsigned char diff[IMAGE_SIZE * IMAGE_SIZE * 4];
+    bad = countDiffering(actual, golden, diff, &worst);
+    free(golden);
+
+    double frac = bad / (double)(IMAGE_SIZE * IMAGE_SIZE);
+    if (frac > opt.max_diff) {
+        printf("FAIL    %s: %d pixels differ (%.3f%%), max channel error %d\n",
+               name, bad, frac * 100, worst);
+        writeImage(opt.out, name, ".actual", actual);
+        writeImage(opt.out, name, ".diff", diff);
+        opt.failed++;
+    } else {
+        printf("ok      %s", name);
+        if (bad) printf(" (%d pixels within budget)", bad);
+        printf("\n");
+        opt.passed++;
+    }
+}
+
+static int selected(const char *name) {
+    return !opt.only || strstr(name, opt.only);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--update") == 0) opt.update = 1;
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) opt.dir = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) opt.out = argv[++i];
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) opt.tolerance = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-diff") == 0 && i + 1 < argc) opt.max_diff = atof(argv[++i]);
+        else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) opt.only = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--update] [--dir DIR] [--out DIR] [--tolerance N]"
+                            " [--max-diff FRACTION] [--only SUBSTRING]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (headless_init(IMAGE_SIZE, IMAGE_SIZE) != 0)
+        return 1;
+    printf("renderer: %s\n", headless_renderer());
+    gls_enable(GL_DEPTH_TEST);
+
+    vc = viewcube_create();
+    viewcube_set_text_renderer(vc, viewcube_text_builtin, NULL);
+    viewcube_resize(vc, IMAGE_SIZE, IMAGE_SIZE);
+    viewcube_set_layout(vc, IMAGE_SIZE, 0);
+    loadTextures();
+
+    // _none is rendered even when --only skips it: hover cases compare with it
+    static unsigned char actual[IMAGE_SIZE * IMAGE_SIZE * 4], none[IMAGE_SIZE * IMAGE_SIZE * 4];
+    char name[128];
+    for (int o = 0; o < NUM_ORIENTATIONS; ++o) {
+        for (int h = 0; h < (int)(sizeof(vc_hovers) / sizeof(vc_hovers[0])); ++h) {
+            snprintf(name, sizeof(name), "viewcube_%s_%s", orientations[o].name, vc_hovers[h].name);
+            if (h && !selected(name)) continue;
+            renderLibViewCube(orientations[o].rot, h);
+            capture(h ? actual : none);
+            if (selected(name)) checkCase(name, h ? actual : none, h ? none : NULL);
+        }
+        renderCubeChars(orientations[o].rot, FACE_NONE);
+        capture(none);
+        snprintf(name, sizeof(name), "cube_chars_%s_none", orientations[o].name);
+        if (selected(name)) checkCase(name, none, NULL);
+        for (int h = 0; h < 2 && orientations[o].chars[h] != FACE_NONE; ++h) {
+            FaceID face = orientations[o].chars[h];
+            snprintf(name, sizeof(name), "cube_chars_%s_%s", orientations[o].name, face_names[face]);
+            if (!selected(name)) continue;
+            renderCubeChars(orientations[o].rot, face);
+            capture(actual);
+            checkCase(name, actual, none);
+        }
+    }
+
+    if (opt.update)
+        printf("%d goldens written to %s/, %d failed\n", opt.written, opt.dir, opt.failed);
+    else
+        printf("%d passed, %d failed, %d missing\n", opt.passed, opt.failed, opt.missing);
+
+    viewcube_destroy(vc);
+    headless_shutdown();
+    return opt.failed || opt.missing ? 1 : 0;
+}
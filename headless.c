@@ -0,0 +1,190 @@
+// headless.c
+#define GL_GLEXT_PROTOTYPES
+#include "headless.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int fb_width, fb_height;
+static GLuint fbo, color_rb, depth_rb;
+
+#ifdef HEADLESS_OSMESA
+
+#include <GL/osmesa.h>
+
+static OSMesaContext osmesa_ctx;
+static unsigned char *osmesa_buffer;
+
+static int create_context(int width, int height) {
+    osmesa_ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+    if (!osmesa_ctx) {
+        fprintf(stderr, "OSMesaCreateContextExt failed\n");
+        return -1;
+    }
+    osmesa_buffer = malloc((size_t)width * height * 4);
+    if (!osmesa_buffer ||
+        !OSMesaMakeCurrent(osmesa_ctx, osmesa_buffer, GL_UNSIGNED_BYTE, width, height)) {
+        fprintf(stderr, "OSMesaMakeCurrent failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int make_current(int on) {
+    if (on ? OSMesaMakeCurrent(osmesa_ctx, osmesa_buffer, GL_UNSIGNED_BYTE, fb_width, fb_height)
+           : OSMesaMakeCurrent(NULL, NULL, 0, 0, 0))
+        return 0;
+    fprintf(stderr, "OSMesaMakeCurrent failed\n");
+    return -1;
+}
+
+static void destroy_context(void) {
+    OSMesaDestroyContext(osmesa_ctx);
+    free(osmesa_buffer);
+}
+
+#else
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay egl_display = EGL_NO_DISPLAY;
+static EGLContext egl_context = EGL_NO_CONTEXT;
+static EGLSurface egl_surface = EGL_NO_SURFACE;
+
+static int create_context(int width, int height) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    const char *client_ext = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    int surfaceless = 0;
+
+    if (get_platform_display && client_ext &&
+        strstr(client_ext, "EGL_MESA_platform_surfaceless")) {
+        egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        surfaceless = egl_display != EGL_NO_DISPLAY;
+    }
+    if (!surfaceless)
+        egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor)) {
+        fprintf(stderr, "eglInitialize failed\n");
+        return -1;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "eglBindAPI(EGL_OPENGL_API) failed\n");
+        return -1;
+    }
+
+    const EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = NULL;
+    EGLint count = 0;
+    eglChooseConfig(egl_display, config_attribs, &config, 1, &count);
+
+    // Legacy (compatibility) context: the renderers use fixed function
+    egl_context = eglCreateContext(egl_display, count ? config : NULL, EGL_NO_CONTEXT, NULL);
+    if (egl_context == EGL_NO_CONTEXT) {
+        fprintf(stderr, "eglCreateContext failed (0x%x)\n", eglGetError());
+        return -1;
+    }
+
+    if (!surfaceless && count) {
+        const EGLint pbuffer_attribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+        egl_surface = eglCreatePbufferSurface(egl_display, config, pbuffer_attribs);
+    }
+    if (!eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context)) {
+        fprintf(stderr, "eglMakeCurrent failed (0x%x)\n", eglGetError());
+        return -1;
+    }
+    return 0;
+}
+
+static int make_current(int on) {
+    if (on ? eglMakeCurrent(egl_display, egl_surface, egl_surface, egl_context)
+           : eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT))
+        return 0;
+    fprintf(stderr, "eglMakeCurrent failed (0x%x)\n", eglGetError());
+    return -1;
+}
+
+static void destroy_context(void) {
+    eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (egl_surface != EGL_NO_SURFACE) eglDestroySurface(egl_display, egl_surface);
+    eglDestroyContext(egl_display, egl_context);
+    eglTerminate(egl_display);
+}
+
+#endif
+
+int headless_init(int width, int height) {
+    fb_width = width;
+    fb_height = height;
+    if (create_context(width, height) != 0)
+        return -1;
+
+#ifndef HEADLESS_OSMESA
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color_rb);
+    glGenRenderbuffers(1, &depth_rb);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_rb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_rb);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_rb);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "offscreen framebuffer incomplete\n");
+        return -1;
+    }
+#endif
+    glViewport(0, 0, width, height);
+    return 0;
+}
+
+void headless_shutdown(void) {
+#ifndef HEADLESS_OSMESA
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color_rb);
+    glDeleteRenderbuffers(1, &depth_rb);
+#endif
+    destroy_context();
+}
+
+unsigned headless_framebuffer(void) {
+    return fbo;
+}
+
+int headless_make_current(int on) {
+    return make_current(on);
+}
+
+const char *headless_renderer(void) {
+    const char *r = (const char *)glGetString(GL_RENDERER);
+    return r ? r : "unknown";
+}
+
+void headless_read_rgba(unsigned char *out) {
+    size_t row = (size_t)fb_width * 4;
+    unsigned char *tmp = malloc(row);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, fb_width, fb_height, GL_RGBA, GL_UNSIGNED_BYTE, out);
+
+    // GL rows are bottom-up
+    for (int y = 0; y < fb_height / 2; ++y) {
+        unsigned char *a = out + y * row;
+        unsigned char *b = out + (fb_height - 1 - y) * row;
+        memcpy(tmp, a, row);
+        memcpy(a, b, row);
+        memcpy(b, tmp, row);
+    }
+    free(tmp);
+}
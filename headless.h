@@ -0,0 +1,24 @@
+// headless.h
+// Offscreen GL context for tools that must run without a display.
+//
+// Uses EGL on Mesa's surfaceless platform (llvmpipe works without a GPU),
+// falling back to the default EGL display with a pbuffer. Built with
+// -DHEADLESS_OSMESA it uses OSMesa instead. In every case rendering goes
+// to an FBO of the requested size, left bound as the draw framebuffer.
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+int headless_init(int width, int height);   // 0 on success
+void headless_shutdown(void);
+
+unsigned headless_framebuffer(void);        // FBO name (0 with OSMesa)
+const char *headless_renderer(void);        // GL_RENDERER string
+
+// Binds (on) or releases (0) the context on the calling thread, to hand it
+// to another thread: release it here first, then bind it there.
+int headless_make_current(int on);
+
+// Read the framebuffer as RGBA8, top row first (image order).
+void headless_read_rgba(unsigned char *out);
+
+#endif
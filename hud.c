@@ -0,0 +1,192 @@
+// hud.c
+#define GL_GLEXT_PROTOTYPES
+#include "hud.h"
+#include "anim.h"
+#include "glstate.h"
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <stdio.h>
+#include <string.h>
+
+static struct {
+    int enabled[HUD_METRIC_COUNT];
+
+    // CPU
+    double frame_start;
+    double cpu_ms;
+
+    // GPU: two queries, used on alternate frames
+    int has_timer_query;
+    GLuint queries[2];
+    int query_pending[2];
+    int frame_index;
+    double gpu_ms;             // < 0 until the first result arrives
+
+    // Counters
+    unsigned draws_cur, draws_last;
+    unsigned states_last;
+    long texture_bytes;
+    unsigned clusters_visible_cur, clusters_total_cur;
+    unsigned clusters_visible_last, clusters_total_last;
+    unsigned meshlets_back_cur, meshlets_tested_cur;
+    unsigned meshlets_back_last, meshlets_tested_last;
+    unsigned occluded_cur, queries_cur, occluded_last, queries_last;
+    unsigned lod_cur[HUD_LOD_LEVELS], lod_last[HUD_LOD_LEVELS];
+
+    // Rolling graph of CPU frame time
+    float graph[HUD_GRAPH_SAMPLES];
+    int graph_head;
+} hud;
+
+void hud_init(void) {
+    for (int i = 0; i < HUD_METRIC_COUNT; ++i) hud.enabled[i] = 1;
+    hud.gpu_ms = -1.0;
+
+    const char *ext = (const char *)glGetString(GL_EXTENSIONS);
+    hud.has_timer_query = ext && strstr(ext, "GL_ARB_timer_query") != NULL;
+    if (hud.has_timer_query)
+        glGenQueries(2, hud.queries);
+}
+
+void hud_frame_begin(void) {
+    hud.frame_start = anim_now();
+    hud.draws_cur = 0;
+    hud.clusters_visible_cur = hud.clusters_total_cur = 0;
+    hud.meshlets_back_cur = hud.meshlets_tested_cur = 0;
+    hud.occluded_cur = hud.queries_cur = 0;
+    memset(hud.lod_cur, 0, sizeof(hud.lod_cur));
+
+    if (!hud.has_timer_query) return;
+
+    // Collect the result from two frames ago, only if it is ready
+    int q = hud.frame_index & 1;
+    if (hud.query_pending[q]) {
+        GLint available = 0;
+        glGetQueryObjectiv(hud.queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(hud.queries[q], GL_QUERY_RESULT, &ns);
+            hud.gpu_ms = ns * 1e-6;
+            hud.query_pending[q] = 0;
+        }
+    }
+    // Still busy: skip timing this frame rather than wait
+    if (!hud.query_pending[q])
+        glBeginQuery(GL_TIME_ELAPSED, hud.queries[q]);
+}
+
+void hud_frame_end(void) {
+    if (hud.has_timer_query) {
+        int q = hud.frame_index & 1;
+        if (!hud.query_pending[q]) {
+            glEndQuery(GL_TIME_ELAPSED);
+            hud.query_pending[q] = 1;
+        }
+        hud.frame_index++;
+    }
+
+    hud.cpu_ms = (anim_now() - hud.frame_start) * 1e3;
+    hud.draws_last = hud.draws_cur;
+    hud.clusters_visible_last = hud.clusters_visible_cur;
+    hud.clusters_total_last = hud.clusters_total_cur;
+    hud.meshlets_back_last = hud.meshlets_back_cur;
+    hud.meshlets_tested_last = hud.meshlets_tested_cur;
+    hud.occluded_last = hud.occluded_cur;
+    hud.queries_last = hud.queries_cur;
+    memcpy(hud.lod_last, hud.lod_cur, sizeof(hud.lod_last));
+    hud.states_last = gls_current().issued;
+
+    hud.graph[hud.graph_head] = (float)hud.cpu_ms;
+    hud.graph_head = (hud.graph_head + 1) % HUD_GRAPH_SAMPLES;
+}
+
+void hud_count_draw(void) {
+    hud.draws_cur++;
+}
+
+void hud_count_clusters(unsigned visible, unsigned total) {
+    hud.clusters_visible_cur += visible;
+    hud.clusters_total_cur += total;
+}
+
+void hud_count_meshlets(unsigned backfacing, unsigned tested) {
+    hud.meshlets_back_cur += backfacing;
+    hud.meshlets_tested_cur += tested;
+}
+
+void hud_count_occlusion(unsigned occluded, unsigned queries) {
+    hud.occluded_cur += occluded;
+    hud.queries_cur += queries;
+}
+
+void hud_count_lod(const unsigned *clusters_per_level, int levels) {
+    for (int i = 0; i < levels && i < HUD_LOD_LEVELS; ++i) hud.lod_cur[i] += clusters_per_level[i];
+}
+
+void hud_add_texture_memory(long bytes) {
+    hud.texture_bytes += bytes;
+}
+
+int hud_enabled(HudMetric m) {
+    return hud.enabled[m];
+}
+
+void hud_toggle(HudMetric m) {
+    hud.enabled[m] = !hud.enabled[m];
+}
+
+int hud_format_lines(char lines[][64], int max_lines) {
+    int n = 0;
+    if (hud.enabled[HUD_CPU_TIME] && n < max_lines)
+        snprintf(lines[n++], 64, "CPU: %.2f ms", hud.cpu_ms);
+    if (hud.enabled[HUD_GPU_TIME] && n < max_lines) {
+        if (!hud.has_timer_query)
+            snprintf(lines[n++], 64, "GPU: n/a");
+        else if (hud.gpu_ms < 0)
+            snprintf(lines[n++], 64, "GPU: --");
+        else
+            snprintf(lines[n++], 64, "GPU: %.2f ms", hud.gpu_ms);
+    }
+    if (hud.enabled[HUD_DRAW_CALLS] && n < max_lines)
+        snprintf(lines[n++], 64, "Draw calls: %u", hud.draws_last);
+    if (hud.enabled[HUD_STATE_CHANGES] && n < max_lines)
+        snprintf(lines[n++], 64, "State changes: %u", hud.states_last);
+    if (hud.enabled[HUD_TEXTURE_MEMORY] && n < max_lines)
+        snprintf(lines[n++], 64, "Texture memory: %.1f KB", hud.texture_bytes / 1024.0);
+    if (hud.enabled[HUD_CULLING] && hud.clusters_total_last && n < max_lines)
+        snprintf(lines[n++], 64, "Culled: %u of %u clusters",
+                 hud.clusters_total_last - hud.clusters_visible_last, hud.clusters_total_last);
+    if (hud.enabled[HUD_CULLING] && hud.meshlets_tested_last && n < max_lines)
+        snprintf(lines[n++], 64, "Backfacing: %u of %u meshlets",
+                 hud.meshlets_back_last, hud.meshlets_tested_last);
+    if (hud.enabled[HUD_CULLING] && (hud.occluded_last || hud.queries_last) && n < max_lines)
+        snprintf(lines[n++], 64, "Occluded: %u clusters (%u queries)", hud.occluded_last, hud.queries_last);
+    if (hud.enabled[HUD_LOD] && hud.clusters_total_last && n < max_lines)
+        snprintf(lines[n++], 64, "LOD 0/1/2/3: %u / %u / %u / %u",
+                 hud.lod_last[0], hud.lod_last[1], hud.lod_last[2], hud.lod_last[3]);
+    return n;
+}
+
+void hud_draw_graph(int x, int y, int w, int h) {
+    if (!hud.enabled[HUD_GRAPH]) return;
+
+    // Full height = 33.3 ms; reference line at 16.7 ms (60 Hz)
+    const float scale = h / 33.3f;
+    float dx = (float)w / HUD_GRAPH_SAMPLES;
+
+    glBegin(GL_LINES);
+    glColor3f(0.5f, 0.5f, 0.5f);
+    glVertex2f(x, y + 16.7f * scale);
+    glVertex2f(x + w, y + 16.7f * scale);
+
+    glColor3f(0.1f, 0.6f, 0.1f);
+    for (int i = 0; i < HUD_GRAPH_SAMPLES; ++i) {
+        float ms = hud.graph[(hud.graph_head + i) % HUD_GRAPH_SAMPLES];
+        float bar = ms * scale;
+        if (bar > h) bar = (float)h;
+        glVertex2f(x + i * dx, (float)y);
+        glVertex2f(x + i * dx, y + bar);
+    }
+    glEnd();
+}
@@ -0,0 +1,52 @@
+// hud.h
+// Performance HUD metrics: CPU frame time, GPU time (GL_TIME_ELAPSED,
+// double-buffered so reading a result never stalls), draw calls, state
+// changes (from glstate), texture memory, a rolling frame-time graph and
+// model clusters culled by the view frustum and drawn at each level of
+// detail, meshlets culled as backfacing and clusters skipped as occluded.
+//
+// Call hud_frame_begin() at the top of display() and hud_frame_end() once
+// the scene is drawn but before the HUD itself, so the HUD's own work is
+// not part of what it reports.
+#ifndef HUD_H
+#define HUD_H
+
+typedef enum {
+    HUD_CPU_TIME,
+    HUD_GPU_TIME,
+    HUD_DRAW_CALLS,
+    HUD_STATE_CHANGES,
+    HUD_TEXTURE_MEMORY,
+    HUD_GRAPH,
+    HUD_CULLING,
+    HUD_LOD,
+    HUD_METRIC_COUNT
+} HudMetric;
+
+#define HUD_GRAPH_SAMPLES 120
+#define HUD_MAX_LINES 9
+#define HUD_LOD_LEVELS 4
+
+void hud_init(void);            // needs a current GL context
+
+void hud_frame_begin(void);
+void hud_frame_end(void);
+
+void hud_count_draw(void);      // one per glBegin/glDrawElements/...
+void hud_add_texture_memory(long bytes);
+void hud_count_clusters(unsigned visible, unsigned total);   // frustum-culling result
+void hud_count_meshlets(unsigned backfacing, unsigned tested); // backface-culling result
+void hud_count_occlusion(unsigned occluded, unsigned queries);  // occlusion-culling result
+void hud_count_lod(const unsigned *clusters_per_level, int levels);  // up to HUD_LOD_LEVELS
+
+int hud_enabled(HudMetric m);
+void hud_toggle(HudMetric m);
+
+// Text for the enabled metrics, one line each. Returns the line count.
+int hud_format_lines(char lines[][64], int max_lines);
+
+// Frame-time graph (one GL_LINES batch) in the rectangle x, y, w, h
+// (window pixels, origin bottom-left). Expects an ortho projection.
+void hud_draw_graph(int x, int y, int w, int h);
+
+#endif
@@ -0,0 +1,102 @@
+// inertia.c
+#include "inertia.h"
+
+#include <math.h>
+
+void inertia_init(Inertia *in) {
+    in->step = 1.0 / 120.0;
+    in->window = 0.08;
+    in->damping = 4.0f;
+    in->stop_speed = 2.0f;
+    inertia_stop(in);
+}
+
+void inertia_stop(Inertia *in) {
+    in->active = 0;
+    in->sample_count = 0;
+    in->sample_head = 0;
+    in->accumulator = 0.0;
+    for (int i = 0; i < 3; ++i) in->vel[i] = 0.0f;
+}
+
+void inertia_drag_sample(Inertia *in, double t, const float pos[3]) {
+    int i = in->sample_head;
+    in->sample_t[i] = t;
+    for (int k = 0; k < 3; ++k) in->sample_pos[i][k] = pos[k];
+    in->sample_head = (i + 1) % INERTIA_SAMPLES;
+    if (in->sample_count < INERTIA_SAMPLES) in->sample_count++;
+}
+
+// Least-squares slope of position over time for samples inside the window.
+static void estimate_velocity(const Inertia *in, double t_end, float vel[3]) {
+    double st = 0, stt = 0, sp[3] = {0}, stp[3] = {0};
+    int n = 0;
+
+    for (int j = 0; j < in->sample_count; ++j) {
+        int i = (in->sample_head - 1 - j + INERTIA_SAMPLES) % INERTIA_SAMPLES;
+        double dt = in->sample_t[i] - t_end;  // <= 0
+        if (dt < -in->window) break;
+        st += dt;
+        stt += dt * dt;
+        for (int k = 0; k < 3; ++k) {
+            sp[k] += in->sample_pos[i][k];
+            stp[k] += dt * in->sample_pos[i][k];
+        }
+        n++;
+    }
+
+    double denom = n * stt - st * st;
+    for (int k = 0; k < 3; ++k)
+        vel[k] = (n >= 2 && denom > 1e-12) ? (float)((n * stp[k] - st * sp[k]) / denom) : 0.0f;
+}
+
+static float speed(const float v[3]) {
+    return sqrtf(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+}
+
+int inertia_release(Inertia *in, double t, const float pos[3]) {
+    inertia_drag_sample(in, t, pos);
+    estimate_velocity(in, t, in->vel);
+    in->sample_count = 0;
+
+    if (speed(in->vel) < in->stop_speed) {
+        in->active = 0;
+        return 0;
+    }
+    for (int k = 0; k < 3; ++k) in->prev[k] = in->cur[k] = pos[k];
+    in->accumulator = 0.0;
+    in->last_time = t;
+    in->active = 1;
+    return 1;
+}
+
+int inertia_update(Inertia *in, double now, float out[3]) {
+    if (!in->active) return 0;
+
+    double frame = now - in->last_time;
+    in->last_time = now;
+    if (frame > 0.25) frame = 0.25;  // e.g. after the window was hidden
+    if (frame < 0.0) frame = 0.0;
+    in->accumulator += frame;
+
+    float decay = expf(-in->damping * (float)in->step);
+    while (in->accumulator >= in->step) {
+        for (int k = 0; k < 3; ++k) {
+            in->prev[k] = in->cur[k];
+            in->vel[k] *= decay;
+            in->cur[k] += in->vel[k] * (float)in->step;
+        }
+        in->accumulator -= in->step;
+    }
+
+    if (speed(in->vel) < in->stop_speed) {
+        for (int k = 0; k < 3; ++k) out[k] = in->cur[k];
+        in->active = 0;
+        return 0;
+    }
+
+    float alpha = (float)(in->accumulator / in->step);
+    for (int k = 0; k < 3; ++k)
+        out[k] = in->prev[k] + (in->cur[k] - in->prev[k]) * alpha;
+    return 1;
+}
@@ -0,0 +1,51 @@
+// inertia.h
+// Momentum ("inertial orbit") for drag rotation.
+//
+// While dragging, the caller feeds timestamped orientations; the angular
+// velocity is estimated from the most recent samples rather than from the
+// last event delta, so it does not depend on the mouse/X server event rate.
+// After release the orientation coasts with exponential damping, integrated
+// at a fixed timestep and interpolated for display.
+#ifndef INERTIA_H
+#define INERTIA_H
+
+#define INERTIA_SAMPLES 16
+
+typedef struct {
+    int active;               // coasting after release
+
+    // Drag history (ring buffer of Euler angles, degrees)
+    double sample_t[INERTIA_SAMPLES];
+    float sample_pos[INERTIA_SAMPLES][3];
+    int sample_count, sample_head;
+
+    // Fixed-step simulation state
+    float vel[3];             // degrees / second
+    float prev[3], cur[3];    // orientation at the previous / current step
+    double accumulator;
+    double last_time;
+
+    // Tunables
+    double step;              // fixed timestep, seconds
+    double window;            // velocity estimation window, seconds
+    float damping;            // exponential decay rate, 1/seconds
+    float stop_speed;         // below this (deg/s) the motion ends
+} Inertia;
+
+void inertia_init(Inertia *in);
+
+// Forget the drag history and stop coasting (mouse down, snap, ...).
+void inertia_stop(Inertia *in);
+
+// Record the orientation reached by a drag event at time t.
+void inertia_drag_sample(Inertia *in, double t, const float pos[3]);
+
+// Mouse released at time t with orientation pos. Returns 1 if the view
+// should keep coasting.
+int inertia_release(Inertia *in, double t, const float pos[3]);
+
+// Advance the simulation to `now` in fixed steps and write the interpolated
+// orientation to out[3]. Returns 1 while still moving, 0 once settled.
+int inertia_update(Inertia *in, double now, float out[3]);
+
+#endif
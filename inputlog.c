@@ -0,0 +1,127 @@
+// inputlog.c
+#include "inputlog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INPUTLOG_VERSION 1
+
+static const int arg_count[INPUT_TYPE_COUNT] = { 4, 2, 2, 2, 3 };
+
+static struct {
+    FILE *f;
+    double start;
+    long long last_us;
+} rec;
+
+static void put_varint(FILE *f, unsigned long long v) {
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7f) | 0x80, f);
+        v >>= 7;
+    }
+    fputc((int)v, f);
+}
+
+static int get_varint(FILE *f, unsigned long long *v) {
+    unsigned long long r = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(f);
+        if (c == EOF) return -1;
+        r |= (unsigned long long)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *v = r;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int inputlog_record_start(const char *path, double now) {
+    inputlog_record_stop();
+    rec.f = fopen(path, "wb");
+    if (!rec.f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return -1;
+    }
+    const unsigned char header[8] = { 'V', 'C', 'I', 'N', INPUTLOG_VERSION, 0, 0, 0 };
+    fwrite(header, 1, sizeof(header), rec.f);
+    rec.start = now;
+    rec.last_us = 0;
+    return 0;
+}
+
+int inputlog_recording(void) {
+    return rec.f != NULL;
+}
+
+void inputlog_record(double now, InputType type, int a0, int a1, int a2, int a3) {
+    if (!rec.f) return;
+    long long us = (long long)((now - rec.start) * 1e6);
+    if (us < rec.last_us) us = rec.last_us;
+    int args[4] = { a0, a1, a2, a3 };
+
+    fputc(type, rec.f);
+    put_varint(rec.f, (unsigned long long)(us - rec.last_us));
+    for (int i = 0; i < arg_count[type]; ++i)
+        put_varint(rec.f, ((unsigned)args[i] << 1) ^ (unsigned)(args[i] >> 31));   // zigzag
+    rec.last_us = us;
+}
+
+void inputlog_record_stop(void) {
+    if (!rec.f) return;
+    fclose(rec.f);
+    rec.f = NULL;
+}
+
+int inputlog_load(const char *path, InputLog *log) {
+    log->events = NULL;
+    log->count = 0;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot read %s\n", path);
+        return -1;
+    }
+    unsigned char header[8];
+    if (fread(header, 1, sizeof(header), f) != sizeof(header) ||
+        memcmp(header, "VCIN", 4) != 0 || header[4] != INPUTLOG_VERSION) {
+        fprintf(stderr, "%s: not an input log\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    int cap = 0;
+    long long us = 0;
+    int type;
+    while ((type = fgetc(f)) != EOF) {
+        unsigned long long dt, v;
+        if (type >= INPUT_TYPE_COUNT || get_varint(f, &dt) != 0) break;
+        if (log->count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            InputEvent *grown = realloc(log->events, sizeof(InputEvent) * cap);
+            if (!grown) break;
+            log->events = grown;
+        }
+        InputEvent *e = &log->events[log->count];
+        memset(e, 0, sizeof(*e));
+        us += (long long)dt;
+        e->t = us * 1e-6;
+        e->type = (InputType)type;
+        int ok = 1;
+        for (int i = 0; i < arg_count[type] && ok; ++i) {
+            ok = get_varint(f, &v) == 0;
+            if (ok) e->arg[i] = (int)((unsigned)(v >> 1) ^ -(unsigned)(v & 1));
+        }
+        if (!ok) break;
+        log->count++;
+    }
+    fclose(f);
+    return 0;
+}
+
+void inputlog_free(InputLog *log) {
+    free(log->events);
+    log->events = NULL;
+    log->count = 0;
+}
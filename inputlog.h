@@ -0,0 +1,39 @@
+// inputlog.h
+// Compact binary log of window-system input, for reproducible runs.
+//
+// File: "VCIN", u16 version, u16 reserved, then one record per event:
+// u8 type, LEB128 microseconds since the previous event, and the event's
+// arguments as zigzag LEB128 integers. A pointer motion is ~6 bytes.
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+typedef enum {
+    INPUT_MOUSE,            // button, state, x, y
+    INPUT_MOTION,           // x, y
+    INPUT_PASSIVE_MOTION,   // x, y
+    INPUT_RESHAPE,          // w, h
+    INPUT_KEY,              // key, x, y
+    INPUT_TYPE_COUNT
+} InputType;
+
+typedef struct {
+    double t;               // seconds since recording started
+    InputType type;
+    int arg[4];
+} InputEvent;
+
+typedef struct {
+    InputEvent *events;
+    int count;
+} InputLog;
+
+// Recording; `now` is any monotonic clock (anim_now()).
+int inputlog_record_start(const char *path, double now);    // 0 on success
+int inputlog_recording(void);
+void inputlog_record(double now, InputType type, int a0, int a1, int a2, int a3);
+void inputlog_record_stop(void);
+
+int inputlog_load(const char *path, InputLog *log);         // 0 on success
+void inputlog_free(InputLog *log);
+
+#endif
@@ -0,0 +1,104 @@
+// latency.c
+#include "latency.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static struct {
+    int enabled, strict;
+    double pending;         // oldest input not yet picked up by a frame, < 0: none
+    double in_flight;       // oldest input consumed by the frame being drawn
+    long histogram[LATENCY_BUCKETS];
+    long count;
+    double max;
+} lat = { 0, 0, -1.0, -1.0 };
+
+void latency_set_enabled(int on) {
+    lat.enabled = on;
+    lat.pending = lat.in_flight = -1.0;
+}
+
+int latency_enabled(void) {
+    return lat.enabled;
+}
+
+void latency_set_strict(int on) {
+    lat.strict = on;
+}
+
+int latency_strict(void) {
+    return lat.strict;
+}
+
+void latency_input(double t) {
+    if (!lat.enabled) return;
+    if (lat.pending < 0) lat.pending = t;
+}
+
+void latency_frame_begin(void) {
+    if (!lat.enabled) return;
+    lat.in_flight = lat.pending;
+    lat.pending = -1.0;
+}
+
+void latency_frame_presented(double t) {
+    if (!lat.enabled || lat.in_flight < 0) return;
+
+    double ms = (t - lat.in_flight) * 1e3;
+    lat.in_flight = -1.0;
+
+    long b = (long)(ms / LATENCY_BUCKET_MS);
+    if (b < 0) b = 0;
+    if (b >= LATENCY_BUCKETS) b = LATENCY_BUCKETS - 1;
+    lat.histogram[b]++;
+    lat.count++;
+    if (ms > lat.max) lat.max = ms;
+}
+
+void latency_reset(void) {
+    memset(lat.histogram, 0, sizeof(lat.histogram));
+    lat.count = 0;
+    lat.max = 0.0;
+    lat.pending = lat.in_flight = -1.0;
+}
+
+static double percentile(double p) {
+    long target = (long)(p * lat.count + 0.5);
+    if (target < 1) target = 1;
+    long seen = 0;
+    for (long b = 0; b < LATENCY_BUCKETS; ++b) {
+        seen += lat.histogram[b];
+        if (seen >= target)
+            return (b + 1) * LATENCY_BUCKET_MS;   // bucket upper bound
+    }
+    return lat.max;
+}
+
+LatencyReport latency_report(void) {
+    LatencyReport r = { lat.count, 0, 0, 0, lat.max };
+    if (lat.count == 0) return r;
+    r.p50 = percentile(0.50);
+    r.p95 = percentile(0.95);
+    r.p99 = percentile(0.99);
+    return r;
+}
+
+void latency_print(const char *label) {
+    LatencyReport r = latency_report();
+    printf("%s%slatency: %ld frames, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           label ? label : "", label ? " " : "",
+           r.count, r.p50, r.p95, r.p99, r.max);
+
+    // Coarse text histogram, 1 ms per row up to the first empty tail
+    long rows[51] = {0};
+    for (long b = 0; b < LATENCY_BUCKETS; ++b) {
+        long ms = (long)(b * LATENCY_BUCKET_MS);
+        rows[ms < 50 ? ms : 50] += lat.histogram[b];
+    }
+    for (int i = 0; i <= 50; ++i) {
+        if (!rows[i]) continue;
+        int bar = (int)(60.0 * rows[i] / (lat.count ? lat.count : 1));
+        printf("  %s%2d ms | %-60.*s %ld\n", i == 50 ? ">=" : "  ", i, bar,
+               "############################################################", rows[i]);
+    }
+}
@@ -0,0 +1,33 @@
+// latency.h
+// Input-to-display latency measurement.
+//
+// The input handler tags the event with a monotonic timestamp
+// (latency_input). display() claims all tags pending at its start
+// (latency_frame_begin), and after glutSwapBuffers (plus glFinish in
+// strict mode) latency_frame_presented records the time from the oldest
+// claimed input to presentation. Samples go into a fixed-bucket histogram.
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#define LATENCY_BUCKET_MS 0.05      // histogram resolution
+#define LATENCY_BUCKETS   10000     // covers 0 .. 500 ms
+
+typedef struct {
+    long count;
+    double p50, p95, p99, max;      // milliseconds
+} LatencyReport;
+
+void latency_set_enabled(int on);
+int latency_enabled(void);
+void latency_set_strict(int on);    // glFinish before timestamping
+int latency_strict(void);
+
+void latency_input(double t);       // t from anim_now()
+void latency_frame_begin(void);
+void latency_frame_presented(double t);
+
+void latency_reset(void);
+LatencyReport latency_report(void);
+void latency_print(const char *label);
+
+#endif
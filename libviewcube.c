@@ -0,0 +1,727 @@
+// libviewcube.c
+// libviewcube 實作：原 ViewCube.c 中的 ViewCube 繪製、hover 判斷與互動，
+// 狀態改為存放在每個 viewcube_t 實例中。
+#include "viewcube.h"
+#include "anim.h"
+#include "inertia.h"
+#include "pick.h"
+#include "glstate.h"
+#include "trace.h"
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glut.h>
+#include <GL/glu.h>
+#include <GL/glext.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// --- 細分面區域 ---
+#define SUBDIV_CELLS 54  // 6面 x 9格
+#define EDGE_DIV 4      // 分割點數量
+#define FACE_SUBDIV_X 3
+#define FACE_SUBDIV_Y 3
+#define FACE_CELLS (FACE_SUBDIV_X * FACE_SUBDIV_Y)
+
+// display list 配置：cell、邊、角依序排列
+#define LIST_CELLS   0
+#define LIST_EDGES   (LIST_CELLS + SUBDIV_CELLS)
+#define LIST_CORNERS (LIST_EDGES + 12)
+#define LIST_COUNT   (LIST_CORNERS + 8)
+
+struct viewcube {
+    float rot[3];              // x, y, z（度）
+    int win_w, win_h;
+    int size, margin;
+    int has_rect;              // 由 viewcube_render_embedded 指定的位置
+    int rect_x, rect_y, rect_size;
+
+    // Hover 狀態
+    int hover_type;            // 0:無, 1:面, 2:邊, 3:角
+    int hover_id;
+    int hover_face;            // 0~5
+    int hover_cell;            // 0~8 (3x3)
+
+    // 拖曳
+    int dragging;
+    int drag_mode;             // 0: xy, 1: z
+    int last_x, last_y;
+
+    // 動畫與慣性
+    OrientAnim snap_anim;
+    double snap_duration;
+    EaseType snap_ease;
+    Inertia inertia;
+    int momentum_enabled;
+
+    // 標籤文字繪製（NULL 表示用 GLUT 點陣字）
+    viewcube_text_fn text_fn;
+    void *text_user;
+};
+
+// 各面對應的旋轉
+static const float face_angles[6][2] = {
+    { 0, 90}, { 0,-90}, {-90, 0}, {90, 0}, {0, 0}, {0, 180}
+};
+
+// 每個面的四個頂點（順序：左下、右下、右上、左上）
+static const float face_vertices[6][4][3] = {
+    // +X
+    { {0.5,-0.5,-0.5}, {0.5,0.5,-0.5}, {0.5,0.5,0.5}, {0.5,-0.5,0.5} },
+    // -X
+    { {-0.5,-0.5,0.5}, {-0.5,0.5,0.5}, {-0.5,0.5,-0.5}, {-0.5,-0.5,-0.5} },
+    // +Y
+    { {-0.5,0.5,-0.5}, {0.5,0.5,-0.5}, {0.5,0.5,0.5}, {-0.5,0.5,0.5} },
+    // -Y
+    { {-0.5,-0.5,0.5}, {0.5,-0.5,0.5}, {0.5,-0.5,-0.5}, {-0.5,-0.5,-0.5} },
+    // +Z
+    { {-0.5,-0.5,0.5}, {0.5,-0.5,0.5}, {0.5,0.5,0.5}, {-0.5,0.5,0.5} },
+    // -Z
+    { {0.5,-0.5,-0.5}, {-0.5,-0.5,-0.5}, {-0.5,0.5,-0.5}, {0.5,0.5,-0.5} }
+};
+
+// 每個面的顏色
+static const float face_colors[6][3] = {
+    {0.8,0.8,0.8},    // +X 灰
+    {0.8,0.8,0.8},    // -X 灰
+    {0.8,0.8,0.8},    // +Y 灰
+    {0.8,0.8,0.8},    // -Y 灰
+    {0.8,0.8,0.8},    // +Z 灰
+    {0.8,0.8,0.8}     // -Z 灰
+};
+
+// 角點顏色；最後畫的是角 7，embedded 以它記錄留下的顏色
+static const float corner_color[3] = { 0.8f, 0.8f, 0.8f };
+static const float corner_hover_color[3] = { 1.0f, 0.2f, 0.2f };
+
+static const float *cornerColor(const viewcube_t *vc, int i) {
+    return vc->hover_type == 3 && vc->hover_id == i ? corner_hover_color : corner_color;
+}
+
+// 定義分割比例
+static const float subdiv_ratios[4] = {
+    0.0f,   // 開始
+    0.1f,   // 1/10
+    0.9f,   // 9/10
+    1.0f    // 結束
+};
+
+// 邊與角
+static const int edge_indices[12][2] = {
+    {0,1},{1,2},{2,3},{3,0}, // +Z 面
+    {4,5},{5,6},{6,7},{7,4}, // -Z 面
+    {0,4},{1,5},{2,6},{3,7}  // 側邊
+};
+static const float edge_vertices[8][3] = {
+    {-0.5,-0.5, 0.5}, {0.5,-0.5, 0.5}, {0.5,0.5, 0.5}, {-0.5,0.5, 0.5},
+    {-0.5,-0.5,-0.5}, {0.5,-0.5,-0.5}, {0.5,0.5,-0.5}, {-0.5,0.5,-0.5}
+};
+
+// 標籤
+static const char* face_labels_zh[6] = {"右", "左", "上", "下", "前", "後"};
+static const float label_pos_zh[6][3] = {
+    {0.5f, 0.0f, 0.0f},   // +X 右
+    {-0.5f, 0.0f, 0.0f},  // -X 左
+    {0.0f, 0.5f, 0.0f},   // +Y 上
+    {0.0f, -0.5f, 0.0f},  // -Y 下
+    {0.0f, 0.0f, 0.5f},   // +Z 前
+    {0.0f, 0.0f, -0.5f}   // -Z 後
+};
+static const float label_normal[6][3] = {
+    {1,0,0}, {-1,0,0}, {0,1,0}, {0,-1,0}, {0,0,1}, {0,0,-1}
+};
+static const float label_up[6][3] = {
+    {0,1,0}, {0,1,0}, {0,0,-1}, {0,0,1}, {0,1,0}, {0,1,0}
+};
+static const char* face_labels[6] = {"R", "L", "U", "D", "F", "B"};
+static const float label_pos[6][3] = {
+    {0.6f, 0.0f, 0.0f},   // +X 右 (Right)
+    {-0.7f, 0.0f, 0.0f},  // -X 左 (Left)
+    {0.0f, 0.6f, 0.0f},   // +Y 上 (Up)
+    {0.0f, -0.7f, 0.0f},  // -Y 下 (Down)
+    {0.0f, 0.0f, 0.6f},   // +Z 前 (Front)
+    {0.0f, 0.0f, -0.7f}   // -Z 後 (Back)
+};
+
+// 儲存預計算的頂點
+typedef struct {
+    float vertices[4][3];  // 每個小面的四個頂點
+} SubdivCell;
+
+// 所有實例共用的資源
+static struct {
+    int refcount;
+    int vertices_ready;
+    SubdivCell subdivided_faces[SUBDIV_CELLS];
+    GLuint lists;          // LIST_COUNT 個連續的 display list，0 表示尚未建立
+} shared;
+
+// 雙線性插值
+static void lerp_face_vertex(const float v[4][3], float u, float vval, float out[3]) {
+    float a[3], b[3];
+    for (int i = 0; i < 3; ++i) {
+        a[i] = v[0][i] * (1-u) + v[1][i] * u;
+        b[i] = v[3][i] * (1-u) + v[2][i] * u;
+        out[i] = a[i] * (1-vval) + b[i] * vval;
+    }
+}
+
+// 生成細分頂點
+static void generateSubdividedVertices(void) {
+    for (int face = 0; face < 6; face++) {
+        for (int y = 0; y < 3; y++) {
+            for (int x = 0; x < 3; x++) {
+                int cell_idx = face * 9 + y * 3 + x;
+                float x1 = subdiv_ratios[x];
+                float x2 = subdiv_ratios[x + 1];
+                float y1 = subdiv_ratios[y];
+                float y2 = subdiv_ratios[y + 1];
+
+                lerp_face_vertex(face_vertices[face], x1, y1, shared.subdivided_faces[cell_idx].vertices[0]);
+                lerp_face_vertex(face_vertices[face], x2, y1, shared.subdivided_faces[cell_idx].vertices[1]);
+                lerp_face_vertex(face_vertices[face], x2, y2, shared.subdivided_faces[cell_idx].vertices[2]);
+                lerp_face_vertex(face_vertices[face], x1, y2, shared.subdivided_faces[cell_idx].vertices[3]);
+            }
+        }
+    }
+    shared.vertices_ready = 1;
+}
+
+// 建立共用 display list（需要目前有 GL context）
+static void buildSharedLists(void) {
+    shared.lists = glGenLists(LIST_COUNT);
+
+    for (int c = 0; c < SUBDIV_CELLS; ++c) {
+        glNewList(shared.lists + LIST_CELLS + c, GL_COMPILE);
+        glBegin(GL_QUADS);
+        for (int i = 0; i < 4; i++)
+            glVertex3fv(shared.subdivided_faces[c].vertices[i]);
+        glEnd();
+        glEndList();
+    }
+    for (int e = 0; e < 12; ++e) {
+        glNewList(shared.lists + LIST_EDGES + e, GL_COMPILE);
+        glBegin(GL_LINES);
+        glVertex3fv(edge_vertices[edge_indices[e][0]]);
+        glVertex3fv(edge_vertices[edge_indices[e][1]]);
+        glEnd();
+        glEndList();
+    }
+    for (int v = 0; v < 8; ++v) {
+        glNewList(shared.lists + LIST_CORNERS + v, GL_COMPILE);
+        glBegin(GL_POINTS);
+        glVertex3fv(edge_vertices[v]);
+        glEnd();
+        glEndList();
+    }
+}
+
+viewcube_t *viewcube_create(void) {
+    viewcube_t *vc = calloc(1, sizeof(*vc));
+    if (!vc) return NULL;
+
+    vc->rot[0] = 35.264f;
+    vc->rot[1] = 45.0f;
+    vc->rot[2] = 0.0f;
+    vc->size = 100;
+    vc->margin = 10;
+    vc->hover_id = -1;
+    vc->hover_face = -1;
+    vc->hover_cell = -1;
+    vc->snap_duration = 0.35;
+    vc->snap_ease = EASE_IN_OUT_CUBIC;
+    inertia_init(&vc->inertia);
+
+    if (!shared.vertices_ready)
+        generateSubdividedVertices();
+    shared.refcount++;
+    return vc;
+}
+
+void viewcube_destroy(viewcube_t *vc) {
+    if (!vc) return;
+    free(vc);
+    if (--shared.refcount == 0 && shared.lists) {
+        glDeleteLists(shared.lists, LIST_COUNT);
+        shared.lists = 0;
+    }
+}
+
+// 實例只有純資料，共用的 display list 在 shared 中，直接整個複製即可
+void viewcube_copy(viewcube_t *dst, const viewcube_t *src) {
+    *dst = *src;
+}
+
+void viewcube_resize(viewcube_t *vc, int win_w, int win_h) {
+    vc->win_w = win_w;
+    vc->win_h = win_h;
+}
+
+void viewcube_set_layout(viewcube_t *vc, int size, int margin) {
+    vc->size = size;
+    vc->margin = margin;
+    vc->has_rect = 0;
+}
+
+// ViewCube 在視窗中的位置（OpenGL 座標，左下為原點）
+static void cubeRect(const viewcube_t *vc, int *vx, int *vy, int *size) {
+    if (vc->has_rect) {
+        *vx = vc->rect_x;
+        *vy = vc->rect_y;
+        *size = vc->rect_size;
+    } else {
+        *size = vc->size;
+        *vx = vc->win_w - vc->size - vc->margin;
+        *vy = vc->win_h - vc->size - vc->margin;
+    }
+}
+
+void viewcube_set_orientation(viewcube_t *vc, float rx, float ry, float rz) {
+    anim_cancel(&vc->snap_anim);
+    inertia_stop(&vc->inertia);
+    vc->rot[0] = rx;
+    vc->rot[1] = ry;
+    vc->rot[2] = rz;
+}
+
+void viewcube_get_orientation(const viewcube_t *vc, float out[3]) {
+    out[0] = vc->rot[0];
+    out[1] = vc->rot[1];
+    out[2] = vc->rot[2];
+}
+
+void viewcube_set_snap_duration(viewcube_t *vc, double seconds) {
+    vc->snap_duration = seconds;
+}
+
+int viewcube_get_snap(const viewcube_t *vc, double now, float target[3], float *progress) {
+    if (!vc->snap_anim.active) return 0;
+    if (target) {
+        target[0] = vc->snap_anim.to_euler[0];
+        target[1] = vc->snap_anim.to_euler[1];
+        target[2] = vc->snap_anim.to_euler[2];
+    }
+    if (progress) *progress = anim_progress(&vc->snap_anim, now);
+    return 1;
+}
+
+void viewcube_set_momentum(viewcube_t *vc, int enabled) {
+    vc->momentum_enabled = enabled;
+    if (!enabled) inertia_stop(&vc->inertia);
+}
+
+void viewcube_get_hover(const viewcube_t *vc, int *type, int *id) {
+    if (type) *type = vc->hover_type;
+    if (id) *id = vc->hover_id;
+}
+
+// hover 判斷；x, y 為 OpenGL 座標（左下為原點）
+static void checkViewCubeHover(viewcube_t *vc, int x, int y) {
+    TRACE_SCOPE("checkViewCubeHover");
+    int vx, vy, size;
+    cubeRect(vc, &vx, &vy, &size);
+
+    PickHover h;
+    pick_viewcube_hover(vc->rot, vx, vy, size, x, y, &h);
+    vc->hover_type = h.type;
+    vc->hover_id = h.id;
+    vc->hover_face = h.face;
+    vc->hover_cell = h.cell;
+}
+
+void viewcube_hit_test_batch(const viewcube_t *vc, const int *x, const int *y, int n, int *ids) {
+    TRACE_SCOPE("viewcube_hit_test_batch");
+    int vx, vy, size;
+    cubeRect(vc, &vx, &vy, &size);
+
+    // 分段翻轉 y（GLUT 座標 -> OpenGL 座標）
+    int gl_y[256];
+    for (int i = 0; i < n; i += 256) {
+        int m = n - i < 256 ? n - i : 256;
+        for (int k = 0; k < m; ++k)
+            gl_y[k] = vc->win_h - y[i + k];
+        pick_viewcube_hover_batch(vc->rot, vx, vy, size, x + i, gl_y, m, ids + i);
+    }
+}
+
+static int insideCube(const viewcube_t *vc, int x, int y) {
+    int vx, vy, size;
+    cubeRect(vc, &vx, &vy, &size);
+    return x >= vx && x <= vx + size && y >= vy && y <= vy + size;
+}
+
+// 更新 hover，回傳是否需要重繪
+static int updateHover(viewcube_t *vc, int x, int y) {
+    int prev_face = vc->hover_face;
+    int prev_cell = vc->hover_cell;
+    int prev_type = vc->hover_type;
+    checkViewCubeHover(vc, x, y);
+    return prev_face != vc->hover_face || prev_cell != vc->hover_cell ||
+           prev_type != vc->hover_type;
+}
+
+int viewcube_pointer_move(viewcube_t *vc, int x, int y) {
+    y = vc->win_h - y; // 修正座標
+    int result = 0;
+
+    if (vc->dragging) {
+        if (vc->drag_mode == 0) {
+            // LMB: xy 旋轉
+            vc->rot[1] += (x - vc->last_x);
+            vc->rot[0] += (y - vc->last_y);
+        } else {
+            // Shift+LMB: z 軸旋轉
+            vc->rot[2] += (x - vc->last_x); // 只用 x 拖曳控制 z 軸
+        }
+        vc->last_x = x;
+        vc->last_y = y;
+        inertia_drag_sample(&vc->inertia, anim_now(), vc->rot);
+        result |= VIEWCUBE_EVENT_CONSUMED | VIEWCUBE_EVENT_REDRAW | VIEWCUBE_EVENT_ORIENTATION;
+    }
+
+    if (updateHover(vc, x, y))
+        result |= VIEWCUBE_EVENT_REDRAW;
+    return result;
+}
+
+int viewcube_pointer_down(viewcube_t *vc, int x, int y, int mods) {
+    y = vc->win_h - y; // 修正座標
+    updateHover(vc, x, y);
+    if (!insideCube(vc, x, y)) return 0;
+
+    // 點擊 ViewCube cell：平滑轉到該面
+    if (vc->hover_type == 1 && vc->hover_face >= 0 && vc->hover_cell >= 0) {
+        float to[3] = { face_angles[vc->hover_face][0], face_angles[vc->hover_face][1], 0 };
+        inertia_stop(&vc->inertia);
+        anim_start(&vc->snap_anim, vc->rot, to, vc->snap_duration, vc->snap_ease);
+        return VIEWCUBE_EVENT_CONSUMED | VIEWCUBE_EVENT_REDRAW | VIEWCUBE_EVENT_ANIMATING;
+    }
+
+    // 否則開始拖曳 ViewCube
+    anim_cancel(&vc->snap_anim);
+    inertia_stop(&vc->inertia);
+    vc->dragging = 1;
+    vc->last_x = x;
+    vc->last_y = y;
+    vc->drag_mode = (mods & VIEWCUBE_MOD_SHIFT) ? 1 : 0;
+    return VIEWCUBE_EVENT_CONSUMED;
+}
+
+int viewcube_pointer_up(viewcube_t *vc, int x, int y) {
+    if (!vc->dragging) return 0;
+    vc->dragging = 0;
+    if (vc->momentum_enabled && inertia_release(&vc->inertia, anim_now(), vc->rot))
+        return VIEWCUBE_EVENT_CONSUMED | VIEWCUBE_EVENT_ANIMATING;
+    return VIEWCUBE_EVENT_CONSUMED;
+}
+
+int viewcube_tick(viewcube_t *vc, double now) {
+    float e[3];
+    int result = 0;
+
+    if (vc->snap_anim.active) {
+        int running = anim_update(&vc->snap_anim, now, e);
+        vc->rot[0] = e[0]; vc->rot[1] = e[1]; vc->rot[2] = e[2];
+        result |= VIEWCUBE_EVENT_REDRAW | VIEWCUBE_EVENT_ORIENTATION;
+        if (running) result |= VIEWCUBE_EVENT_ANIMATING;
+    } else if (vc->inertia.active) {
+        int running = inertia_update(&vc->inertia, now, e);
+        vc->rot[0] = e[0]; vc->rot[1] = e[1]; vc->rot[2] = e[2];
+        result |= VIEWCUBE_EVENT_REDRAW | VIEWCUBE_EVENT_ORIENTATION;
+        if (running) result |= VIEWCUBE_EVENT_ANIMATING;
+    }
+    return result;
+}
+
+// 內建 5x7 點陣字（A-Z），放大兩倍後以 glBitmap 繪製，不需要 GLUT。
+// 每列存成 32 位元寬，使 GL_UNPACK_ALIGNMENT 為 1/2/4 時列距都一樣，不必更改該狀態。
+static const unsigned char font5x7[26][7] = {
+    {0x0E,0x11,0x11,0x1F,0x11,0x11,0x11}, {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E},
+    {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}, {0x1C,0x12,0x11,0x11,0x11,0x12,0x1C},
+    {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F}, {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10},
+    {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}, {0x11,0x11,0x11,0x1F,0x11,0x11,0x11},
+    {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}, {0x07,0x02,0x02,0x02,0x02,0x12,0x0C},
+    {0x11,0x12,0x14,0x18,0x14,0x12,0x11}, {0x10,0x10,0x10,0x10,0x10,0x10,0x1F},
+    {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}, {0x11,0x11,0x19,0x15,0x13,0x11,0x11},
+    {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10},
+    {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D}, {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11},
+    {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}, {0x1F,0x04,0x04,0x04,0x04,0x04,0x04},
+    {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x11,0x11,0x11,0x11,0x11,0x0A,0x04},
+    {0x11,0x11,0x11,0x15,0x15,0x15,0x0A}, {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11},
+    {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}, {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F}
+};
+
+#define GLYPH_W 10
+#define GLYPH_H 14
+
+static GLubyte font_bits[26][GLYPH_H][4];
+static int font_ready = 0;
+
+static void buildFont(void) {
+    for (int g = 0; g < 26; ++g) {
+        for (int r = 0; r < GLYPH_H; ++r) {
+            // glBitmap 由下往上
+            unsigned char src = font5x7[g][6 - r / 2];
+            unsigned bits = 0;
+            for (int c = 0; c < 5; ++c)
+                if (src & (0x10 >> c)) bits |= 3u << (30 - 2 * c);
+            font_bits[g][r][0] = bits >> 24;
+            font_bits[g][r][1] = bits >> 16;
+            font_bits[g][r][2] = bits >> 8;
+            font_bits[g][r][3] = bits;
+        }
+    }
+    font_ready = 1;
+}
+
+void viewcube_text_builtin(const char *text, void *user) {
+    if (!font_ready) buildFont();
+    for (const char *p = text; *p; ++p) {
+        int c = *p;
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        if (c >= 'A' && c <= 'Z')
+            glBitmap(32, GLYPH_H, 0, 0, GLYPH_W + 2, 0, &font_bits[c - 'A'][0][0]);
+        else if ((unsigned char)c < 0x80)
+            glBitmap(0, 0, 0, 0, GLYPH_W + 2, 0, NULL);  // 空白等：只前進
+        // 非 ASCII（中文標籤）沒有字形，略過
+    }
+}
+
+static void drawText(const viewcube_t *vc, const char *text) {
+    if (vc->text_fn) {
+        vc->text_fn(text, vc->text_user);
+        return;
+    }
+    for (const char *p = text; *p; ++p)
+        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *p);
+}
+
+void viewcube_set_text_renderer(viewcube_t *vc, viewcube_text_fn fn, void *user) {
+    vc->text_fn = fn;
+    vc->text_user = user;
+}
+
+static void drawLabels(const viewcube_t *vc) {
+    // --- 中文標籤 ---
+    glColor3f(0,0,0);
+    for (int f = 0; f < 6; ++f) {
+        glPushMatrix();
+        // 1. 先移動到面中心
+        glTranslatef(label_pos_zh[f][0], label_pos_zh[f][1], label_pos_zh[f][2]);
+        // 2. 讓文字面朝外且平貼在面上
+        float nx = label_normal[f][0], ny = label_normal[f][1], nz = label_normal[f][2];
+        float ux = label_up[f][0], uy = label_up[f][1], uz = label_up[f][2];
+        // 計算旋轉矩陣
+        float fx = uy * nz - uz * ny;
+        float fy = uz * nx - ux * nz;
+        float fz = ux * ny - uy * nx;
+        float m[16] = {
+            fx,  ux,  nx, 0,
+            fy,  uy,  ny, 0,
+            fz,  uz,  nz, 0,
+            0,   0,   0,  1
+        };
+        glMultMatrixf(m);
+        // 3. 可選：縮小字體，避免超出面
+        glScalef(0.0015f, 0.0015f, 1.0f);
+        // 4. 畫文字
+        glRasterPos3f(0, 0, 0.01f); // 貼在面上
+        drawText(vc, face_labels_zh[f]);
+        glPopMatrix();
+    }
+
+    // --- 英文標籤 ---
+    glColor3f(0,0,0);
+    for (int f = 0; f < 6; ++f) {
+        glRasterPos3f(label_pos[f][0], label_pos[f][1], label_pos[f][2]);
+        drawText(vc, face_labels[f]);
+    }
+}
+
+// 畫出 ViewCube 本體；呼叫端已設定好 viewport、投影矩陣與狀態
+static void drawCubeContents(const viewcube_t *vc) {
+    glLoadIdentity();
+    gluLookAt(0,0,5, 0,0,0, 0,1,0);
+
+    glPushMatrix();
+    glRotatef(vc->rot[2], 0, 0, 1);
+    glRotatef(vc->rot[0], 1, 0, 0);
+    glRotatef(vc->rot[1], 0, 1, 0);
+
+    // 每個面細分 3x3
+    for (int f = 0; f < 6; ++f) {
+        for (int cell = 0; cell < FACE_CELLS; ++cell) {
+            if (vc->hover_type == 1 && vc->hover_face == f && vc->hover_cell == cell)
+                glColor3f(1, 0.8, 0.2);
+            else
+                glColor3fv(face_colors[f]);
+            glCallList(shared.lists + LIST_CELLS + f * FACE_CELLS + cell);
+        }
+    }
+
+    drawLabels(vc);
+
+    // 邊高亮
+    gls_line_width(4.0f);
+    for (int i = 0; i < 12; ++i) {
+        if (vc->hover_type == 2 && vc->hover_id == i)
+            glColor3f(0.2, 1, 0.2); // 邊高亮
+        else
+            glColor3f(0.5, 0.5, 0.5);
+        glCallList(shared.lists + LIST_EDGES + i);
+    }
+
+    // 角高亮
+    gls_point_size(10.0f);
+    for (int i = 0; i < 8; ++i) {
+        glColor3fv(cornerColor(vc, i));
+        glCallList(shared.lists + LIST_CORNERS + i);
+    }
+
+    glPopMatrix();
+}
+
+void viewcube_render(viewcube_t *vc) {
+    TRACE_SCOPE("viewcube_render");
+    if (!shared.lists)
+        buildSharedLists();
+
+    int vx, vy, size;
+    cubeRect(vc, &vx, &vy, &size);
+    glViewport(vx, vy, size, size);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(30, 1, 1, 10);
+    glMatrixMode(GL_MODELVIEW);
+
+    drawCubeContents(vc);
+
+    gls_line_width(1.0f);
+    gls_point_size(1.0f);
+    glViewport(0, 0, vc->win_w, vc->win_h);
+}
+
+void viewcube_gl_state_init(viewcube_gl_state *s) {
+    s->framebuffer = 0;
+    s->viewport[0] = s->viewport[1] = 0;
+    s->viewport[2] = s->viewport[3] = 0;
+    s->matrix_mode = GL_MODELVIEW;
+    s->depth_test = 0;
+    s->texture_2d = 0;
+    s->blend = 0;
+    s->lighting = 0;
+    s->cull_face = 0;
+    s->line_width = 1.0f;
+    s->point_size = 1.0f;
+    s->color[0] = s->color[1] = s->color[2] = s->color[3] = 1.0f;
+}
+
+// 以 host 記錄的值為準設定 glstate 快取，之後的 gls_* 呼叫只會送出真正不同的狀態
+static void assumeHostState(const viewcube_gl_state *host) {
+    gls_assume_framebuffer(host->framebuffer);
+    gls_assume(GL_DEPTH_TEST, host->depth_test);
+    gls_assume(GL_TEXTURE_2D, host->texture_2d);
+    gls_assume(GL_BLEND, host->blend);
+    gls_assume(GL_LIGHTING, host->lighting);
+    gls_assume(GL_CULL_FACE, host->cull_face);
+    gls_assume_line_width(host->line_width);
+    gls_assume_point_size(host->point_size);
+}
+
+static unsigned diffCap(int want, int have, unsigned bit) {
+    return (!want != !have) ? bit : 0;
+}
+
+unsigned viewcube_render_embedded(viewcube_t *vc, viewcube_gl_state *host,
+                                  unsigned fbo, int x, int y, int w, int h,
+                                  unsigned flags) {
+    TRACE_SCOPE("viewcube_render_embedded");
+    unsigned touched = 0;
+
+    if (!shared.lists)
+        buildSharedLists();
+
+    // 在矩形中置中一個正方形，並作為 hover 判斷的位置
+    int size = w < h ? w : h;
+    vc->has_rect = 1;
+    vc->rect_x = x + (w - size) / 2;
+    vc->rect_y = y + (h - size) / 2;
+    vc->rect_size = size;
+
+    assumeHostState(host);
+    touched |= (host->framebuffer != fbo) ? VIEWCUBE_STATE_FRAMEBUFFER : 0;
+    touched |= diffCap(1, host->depth_test, VIEWCUBE_STATE_DEPTH_TEST);
+    touched |= diffCap(0, host->texture_2d, VIEWCUBE_STATE_TEXTURE_2D);
+    touched |= diffCap(0, host->blend, VIEWCUBE_STATE_BLEND);
+    touched |= diffCap(0, host->lighting, VIEWCUBE_STATE_LIGHTING);
+    touched |= diffCap(0, host->cull_face, VIEWCUBE_STATE_CULL_FACE);
+
+    gls_bind_framebuffer(fbo);
+    if (host->viewport[0] != vc->rect_x || host->viewport[1] != vc->rect_y ||
+        host->viewport[2] != size || host->viewport[3] != size) {
+        glViewport(vc->rect_x, vc->rect_y, size, size);
+        touched |= VIEWCUBE_STATE_VIEWPORT;
+    }
+    gls_enable(GL_DEPTH_TEST);
+    gls_disable(GL_TEXTURE_2D);
+    gls_disable(GL_BLEND);
+    gls_disable(GL_LIGHTING);
+    gls_disable(GL_CULL_FACE);
+
+    // 矩陣以 push/pop 保存，不需 glGet
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluPerspective(30, 1, 1, 10);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    touched |= VIEWCUBE_STATE_MATRICES | VIEWCUBE_STATE_COLOR;
+    if (host->line_width != 4.0f) touched |= VIEWCUBE_STATE_LINE_WIDTH;
+    if (host->point_size != 10.0f) touched |= VIEWCUBE_STATE_POINT_SIZE;
+
+    drawCubeContents(vc);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    if (host->matrix_mode != GL_PROJECTION) {
+        glMatrixMode(host->matrix_mode);
+    }
+
+    if (flags & VIEWCUBE_EMBED_NO_RESTORE) {
+        // host 接受我們留下的狀態：更新記錄，讓 host 略過重複設定
+        host->framebuffer = fbo;
+        host->viewport[0] = vc->rect_x;
+        host->viewport[1] = vc->rect_y;
+        host->viewport[2] = size;
+        host->viewport[3] = size;
+        host->depth_test = 1;
+        host->texture_2d = 0;
+        host->blend = 0;
+        host->lighting = 0;
+        host->cull_face = 0;
+        host->line_width = 4.0f;
+        host->point_size = 10.0f;
+        memcpy(host->color, cornerColor(vc, 7), sizeof(float) * 3);
+        host->color[3] = 1.0f;
+        return touched;
+    }
+
+    // 只還原真的改過的狀態（glstate 會略過沒變的部分）
+    gls_bind_framebuffer(host->framebuffer);
+    if (touched & VIEWCUBE_STATE_VIEWPORT)
+        glViewport(host->viewport[0], host->viewport[1], host->viewport[2], host->viewport[3]);
+    gls_set(GL_DEPTH_TEST, host->depth_test);
+    gls_set(GL_TEXTURE_2D, host->texture_2d);
+    gls_set(GL_BLEND, host->blend);
+    gls_set(GL_LIGHTING, host->lighting);
+    gls_set(GL_CULL_FACE, host->cull_face);
+    gls_line_width(host->line_width);
+    gls_point_size(host->point_size);
+    glColor4fv(host->color);
+    return touched;
+}
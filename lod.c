@@ -0,0 +1,419 @@
+// lod.c
+#include "lod.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+// --- Quadrics ---
+
+typedef struct { double m[10]; } Quadric;   // a2 ab ac ad b2 bc bd c2 cd d2
+
+static void quadric_add_plane(Quadric *q, double a, double b, double c, double d) {
+    double v[10] = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+    for (int i = 0; i < 10; ++i) q->m[i] += v[i];
+}
+
+static double quadric_eval(const Quadric *q, const Quadric *r, const float p[3]) {
+    double m[10];
+    for (int i = 0; i < 10; ++i) m[i] = q->m[i] + r->m[i];
+    double x = p[0], y = p[1], z = p[2];
+    double e = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+             + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+             + m[7] * z * z + 2 * m[8] * z + m[9];
+    return e > 0 ? e : 0;
+}
+
+static void normal_of(const float *a, const float *b, const float *c, double n[3]) {
+    double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// --- One group ---
+
+typedef struct {
+    float cost;
+    int from, to;
+} Candidate;
+
+static int cmp_candidate(const void *a, const void *b) {
+    float x = ((const Candidate *)a)->cost, y = ((const Candidate *)b)->cost;
+    return x < y ? -1 : x > y;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Scratch for one worker, sized for the largest group
+typedef struct {
+    uint64_t *keys;             // sort scratch (vertex mapping, edges)
+    unsigned *global;           // local -> global vertex
+    float (*pos)[3];
+    Quadric *quad;
+    unsigned char *locked, *touched;
+    int (*tri)[3];
+    unsigned char *dead;
+    int *adj_start, *adj;
+    Candidate *cand;
+} Scratch;
+
+static int scratch_init(Scratch *s, uint32_t ct) {
+    size_t nv = 3 * (size_t)ct;
+    memset(s, 0, sizeof(*s));
+    s->keys = malloc(sizeof(uint64_t) * 3 * ct);
+    s->global = malloc(sizeof(unsigned) * nv);
+    s->pos = malloc(sizeof(float) * 3 * nv);
+    s->quad = malloc(sizeof(Quadric) * nv);
+    s->locked = malloc(nv);
+    s->touched = malloc(nv);
+    s->tri = malloc(sizeof(int) * 3 * ct);
+    s->dead = malloc(ct);
+    s->adj_start = malloc(sizeof(int) * (nv + 1));
+    s->adj = malloc(sizeof(int) * 3 * ct);
+    s->cand = malloc(sizeof(Candidate) * 6 * ct);
+    return s->keys && s->global && s->pos && s->quad && s->locked && s->touched &&
+           s->tri && s->dead && s->adj_start && s->adj && s->cand ? 0 : -1;
+}
+
+static void scratch_free(Scratch *s) {
+    free(s->keys); free(s->global); free(s->pos); free(s->quad); free(s->locked);
+    free(s->touched); free(s->tri); free(s->dead); free(s->adj_start); free(s->adj); free(s->cand);
+}
+
+// Moving `from` onto `to` must not flip or squash any surviving triangle
+static int collapse_ok(const Scratch *s, int from, int to) {
+    for (int k = s->adj_start[from]; k < s->adj_start[from + 1]; ++k) {
+        int t = s->adj[k];
+        const int *v = s->tri[t];
+        if (s->dead[t] || v[0] == to || v[1] == to || v[2] == to) continue;
+        const float *p[3], *q[3];
+        for (int i = 0; i < 3; ++i) {
+            p[i] = s->pos[v[i]];
+            q[i] = v[i] == from ? s->pos[to] : p[i];
+        }
+        double n0[3], n1[3];
+        normal_of(p[0], p[1], p[2], n0);
+        normal_of(q[0], q[1], q[2], n1);
+        double d = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+        double l = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) *
+                        (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+        if (d <= 0.25 * l) return 0;
+    }
+    return 1;
+}
+
+// One round of independent collapses, cheapest first. Returns collapses made.
+static int collapse_pass(Scratch *s, int nv, int *nt, int target, double *max_cost) {
+    // Vertex -> triangle adjacency
+    memset(s->adj_start, 0, sizeof(int) * (nv + 1));
+    for (int t = 0; t < *nt; ++t)
+        for (int i = 0; i < 3; ++i) s->adj_start[s->tri[t][i] + 1]++;
+    for (int v = 0; v < nv; ++v) s->adj_start[v + 1] += s->adj_start[v];
+    for (int t = 0; t < *nt; ++t)
+        for (int i = 0; i < 3; ++i) s->adj[s->adj_start[s->tri[t][i]]++] = t;
+    for (int v = nv; v > 0; --v) s->adj_start[v] = s->adj_start[v - 1];
+    s->adj_start[0] = 0;
+
+    int nc = 0;
+    for (int t = 0; t < *nt; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            int a = s->tri[t][i], b = s->tri[t][(i + 1) % 3];
+            if (!s->locked[a])
+                s->cand[nc++] = (Candidate){ (float)quadric_eval(&s->quad[a], &s->quad[b], s->pos[b]), a, b };
+            if (!s->locked[b])
+                s->cand[nc++] = (Candidate){ (float)quadric_eval(&s->quad[a], &s->quad[b], s->pos[a]), b, a };
+        }
+    }
+    qsort(s->cand, nc, sizeof(Candidate), cmp_candidate);
+
+    memset(s->touched, 0, nv);
+    memset(s->dead, 0, *nt);
+    int live = *nt, done = 0;
+    for (int c = 0; c < nc && live > target; ++c) {
+        int from = s->cand[c].from, to = s->cand[c].to;
+        if (s->touched[from] || s->touched[to] || !collapse_ok(s, from, to)) continue;
+        for (int k = s->adj_start[from]; k < s->adj_start[from + 1]; ++k) {
+            int t = s->adj[k], *v = s->tri[t];
+            if (s->dead[t]) continue;
+            if (v[0] == to || v[1] == to || v[2] == to) {
+                s->dead[t] = 1;
+                live--;
+            } else {
+                for (int i = 0; i < 3; ++i) if (v[i] == from) v[i] = to;
+            }
+        }
+        for (int i = 0; i < 10; ++i) s->quad[to].m[i] += s->quad[from].m[i];
+        if (s->cand[c].cost > *max_cost) *max_cost = s->cand[c].cost;
+        s->touched[from] = s->touched[to] = 1;
+        done++;
+    }
+
+    int w = 0;
+    for (int t = 0; t < *nt; ++t)
+        if (!s->dead[t]) memcpy(s->tri[w++], s->tri[t], sizeof(s->tri[t]));
+    *nt = w;
+    return done;
+}
+
+typedef struct {
+    const float *positions;
+    const unsigned *indices;
+    size_t triangle_count;
+    uint32_t ct, group_size;            // triangles per cluster, clusters per group
+    int level;
+    unsigned *tris;                     // group g at g * group_size * ct * 3
+    uint32_t *count;
+    float *error;
+    atomic_int failed;
+} BuildJob;
+
+static void simplify_group(BuildJob *j, Scratch *s, uint32_t g) {
+    size_t span = (size_t)j->ct * j->group_size;
+    size_t t0 = (size_t)g * span, t1 = t0 + span;
+    if (t1 > j->triangle_count) t1 = j->triangle_count;
+    int nt = (int)(t1 - t0);
+    const unsigned *src = j->indices + 3 * t0;
+
+    // Local vertex numbering
+    for (int i = 0; i < 3 * nt; ++i) s->keys[i] = (uint64_t)src[i] << 32 | (uint32_t)i;
+    qsort(s->keys, 3 * nt, sizeof(uint64_t), cmp_u64);
+    int nv = 0;
+    for (int i = 0; i < 3 * nt; ++i) {
+        unsigned v = (unsigned)(s->keys[i] >> 32);
+        if (!nv || s->global[nv - 1] != v) {
+            s->global[nv] = v;
+            memcpy(s->pos[nv], j->positions + 3 * (size_t)v, sizeof(s->pos[nv]));
+            nv++;
+        }
+        s->tri[(uint32_t)s->keys[i] / 3][(uint32_t)s->keys[i] % 3] = nv - 1;
+    }
+
+    // Lock vertices on edges used once (group or mesh boundary) or more than twice
+    memset(s->locked, 0, nv);
+    for (int t = 0; t < nt; ++t) {
+        for (int i = 0; i < 3; ++i) {
+            uint64_t a = (uint64_t)s->tri[t][i], b = (uint64_t)s->tri[t][(i + 1) % 3];
+            s->keys[3 * t + i] = a < b ? a << 32 | b : b << 32 | a;
+        }
+    }
+    qsort(s->keys, 3 * nt, sizeof(uint64_t), cmp_u64);
+    for (int i = 0; i < 3 * nt;) {
+        int k = i;
+        while (k < 3 * nt && s->keys[k] == s->keys[i]) k++;
+        if (k - i != 2) {
+            s->locked[s->keys[i] >> 32] = 1;
+            s->locked[(uint32_t)s->keys[i]] = 1;
+        }
+        i = k;
+    }
+
+    memset(s->quad, 0, sizeof(Quadric) * nv);
+    for (int t = 0; t < nt; ++t) {
+        double n[3];
+        normal_of(s->pos[s->tri[t][0]], s->pos[s->tri[t][1]], s->pos[s->tri[t][2]], n);
+        double l = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (l == 0) continue;
+        n[0] /= l; n[1] /= l; n[2] /= l;
+        const float *p = s->pos[s->tri[t][0]];
+        double d = -(n[0] * p[0] + n[1] * p[1] + n[2] * p[2]);
+        for (int i = 0; i < 3; ++i) quadric_add_plane(&s->quad[s->tri[t][i]], n[0], n[1], n[2], d);
+    }
+
+    double max_cost = 0;
+    int target = nt >> j->level;
+    while (nt > target && collapse_pass(s, nv, &nt, target, &max_cost) > 0) {}
+
+    unsigned *out = j->tris + (size_t)g * span * 3;
+    for (int t = 0; t < nt; ++t)
+        for (int i = 0; i < 3; ++i) out[3 * t + i] = s->global[s->tri[t][i]];
+    j->count[g] = (uint32_t)nt;
+    j->error[g] = (float)sqrt(max_cost);
+}
+
+static void build_range(void *ctx, size_t begin, size_t end) {
+    BuildJob *j = ctx;
+    Scratch s;
+    if (scratch_init(&s, j->ct * j->group_size) != 0) {
+        atomic_store(&j->failed, 1);
+        scratch_free(&s);
+        return;
+    }
+    for (size_t g = begin; g < end; ++g) simplify_group(j, &s, (uint32_t)g);
+    scratch_free(&s);
+}
+
+int lod_build(LodSet *s, const float *positions, size_t vertex_count,
+              const unsigned *indices, size_t triangle_count, uint32_t cluster_triangles) {
+    (void)vertex_count;
+    memset(s, 0, sizeof(*s));
+    uint32_t clusters = (uint32_t)((triangle_count + cluster_triangles - 1) / cluster_triangles);
+    s->cluster_count = clusters;
+    s->cluster_triangles = cluster_triangles;
+
+    // Level 0 is the source: one group per cluster
+    s->group_count[0] = clusters;
+    s->first[0] = malloc(sizeof(uint32_t) * (clusters + 1));
+    s->error[0] = calloc(clusters ? clusters : 1, sizeof(float));
+    if (!s->first[0] || !s->error[0]) goto fail;
+    for (uint32_t c = 0; c <= clusters; ++c)
+        s->first[0][c] = (uint32_t)(c == clusters ? triangle_count : (size_t)c * cluster_triangles);
+
+    unsigned *level_tris[LOD_LEVELS] = { NULL };
+    size_t total = 0;
+    int ok = 1;
+    for (int l = 1; l < LOD_LEVELS && ok; ++l) {
+        uint32_t gs = LOD_GROUP(l), groups = (clusters + gs - 1) / gs;
+        BuildJob j = { positions, indices, triangle_count, cluster_triangles, gs, l };
+        atomic_init(&j.failed, 0);
+        s->group_count[l] = groups;
+        s->first[l] = calloc(groups + 1, sizeof(uint32_t));
+        s->error[l] = calloc(groups ? groups : 1, sizeof(float));
+        j.tris = level_tris[l] = malloc(sizeof(unsigned) * 3 * (size_t)gs * cluster_triangles * (groups ? groups : 1));
+        j.count = malloc(sizeof(uint32_t) * (groups ? groups : 1));
+        j.error = s->error[l];
+        ok = s->first[l] && s->error[l] && j.tris && j.count;
+        if (ok) parallel_for(groups, 1, build_range, &j);
+        ok = ok && !atomic_load(&j.failed);
+        for (uint32_t g = 0; g < groups && ok; ++g) {
+            s->first[l][g + 1] = s->first[l][g] + j.count[g];
+            // Monotonic: never claim less error than the finer level it replaces
+            for (uint32_t c = g * gs; c < (g + 1) * gs && c < clusters; ++c) {
+                float e = lod_error(s, l - 1, c);
+                if (e > s->error[l][g]) s->error[l][g] = e;
+            }
+        }
+        if (ok) total += s->first[l][groups];
+        free(j.count);
+    }
+
+    // Compact the levels into one index array
+    if (ok) s->indices = malloc(sizeof(unsigned) * 3 * (total ? total : 1));
+    ok = ok && s->indices;
+    size_t at = 0;
+    for (int l = 1; l < LOD_LEVELS && ok; ++l) {
+        uint32_t span = LOD_GROUP(l) * cluster_triangles;
+        s->level_start[l] = at;
+        for (uint32_t g = 0; g < s->group_count[l]; ++g) {
+            uint32_t n = s->first[l][g + 1] - s->first[l][g];
+            memcpy(s->indices + 3 * (at + s->first[l][g]), level_tris[l] + (size_t)g * span * 3,
+                   sizeof(unsigned) * 3 * n);
+        }
+        at += s->first[l][s->group_count[l]];
+    }
+    for (int l = 1; l < LOD_LEVELS; ++l) free(level_tris[l]);
+    for (int l = 1; l < LOD_LEVELS && ok; ++l)
+        meshlet_build(&s->meshlets[l], positions, s->indices + 3 * s->level_start[l], s->first[l], s->group_count[l]);
+    if (ok) return 0;
+fail:
+    lod_free(s);
+    return -1;
+}
+
+void lod_free(LodSet *s) {
+    free(s->indices);
+    for (int l = 0; l < LOD_LEVELS; ++l) {
+        free(s->first[l]);
+        free(s->error[l]);
+        meshlet_free(&s->meshlets[l]);
+    }
+    memset(s, 0, sizeof(*s));
+}
+
+int lod_select_level(const LodSet *s, uint32_t cluster, int current,
+                     float pixels_per_unit, float max_pixels) {
+    int l = current < 0 ? 0 : current >= LOD_LEVELS ? LOD_LEVELS - 1 : current;
+    while (l > 0 && lod_error(s, l, cluster) * pixels_per_unit > max_pixels) l--;
+    while (l + 1 < LOD_LEVELS && lod_error(s, l + 1, cluster) * pixels_per_unit < max_pixels * LOD_HYSTERESIS) l++;
+    return l;
+}
+
+void lod_resolve_groups(const LodSet *s, unsigned char *levels, const uint32_t *visible, uint32_t count) {
+    (void)s;
+    for (int l = LOD_LEVELS - 1; l >= 2; --l) {
+        uint32_t gs = LOD_GROUP(l);
+        // Visible clusters of a group are adjacent in the sorted list
+        for (uint32_t i = 0; i < count;) {
+            uint32_t g = visible[i] / gs, k = i;
+            int agree = 1;
+            while (k < count && visible[k] / gs == g) {
+                if (levels[visible[k]] < l) agree = 0;
+                k++;
+            }
+            if (!agree)
+                for (uint32_t m = i; m < k; ++m)
+                    if (levels[visible[m]] >= l) levels[visible[m]] = (unsigned char)(l - 1);
+            i = k;
+        }
+    }
+}
+
+// --- Background build ---
+
+struct LodJob {
+    pthread_t thread;
+    float *positions;
+    unsigned *indices;
+    size_t vertex_count, triangle_count;
+    uint32_t cluster_triangles;
+    LodSet set;
+    atomic_int state;           // 0 running, 1 done, -1 failed
+};
+
+static void *job_main(void *arg) {
+    LodJob *job = arg;
+    int r = lod_build(&job->set, job->positions, job->vertex_count, job->indices,
+                      job->triangle_count, job->cluster_triangles);
+    free(job->positions);
+    free(job->indices);
+    job->positions = NULL;
+    job->indices = NULL;
+    atomic_store(&job->state, r == 0 ? 1 : -1);
+    return NULL;
+}
+
+LodJob *lod_build_async(float *positions, size_t vertex_count,
+                        unsigned *indices, size_t triangle_count, uint32_t cluster_triangles) {
+    LodJob *job = calloc(1, sizeof(LodJob));
+    if (!job) {
+        free(positions);
+        free(indices);
+        return NULL;
+    }
+    job->positions = positions;
+    job->indices = indices;
+    job->vertex_count = vertex_count;
+    job->triangle_count = triangle_count;
+    job->cluster_triangles = cluster_triangles;
+    atomic_init(&job->state, 0);
+    if (pthread_create(&job->thread, NULL, job_main, job) != 0) {
+        free(positions);
+        free(indices);
+        free(job);
+        return NULL;
+    }
+    return job;
+}
+
+int lod_job_poll(LodJob *job, LodSet *out) {
+    int state = atomic_load(&job->state);
+    if (state == 0) return 0;
+    pthread_join(job->thread, NULL);
+    if (state > 0) *out = job->set;
+    free(job);
+    return state > 0 ? 1 : -1;
+}
+
+void lod_job_cancel(LodJob *job) {
+    pthread_join(job->thread, NULL);
+    lod_free(&job->set);
+    free(job);
+}
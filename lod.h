@@ -0,0 +1,75 @@
+// lod.h
+// Per-cluster levels of detail for loaded meshes. Clusters (runs of
+// cluster_triangles triangles in Morton order, see bvh.h) are simplified
+// by quadric-error edge collapse onto existing vertices, so every level
+// shares the mesh's vertex buffer and only needs its own indices.
+//
+// Level l simplifies groups of LOD_GROUP(l) consecutive clusters (1, 1, 4,
+// 16) to 1/2^l of their triangles, with the group's boundary vertices
+// locked. Groups nest, so wherever two groups meet, whatever their levels,
+// the shared boundary is locked in both and no cracks open. Locking whole
+// cluster boundaries alone would stall the coarse levels well above their
+// targets; grouping lets the coarse levels remove the inner borders.
+//
+// Each group level records an error bound in model units (an upper bound
+// on the distance to the source surface, made monotonic across levels).
+// lod_select_level turns it into a level for a projected pixel error, with
+// hysteresis; a group is drawn coarse only if all its visible clusters
+// agree (lod_resolve_groups).
+//
+// The groups of levels 1.. are also cut into meshlets (meshlet.h), so the
+// coarse levels can be backface culled like the source.
+#ifndef LOD_H
+#define LOD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "meshlet.h"
+
+#define LOD_LEVELS 4
+
+#define LOD_GROUP(level) ((level) < 2 ? 1u : 1u << (2 * ((level) - 1)))
+
+typedef struct {
+    uint32_t cluster_count, cluster_triangles;
+    unsigned *indices;              // levels 1.., each level's groups in order
+    size_t level_start[LOD_LEVELS]; // triangle offset of each level in indices (0 for level 0)
+    uint32_t group_count[LOD_LEVELS];
+    uint32_t *first[LOD_LEVELS];    // per group + 1: triangle offsets within the level
+    float *error[LOD_LEVELS];       // per group, model units
+    MeshletSet meshlets[LOD_LEVELS];    // levels 1.., offsets within the level; empty if out of memory
+} LodSet;
+
+int lod_build(LodSet *s, const float *positions, size_t vertex_count,
+              const unsigned *indices, size_t triangle_count, uint32_t cluster_triangles);
+void lod_free(LodSet *s);
+
+static inline uint32_t lod_first(const LodSet *s, int level, uint32_t group) {
+    return s->first[level][group];
+}
+static inline float lod_error(const LodSet *s, int level, uint32_t cluster) {
+    return s->error[level][cluster / LOD_GROUP(level)];
+}
+
+// Level for a cluster whose error would cover pixels_per_unit pixels per
+// model unit. Refines as soon as the current level exceeds max_pixels,
+// but coarsens only once the next level is below LOD_HYSTERESIS of it.
+#define LOD_HYSTERESIS 0.7f
+int lod_select_level(const LodSet *s, uint32_t cluster, int current,
+                     float pixels_per_unit, float max_pixels);
+
+// Lowers levels[] of the visible clusters (ascending ids) until every
+// group drawn at a level l >= 2 has all its visible clusters at l.
+void lod_resolve_groups(const LodSet *s, unsigned char *levels, const uint32_t *visible, uint32_t count);
+
+// Background build on its own thread. Takes ownership of positions and
+// indices. lod_job_poll returns 1 once the set is ready (and frees the
+// job), 0 while it is running, -1 if the build failed (job freed too).
+typedef struct LodJob LodJob;
+LodJob *lod_build_async(float *positions, size_t vertex_count,
+                        unsigned *indices, size_t triangle_count, uint32_t cluster_triangles);
+int lod_job_poll(LodJob *job, LodSet *out);
+void lod_job_cancel(LodJob *job);   // waits for the thread, discards the result
+
+#endif
@@ -0,0 +1,947 @@
+// mesh.c
+#include "mesh.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "normals.h"
+#include "parallel.h"
+#include "ply.h"
+
+void mesh_set_threads(int n) {
+    parallel_set_threads(n);
+}
+
+int mesh_threads(void) {
+    return parallel_threads();
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// --- Growable arrays ---
+
+typedef struct { float *data; size_t n, cap; } FloatVec;
+typedef struct { unsigned *data; size_t n, cap; } UIntVec;
+
+static int push3f(FloatVec *v, float x, float y, float z) {
+    if (grow((void **)&v->data, &v->cap, v->n + 3, sizeof(float))) return -1;
+    v->data[v->n++] = x;
+    v->data[v->n++] = y;
+    v->data[v->n++] = z;
+    return 0;
+}
+
+static int pushu(UIntVec *v, unsigned x) {
+    if (grow((void **)&v->data, &v->cap, v->n + 1, sizeof(unsigned))) return -1;
+    v->data[v->n++] = x;
+    return 0;
+}
+
+// --- Text scanning ---
+
+static const double pow10_table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+// Decimal float without locale or strtod; NULL if there is no number.
+static const char *parse_float(const char *p, const char *end, float *out) {
+    p = skip_blanks(p, end);
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+    uint64_t mant = 0;
+    int exp10 = 0, digits = 0;
+    while (p < end && (unsigned)(*p - '0') < 10) {
+        if (mant < 1000000000000000000ull) mant = mant * 10 + (*p - '0');
+        else exp10++;
+        p++;
+        digits++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && (unsigned)(*p - '0') < 10) {
+            if (mant < 1000000000000000000ull) {
+                mant = mant * 10 + (*p - '0');
+                exp10--;
+            }
+            p++;
+            digits++;
+        }
+    }
+    if (!digits) {
+        // nan / inf are rare enough for strtod
+        char buf[16];
+        size_t n = 0;
+        while (p + n < end && n < sizeof(buf) - 1 && isalpha((unsigned char)p[n])) { buf[n] = p[n]; n++; }
+        buf[n] = 0;
+        if (n == 0) return NULL;
+        *out = (float)(neg ? -strtod(buf, NULL) : strtod(buf, NULL));
+        return p + n;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        int eneg = 0, e = 0, edigits = 0;
+        if (q < end && (*q == '-' || *q == '+')) eneg = *q++ == '-';
+        while (q < end && (unsigned)(*q - '0') < 10) {
+            if (e < 10000) e = e * 10 + (*q - '0');
+            q++;
+            edigits++;
+        }
+        if (edigits) {
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    double v = (double)mant;
+    if (exp10 < 0) v = -exp10 <= 22 ? v / pow10_table[-exp10] : v * pow(10.0, exp10);
+    else if (exp10 > 0) v = exp10 <= 22 ? v * pow10_table[exp10] : v * pow(10.0, exp10);
+    *out = (float)(neg ? -v : v);
+    return p;
+}
+
+static const char *parse_long(const char *p, const char *end, long *out) {
+    p = skip_blanks(p, end);
+    int neg = 0;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+    if (p >= end || (unsigned)(*p - '0') >= 10) return NULL;
+    long v = 0;
+    while (p < end && (unsigned)(*p - '0') < 10) v = v * 10 + (*p++ - '0');
+    *out = neg ? -v : v;
+    return p;
+}
+
+static const char *line_end(const char *p, const char *end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl : end;
+}
+
+// Split [begin, end) into n ranges that start at line starts.
+static void split_lines(const char *begin, const char *end, int n, const char **cuts) {
+    size_t size = (size_t)(end - begin);
+    cuts[0] = begin;
+    for (int i = 1; i < n; ++i) {
+        const char *c = begin + size * i / n;
+        if (c < cuts[i - 1]) c = cuts[i - 1];
+        if (c > begin && c < end && c[-1] != '\n') {
+            c = line_end(c, end);
+            if (c < end) c++;
+        }
+        cuts[i] = c;
+    }
+    cuts[n] = end;
+}
+
+// --- Welding (STL): merge bit-identical positions ---
+
+typedef struct {
+    const unsigned char *base;  // first vertex of triangle 0
+    size_t tri_stride;          // bytes between triangles; vertices are 12 bytes apart
+    size_t t0, t1;
+    FloatVec pos;               // unique local positions
+    unsigned *idx;              // 3 per triangle, local
+    unsigned *remap;            // local -> global (merge step)
+    unsigned *out;              // final index destination
+    int error;
+} WeldChunk;
+
+static uint32_t hash3(const float *v) {
+    uint32_t a, b, c;
+    memcpy(&a, &v[0], 4);
+    memcpy(&b, &v[1], 4);
+    memcpy(&c, &v[2], 4);
+    uint32_t h = a * 0x9e3779b1u;
+    h ^= b * 0x85ebca77u + (h << 6) + (h >> 2);
+    h ^= c * 0xc2b2ae3du + (h << 6) + (h >> 2);
+    return h ^ (h >> 15);
+}
+
+typedef struct {
+    unsigned *slots;            // vertex index + 1, 0 empty
+    size_t mask;
+} WeldTable;
+
+static int table_init(WeldTable *t, size_t expected) {
+    size_t cap = 64;
+    while (cap < expected * 2) cap *= 2;
+    t->slots = calloc(cap, sizeof(unsigned));
+    t->mask = cap - 1;
+    return t->slots ? 0 : -1;
+}
+
+static int table_rehash(WeldTable *t, const float *pos, size_t count) {
+    WeldTable bigger;
+    if (table_init(&bigger, (t->mask + 1)) != 0) return -1;
+    for (size_t i = 0; i < count; ++i) {
+        size_t s = hash3(pos + 3 * i) & bigger.mask;
+        while (bigger.slots[s]) s = (s + 1) & bigger.mask;
+        bigger.slots[s] = (unsigned)i + 1;
+    }
+    free(t->slots);
+    *t = bigger;
+    return 0;
+}
+
+// Index of v in pos, appending it if new; ~0u on allocation failure.
+static unsigned table_insert(WeldTable *t, FloatVec *pos, const float *v) {
+    size_t s = hash3(v) & t->mask;
+    for (;;) {
+        unsigned e = t->slots[s];
+        if (!e) break;
+        if (memcmp(pos->data + 3 * (e - 1), v, 12) == 0) return e - 1;
+        s = (s + 1) & t->mask;
+    }
+    unsigned id = (unsigned)(pos->n / 3);
+    if (push3f(pos, v[0], v[1], v[2])) return ~0u;
+    t->slots[s] = id + 1;
+    if ((size_t)(id + 1) * 2 > t->mask + 1 && table_rehash(t, pos->data, id + 1)) return ~0u;
+    return id;
+}
+
+static void weld_task(void *arg) {
+    WeldChunk *c = arg;
+    size_t n = c->t1 - c->t0;
+    WeldTable t;
+    c->idx = malloc(sizeof(unsigned) * 3 * (n ? n : 1));
+    if (!c->idx || table_init(&t, n / 2 + 16)) {
+        c->error = 1;
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned char *tri = c->base + (c->t0 + i) * c->tri_stride;
+        for (int k = 0; k < 3; ++k) {
+            float v[3];
+            memcpy(v, tri + 12 * k, 12);
+            for (int j = 0; j < 3; ++j) if (v[j] == 0.0f) v[j] = 0.0f;  // -0 welds with +0
+            unsigned id = table_insert(&t, &c->pos, v);
+            if (id == ~0u) { c->error = 1; free(t.slots); return; }
+            c->idx[3 * i + k] = id;
+        }
+    }
+    free(t.slots);
+}
+
+static void weld_range(void *ctx, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) weld_task((WeldChunk *)ctx + i);
+}
+
+static void remap_task(void *arg) {
+    WeldChunk *c = arg;
+    size_t n = 3 * (c->t1 - c->t0);
+    for (size_t i = 0; i < n; ++i) c->out[i] = c->remap[c->idx[i]];
+}
+
+static void remap_range(void *ctx, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) remap_task((WeldChunk *)ctx + i);
+}
+
+// Weld a triangle soup into m.
+static int weld(const unsigned char *base, size_t tri_stride, size_t tris, int threads, Mesh *m) {
+    WeldChunk chunks[PARALLEL_MAX_THREADS];
+    int n = tris < (size_t)threads * 1024 ? 1 : threads;
+    memset(chunks, 0, sizeof(chunks));
+    for (int i = 0; i < n; ++i) {
+        chunks[i].base = base;
+        chunks[i].tri_stride = tri_stride;
+        chunks[i].t0 = tris * i / n;
+        chunks[i].t1 = tris * (i + 1) / n;
+    }
+    parallel_for((size_t)n, 1, weld_range, chunks);
+
+    int err = 0;
+    for (int i = 0; i < n; ++i) err |= chunks[i].error;
+
+    m->triangle_count = tris;
+    if (!err && n == 1) {
+        m->positions = chunks[0].pos.data;
+        m->vertex_count = chunks[0].pos.n / 3;
+        m->indices = chunks[0].idx;
+        return 0;
+    }
+
+    // Merge the per-chunk vertex sets, then rewrite indices in parallel
+    FloatVec global = {0};
+    WeldTable t = {0};
+    m->indices = malloc(sizeof(unsigned) * 3 * (tris ? tris : 1));
+    size_t total = 0;
+    for (int i = 0; i < n; ++i) total += chunks[i].pos.n / 3;
+    if (err || !m->indices || table_init(&t, total / 2 + 16)) err = 1;
+    for (int i = 0; i < n && !err; ++i) {
+        size_t count = chunks[i].pos.n / 3;
+        chunks[i].remap = malloc(sizeof(unsigned) * (count ? count : 1));
+        chunks[i].out = m->indices + 3 * chunks[i].t0;
+        if (!chunks[i].remap) { err = 1; break; }
+        for (size_t v = 0; v < count && !err; ++v) {
+            chunks[i].remap[v] = table_insert(&t, &global, chunks[i].pos.data + 3 * v);
+            if (chunks[i].remap[v] == ~0u) err = 1;
+        }
+    }
+    if (!err) parallel_for((size_t)n, 1, remap_range, chunks);
+    free(t.slots);
+    for (int i = 0; i < n; ++i) {
+        free(chunks[i].pos.data);
+        free(chunks[i].idx);
+        free(chunks[i].remap);
+    }
+    m->positions = global.data;
+    m->vertex_count = global.n / 3;
+    return err ? -1 : 0;
+}
+
+// --- STL ---
+
+static int load_stl_binary(const unsigned char *data, size_t size, int threads, Mesh *m) {
+    uint32_t tris;
+    memcpy(&tris, data + 80, 4);
+    if (84 + (size_t)tris * 50 > size) {
+        fprintf(stderr, "binary STL truncated\n");
+        return -1;
+    }
+    // Each 50-byte record: normal, three vertices, attribute bytes
+    return weld(data + 84 + 12, 50, tris, threads, m);
+}
+
+typedef struct {
+    const char *begin, *end;
+    FloatVec verts;
+    UIntVec idx;
+    UIntVec rel;                // OBJ: positions in idx holding chunk-relative indices
+    long line;                  // first bad line (relative to chunk), 0 if none
+    int error;
+} TextChunk;
+
+static void stl_ascii_task(void *arg) {
+    TextChunk *c = arg;
+    const char *p = c->begin;
+    while (p < c->end) {
+        const char *e = line_end(p, c->end);
+        const char *q = skip_blanks(p, e);
+        if (e - q > 6 && memcmp(q, "vertex", 6) == 0) {
+            float v[3];
+            q += 6;
+            for (int k = 0; k < 3 && q; ++k) q = parse_float(q, e, &v[k]);
+            if (!q || push3f(&c->verts, v[0], v[1], v[2])) { c->error = 1; return; }
+        }
+        p = e + 1;
+    }
+}
+
+static void stl_ascii_range(void *ctx, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) stl_ascii_task((TextChunk *)ctx + i);
+}
+
+static int load_stl_ascii(const char *data, size_t size, int threads, Mesh *m) {
+    TextChunk chunks[PARALLEL_MAX_THREADS];
+    const char *cuts[PARALLEL_MAX_THREADS + 1];
+    int n = size < (size_t)threads * 65536 ? 1 : threads;
+    memset(chunks, 0, sizeof(chunks));
+    split_lines(data, data + size, n, cuts);
+    for (int i = 0; i < n; ++i) {
+        chunks[i].begin = cuts[i];
+        chunks[i].end = cuts[i + 1];
+    }
+    parallel_for((size_t)n, 1, stl_ascii_range, chunks);
+
+    // Chunks keep file order, so consecutive vertex triples are the facets
+    size_t total = 0;
+    int err = 0;
+    for (int i = 0; i < n; ++i) {
+        total += chunks[i].verts.n;
+        err |= chunks[i].error;
+    }
+    float *soup = err ? NULL : malloc(sizeof(float) * (total ? total : 1));
+    if (soup) {
+        size_t at = 0;
+        for (int i = 0; i < n; ++i) {
+            memcpy(soup + at, chunks[i].verts.data, sizeof(float) * chunks[i].verts.n);
+            at += chunks[i].verts.n;
+        }
+    }
+    for (int i = 0; i < n; ++i) free(chunks[i].verts.data);
+    if (!soup) {
+        fprintf(stderr, "ASCII STL: bad vertex line or out of memory\n");
+        return -1;
+    }
+    if (total % 9) fprintf(stderr, "ASCII STL: vertex count not a multiple of 3, last facet dropped\n");
+    int r = weld((const unsigned char *)soup, 36, total / 9, threads, m);
+    free(soup);
+    return r;
+}
+
+// --- OBJ ---
+
+static void obj_task(void *arg) {
+    TextChunk *c = arg;
+    const char *p = c->begin;
+    long line = 0;
+    while (p < c->end) {
+        const char *e = line_end(p, c->end);
+        const char *q = skip_blanks(p, e);
+        line++;
+        if (e - q > 1 && q[0] == 'v' && (q[1] == ' ' || q[1] == '\t')) {
+            float v[3];
+            q++;
+            for (int k = 0; k < 3 && q; ++k) q = parse_float(q, e, &v[k]);
+            if (!q || push3f(&c->verts, v[0], v[1], v[2])) goto bad;
+        } else if (e - q > 1 && q[0] == 'f' && (q[1] == ' ' || q[1] == '\t')) {
+            // f v, v/vt, v/vt/vn or v//vn; fan-triangulate polygons
+            unsigned first = 0, prev = 0;
+            int first_rel = 0, prev_rel = 0, count = 0;
+            q++;
+            for (;;) {
+                long idx;
+                q = skip_blanks(q, e);
+                if (q >= e) break;
+                if (!(q = parse_long(q, e, &idx)) || idx == 0) goto bad;
+                while (q < e && *q != ' ' && *q != '\t' && *q != '\r') q++;   // skip /vt/vn
+
+                // Negative indices count back from the vertices seen so far;
+                // resolved once the chunk's starting vertex is known
+                int rel = idx < 0;
+                unsigned v = rel ? (unsigned)((long)(c->verts.n / 3) + idx) : (unsigned)(idx - 1);
+                if (count >= 2) {
+                    if (first_rel && pushu(&c->rel, (unsigned)c->idx.n)) goto bad;
+                    if (pushu(&c->idx, first)) goto bad;
+                    if (prev_rel && pushu(&c->rel, (unsigned)c->idx.n)) goto bad;
+                    if (pushu(&c->idx, prev)) goto bad;
+                    if (rel && pushu(&c->rel, (unsigned)c->idx.n)) goto bad;
+                    if (pushu(&c->idx, v)) goto bad;
+                }
+                if (count == 0) { first = v; first_rel = rel; }
+                prev = v;
+                prev_rel = rel;
+                count++;
+            }
+        }
+        p = e + 1;
+    }
+    return;
+bad:
+    c->error = 1;
+    c->line = line;
+}
+
+static void obj_range(void *ctx, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) obj_task((TextChunk *)ctx + i);
+}
+
+// Concatenate chunk vertices and indices into m. `obj` fixes up OBJ negative
+// indices and reports bad ones 1-based, as OBJ writes them (PLY is 0-based).
+static int gather(TextChunk *chunks, int n, int obj, Mesh *m) {
+    size_t verts = 0, idx = 0;
+    for (int i = 0; i < n; ++i) {
+        verts += chunks[i].verts.n;
+        idx += chunks[i].idx.n;
+    }
+    m->positions = malloc(sizeof(float) * (verts ? verts : 1));
+    m->indices = malloc(sizeof(unsigned) * (idx ? idx : 1));
+    if (!m->positions || !m->indices) return -1;
+
+    size_t vat = 0, iat = 0;
+    for (int i = 0; i < n; ++i) {
+        TextChunk *c = &chunks[i];
+        if (obj) {
+            unsigned base = (unsigned)(vat / 3);
+            for (size_t r = 0; r < c->rel.n; ++r) c->idx.data[c->rel.data[r]] += base;
+        }
+        // Empty chunks have NULL data
+        if (c->verts.n) memcpy(m->positions + vat, c->verts.data, sizeof(float) * c->verts.n);
+        if (c->idx.n) memcpy(m->indices + iat, c->idx.data, sizeof(unsigned) * c->idx.n);
+        vat += c->verts.n;
+        iat += c->idx.n;
+    }
+    m->vertex_count = verts / 3;
+    m->triangle_count = idx / 3;
+
+    for (size_t i = 0; i < idx; ++i) {
+        if (m->indices[i] >= m->vertex_count) {
+            fprintf(stderr, "%s: face index %u out of range (%zu vertices)\n", obj ? "OBJ" : "PLY",
+                    m->indices[i] + (obj ? 1 : 0), m->vertex_count);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void free_chunks(TextChunk *chunks, int n) {
+    for (int i = 0; i < n; ++i) {
+        free(chunks[i].verts.data);
+        free(chunks[i].idx.data);
+        free(chunks[i].rel.data);
+    }
+}
+
+static int load_obj(const char *data, size_t size, int threads, Mesh *m) {
+    TextChunk chunks[PARALLEL_MAX_THREADS];
+    const char *cuts[PARALLEL_MAX_THREADS + 1];
+    int n = size < (size_t)threads * 65536 ? 1 : threads;
+    memset(chunks, 0, sizeof(chunks));
+    split_lines(data, data + size, n, cuts);
+    for (int i = 0; i < n; ++i) {
+        chunks[i].begin = cuts[i];
+        chunks[i].end = cuts[i + 1];
+    }
+    parallel_for((size_t)n, 1, obj_range, chunks);
+
+    long lines_before = 0;
+    for (int i = 0; i < n; ++i) {
+        if (chunks[i].error) {
+            fprintf(stderr, "OBJ: cannot parse line %ld\n", lines_before + chunks[i].line);
+            free_chunks(chunks, n);
+            return -1;
+        }
+        for (const char *p = chunks[i].begin; p < chunks[i].end; p = line_end(p, chunks[i].end) + 1)
+            lines_before++;
+    }
+    int r = gather(chunks, n, 1, m);
+    free_chunks(chunks, n);
+    return r;
+}
+
+// --- PLY ---
+
+typedef struct {
+    const PlyElement *el;
+    int xyz[3];                 // property index of x, y, z
+    int face_list;              // property index of vertex_indices
+} PlyLayout;
+
+// Binary vertex block: fixed stride, decoded in parallel ranges
+typedef struct {
+    const unsigned char *base;
+    size_t stride, first, last;
+    int offs[3];
+    PlyType types[3];
+    int swap;
+    float *out;
+} PlyVertexChunk;
+
+static void ply_vertex_task(void *arg) {
+    PlyVertexChunk *c = arg;
+    for (size_t i = c->first; i < c->last; ++i) {
+        const unsigned char *v = c->base + i * c->stride;
+        for (int k = 0; k < 3; ++k)
+            c->out[3 * i + k] = (float)ply_read(v + c->offs[k], c->types[k], c->swap);
+    }
+}
+
+static void ply_vertex_range(void *ctx, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) ply_vertex_task((PlyVertexChunk *)ctx + i);
+}
+
+// ASCII: the vertex and face sections are line ranges, parsed in parallel
+typedef struct {
+    TextChunk text;
+    const PlyLayout *layout;
+    int faces;
+} PlyTextChunk;
+
+static void ply_ascii_task(void *arg) {
+    PlyTextChunk *pc = arg;
+    TextChunk *c = &pc->text;
+    const PlyElement *el = pc->layout->el;
+    const char *p = c->begin;
+    long line = 0;
+
+    while (p < c->end) {
+        const char *e = line_end(p, c->end);
+        const char *q = p;
+        float xyz[3] = {0, 0, 0};
+        line++;
+        if (skip_blanks(q, e) == e) { p = e + 1; continue; }
+        for (int k = 0; k < el->nprops && q; ++k) {
+            if (el->props[k].count_type != PLY_BAD) {
+                long n, idx;
+                unsigned first = 0, prev = 0;
+                if (!(q = parse_long(q, e, &n))) break;
+                for (long j = 0; j < n && q; ++j) {
+                    if (!(q = parse_long(q, e, &idx))) break;
+                    if (pc->faces && k == pc->layout->face_list) {
+                        if (j >= 2 && (pushu(&c->idx, first) || pushu(&c->idx, prev) ||
+                                       pushu(&c->idx, (unsigned)idx))) q = NULL;
+                        if (j == 0) first = (unsigned)idx;
+                        prev = (unsigned)idx;
+                    }
+                }
+            } else {
+                float v;
+                if (!(q = parse_float(q, e, &v))) break;
+                for (int a = 0; a < 3; ++a)
+                    if (!pc->faces && k == pc->layout->xyz[a]) xyz[a] = v;
+            }
+        }
+        if (!q || (!pc->faces && push3f(&c->verts, xyz[0], xyz[1], xyz[2]))) {
+            c->error = 1;
+            c->line = line;
+            return;
+        }
+        p = e + 1;
+    }
+}
+
+static void ply_ascii_range(void *ctx, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) ply_ascii_task((PlyTextChunk *)ctx + i);
+}
+
+static int find_prop(const PlyElement *el, const char *name) {
+    for (int i = 0; i < el->nprops; ++i)
+        if (strcmp(el->props[i].name, name) == 0) return i;
+    return -1;
+}
+
+// Size of one binary element instance starting at p (lists make it variable)
+static size_t ply_element_size(const PlyElement *el, const unsigned char *p, const unsigned char *end, int swap) {
+    size_t s = 0;
+    for (int k = 0; k < el->nprops; ++k) {
+        if (el->props[k].count_type != PLY_BAD) {
+            if (p + s + ply_size[el->props[k].count_type] > end) return 0;
+            size_t n = (size_t)ply_read(p + s, el->props[k].count_type, swap);
+            s += ply_size[el->props[k].count_type] + n * ply_size[el->props[k].type];
+        } else {
+            s += ply_size[el->props[k].type];
+        }
+    }
+    return p + s > end ? 0 : s;
+}
+
+static int load_ply(const char *data, size_t size, int threads, Mesh *m, const char **format) {
+    PlyHeader h;
+    if (ply_parse_header(data, size, &h) != 0) {
+        fprintf(stderr, "PLY: unsupported or malformed header\n");
+        return -1;
+    }
+    *format = h.format == 0 ? "ply-ascii" : "ply-binary";
+
+    PlyLayout vl = { NULL, { -1, -1, -1 }, -1 }, fl = { NULL, { -1, -1, -1 }, -1 };
+    for (int i = 0; i < h.nelements; ++i) {
+        if (strcmp(h.elements[i].name, "vertex") == 0) vl.el = &h.elements[i];
+        if (strcmp(h.elements[i].name, "face") == 0) fl.el = &h.elements[i];
+    }
+    if (!vl.el) {
+        fprintf(stderr, "PLY: no vertex element\n");
+        return -1;
+    }
+    for (int a = 0; a < 3; ++a) {
+        vl.xyz[a] = find_prop(vl.el, (const char *[]){ "x", "y", "z" }[a]);
+        if (vl.xyz[a] < 0 || vl.el->props[vl.xyz[a]].count_type != PLY_BAD) {
+            fprintf(stderr, "PLY: vertex element needs scalar x, y, z\n");
+            return -1;
+        }
+    }
+    // Binary vertices are decoded at a fixed stride, so lists cannot be walked there
+    for (int k = 0; k < vl.el->nprops; ++k) {
+        if (vl.el->props[k].count_type != PLY_BAD) {
+            fprintf(stderr, "PLY: list properties on vertices are not supported ('%s')\n",
+                    vl.el->props[k].name);
+            return -1;
+        }
+    }
+    if (fl.el) {
+        fl.face_list = find_prop(fl.el, "vertex_indices");
+        if (fl.face_list < 0) fl.face_list = find_prop(fl.el, "vertex_index");
+        if (fl.face_list < 0 || fl.el->props[fl.face_list].count_type == PLY_BAD) {
+            fprintf(stderr, "PLY: face element needs a vertex_indices list\n");
+            return -1;
+        }
+    }
+
+    const char *body = data + h.header_size, *end = data + size;
+
+    if (h.format == 0) {
+        // Locate each element's line range, then parse vertex and face lines in parallel
+        const char *sect_begin[PLY_MAX_ELEMENTS], *sect_end[PLY_MAX_ELEMENTS];
+        const char *p = body;
+        for (int i = 0; i < h.nelements; ++i) {
+            size_t l = 0;
+            sect_begin[i] = p;
+            for (; l < h.elements[i].count && p < end; ++l)
+                p = line_end(p, end) + 1;
+            if (p > end) p = end;
+            sect_end[i] = p;
+            if (l < h.elements[i].count) {
+                fprintf(stderr, "PLY: ASCII body truncated (%s: %zu of %zu lines)\n",
+                        h.elements[i].name, l, h.elements[i].count);
+                return -1;
+            }
+        }
+
+        PlyTextChunk chunks[2 * PARALLEL_MAX_THREADS];
+        const char *cuts[PARALLEL_MAX_THREADS + 1];
+        int n = size < (size_t)threads * 65536 ? 1 : threads, total = 0;
+        memset(chunks, 0, sizeof(chunks));
+        for (int i = 0; i < h.nelements; ++i) {
+            int faces = &h.elements[i] == fl.el;
+            if (&h.elements[i] != vl.el && !faces) continue;
+            split_lines(sect_begin[i], sect_end[i], n, cuts);
+            for (int k = 0; k < n; ++k, ++total) {
+                chunks[total].text.begin = cuts[k];
+                chunks[total].text.end = cuts[k + 1];
+                chunks[total].layout = faces ? &fl : &vl;
+                chunks[total].faces = faces;
+            }
+        }
+        // gather() keeps vertex and face chunks apart, so only the order
+        // within each section matters
+        parallel_for((size_t)total, 1, ply_ascii_range, chunks);
+
+        TextChunk text[2 * PARALLEL_MAX_THREADS];
+        int err = 0;
+        for (int i = 0; i < total; ++i) {
+            text[i] = chunks[i].text;
+            if (text[i].error) err = 1;
+        }
+        int r = err ? -1 : gather(text, total, 0, m);
+        if (err) fprintf(stderr, "PLY: cannot parse ASCII body\n");
+        free_chunks(text, total);
+        return r;
+    }
+
+    // Binary
+    int swap = ply_swap(&h);
+    const unsigned char *p = (const unsigned char *)body, *bend = (const unsigned char *)end;
+    for (int i = 0; i < h.nelements; ++i) {
+        const PlyElement *el = &h.elements[i];
+        if (el == vl.el) {
+            PlyVertexChunk chunks[PARALLEL_MAX_THREADS];
+            size_t stride = ply_element_size(el, p, bend, swap);
+            if (!stride || p + stride * el->count > bend) goto truncated;
+            m->vertex_count = el->count;
+            m->positions = malloc(sizeof(float) * 3 * (el->count ? el->count : 1));
+            if (!m->positions) return -1;
+            int n = el->count < (size_t)threads * 4096 ? 1 : threads;
+            for (int k = 0; k < n; ++k) {
+                chunks[k].base = p;
+                chunks[k].stride = stride;
+                chunks[k].first = el->count * k / n;
+                chunks[k].last = el->count * (k + 1) / n;
+                chunks[k].swap = swap;
+                chunks[k].out = m->positions;
+                for (int a = 0; a < 3; ++a) {
+                    int off = 0;
+                    for (int j = 0; j < vl.xyz[a]; ++j) off += ply_size[el->props[j].type];
+                    chunks[k].offs[a] = off;
+                    chunks[k].types[a] = el->props[vl.xyz[a]].type;
+                }
+            }
+            parallel_for((size_t)n, 1, ply_vertex_range, chunks);
+            p += stride * el->count;
+        } else if (el == fl.el) {
+            // Lists make records variable-sized: one sequential pass
+            UIntVec idx = {0};
+            for (size_t f = 0; f < el->count; ++f) {
+                for (int k = 0; k < el->nprops; ++k) {
+                    PlyType ct = el->props[k].count_type, t = el->props[k].type;
+                    if (ct == PLY_BAD) {
+                        if (p + ply_size[t] > bend) goto truncated_faces;
+                        p += ply_size[t];
+                        continue;
+                    }
+                    if (p + ply_size[ct] > bend) goto truncated_faces;
+                    size_t cnt = (size_t)ply_read(p, ct, swap);
+                    p += ply_size[ct];
+                    if (p + cnt * ply_size[t] > bend) goto truncated_faces;
+                    // Faces with fewer than three corners add no triangles
+                    if (k == fl.face_list && cnt >= 3) {
+                        unsigned first = (unsigned)ply_read(p, t, swap), prev = 0;
+                        for (size_t j = 1; j < cnt; ++j) {
+                            unsigned v = (unsigned)ply_read(p + j * ply_size[t], t, swap);
+                            if (j >= 2 && (pushu(&idx, first) || pushu(&idx, prev) || pushu(&idx, v))) {
+                                free(idx.data);
+                                return -1;
+                            }
+                            prev = v;
+                        }
+                    }
+                    p += cnt * ply_size[t];
+                }
+            }
+            m->indices = idx.data ? idx.data : malloc(sizeof(unsigned));
+            m->triangle_count = idx.n / 3;
+            continue;
+        truncated_faces:
+            free(idx.data);
+            goto truncated;
+        } else {
+            for (size_t j = 0; j < el->count; ++j) {
+                size_t s = ply_element_size(el, p, bend, swap);
+                if (!s && el->nprops) goto truncated;
+                p += s;
+            }
+        }
+    }
+    if (!m->indices) m->indices = malloc(sizeof(unsigned));
+    for (size_t i = 0; i < 3 * m->triangle_count; ++i) {
+        if (m->indices[i] >= m->vertex_count) {
+            fprintf(stderr, "PLY: face index %u out of range\n", m->indices[i]);
+            return -1;
+        }
+    }
+    return 0;
+
+truncated:
+    fprintf(stderr, "PLY: binary body truncated\n");
+    return -1;
+}
+
+// --- Entry points ---
+
+static int has_ext(const char *path, const char *ext) {
+    size_t n = strlen(path), e = strlen(ext);
+    return n >= e && strcasecmp(path + n - e, ext) == 0;
+}
+
+static void compute_bounds(Mesh *m) {
+    for (int a = 0; a < 3; ++a) {
+        m->bounds_min[a] = m->vertex_count ? INFINITY : 0;
+        m->bounds_max[a] = m->vertex_count ? -INFINITY : 0;
+    }
+    for (size_t i = 0; i < m->vertex_count; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            float v = m->positions[3 * i + a];
+            if (v < m->bounds_min[a]) m->bounds_min[a] = v;
+            if (v > m->bounds_max[a]) m->bounds_max[a] = v;
+        }
+    }
+}
+
+int mesh_load(const char *path, Mesh *m, MeshLoadStats *stats) {
+    double t0 = now_seconds();
+    int threads = mesh_threads();
+    memset(m, 0, sizeof(*m));
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "cannot open %s\n", path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        fprintf(stderr, "%s: empty file\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "cannot map %s\n", path);
+        return -1;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    madvise(map, size, MADV_WILLNEED);
+
+    const char *data = map;
+    const char *format;
+    int r;
+    if (has_ext(path, ".obj")) {
+        format = "obj";
+        r = load_obj(data, size, threads, m);
+    } else if (has_ext(path, ".ply") || (size >= 4 && memcmp(data, "ply", 3) == 0)) {
+        format = "ply";
+        r = load_ply(data, size, threads, m, &format);
+    } else {
+        // Binary STL can also start with "solid"; trust the size check first
+        uint32_t tris = 0;
+        if (size >= 84) memcpy(&tris, data + 80, 4);
+        int binary = size >= 84 && 84 + (size_t)tris * 50 == size;
+        if (!binary && !(size >= 5 && memcmp(data, "solid", 5) == 0))
+            binary = size >= 84;
+        format = binary ? "stl-binary" : "stl-ascii";
+        r = binary ? load_stl_binary((const unsigned char *)data, size, threads, m)
+                   : load_stl_ascii(data, size, threads, m);
+    }
+    munmap(map, size);
+
+    if (r != 0) {
+        fprintf(stderr, "failed to load %s\n", path);
+        mesh_free(m);
+        return -1;
+    }
+    compute_bounds(m);
+
+    if (stats) {
+        stats->format = format;
+        stats->bytes = size;
+        stats->seconds = now_seconds() - t0;
+        stats->threads = threads;
+    }
+    return 0;
+}
+
+void mesh_free(Mesh *m) {
+    free(m->positions);
+    free(m->normals);
+    free(m->indices);
+    memset(m, 0, sizeof(*m));
+}
+
+int mesh_compute_normals(Mesh *m, float crease_degrees) {
+    size_t nv = m->vertex_count ? m->vertex_count : 1;
+    float *soa = malloc(sizeof(float) * 3 * nv);
+    if (!soa) {
+        fprintf(stderr, "out of memory computing normals\n");
+        return -1;
+    }
+    for (size_t v = 0; v < m->vertex_count; ++v) {
+        soa[v] = m->positions[3 * v];
+        soa[nv + v] = m->positions[3 * v + 1];
+        soa[2 * nv + v] = m->positions[3 * v + 2];
+    }
+    NormalsInput in = { soa, soa + nv, soa + 2 * nv, m->vertex_count, m->indices, m->triangle_count };
+    NormalsOutput out;
+    int r = normals_compute(&in, crease_degrees, &out);
+    float *positions = NULL, *normals = NULL;
+    if (r == 0) {
+        size_t n = out.vertex_count ? out.vertex_count : 1;
+        positions = malloc(sizeof(float) * 3 * n);
+        normals = malloc(sizeof(float) * 3 * n);
+        if (!positions || !normals) {
+            fprintf(stderr, "out of memory computing normals\n");
+            r = -1;
+        }
+    }
+    if (r == 0) {
+        // Split vertices repeat their source position
+        for (size_t v = 0; v < out.vertex_count; ++v) {
+            memcpy(positions + 3 * v, m->positions + 3 * (size_t)out.source[v], sizeof(float) * 3);
+            normals[3 * v] = out.nx[v];
+            normals[3 * v + 1] = out.ny[v];
+            normals[3 * v + 2] = out.nz[v];
+        }
+        free(m->positions);
+        free(m->normals);
+        free(m->indices);
+        m->positions = positions;
+        m->normals = normals;
+        m->indices = out.indices;
+        m->vertex_count = out.vertex_count;
+        out.indices = NULL;
+    } else {
+        free(positions);
+        free(normals);
+    }
+    normals_free(&out);
+    free(soa);
+    return r;
+}
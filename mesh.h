@@ -0,0 +1,43 @@
+// mesh.h
+// Triangle mesh loading for the main views: STL (binary and ASCII), OBJ
+// and PLY (ASCII and binary), read through a memory mapping and parsed in
+// parallel chunks, one thread per online CPU by default.
+//
+// Every format ends up in the same compact indexed layout. STL triangle
+// soup is welded on exact vertex positions; OBJ and PLY keep their own
+// vertex indexing, with polygons fan-triangulated. Only positions are read.
+// Errors are reported on stderr and the call returns -1.
+#ifndef MESH_H
+#define MESH_H
+
+#include <stddef.h>
+
+typedef struct {
+    float *positions;           // xyz per vertex
+    float *normals;             // xyz per vertex, NULL until mesh_compute_normals
+    unsigned *indices;          // 3 per triangle
+    size_t vertex_count;
+    size_t triangle_count;
+    float bounds_min[3], bounds_max[3];
+} Mesh;
+
+typedef struct {
+    const char *format;         // "stl-binary", "stl-ascii", "obj", "ply-ascii", ...
+    size_t bytes;               // file size
+    double seconds;             // map + parse + weld, wall clock
+    int threads;
+} MeshLoadStats;
+
+void mesh_set_threads(int n);   // 0 (default): one per online CPU
+int mesh_threads(void);
+
+int mesh_load(const char *path, Mesh *m, MeshLoadStats *stats);  // stats may be NULL
+void mesh_free(Mesh *m);
+
+// Angle-weighted smooth vertex normals (normals.h), splitting vertices
+// across edges sharper than crease_degrees, so the vertex count and
+// indices may change. Returns -1 and leaves the mesh as it was on failure.
+#define MESH_CREASE_DEGREES 45.0f
+int mesh_compute_normals(Mesh *m, float crease_degrees);
+
+#endif
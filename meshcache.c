@@ -0,0 +1,389 @@
+// meshcache.c
+#include "meshcache.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bvh.h"
+#include "meshopt.h"
+
+static const char cache_magic[8] = "VCMESH";
+
+#define ALIGN64(x) (((x) + 63) & ~(uint64_t)63)
+
+int meshcache_path(const char *source, char *out, size_t n) {
+    int r = snprintf(out, n, "%s.vcmesh", source);
+    return r < 0 || (size_t)r >= n ? -1 : 0;
+}
+
+// 64-bit content hash, four independent lanes of 8 bytes
+static uint64_t hash_bytes(const unsigned char *p, size_t n) {
+    uint64_t h[4] = { 0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+                      0x165667b19e3779f9ull, 0x27d4eb2f165667c5ull };
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        for (int k = 0; k < 4; ++k) {
+            uint64_t w;
+            memcpy(&w, p + i + 8 * k, 8);
+            h[k] = (h[k] ^ w) * 0x9fb21c651e98df25ull;
+            h[k] ^= h[k] >> 31;
+        }
+    }
+    uint64_t r = n;
+    for (int k = 0; k < 4; ++k) r = (r ^ h[k]) * 0x100000001b3ull + (r >> 29);
+    for (; i < n; ++i) r = (r ^ p[i]) * 0x100000001b3ull;
+    return r ^ (r >> 32);
+}
+
+typedef struct {
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t hash;
+} SourceInfo;
+
+// Size and mtime only; cheap enough for every open
+static int source_stat(const char *path, SourceInfo *s) {
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size == 0) return -1;
+    s->size = (uint64_t)st.st_size;
+    s->mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return 0;
+}
+
+// Reads the whole source, so only once size and mtime have matched.
+// -1 if the file changed since source_stat.
+static int source_hash(const char *path, SourceInfo *s) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != s->size ||
+        (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec != s->mtime_ns) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, s->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, s->size, MADV_SEQUENTIAL);
+    s->hash = hash_bytes(map, s->size);
+    munmap(map, s->size);
+    return 0;
+}
+
+// --- Octahedral normals ---
+
+static float sign_nz(float v) { return v < 0 ? -1.0f : 1.0f; }
+
+void meshcache_oct_encode(const float n[3], int16_t out[2]) {
+    float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    float x = l1 > 0 ? n[0] / l1 : 0, y = l1 > 0 ? n[1] / l1 : 0;
+    if (n[2] < 0) {
+        float ox = x;
+        x = (1 - fabsf(y)) * sign_nz(ox);
+        y = (1 - fabsf(ox)) * sign_nz(y);
+    }
+    out[0] = (int16_t)lrintf(x * 32767);
+    out[1] = (int16_t)lrintf(y * 32767);
+}
+
+void meshcache_oct_decode(const int16_t in[2], float n[3]) {
+    float x = in[0] / 32767.0f, y = in[1] / 32767.0f;
+    float z = 1 - fabsf(x) - fabsf(y);
+    if (z < 0) {
+        float ox = x;
+        x = (1 - fabsf(y)) * sign_nz(ox);
+        y = (1 - fabsf(ox)) * sign_nz(y);
+    }
+    float l = sqrtf(x * x + y * y + z * z);
+    n[0] = x / l;
+    n[1] = y / l;
+    n[2] = z / l;
+}
+
+// --- Writing ---
+
+static void quant_params(const float bmin[3], const float bmax[3], float scale[3], float offset[3]) {
+    for (int a = 0; a < 3; ++a) {
+        float e = bmax[a] - bmin[a];
+        scale[a] = e > 0 ? e / 65534.0f : 1.0f;
+        offset[a] = bmin[a] + 32767.0f * scale[a];
+    }
+}
+
+typedef struct {
+    int16_t pos[4];
+    int16_t nrm[2];
+} QVertex;
+
+static uint32_t qhash(const QVertex *v) {
+    uint64_t a, b;
+    memcpy(&a, v->pos, 8);
+    uint32_t n;
+    memcpy(&n, v->nrm, 4);
+    b = a ^ ((uint64_t)n * 0x9e3779b97f4a7c15ull);
+    b *= 0xff51afd7ed558ccdull;
+    return (uint32_t)(b ^ (b >> 32));
+}
+
+static int write_cache(const char *source, Mesh *m) {
+    char path[4096], tmp[4200];
+    SourceInfo src;
+    if (meshcache_path(source, path, sizeof(path)) != 0 || source_stat(source, &src) != 0 ||
+        source_hash(source, &src) != 0)
+        return -1;
+    if (!m->normals && mesh_compute_normals(m, MESH_CREASE_DEGREES) != 0) return -1;
+    bvh_sort_triangles(m->positions, m->indices, m->triangle_count, m->bounds_min, m->bounds_max);
+
+    float scale[3], offset[3];
+    quant_params(m->bounds_min, m->bounds_max, scale, offset);
+
+    // Quantise and merge vertices that became identical
+    size_t nv = m->vertex_count, cap = 64;
+    while (cap < nv * 2) cap *= 2;
+    QVertex *verts = malloc(sizeof(QVertex) * (nv ? nv : 1));
+    unsigned *remap = malloc(sizeof(unsigned) * (nv ? nv : 1));
+    unsigned *slots = calloc(cap, sizeof(unsigned));
+    unsigned *tris = malloc(sizeof(unsigned) * 3 * (m->triangle_count ? m->triangle_count : 1));
+    if (!verts || !remap || !slots || !tris) {
+        free(verts); free(remap); free(slots); free(tris);
+        return -1;
+    }
+    size_t unique = 0;
+    for (size_t i = 0; i < nv; ++i) {
+        QVertex q;
+        for (int a = 0; a < 3; ++a) {
+            long v = lrintf((m->positions[3 * i + a] - offset[a]) / scale[a]);
+            q.pos[a] = (int16_t)(v < -32767 ? -32767 : v > 32767 ? 32767 : v);
+        }
+        q.pos[3] = 0;
+        meshcache_oct_encode(m->normals + 3 * i, q.nrm);
+        size_t s = qhash(&q) & (cap - 1);
+        while (slots[s] && memcmp(&verts[slots[s] - 1], &q, sizeof(q)) != 0) s = (s + 1) & (cap - 1);
+        if (!slots[s]) {
+            verts[unique] = q;
+            slots[s] = (unsigned)++unique;
+        }
+        remap[i] = slots[s] - 1;
+    }
+    free(slots);
+
+    size_t nt = 0;
+    for (size_t t = 0; t < m->triangle_count; ++t) {
+        unsigned a = remap[m->indices[3 * t]], b = remap[m->indices[3 * t + 1]], c = remap[m->indices[3 * t + 2]];
+        if (a == b || b == c || a == c) continue;
+        tris[3 * nt] = a;
+        tris[3 * nt + 1] = b;
+        tris[3 * nt + 2] = c;
+        nt++;
+    }
+
+    // Reorder for the vertex cache and fetch, then permute the vertices to match
+    float acmr_before = meshopt_acmr(tris, nt, unique);
+    float *fpos = malloc(sizeof(float) * 3 * (unique ? unique : 1));
+    QVertex *ordered = malloc(sizeof(QVertex) * (unique ? unique : 1));
+    if (fpos && ordered) {
+        for (size_t i = 0; i < unique; ++i)
+            for (int a = 0; a < 3; ++a) fpos[3 * i + a] = offset[a] + scale[a] * verts[i].pos[a];
+        if (meshopt_reorder_triangles(tris, nt, fpos, unique, MESHCACHE_CHUNK_TRIANGLES) == 0) {
+            meshopt_fetch_remap(tris, 3 * nt, unique, remap);
+            for (size_t i = 0; i < unique; ++i) ordered[remap[i]] = verts[i];
+            QVertex *t = verts;
+            verts = ordered;
+            ordered = t;
+        }
+    }
+    free(fpos);
+    free(ordered);
+    free(remap);
+
+    MeshCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, cache_magic, sizeof(h.magic));
+    h.version = MESHCACHE_VERSION;
+    h.byte_order = 0x01020304;
+    h.source_size = src.size;
+    h.source_mtime_ns = src.mtime_ns;
+    h.source_hash = src.hash;
+    h.vertex_count = unique;
+    h.triangle_count = nt;
+    h.chunk_count = (nt + MESHCACHE_CHUNK_TRIANGLES - 1) / MESHCACHE_CHUNK_TRIANGLES;
+    h.index_size = unique <= 65536 ? 2 : 4;
+    memcpy(h.bounds_min, m->bounds_min, sizeof(h.bounds_min));
+    memcpy(h.bounds_max, m->bounds_max, sizeof(h.bounds_max));
+    h.acmr_before = acmr_before;
+    h.acmr_after = meshopt_acmr(tris, nt, unique);
+    h.positions_offset = ALIGN64(sizeof(h));
+    h.normals_offset = ALIGN64(h.positions_offset + 8 * unique);
+    h.indices_offset = ALIGN64(h.normals_offset + 4 * unique);
+    h.chunks_offset = ALIGN64(h.indices_offset + (uint64_t)h.index_size * 3 * nt);
+    h.file_size = h.chunks_offset + sizeof(MeshCacheChunk) * h.chunk_count;
+
+    unsigned char *buf = calloc(1, h.file_size);
+    if (!buf) {
+        free(verts);
+        free(tris);
+        return -1;
+    }
+    memcpy(buf, &h, sizeof(h));
+    int16_t *pos = (int16_t *)(buf + h.positions_offset), *nrm = (int16_t *)(buf + h.normals_offset);
+    for (size_t i = 0; i < unique; ++i) {
+        memcpy(pos + 4 * i, verts[i].pos, 8);
+        memcpy(nrm + 2 * i, verts[i].nrm, 4);
+    }
+    for (size_t i = 0; i < 3 * nt; ++i) {
+        if (h.index_size == 2) ((uint16_t *)(buf + h.indices_offset))[i] = (uint16_t)tris[i];
+        else ((uint32_t *)(buf + h.indices_offset))[i] = tris[i];
+    }
+    MeshCacheChunk *chunks = (MeshCacheChunk *)(buf + h.chunks_offset);
+    for (size_t c = 0; c < h.chunk_count; ++c) {
+        MeshCacheChunk *ch = &chunks[c];
+        ch->first_triangle = (uint32_t)(c * MESHCACHE_CHUNK_TRIANGLES);
+        ch->triangle_count = (uint32_t)(nt - ch->first_triangle < MESHCACHE_CHUNK_TRIANGLES
+                                        ? nt - ch->first_triangle : MESHCACHE_CHUNK_TRIANGLES);
+        for (int a = 0; a < 3; ++a) {
+            ch->bounds_min[a] = INFINITY;
+            ch->bounds_max[a] = -INFINITY;
+        }
+        for (size_t i = 3 * (size_t)ch->first_triangle; i < 3 * ((size_t)ch->first_triangle + ch->triangle_count); ++i) {
+            for (int a = 0; a < 3; ++a) {
+                float v = offset[a] + scale[a] * verts[tris[i]].pos[a];
+                if (v < ch->bounds_min[a]) ch->bounds_min[a] = v;
+                if (v > ch->bounds_max[a]) ch->bounds_max[a] = v;
+            }
+        }
+    }
+    free(verts);
+    free(tris);
+
+    // Write beside the final name and rename, so readers never see half a file
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    FILE *fp = fopen(tmp, "wb");
+    int ok = fp && fwrite(buf, 1, h.file_size, fp) == h.file_size;
+    if (fp && fclose(fp) != 0) ok = 0;
+    free(buf);
+    if (!ok || rename(tmp, path) != 0) {
+        fprintf(stderr, "cannot write mesh cache %s\n", path);
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int meshcache_write(const char *source, const Mesh *m) {
+    // Normals and the Morton sort go to copies; the caller's mesh stays as loaded
+    Mesh w = *m;
+    w.indices = malloc(sizeof(unsigned) * 3 * (m->triangle_count ? m->triangle_count : 1));
+    w.positions = m->normals ? m->positions : malloc(sizeof(float) * 3 * (m->vertex_count ? m->vertex_count : 1));
+    int r = -1;
+    if (w.indices && w.positions) {
+        memcpy(w.indices, m->indices, sizeof(unsigned) * 3 * m->triangle_count);
+        if (!m->normals) memcpy(w.positions, m->positions, sizeof(float) * 3 * m->vertex_count);
+        r = write_cache(source, &w);
+    }
+    free(w.indices);
+    if (!m->normals) {
+        free(w.positions);
+        free(w.normals);
+    }
+    return r;
+}
+
+// --- Reading ---
+
+int meshcache_open(const char *source, MeshCache *c) {
+    char path[4096];
+    memset(c, 0, sizeof(*c));
+    if (meshcache_path(source, path, sizeof(path)) != 0) return -1;
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeshCacheHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    c->map = map;
+    c->map_size = (size_t)st.st_size;
+
+    const MeshCacheHeader *h = map;
+    uint64_t nv = h->vertex_count, nt = h->triangle_count;
+    int ok = memcmp(h->magic, cache_magic, sizeof(h->magic)) == 0 &&
+             h->version == MESHCACHE_VERSION && h->byte_order == 0x01020304 &&
+             h->file_size == c->map_size && (h->index_size == 2 || h->index_size == 4) &&
+             nv < (1ull << 32) && nt < (1ull << 32) &&
+             h->chunk_count == (nt + MESHCACHE_CHUNK_TRIANGLES - 1) / MESHCACHE_CHUNK_TRIANGLES &&
+             h->positions_offset >= sizeof(*h) && h->positions_offset % 64 == 0 &&
+             h->normals_offset >= h->positions_offset + 8 * nv && h->normals_offset % 64 == 0 &&
+             h->indices_offset >= h->normals_offset + 4 * nv && h->indices_offset % 64 == 0 &&
+             h->chunks_offset >= h->indices_offset + h->index_size * 3 * nt && h->chunks_offset % 64 == 0 &&
+             h->file_size >= h->chunks_offset + sizeof(MeshCacheChunk) * h->chunk_count;
+
+    // Source checks last, and the hash only once size and mtime agree:
+    // hashing reads the whole model
+    SourceInfo src;
+    ok = ok && source_stat(source, &src) == 0 && src.size == h->source_size &&
+         src.mtime_ns == h->source_mtime_ns && source_hash(source, &src) == 0 &&
+         src.hash == h->source_hash;
+    if (!ok) {
+        meshcache_close(c);
+        return -1;
+    }
+
+    const unsigned char *base = map;
+    c->header = h;
+    c->positions = (const int16_t *)(base + h->positions_offset);
+    c->normals = (const int16_t *)(base + h->normals_offset);
+    c->indices = base + h->indices_offset;
+    c->chunks = (const MeshCacheChunk *)(base + h->chunks_offset);
+    quant_params(h->bounds_min, h->bounds_max, c->scale, c->offset);
+
+    // Indices were checked when written; a corrupted file must not crash the GL
+    for (uint64_t i = 0; i < 3 * nt; ++i) {
+        uint32_t v = h->index_size == 2 ? ((const uint16_t *)c->indices)[i] : ((const uint32_t *)c->indices)[i];
+        if (v >= nv) {
+            fprintf(stderr, "mesh cache %s is corrupt, ignoring it\n", path);
+            meshcache_close(c);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void meshcache_close(MeshCache *c) {
+    if (c->map) munmap(c->map, c->map_size);
+    memset(c, 0, sizeof(*c));
+}
+
+int meshcache_to_mesh(const MeshCache *c, Mesh *m) {
+    const MeshCacheHeader *h = c->header;
+    size_t nv = h->vertex_count, nt = h->triangle_count;
+    memset(m, 0, sizeof(*m));
+    m->positions = malloc(sizeof(float) * 3 * (nv ? nv : 1));
+    m->normals = malloc(sizeof(float) * 3 * (nv ? nv : 1));
+    m->indices = malloc(sizeof(unsigned) * 3 * (nt ? nt : 1));
+    if (!m->positions || !m->normals || !m->indices) {
+        mesh_free(m);
+        return -1;
+    }
+    for (size_t i = 0; i < nv; ++i) {
+        for (int a = 0; a < 3; ++a)
+            m->positions[3 * i + a] = c->offset[a] + c->scale[a] * c->positions[4 * i + a];
+        meshcache_oct_decode(c->normals + 2 * i, m->normals + 3 * i);
+    }
+    for (size_t i = 0; i < 3 * nt; ++i)
+        m->indices[i] = h->index_size == 2 ? ((const uint16_t *)c->indices)[i] : ((const uint32_t *)c->indices)[i];
+    m->vertex_count = nv;
+    m->triangle_count = nt;
+    memcpy(m->bounds_min, h->bounds_min, sizeof(m->bounds_min));
+    memcpy(m->bounds_max, h->bounds_max, sizeof(m->bounds_max));
+    return 0;
+}
@@ -0,0 +1,86 @@
+// meshcache.h
+// Binary cache for loaded meshes, written next to the source as
+// <source>.vcmesh and memory-mapped on later opens so nothing is parsed.
+//
+// Layout (native endianness, sections 64-byte aligned): a fixed header,
+// positions quantised to int16 over the mesh bounds (4 per vertex, the
+// fourth is padding so rows stay 8-byte aligned), octahedral normals as
+// two snorm16, the index buffer (16-bit when the vertex count allows),
+// and bounds for each run of MESHCACHE_CHUNK_TRIANGLES triangles. The
+// triangles are in Morton order, so those runs serve as culling clusters.
+// Vertices that quantise to the same position and normal are merged and
+// triangles that collapse are dropped; the result is then reordered for
+// the vertex cache and fetch (meshopt.h), so cached loads skip that too.
+// The cache is therefore not index for index the source: triangles that
+// were degenerate already and slivers thinner than a quantisation step
+// (1/65534 of the bounds) are lost. Of bench_mesh's 262144-triangle
+// sphere the STL copies keep 261629 (welding leaves a pole fan with zero
+// area) and OBJ and PLY 262141. header->triangle_count is what survived;
+// bench_mesh reports the difference as cache_dropped_triangles.
+//
+// A cache is used only if its magic, version and section sizes check out
+// and the recorded source size and mtime still match; only then is the
+// source read to compare its content hash.
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh.h"
+
+#define MESHCACHE_VERSION 4
+#define MESHCACHE_CHUNK_TRIANGLES 256
+
+typedef struct {
+    float bounds_min[3], bounds_max[3];
+    uint32_t first_triangle, triangle_count;
+} MeshCacheChunk;
+
+typedef struct {
+    char magic[8];              // "VCMESH\0\0"
+    uint32_t version;
+    uint32_t byte_order;        // 0x01020304 as written
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t source_hash;
+    uint64_t vertex_count, triangle_count, chunk_count;
+    uint32_t index_size;        // 2 or 4
+    uint32_t reserved;
+    float bounds_min[3], bounds_max[3];
+    float acmr_before, acmr_after;  // meshopt.h statistics from the write
+    uint64_t positions_offset, normals_offset, indices_offset, chunks_offset;
+    uint64_t file_size;
+} MeshCacheHeader;
+
+typedef struct {
+    void *map;
+    size_t map_size;
+    const MeshCacheHeader *header;
+    const int16_t *positions;   // 4 per vertex
+    const int16_t *normals;     // 2 per vertex, octahedral
+    const void *indices;        // header->index_size bytes each
+    const MeshCacheChunk *chunks;
+    float scale[3], offset[3];  // position = offset + scale * stored
+} MeshCache;
+
+// "<source>.vcmesh"; -1 if it does not fit.
+int meshcache_path(const char *source, char *out, size_t n);
+
+// Maps a valid, up-to-date cache for source. Returns -1 (quietly) when
+// there is none or it is stale.
+int meshcache_open(const char *source, MeshCache *c);
+void meshcache_close(MeshCache *c);
+
+// Writes the cache for source from m. Normals are computed if missing and
+// triangles Morton-sorted, both on copies: m is not modified.
+int meshcache_write(const char *source, const Mesh *m);
+
+// Decodes into a float Mesh, for CPU-side users.
+int meshcache_to_mesh(const MeshCache *c, Mesh *m);
+
+// Octahedral normal coding, exposed for the uploaders.
+void meshcache_oct_encode(const float n[3], int16_t out[2]);
+void meshcache_oct_decode(const int16_t in[2], float n[3]);
+
+#endif
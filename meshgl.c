@@ -0,0 +1,575 @@
+// meshgl.c
+#define GL_GLEXT_PROTOTYPES
+#include "meshgl.h"
+
+#include <GL/glext.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fit.h"
+#include "glstate.h"
+
+static void setBounds(MeshGL *g, const float bmin[3], const float bmax[3]) {
+    g->extent = 0;
+    for (int a = 0; a < 3; ++a) {
+        g->center[a] = 0.5f * (bmin[a] + bmax[a]);
+        float e = bmax[a] - bmin[a];
+        if (e > g->extent) g->extent = e;
+    }
+    if (g->extent <= 0) g->extent = 1;
+}
+
+static int buildClusters(MeshGL *g, const BvhBox *boxes, uint32_t count, uint32_t cluster_triangles) {
+    g->cluster_triangles = cluster_triangles;
+    g->culling = 1;
+    g->lod_pixel_error = 1.0f;
+    g->occlusion_culling = 1;
+    g->ranges = malloc(sizeof(BvhRange) * (count ? count : 1));
+    g->occlusion_ranges = malloc(sizeof(BvhRange) * (count ? count : 1));
+    g->cluster_sphere = malloc(sizeof(float) * 4 * (count ? count : 1));
+    g->cluster_level = calloc(count ? count : 1, 1);
+    g->cluster_visible = malloc(sizeof(uint32_t) * (count ? count : 1));
+    if (!g->ranges || !g->occlusion_ranges || !g->cluster_sphere || !g->cluster_level || !g->cluster_visible ||
+        bvh_build(&g->bvh, boxes, count) != 0) {
+        fprintf(stderr, "out of memory building the mesh BVH\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        float r2 = 0;
+        for (int a = 0; a < 3; ++a) {
+            float h = 0.5f * (boxes[i].max[a] - boxes[i].min[a]);
+            g->cluster_sphere[4 * i + a] = boxes[i].min[a] + h;
+            r2 += h * h;
+        }
+        g->cluster_sphere[4 * i + 3] = sqrtf(r2);
+    }
+    // Without queries every cluster in the frustum is drawn
+    occlusion_init(&g->occlusion, boxes, count, 1e-3f * g->extent);
+    return 0;
+}
+
+// Per-frame meshlet scratch for up to n meshlets per glMultiDrawElements
+static int reserveMeshlets(MeshGL *g, size_t n) {
+    if (n <= g->meshlet_capacity) return 0;
+    unsigned char *front = realloc(g->meshlet_front, n);
+    if (front) g->meshlet_front = front;
+    GLsizei *count = realloc(g->run_count, sizeof(GLsizei) * n);
+    if (count) g->run_count = count;
+    const GLvoid **offset = realloc(g->run_offset, sizeof(GLvoid *) * n);
+    if (offset) g->run_offset = offset;
+    if (!front || !count || !offset) return -1;
+    g->meshlet_capacity = n;
+    return 0;
+}
+
+// Meshlets over the uploaded triangle order; without them every full-detail
+// cluster is submitted whole. Back faces are only culled on closed meshes:
+// those of an open shell or a mis-wound part can be in view.
+static void buildMeshlets(MeshGL *g, const float *positions, size_t vertex_count, const unsigned *indices,
+                          size_t triangle_count) {
+    g->backface_culling = meshlet_closed(positions, vertex_count, indices, triangle_count);
+    uint32_t clusters = g->bvh.cluster_count;
+    uint32_t *first = malloc(sizeof(uint32_t) * ((size_t)clusters + 1));
+    if (first) {
+        for (uint32_t c = 0; c <= clusters; ++c)
+            first[c] = (uint32_t)(c == clusters ? triangle_count : (size_t)c * g->cluster_triangles);
+        if (meshlet_build(&g->meshlets, positions, indices, first, clusters) == 0 &&
+            reserveMeshlets(g, g->meshlets.count) == 0) {
+            free(first);
+            return;
+        }
+    }
+    free(first);
+    fprintf(stderr, "out of memory building meshlets; submitting backfacing clusters\n");
+    meshlet_free(&g->meshlets);
+}
+
+// Hands copies of the geometry to a background LOD build
+static void startLod(MeshGL *g, float *positions, size_t vertex_count, unsigned *indices, size_t triangle_count) {
+    if (!positions || !indices) {
+        free(positions);
+        free(indices);
+        return;
+    }
+    g->lod_job = lod_build_async(positions, vertex_count, indices, triangle_count, g->cluster_triangles);
+}
+
+// Collects a finished build and uploads its indices in the mesh's index type
+static void collectLod(MeshGL *g) {
+    int r = lod_job_poll(g->lod_job, &g->lod);
+    if (r == 0) return;
+    g->lod_job = NULL;
+    if (r < 0) {
+        fprintf(stderr, "level-of-detail build failed; drawing full detail\n");
+        return;
+    }
+    size_t n = 3 * g->lod.level_start[LOD_LEVELS - 1];
+    n += 3 * (size_t)lod_first(&g->lod, LOD_LEVELS - 1, g->lod.group_count[LOD_LEVELS - 1]);
+    void *data = g->lod.indices;
+    uint16_t *shorts = NULL;
+    if (g->index_type == GL_UNSIGNED_SHORT) {
+        shorts = malloc(sizeof(uint16_t) * (n ? n : 1));
+        if (!shorts) return;
+        for (size_t i = 0; i < n; ++i) shorts[i] = (uint16_t)g->lod.indices[i];
+        data = shorts;
+    }
+    glGenBuffers(1, &g->lod_index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g->lod_index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(n * (shorts ? 2 : 4)), data, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    free(shorts);
+
+    // The coarse levels share one multi-draw
+    size_t meshlets = 0;
+    for (int l = 1; l < LOD_LEVELS; ++l) meshlets += g->lod.meshlets[l].count;
+    if (reserveMeshlets(g, meshlets) != 0)
+        for (int l = 1; l < LOD_LEVELS; ++l) meshlet_free(&g->lod.meshlets[l]);
+}
+
+int meshgl_upload(MeshGL *g, Mesh *m) {
+    memset(g, 0, sizeof(*g));
+    if (3 * m->triangle_count > INT_MAX) {
+        fprintf(stderr, "mesh too large: %zu triangles\n", m->triangle_count);
+        return -1;
+    }
+    if (!m->normals && mesh_compute_normals(m, MESH_CREASE_DEGREES) != 0) return -1;
+    bvh_sort_triangles(m->positions, m->indices, m->triangle_count, m->bounds_min, m->bounds_max);
+    MeshOptStats opt;
+    if (meshopt_optimize(m, MESHCACHE_CHUNK_TRIANGLES, &opt) == 0) {
+        g->acmr_before = opt.acmr_before;
+        g->acmr_after = opt.acmr_after;
+    }
+
+    GLsizeiptr vbytes = (GLsizeiptr)(sizeof(float) * 3 * m->vertex_count);
+    glGenBuffers(1, &g->position_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, g->position_buffer);
+    glBufferData(GL_ARRAY_BUFFER, vbytes, m->positions, GL_STATIC_DRAW);
+    glGenBuffers(1, &g->normal_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, g->normal_buffer);
+    glBufferData(GL_ARRAY_BUFFER, vbytes, m->normals, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &g->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g->index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(sizeof(unsigned) * 3 * m->triangle_count),
+                 m->indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    g->index_count = (GLsizei)(3 * m->triangle_count);
+    g->vertex_count = m->vertex_count;
+    g->position_type = g->normal_type = GL_FLOAT;
+    g->index_type = GL_UNSIGNED_INT;
+    for (int a = 0; a < 3; ++a) {
+        g->scale[a] = 1;
+        g->offset[a] = 0;
+    }
+    setBounds(g, m->bounds_min, m->bounds_max);
+
+    uint32_t clusters = (uint32_t)((m->triangle_count + MESHCACHE_CHUNK_TRIANGLES - 1) / MESHCACHE_CHUNK_TRIANGLES);
+    BvhBox *boxes = malloc(sizeof(BvhBox) * (clusters ? clusters : 1));
+    if (!boxes) return -1;
+    bvh_cluster_bounds(m->positions, m->indices, m->triangle_count, MESHCACHE_CHUNK_TRIANGLES, boxes);
+    int r = buildClusters(g, boxes, clusters, MESHCACHE_CHUNK_TRIANGLES);
+    free(boxes);
+    if (r == 0) {
+        buildMeshlets(g, m->positions, m->vertex_count, m->indices, m->triangle_count);
+        float *positions = malloc(sizeof(float) * 3 * (m->vertex_count ? m->vertex_count : 1));
+        unsigned *indices = malloc(sizeof(unsigned) * 3 * (m->triangle_count ? m->triangle_count : 1));
+        if (positions) memcpy(positions, m->positions, sizeof(float) * 3 * m->vertex_count);
+        if (indices) memcpy(indices, m->indices, sizeof(unsigned) * 3 * m->triangle_count);
+        startLod(g, positions, m->vertex_count, indices, m->triangle_count);
+    }
+    return r;
+}
+
+int meshgl_upload_cache(MeshGL *g, const MeshCache *c) {
+    const MeshCacheHeader *h = c->header;
+    memset(g, 0, sizeof(*g));
+    if (3 * h->triangle_count > INT_MAX) {
+        fprintf(stderr, "mesh too large: %llu triangles\n", (unsigned long long)h->triangle_count);
+        return -1;
+    }
+    signed char *normals = malloc(4 * (h->vertex_count ? h->vertex_count : 1));
+    if (!normals) return -1;
+    for (size_t i = 0; i < h->vertex_count; ++i) {
+        float n[3];
+        meshcache_oct_decode(c->normals + 2 * i, n);
+        for (int a = 0; a < 3; ++a) normals[4 * i + a] = (signed char)lrintf(n[a] * 127);
+        normals[4 * i + 3] = 0;
+    }
+
+    glGenBuffers(1, &g->position_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, g->position_buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(8 * h->vertex_count), c->positions, GL_STATIC_DRAW);
+    glGenBuffers(1, &g->normal_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, g->normal_buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(4 * h->vertex_count), normals, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    free(normals);
+
+    glGenBuffers(1, &g->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g->index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(h->index_size * 3 * h->triangle_count),
+                 c->indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    g->index_count = (GLsizei)(3 * h->triangle_count);
+    g->vertex_count = h->vertex_count;
+    g->position_type = GL_SHORT;
+    g->position_stride = 8;
+    g->normal_type = GL_BYTE;
+    g->normal_stride = 4;
+    g->index_type = h->index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    memcpy(g->scale, c->scale, sizeof(g->scale));
+    memcpy(g->offset, c->offset, sizeof(g->offset));
+    setBounds(g, h->bounds_min, h->bounds_max);
+    g->acmr_before = h->acmr_before;
+    g->acmr_after = h->acmr_after;
+
+    // The cache's chunks are the clusters
+    uint32_t clusters = (uint32_t)h->chunk_count;
+    BvhBox *boxes = malloc(sizeof(BvhBox) * (clusters ? clusters : 1));
+    if (!boxes) return -1;
+    for (uint32_t i = 0; i < clusters; ++i) {
+        memcpy(boxes[i].min, c->chunks[i].bounds_min, sizeof(boxes[i].min));
+        memcpy(boxes[i].max, c->chunks[i].bounds_max, sizeof(boxes[i].max));
+    }
+    int r = buildClusters(g, boxes, clusters, MESHCACHE_CHUNK_TRIANGLES);
+    free(boxes);
+
+    // Meshlets and levels of what was uploaded: the dequantised cache geometry
+    Mesh m;
+    if (r == 0 && meshcache_to_mesh(c, &m) == 0) {
+        buildMeshlets(g, m.positions, m.vertex_count, m.indices, m.triangle_count);
+        startLod(g, m.positions, m.vertex_count, m.indices, m.triangle_count);
+        free(m.normals);
+    }
+    return r;
+}
+
+int meshgl_load(MeshGL *g, const char *path, int use_cache, MeshLoadStats *stats) {
+    struct timespec t0, t1;
+    MeshCache cache;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (use_cache && meshcache_open(path, &cache) == 0) {
+        int r = meshgl_upload_cache(g, &cache);
+        if (stats) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            stats->format = "cache";
+            stats->bytes = cache.map_size;
+            stats->seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+            stats->threads = 1;
+        }
+        meshcache_close(&cache);
+        return r;
+    }
+
+    Mesh m;
+    if (mesh_load(path, &m, stats) != 0) return -1;
+    int r;
+    if (use_cache && meshcache_write(path, &m) == 0 && meshcache_open(path, &cache) == 0) {
+        // Draw what later opens will draw
+        r = meshgl_upload_cache(g, &cache);
+        meshcache_close(&cache);
+    } else {
+        r = meshgl_upload(g, &m);
+    }
+    mesh_free(&m);
+    return r;
+}
+
+// Per-draw state of the meshlet backface cull
+typedef struct {
+    float eye[4];               // camera in model units, as meshlet_cull takes it
+    const MeshletSet *set;      // the level being drawn
+    size_t base;                // its first triangle in the bound index buffer
+    GLsizei runs;
+    unsigned tested, backfacing;
+} MeshletPass;
+
+// Queues the meshlets of units [u0, u1) that may face the camera as
+// merged runs, drawn together by flushMeshlets
+static size_t queueMeshlets(const MeshGL *g, MeshletPass *p, uint32_t u0, uint32_t u1) {
+    const MeshletSet *s = p->set;
+    uint32_t m0 = s->unit_first[u0], m1 = s->unit_first[u1];
+    uint32_t front = meshlet_cull(s, p->eye, m0, m1, g->meshlet_front);
+    p->tested += m1 - m0;
+    p->backfacing += m1 - m0 - front;
+    size_t index_size = g->index_type == GL_UNSIGNED_SHORT ? 2 : 4, drawn = 0;
+    for (uint32_t i = m0; i < m1; ++i) {
+        if (!g->meshlet_front[i - m0]) continue;
+        uint32_t j = i + 1;
+        while (j < m1 && g->meshlet_front[j - m0]) j++;
+        g->run_count[p->runs] = (GLsizei)(3 * (s->first[j] - s->first[i]));
+        g->run_offset[p->runs++] = (const GLvoid *)(3 * (p->base + s->first[i]) * index_size);
+        drawn += s->first[j] - s->first[i];
+        i = j;
+    }
+    return drawn;
+}
+
+static void flushMeshlets(const MeshGL *g, MeshletPass *p, unsigned *calls) {
+    if (!p || !p->runs) return;
+    glMultiDrawElements(GL_TRIANGLES, g->run_count, g->index_type, (const GLvoid *const *)g->run_offset, p->runs);
+    p->runs = 0;
+    (*calls)++;
+}
+
+// Camera as a homogeneous point in the coordinates of the modelview mv:
+// the eye under perspective, the direction it looks from otherwise.
+// Returns 0 if mv mirrors (or flattens) the model.
+static int cameraInModel(const GLfloat mv[16], int perspective, float eye[4]) {
+    // Columns of the inverse of the upper 3x3 are the cross products of its rows
+    float r[3][3], inv[3][3];
+    for (int i = 0; i < 3; ++i)
+        for (int k = 0; k < 3; ++k) r[i][k] = mv[4 * k + i];
+    for (int k = 0; k < 3; ++k) {
+        const float *a = r[(k + 1) % 3], *b = r[(k + 2) % 3];
+        inv[0][k] = a[1] * b[2] - a[2] * b[1];
+        inv[1][k] = a[2] * b[0] - a[0] * b[2];
+        inv[2][k] = a[0] * b[1] - a[1] * b[0];
+    }
+    float det = r[0][0] * inv[0][0] + r[0][1] * inv[1][0] + r[0][2] * inv[2][0];
+    if (!(det > 0)) return 0;
+    float v[3] = { -mv[12], -mv[13], -mv[14] };
+    if (!perspective) {
+        v[0] = v[1] = 0;
+        v[2] = 1;
+    }
+    for (int i = 0; i < 3; ++i) eye[i] = (inv[i][0] * v[0] + inv[i][1] * v[1] + inv[i][2] * v[2]) / det;
+    eye[3] = perspective ? 1.0f : 0.0f;
+    return 1;
+}
+
+// Draws units [u0, u1) of a level: clusters at level 0, groups above.
+// With meshlets they are only queued (queueMeshlets)
+static size_t drawUnits(const MeshGL *g, int level, uint32_t u0, uint32_t u1, MeshletPass *p, unsigned *calls) {
+    if (p) return queueMeshlets(g, p, u0, u1);
+    size_t first, last;
+    if (level == 0) {
+        first = (size_t)u0 * g->cluster_triangles;
+        last = (size_t)u1 * g->cluster_triangles;
+        if (last > (size_t)g->index_count / 3) last = (size_t)g->index_count / 3;
+    } else {
+        first = g->lod.level_start[level] + lod_first(&g->lod, level, u0);
+        last = g->lod.level_start[level] + lod_first(&g->lod, level, u1);
+    }
+    if (last <= first) return 0;
+    size_t index_size = g->index_type == GL_UNSIGNED_SHORT ? 2 : 4;
+    glDrawElements(GL_TRIANGLES, (GLsizei)(3 * (last - first)), g->index_type,
+                   (const void *)(3 * first * index_size));
+    (*calls)++;
+    return last - first;
+}
+
+// Issues one call per run of consecutive units holding visible clusters
+// drawn at `level`; a group is drawn once however many of its clusters show
+static size_t drawLevel(const MeshGL *g, int level, const BvhRange *ranges, int range_count,
+                        int use_lod, MeshletPass *p, unsigned *calls) {
+    uint32_t group = LOD_GROUP(level), u0 = 0, u1 = 0;
+    size_t drawn = 0;
+    for (int i = 0; i < range_count; ++i) {
+        for (uint32_t c = ranges[i].first; c < ranges[i].first + ranges[i].count; ++c) {
+            if (use_lod && g->cluster_level[c] != level) continue;
+            uint32_t u = c / group;
+            if (u1 > u0 && u < u1) continue;
+            if (u1 > u0 && u == u1) {
+                u1++;
+                continue;
+            }
+            if (u1 > u0) drawn += drawUnits(g, level, u0, u1, p, calls);
+            u0 = u;
+            u1 = u + 1;
+        }
+    }
+    if (u1 > u0) drawn += drawUnits(g, level, u0, u1, p, calls);
+    return drawn;
+}
+
+void meshgl_draw(MeshGL *g, float size, MeshDrawStats *stats) {
+    static const GLfloat light_dir[4] = { 0.3f, 0.5f, 1.0f, 0.0f };   // eye space, from the viewer
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!g->index_count) return;
+    if (g->lod_job) collectLod(g);
+    int use_lod = g->lod_index_buffer && g->lod_pixel_error > 0;
+
+    glPushMatrix();
+    glPushMatrix();
+    glLoadIdentity();
+    glLightfv(GL_LIGHT0, GL_POSITION, light_dir);
+    glPopMatrix();
+    glEnable(GL_LIGHT0);
+    glEnable(GL_COLOR_MATERIAL);
+    glEnable(GL_NORMALIZE);
+    gls_enable(GL_LIGHTING);
+
+    float s = size / g->extent;
+    glScalef(s, s, s);
+    glTranslatef(-g->center[0], -g->center[1], -g->center[2]);
+
+    // Cluster bounds are in model units: take the frustum before dequantising
+    BvhRange all = { 0, g->bvh.cluster_count };
+    const BvhRange *ranges = &all;
+    int range_count = 1;
+    uint32_t visible = g->bvh.cluster_count, occluded = 0;
+    int occlusion = g->occlusion_culling && g->occlusion.target;
+    GLfloat proj[16], mv[16], planes[6][4];
+    if (g->culling || use_lod || g->backface_culling || occlusion) {
+        glGetFloatv(GL_PROJECTION_MATRIX, proj);
+        glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+    }
+    if (g->culling || occlusion) {
+        GLfloat clip[16];
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                clip[4 * c + r] = proj[r] * mv[4 * c] + proj[4 + r] * mv[4 * c + 1] +
+                                  proj[8 + r] * mv[4 * c + 2] + proj[12 + r] * mv[4 * c + 3];
+        bvh_planes_from_matrix(clip, planes);
+    }
+    if (g->culling) {
+        range_count = bvh_cull(&g->bvh, (const float (*)[4])planes, g->ranges, &visible);
+        ranges = g->ranges;
+    }
+    // Of those, skip what last frame's queries found hidden
+    if (occlusion) {
+        occlusion_collect(&g->occlusion);
+        range_count = occlusion_filter(&g->occlusion, ranges, range_count, (const float (*)[4])planes,
+                                       g->occlusion_ranges, &occluded);
+        ranges = g->occlusion_ranges;
+    }
+
+    // Pixels covered by one model unit at each visible cluster's nearest point
+    unsigned at_level[LOD_LEVELS] = { 0 };
+    if (use_lod) {
+        GLint vp[4];
+        glGetIntegerv(GL_VIEWPORT, vp);
+        float mv_scale = sqrtf(mv[0] * mv[0] + mv[1] * mv[1] + mv[2] * mv[2]);
+        float px_per_unit = proj[5] * vp[3] * 0.5f * mv_scale;
+        int perspective = proj[11] != 0;
+        uint32_t count = 0;
+        for (int i = 0; i < range_count; ++i) {
+            for (uint32_t c = ranges[i].first; c < ranges[i].first + ranges[i].count; ++c) {
+                const float *sp = g->cluster_sphere + 4 * c;
+                float dist = 1;
+                if (perspective) {
+                    float e[3];
+                    for (int r = 0; r < 3; ++r)
+                        e[r] = mv[r] * sp[0] + mv[4 + r] * sp[1] + mv[8 + r] * sp[2] + mv[12 + r];
+                    dist = sqrtf(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]) - sp[3] * mv_scale;
+                    if (dist < 1e-3f) dist = 1e-3f;
+                }
+                g->cluster_level[c] = (unsigned char)lod_select_level(&g->lod, c, g->cluster_level[c],
+                                                                      px_per_unit / dist, g->lod_pixel_error);
+                g->cluster_visible[count++] = c;
+            }
+        }
+        lod_resolve_groups(&g->lod, g->cluster_level, g->cluster_visible, count);
+        for (uint32_t i = 0; i < count; ++i) at_level[g->cluster_level[g->cluster_visible[i]]]++;
+    } else {
+        at_level[0] = visible - occluded;
+    }
+
+    // Meshlet cones are in model units too
+    MeshletPass pass = { { 0 }, NULL, 0, 0, 0, 0 }, *mp = NULL;
+    if (g->backface_culling && cameraInModel(mv, proj[11] != 0, pass.eye)) mp = &pass;
+
+    glPushMatrix();
+    glTranslatef(g->offset[0], g->offset[1], g->offset[2]);
+    glScalef(g->scale[0], g->scale[1], g->scale[2]);
+    if (mp) gls_enable(GL_CULL_FACE);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, g->position_buffer);
+    glVertexPointer(3, g->position_type, g->position_stride, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, g->normal_buffer);
+    glNormalPointer(g->normal_type, g->normal_stride, 0);
+
+    unsigned calls = 0;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g->index_buffer);
+    pass.set = &g->meshlets;
+    size_t drawn = drawLevel(g, 0, ranges, range_count, use_lod, g->meshlets.count ? mp : NULL, &calls);
+    flushMeshlets(g, mp, &calls);
+    if (use_lod) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g->lod_index_buffer);
+        for (int l = 1; l < LOD_LEVELS; ++l) {
+            if (!at_level[l]) continue;
+            pass.set = &g->lod.meshlets[l];
+            pass.base = g->lod.level_start[l];
+            drawn += drawLevel(g, l, ranges, range_count, 1, pass.set->count ? mp : NULL, &calls);
+        }
+        flushMeshlets(g, mp, &calls);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopMatrix();
+
+    // Boxes against this frame's depth, read back in a later frame
+    unsigned queries = occlusion ? occlusion_issue(&g->occlusion) : 0;
+
+    // Leave lighting and face culling off for the ViewCube and overlays drawn after us
+    if (mp) gls_disable(GL_CULL_FACE);
+    gls_disable(GL_LIGHTING);
+    glDisable(GL_NORMALIZE);
+    glDisable(GL_COLOR_MATERIAL);
+    glDisable(GL_LIGHT0);
+    glPopMatrix();
+
+    if (stats) {
+        stats->draw_calls = calls;
+        stats->clusters_visible = visible;
+        stats->clusters_total = g->bvh.cluster_count;
+        stats->triangles_drawn = drawn;
+        memcpy(stats->clusters_at_level, at_level, sizeof(at_level));
+        stats->meshlets_tested = pass.tested;
+        stats->meshlets_backfacing = pass.backfacing;
+        stats->clusters_occluded = occluded;
+        stats->occlusion_queries = queries;
+        stats->pending = g->occlusion.pending_count > 0;
+    }
+}
+
+int meshgl_poll(MeshGL *g) {
+    if (!g->occlusion.pending_count) return -1;
+    if (occlusion_collect(&g->occlusion)) return 1;
+    return g->occlusion.pending_count ? 0 : -1;
+}
+
+void meshgl_view_extent(const MeshGL *g, float size, const float rot[9], float min[3], float max[3]) {
+    float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    fit_extent_nodes(g->bvh.nodes, (g->bvh.cluster_count + 3) / 4, rot, lo, hi);
+    // The leaves are in model units; meshgl_draw scales by s about the centre
+    float s = size / g->extent;
+    for (int a = 0; a < 3; ++a) {
+        float c = rot[3 * a] * g->center[0] + rot[3 * a + 1] * g->center[1] + rot[3 * a + 2] * g->center[2];
+        min[a] = s * (lo[a] - c);
+        max[a] = s * (hi[a] - c);
+    }
+}
+
+void meshgl_free(MeshGL *g) {
+    if (g->position_buffer) glDeleteBuffers(1, &g->position_buffer);
+    if (g->normal_buffer) glDeleteBuffers(1, &g->normal_buffer);
+    if (g->index_buffer) glDeleteBuffers(1, &g->index_buffer);
+    if (g->lod_index_buffer) glDeleteBuffers(1, &g->lod_index_buffer);
+    if (g->lod_job) lod_job_cancel(g->lod_job);
+    lod_free(&g->lod);
+    bvh_free(&g->bvh);
+    occlusion_free(&g->occlusion);
+    free(g->ranges);
+    free(g->occlusion_ranges);
+    free(g->cluster_sphere);
+    free(g->cluster_level);
+    free(g->cluster_visible);
+    meshlet_free(&g->meshlets);
+    free(g->meshlet_front);
+    free(g->run_count);
+    free(g->run_offset);
+    memset(g, 0, sizeof(*g));
+}
@@ -0,0 +1,109 @@
+// meshgl.h
+// GL side of mesh.h: uploads a loaded Mesh, or a mapped mesh cache, into
+// vertex buffers and draws it lit, scaled so its bounding box fits a cube
+// of the given edge length centred on the origin (the space the
+// placeholder cube occupied).
+// Triangles are grouped into clusters under a BVH (bvh.h), and each draw
+// submits only the clusters inside the current view frustum. Each visible
+// cluster is drawn at the coarsest level of detail (lod.h) whose error
+// projects to at most lod_pixel_error pixels; the levels are built on a
+// background thread after upload and used once ready. At every level the
+// visible clusters are split further into meshlets (meshlet.h), and on a
+// mesh that meshlet_closed finds closed and consistently wound those that
+// face away from the camera are not submitted; the rest go out in one
+// glMultiDrawElements per index buffer. GL_CULL_FACE is on exactly while
+// that cone pass runs, so for a camera outside such a mesh skipping them
+// never changes the image. Open shells, clipped parts and mixed windings
+// are drawn whole, both faces.
+// Clusters hidden behind others, as found by last frame's occlusion
+// queries on their bounding boxes (occlusion.h), are skipped too.
+// Needs a current context with GL 1.5 buffer objects.
+#ifndef MESHGL_H
+#define MESHGL_H
+
+#include <GL/gl.h>
+
+#include "bvh.h"
+#include "lod.h"
+#include "mesh.h"
+#include "meshcache.h"
+#include "meshlet.h"
+#include "meshopt.h"
+#include "occlusion.h"
+
+typedef struct {
+    GLuint position_buffer, normal_buffer, index_buffer;
+    GLenum position_type, normal_type, index_type;
+    GLsizei position_stride, normal_stride;
+    float scale[3], offset[3];  // model position = offset + scale * stored
+    size_t vertex_count;
+    GLsizei index_count;
+    float center[3];
+    float extent;               // largest bounding-box side
+    float acmr_before, acmr_after;  // vertex cache misses per triangle around meshopt.h
+
+    Bvh bvh;                    // over clusters of cluster_triangles triangles
+    uint32_t cluster_triangles;
+    BvhRange *ranges;           // per-draw scratch, one per cluster
+    int culling;                // 1 (default): submit only visible clusters
+    float *cluster_sphere;      // xyz centre + radius per cluster, model units
+
+    LodJob *lod_job;            // running background build, NULL once collected
+    LodSet lod;
+    GLuint lod_index_buffer;    // 0 until the levels are ready
+    unsigned char *cluster_level;   // level drawn last frame, for hysteresis
+    uint32_t *cluster_visible;      // per-frame scratch: visible cluster ids
+    float lod_pixel_error;      // 1 px default; 0 always draws level 0
+
+    MeshletSet meshlets;        // level 0 (lod.meshlets above); count 0 when the build failed
+    int backface_culling;       // skip backfacing meshlets, cull faces in GL; 1 on closed meshes
+    unsigned char *meshlet_front;   // per-frame scratch: meshlet_cull results
+    GLsizei *run_count;             // per-frame scratch: glMultiDrawElements arguments
+    const GLvoid **run_offset;
+    size_t meshlet_capacity;        // entries in each of the three
+
+    Occlusion occlusion;        // target 0 when the context has no occlusion queries
+    int occlusion_culling;      // 1 (default): skip clusters the queries found hidden
+    BvhRange *occlusion_ranges; // per-draw scratch, one per cluster
+} MeshGL;
+
+typedef struct {
+    unsigned draw_calls;
+    unsigned clusters_visible, clusters_total;
+    size_t triangles_drawn;
+    unsigned clusters_at_level[LOD_LEVELS];
+    unsigned meshlets_tested, meshlets_backfacing;
+    unsigned clusters_occluded;     // in the frustum but skipped as hidden
+    unsigned occlusion_queries;
+    int pending;                // occlusion results are still on their way (meshgl_poll)
+} MeshDrawStats;
+
+// Computes normals if the mesh has none and sorts its triangles into
+// clusters. Returns -1 if the mesh is too large for one draw call.
+int meshgl_upload(MeshGL *g, Mesh *m);
+
+// Positions and indices go to GL straight from the mapping; normals are
+// expanded from octahedral to bytes on the way, since fixed-function GL
+// cannot decode them.
+int meshgl_upload_cache(MeshGL *g, const MeshCache *c);
+
+// Opens path through its cache, parsing and writing the cache when it is
+// missing or stale (use_cache 0 skips both). stats->format is "cache"
+// when nothing was parsed.
+int meshgl_load(MeshGL *g, const char *path, int use_cache, MeshLoadStats *stats);
+
+// stats may be NULL.
+void meshgl_draw(MeshGL *g, float size, MeshDrawStats *stats);
+
+// For hosts that redraw only on events: 1 when occlusion results have
+// shown hidden clusters since the last draw (draw again), 0 while queries
+// are in flight, -1 when none are.
+int meshgl_poll(MeshGL *g);
+// Extent of the model, as meshgl_draw places it for `size`, along the rows
+// of the view rotation rot (fit.h); from the cluster boxes, so slightly
+// conservative.
+void meshgl_view_extent(const MeshGL *g, float size, const float rot[9], float min[3], float max[3]);
+
+void meshgl_free(MeshGL *g);
+
+#endif
@@ -0,0 +1,285 @@
+// meshlet.c
+#include "meshlet.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// --- Build ---
+
+// Unit normal of a triangle; 0 when it has no area. In double, so that
+// slivers (e.g. at a UV sphere's poles) still get their true direction
+static int unit_normal(const float *positions, const unsigned *tri, float n[3]) {
+    const float *p0 = positions + 3 * (size_t)tri[0];
+    const float *p1 = positions + 3 * (size_t)tri[1];
+    const float *p2 = positions + 3 * (size_t)tri[2];
+    double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+    double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+    double c[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+    double len = sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+    if (!(len > 0) || !isfinite(len)) return 0;
+    for (int a = 0; a < 3; ++a) n[a] = (float)(c[a] / len);
+    return 1;
+}
+
+// Triangles in the meshlet that starts at t and ends by end (at least one)
+static size_t span(const float *positions, const unsigned *indices, size_t t, size_t end) {
+    const float split_cos = cosf(MESHLET_SPLIT_DEGREES * 3.14159265f / 180);
+    unsigned verts[MESHLET_VERTICES];
+    int nv = 0;
+    float sum[3] = { 0, 0, 0 };
+    size_t i;
+    for (i = t; i < end && i - t < MESHLET_TRIANGLES; ++i) {
+        const unsigned *tri = indices + 3 * i;
+        unsigned fresh[3];
+        int nf = 0;
+        for (int k = 0; k < 3; ++k) {
+            int seen = 0;
+            // Newest first: in vertex cache order most hits are recent
+            for (int j = nv - 1; j >= 0 && !seen; --j) seen = verts[j] == tri[k];
+            for (int j = 0; j < nf && !seen; ++j) seen = fresh[j] == tri[k];
+            if (!seen) fresh[nf++] = tri[k];
+        }
+        if (nv + nf > MESHLET_VERTICES) break;
+        float n[3];
+        if (unit_normal(positions, tri, n)) {
+            float len = sqrtf(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+            if (i - t >= MESHLET_MIN_TRIANGLES && len > 0 &&
+                n[0] * sum[0] + n[1] * sum[1] + n[2] * sum[2] < split_cos * len)
+                break;
+            for (int a = 0; a < 3; ++a) sum[a] += n[a];
+        }
+        for (int k = 0; k < nf; ++k) verts[nv++] = fresh[k];
+    }
+    return i - t;
+}
+
+typedef struct {
+    MeshletSet *s;
+    const float *positions;
+    const unsigned *indices;
+    const uint32_t *triangle_first;
+    unsigned char *length;      // per triangle: meshlet length when one starts there
+} BuildJob;
+
+// unit_first[u + 1] = meshlets in unit u, summed afterwards
+static void count_range(void *ctx, size_t begin, size_t end) {
+    BuildJob *j = ctx;
+    for (size_t u = begin; u < end; ++u) {
+        size_t t = j->triangle_first[u], t1 = j->triangle_first[u + 1];
+        uint32_t n = 0;
+        for (; t < t1; ++n) {
+            size_t len = span(j->positions, j->indices, t, t1);
+            j->length[t] = (unsigned char)len;
+            t += len;
+        }
+        j->s->unit_first[u + 1] = n;
+    }
+}
+
+static void bound(const BuildJob *j, uint32_t m, size_t t0, size_t t1) {
+    MeshletSet *s = j->s;
+    float lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (size_t i = 3 * t0; i < 3 * t1; ++i) {
+        const float *p = j->positions + 3 * (size_t)j->indices[i];
+        for (int a = 0; a < 3; ++a) {
+            if (p[a] < lo[a]) lo[a] = p[a];
+            if (p[a] > hi[a]) hi[a] = p[a];
+        }
+    }
+    float c[3], r2 = 0;
+    for (int a = 0; a < 3; ++a) c[a] = 0.5f * (lo[a] + hi[a]);
+    for (size_t i = 3 * t0; i < 3 * t1; ++i) {
+        const float *p = j->positions + 3 * (size_t)j->indices[i];
+        float d2 = (p[0] - c[0]) * (p[0] - c[0]) + (p[1] - c[1]) * (p[1] - c[1]) + (p[2] - c[2]) * (p[2] - c[2]);
+        if (d2 > r2) r2 = d2;
+    }
+    s->cx[m] = c[0];
+    s->cy[m] = c[1];
+    s->cz[m] = c[2];
+    s->radius[m] = sqrtf(r2) * (1 + 1e-5f);
+
+    // Cone: mean normal, widened to the least aligned triangle
+    float axis[3] = { 0, 0, 0 }, n[MESHLET_TRIANGLES][3];
+    int nn = 0;
+    for (size_t t = t0; t < t1; ++t) {
+        if (!unit_normal(j->positions, j->indices + 3 * t, n[nn])) continue;
+        for (int a = 0; a < 3; ++a) axis[a] += n[nn][a];
+        nn++;
+    }
+    float len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float min_dot = -1;
+    if (len > 0) {
+        for (int a = 0; a < 3; ++a) axis[a] /= len;
+        min_dot = 1;
+        for (int k = 0; k < nn; ++k) {
+            float d = n[k][0] * axis[0] + n[k][1] * axis[1] + n[k][2] * axis[2];
+            if (d < min_dot) min_dot = d;
+        }
+    }
+    s->ax[m] = axis[0];
+    s->ay[m] = axis[1];
+    s->az[m] = axis[2];
+    // Wider than a hemisphere, some triangle faces every direction
+    s->cutoff[m] = min_dot > 0 ? sqrtf(1 - min_dot * min_dot) + 1e-3f : 2;
+}
+
+static void fill_range(void *ctx, size_t begin, size_t end) {
+    BuildJob *j = ctx;
+    for (size_t u = begin; u < end; ++u) {
+        size_t t = j->triangle_first[u], t1 = j->triangle_first[u + 1];
+        uint32_t m = j->s->unit_first[u];
+        for (; t < t1; ++m) {
+            j->s->first[m] = (uint32_t)t;
+            bound(j, m, t, t + j->length[t]);
+            t += j->length[t];
+        }
+    }
+}
+
+int meshlet_build(MeshletSet *s, const float *positions, const unsigned *indices,
+                  const uint32_t *triangle_first, uint32_t unit_count) {
+    memset(s, 0, sizeof(*s));
+    size_t triangle_count = triangle_first[unit_count];
+    s->unit_count = unit_count;
+    s->unit_first = malloc(sizeof(uint32_t) * ((size_t)unit_count + 1));
+    unsigned char *length = malloc(triangle_count ? triangle_count : 1);
+    if (!s->unit_first || !length) {
+        free(length);
+        meshlet_free(s);
+        return -1;
+    }
+    BuildJob job = { s, positions, indices, triangle_first, length };
+    s->unit_first[0] = 0;
+    parallel_for(unit_count, 64, count_range, &job);
+    for (uint32_t u = 0; u < unit_count; ++u) s->unit_first[u + 1] += s->unit_first[u];
+    s->count = s->unit_first[unit_count];
+
+    size_t n = s->count ? s->count : 1;
+    s->first = malloc(sizeof(uint32_t) * (n + 1));
+    float **soa[8] = { &s->cx, &s->cy, &s->cz, &s->radius, &s->ax, &s->ay, &s->az, &s->cutoff };
+    int ok = s->first != NULL;
+    for (int k = 0; k < 8; ++k) ok &= (*soa[k] = malloc(sizeof(float) * n)) != NULL;
+    if (ok) {
+        parallel_for(unit_count, 64, fill_range, &job);
+        s->first[s->count] = (uint32_t)triangle_count;
+    } else {
+        meshlet_free(s);
+    }
+    free(length);
+    return ok ? 0 : -1;
+}
+
+void meshlet_free(MeshletSet *s) {
+    free(s->first);
+    free(s->unit_first);
+    free(s->cx); free(s->cy); free(s->cz); free(s->radius);
+    free(s->ax); free(s->ay); free(s->az); free(s->cutoff);
+    memset(s, 0, sizeof(*s));
+}
+
+// --- Closed surfaces ---
+
+// Equal positions hash equal, -0 included
+static uint32_t hash_position(const float *p) {
+    float q[3] = { p[0] + 0.0f, p[1] + 0.0f, p[2] + 0.0f };
+    uint32_t a, b, c;
+    memcpy(&a, &q[0], 4);
+    memcpy(&b, &q[1], 4);
+    memcpy(&c, &q[2], 4);
+    uint32_t h = a * 0x9e3779b1u ^ b * 0x85ebca77u ^ c * 0xc2b2ae3du;
+    return h ^ (h >> 15);
+}
+
+static size_t table_size(size_t expected) {
+    size_t cap = 64;
+    while (cap < expected * 2) cap *= 2;
+    return cap;
+}
+
+int meshlet_closed(const float *positions, size_t vertex_count, const unsigned *indices,
+                   size_t triangle_count) {
+    // Vertices split for normals or texture seams share a position
+    size_t vmask = table_size(vertex_count) - 1, emask = table_size(3 * triangle_count / 2 + 1) - 1;
+    unsigned *slots = calloc(vmask + 1, sizeof(unsigned));     // vertex + 1, 0 empty
+    unsigned *weld = malloc(sizeof(unsigned) * (vertex_count ? vertex_count : 1));
+    uint64_t *edges = malloc(sizeof(uint64_t) * (emask + 1));  // lo << 32 | hi, ~0 empty
+    unsigned char *dirs = calloc(emask + 1, 1);                // 1: lo -> hi seen, 2: hi -> lo
+    int closed = slots && weld && edges && dirs && triangle_count > 0;
+    for (size_t v = 0; closed && v < vertex_count; ++v) {
+        const float *p = positions + 3 * v;
+        size_t s = hash_position(p) & vmask;
+        for (; slots[s]; s = (s + 1) & vmask) {
+            const float *q = positions + 3 * (size_t)(slots[s] - 1);
+            if (q[0] == p[0] && q[1] == p[1] && q[2] == p[2]) break;
+        }
+        if (!slots[s]) slots[s] = (unsigned)v + 1;
+        weld[v] = slots[s] - 1;
+    }
+    if (edges) memset(edges, 0xff, sizeof(uint64_t) * (emask + 1));
+
+    // Each edge must be used once in each direction
+    for (size_t t = 0; closed && t < triangle_count; ++t) {
+        unsigned v[3] = { weld[indices[3 * t]], weld[indices[3 * t + 1]], weld[indices[3 * t + 2]] };
+        if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0]) continue;
+        for (int k = 0; k < 3 && closed; ++k) {
+            unsigned a = v[k], b = v[(k + 1) % 3];
+            uint64_t key = a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+            unsigned char dir = a < b ? 1 : 2;
+            size_t s = (size_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & emask;
+            while (edges[s] != ~(uint64_t)0 && edges[s] != key) s = (s + 1) & emask;
+            edges[s] = key;
+            if (dirs[s] & dir) closed = 0;
+            dirs[s] |= dir;
+        }
+    }
+    for (size_t s = 0; closed && s <= emask; ++s)
+        if (edges[s] != ~(uint64_t)0 && dirs[s] != 3) closed = 0;
+    free(slots);
+    free(weld);
+    free(edges);
+    free(dirs);
+    return closed;
+}
+
+// --- Cull ---
+
+uint32_t meshlet_cull(const MeshletSet *s, const float eye[4], uint32_t first, uint32_t last,
+                      unsigned char *front) {
+    uint32_t i = first, count = 0;
+#if defined(__SSE2__)
+    const __m128 ex = _mm_set1_ps(eye[0]), ey = _mm_set1_ps(eye[1]);
+    const __m128 ez = _mm_set1_ps(eye[2]), ew = _mm_set1_ps(eye[3]);
+    for (; i + 4 <= last; i += 4) {
+        __m128 vx = _mm_sub_ps(_mm_mul_ps(ew, _mm_loadu_ps(s->cx + i)), ex);
+        __m128 vy = _mm_sub_ps(_mm_mul_ps(ew, _mm_loadu_ps(s->cy + i)), ey);
+        __m128 vz = _mm_sub_ps(_mm_mul_ps(ew, _mm_loadu_ps(s->cz + i)), ez);
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(s->ax + i)),
+                                         _mm_mul_ps(vy, _mm_loadu_ps(s->ay + i))),
+                              _mm_mul_ps(vz, _mm_loadu_ps(s->az + i)));
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+                                            _mm_mul_ps(vz, vz)));
+        __m128 lim = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(s->cutoff + i), len),
+                                _mm_mul_ps(ew, _mm_loadu_ps(s->radius + i)));
+        int back = _mm_movemask_ps(_mm_cmpgt_ps(d, lim));
+        for (int k = 0; k < 4; ++k) {
+            front[i - first + k] = !(back >> k & 1);
+            count += !(back >> k & 1);
+        }
+    }
+#endif
+    for (; i < last; ++i) {
+        float v[3] = { eye[3] * s->cx[i] - eye[0], eye[3] * s->cy[i] - eye[1], eye[3] * s->cz[i] - eye[2] };
+        float d = v[0] * s->ax[i] + v[1] * s->ay[i] + v[2] * s->az[i];
+        float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        front[i - first] = !(d > s->cutoff[i] * len + eye[3] * s->radius[i]);
+        count += front[i - first];
+    }
+    return count;
+}
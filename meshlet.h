@@ -0,0 +1,67 @@
+// meshlet.h
+// Backface culling below the cluster level for loaded meshes. Each unit
+// (a cluster, see bvh.h, or a level-of-detail group, see lod.h) is cut
+// greedily, in its own triangle order, into meshlets of at most
+// MESHLET_VERTICES distinct vertices and MESHLET_TRIANGLES triangles, so a
+// meshlet is again a contiguous run of the index buffer and the vertex
+// cache order that meshopt.h chose is kept. A meshlet is also closed early once a triangle
+// faces more than MESHLET_SPLIT_DEGREES away from the meshlet so far (never
+// before MESHLET_MIN_TRIANGLES), so the faces of a CAD part do not share
+// meshlets across their sharp edges.
+//
+// The limits are rarely reached together: a 256-triangle cluster touches
+// about 180 distinct vertices, so it splits into four meshlets of about 54
+// vertices and 67-70 triangles, and even at MESHLET_TRIANGLES it would
+// need three. Growing meshlets across triangle adjacency instead of index
+// order was measured to fill them no better within a cluster, at three
+// times the build cost, and would reorder the uploaded index buffer.
+//
+// Every meshlet gets a bounding sphere and a cone around its triangles'
+// normals. A meshlet is backfacing from camera position e when
+//   dot(c - e, axis) > cutoff * |c - e| + r
+// (cutoff = sine of the cone's half angle), which guarantees that every
+// triangle in the sphere faces away (CCW front faces). The data is SoA so
+// meshlet_cull tests four meshlets at a time (SSE2 when available).
+// Building runs units in parallel.
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MESHLET_VERTICES 64
+#define MESHLET_TRIANGLES 124
+#define MESHLET_SPLIT_DEGREES 60.0f
+#define MESHLET_MIN_TRIANGLES 16
+
+typedef struct {
+    uint32_t count, unit_count;
+    uint32_t *first;            // per meshlet + 1: triangle offsets in indices
+    uint32_t *unit_first;       // per unit + 1: meshlet offsets
+    float *cx, *cy, *cz, *radius;   // bounding sphere
+    float *ax, *ay, *az, *cutoff;   // normal cone; cutoff > 1 when it cannot be backfacing
+} MeshletSet;
+
+// Unit u is triangles [triangle_first[u], triangle_first[u + 1]) of
+// indices (3 per triangle). positions are xyz per vertex, in the units the
+// cull is done in. On failure the set is left empty.
+int meshlet_build(MeshletSet *s, const float *positions, const unsigned *indices,
+                  const uint32_t *triangle_first, uint32_t unit_count);
+void meshlet_free(MeshletSet *s);
+
+// 1 if the triangles form closed surfaces wound consistently: every edge,
+// with vertices compared by position, is used once in each direction.
+// Only then are back faces hidden behind front ones from any camera
+// outside the model, so culling them cannot open holes. Triangles that
+// lose an edge to a repeated vertex are ignored. 0 when out of memory.
+int meshlet_closed(const float *positions, size_t vertex_count, const unsigned *indices,
+                   size_t triangle_count);
+
+// Camera as a homogeneous point in the meshlets' units: (x, y, z, 1) for a
+// perspective eye, (d, 0) for an orthographic view looking along -d.
+// Sets front[i - first] for meshlets [first, last) to 1 if any of their
+// triangles may face the camera, 0 if none can. Returns the front count.
+uint32_t meshlet_cull(const MeshletSet *s, const float eye[4], uint32_t first, uint32_t last,
+                      unsigned char *front);
+
+#endif
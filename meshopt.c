@@ -0,0 +1,364 @@
+// meshopt.c
+#include "meshopt.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parallel.h"
+
+float meshopt_acmr(const unsigned *indices, size_t triangle_count, size_t vertex_count) {
+    if (!triangle_count) return 0;
+    size_t *stamp = calloc(vertex_count ? vertex_count : 1, sizeof(size_t));
+    if (!stamp) return 0;
+    // stamp = insertion time + 1; a vertex is cached while fewer than
+    // MESHOPT_CACHE_SIZE misses have happened since it went in
+    size_t misses = 0;
+    for (size_t i = 0; i < 3 * triangle_count; ++i) {
+        size_t *s = &stamp[indices[i]];
+        if (!*s || misses + 1 - *s >= MESHOPT_CACHE_SIZE) *s = ++misses;
+    }
+    free(stamp);
+    return (float)misses / triangle_count;
+}
+
+// --- Overdraw: outward-facing clusters first, within BVH-aligned blocks ---
+
+typedef struct {
+    double centroid[3];         // area-weighted sum of triangle centroids
+    double normal[3];           // sum of unnormalised face normals
+    double area;
+} Patch;
+
+static void patch_add(Patch *p, const Patch *q) {
+    for (int a = 0; a < 3; ++a) {
+        p->centroid[a] += q->centroid[a];
+        p->normal[a] += q->normal[a];
+    }
+    p->area += q->area;
+}
+
+typedef struct {
+    const unsigned *indices;
+    const float *positions;
+    size_t triangle_count;
+    uint32_t ct;
+    Patch *patches;
+} PatchJob;
+
+static void patch_range(void *ctx, size_t begin, size_t end) {
+    PatchJob *j = ctx;
+    for (size_t c = begin; c < end; ++c) {
+        Patch *p = &j->patches[c];
+        memset(p, 0, sizeof(*p));
+        size_t t1 = (c + 1) * j->ct < j->triangle_count ? (c + 1) * j->ct : j->triangle_count;
+        for (size_t t = c * j->ct; t < t1; ++t) {
+            const float *a = j->positions + 3 * (size_t)j->indices[3 * t];
+            const float *b = j->positions + 3 * (size_t)j->indices[3 * t + 1];
+            const float *d = j->positions + 3 * (size_t)j->indices[3 * t + 2];
+            double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            double e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                            e1[0] * e2[1] - e1[1] * e2[0] };
+            double area = 0.5 * sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k) {
+                p->centroid[k] += area * (a[k] + b[k] + d[k]) / 3;
+                p->normal[k] += n[k];
+            }
+            p->area += area;
+        }
+    }
+}
+
+typedef struct {
+    const Patch *patches;
+    uint32_t clusters, full;    // clusters with all cluster_triangles triangles
+    double center[3];
+    uint32_t *order, *scratch;
+} OrderJob;
+
+typedef struct {
+    double key;
+    uint32_t first, count;
+} Child;
+
+static int cmp_child(const void *a, const void *b) {
+    const Child *x = a, *y = b;
+    if (x->key != y->key) return x->key > y->key ? -1 : 1;
+    return x->first < y->first ? -1 : x->first > y->first;
+}
+
+// How much a patch faces away from the mesh centre: outer shells draw first
+static double outwardness(const OrderJob *j, const Patch *p) {
+    double len = sqrt(p->normal[0] * p->normal[0] + p->normal[1] * p->normal[1] + p->normal[2] * p->normal[2]);
+    if (len == 0 || p->area == 0) return 0;
+    double d = 0;
+    for (int a = 0; a < 3; ++a) d += (p->centroid[a] / p->area - j->center[a]) * p->normal[a] / len;
+    return d;
+}
+
+// Orders the clusters of block [first, first + size) into order[first..];
+// only complete children move, so partial blocks stay at the end
+static Patch order_block(OrderJob *j, uint32_t first, uint32_t size) {
+    Patch total = { { 0 } };
+    if (size == 1) {
+        j->order[first] = first;
+        return j->patches[first];
+    }
+    Child child[4];
+    int n = 0, movable = 0;
+    uint32_t step = size / 4;
+    for (int k = 0; k < 4 && first + k * step < j->clusters; ++k) {
+        uint32_t cf = first + k * step;
+        Patch p = order_block(j, cf, step);
+        patch_add(&total, &p);
+        child[n] = (Child){ outwardness(j, &p), cf, cf + step <= j->clusters ? step : j->clusters - cf };
+        if (cf + step <= j->full) movable = n + 1;
+        n++;
+    }
+    qsort(child, movable, sizeof(Child), cmp_child);
+    uint32_t at = first;
+    for (int k = 0; k < n; ++k) {
+        memcpy(j->scratch + at, j->order + child[k].first, sizeof(uint32_t) * child[k].count);
+        at += child[k].count;
+    }
+    memcpy(j->order + first, j->scratch + first, sizeof(uint32_t) * (at - first));
+    return total;
+}
+
+// --- Vertex cache: Tipsify within each cluster ---
+
+typedef struct {
+    unsigned *table;            // local vertex hash: global + 1, 0 empty
+    unsigned *table_local;
+    size_t table_mask;
+    unsigned *global;           // local -> global
+    int (*tri)[3];
+    int *start, *adj, *live, *stamp, *dead, *cand, *out;
+    unsigned char *emitted;
+} Tipsify;
+
+static int tipsify_init(Tipsify *s, uint32_t ct) {
+    size_t corners = 3 * (size_t)ct, cap = 16;
+    while (cap < 2 * corners) cap *= 2;
+    memset(s, 0, sizeof(*s));
+    s->table_mask = cap - 1;
+    s->table = malloc(sizeof(unsigned) * cap);
+    s->table_local = malloc(sizeof(unsigned) * cap);
+    s->global = malloc(sizeof(unsigned) * corners);
+    s->tri = malloc(sizeof(int) * corners);
+    s->start = malloc(sizeof(int) * (corners + 1));
+    s->adj = malloc(sizeof(int) * corners);
+    s->live = malloc(sizeof(int) * corners);
+    s->stamp = malloc(sizeof(int) * corners);
+    s->dead = malloc(sizeof(int) * corners);
+    s->cand = malloc(sizeof(int) * corners);
+    s->out = malloc(sizeof(int) * ct);
+    s->emitted = malloc(ct);
+    return s->table && s->table_local && s->global && s->tri && s->start && s->adj && s->live &&
+           s->stamp && s->dead && s->cand && s->out && s->emitted ? 0 : -1;
+}
+
+static void tipsify_free(Tipsify *s) {
+    free(s->table); free(s->table_local); free(s->global); free(s->tri); free(s->start); free(s->adj);
+    free(s->live); free(s->stamp); free(s->dead); free(s->cand); free(s->out); free(s->emitted);
+}
+
+// Dead end: the most recent vertex with work left, else the next in input order
+static int skip_dead_end(Tipsify *s, int *dead_top, int *cursor, int nv) {
+    while (*dead_top > 0) {
+        int d = s->dead[--*dead_top];
+        if (s->live[d] > 0) return d;
+    }
+    while (*cursor < nv) {
+        int v = (*cursor)++;
+        if (s->live[v] > 0) return v;
+    }
+    return -1;
+}
+
+static void tipsify_cluster(Tipsify *s, unsigned *indices, int nt) {
+    const int k = MESHOPT_CACHE_SIZE;
+    memset(s->table, 0, sizeof(unsigned) * (s->table_mask + 1));
+    int nv = 0;
+    for (int i = 0; i < 3 * nt; ++i) {
+        unsigned g = indices[i];
+        size_t h = (g * 2654435761u) & s->table_mask;
+        while (s->table[h] && s->table[h] != g + 1) h = (h + 1) & s->table_mask;
+        if (!s->table[h]) {
+            s->table[h] = g + 1;
+            s->table_local[h] = (unsigned)nv;
+            s->global[nv++] = g;
+        }
+        s->tri[i / 3][i % 3] = (int)s->table_local[h];
+    }
+
+    memset(s->start, 0, sizeof(int) * (nv + 1));
+    for (int t = 0; t < nt; ++t)
+        for (int i = 0; i < 3; ++i) s->start[s->tri[t][i] + 1]++;
+    for (int v = 0; v < nv; ++v) {
+        s->live[v] = s->start[v + 1];
+        s->start[v + 1] += s->start[v];
+        s->stamp[v] = 0;
+    }
+    for (int t = 0; t < nt; ++t)
+        for (int i = 0; i < 3; ++i) s->adj[s->start[s->tri[t][i]]++] = t;
+    for (int v = nv; v > 0; --v) s->start[v] = s->start[v - 1];
+    s->start[0] = 0;
+    memset(s->emitted, 0, nt);
+
+    int time = k + 1, cursor = 1, dead_top = 0, emitted = 0, f = 0;
+    while (f >= 0) {
+        int nc = 0;
+        for (int a = s->start[f]; a < s->start[f + 1]; ++a) {
+            int t = s->adj[a];
+            if (s->emitted[t]) continue;
+            for (int i = 0; i < 3; ++i) {
+                int v = s->tri[t][i];
+                s->dead[dead_top++] = v;
+                s->cand[nc++] = v;
+                s->live[v]--;
+                if (time - s->stamp[v] > k) s->stamp[v] = time++;
+            }
+            s->emitted[t] = 1;
+            s->out[emitted++] = t;
+        }
+        // Next fan: the candidate still in cache with the most to do, else a dead end
+        int best = -1, best_priority = -1;
+        for (int c = 0; c < nc; ++c) {
+            int v = s->cand[c];
+            if (s->live[v] <= 0) continue;
+            int priority = time - s->stamp[v] + 2 * s->live[v] <= k ? time - s->stamp[v] : 0;
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+        f = best >= 0 ? best : skip_dead_end(s, &dead_top, &cursor, nv);
+    }
+
+    for (int t = 0; t < emitted; ++t)
+        for (int i = 0; i < 3; ++i) s->adj[3 * t + i] = s->tri[s->out[t]][i];
+    for (int i = 0; i < 3 * emitted; ++i) indices[i] = s->global[s->adj[i]];
+}
+
+typedef struct {
+    unsigned *indices;
+    size_t triangle_count;
+    uint32_t ct;
+    int *failed;                // one flag per range start, written by that range only
+} TipsifyJob;
+
+static void tipsify_range(void *ctx, size_t begin, size_t end) {
+    TipsifyJob *j = ctx;
+    Tipsify s;
+    if (tipsify_init(&s, j->ct) != 0) {
+        j->failed[begin] = 1;
+        tipsify_free(&s);
+        return;
+    }
+    for (size_t c = begin; c < end; ++c) {
+        size_t t0 = c * j->ct, t1 = t0 + j->ct < j->triangle_count ? t0 + j->ct : j->triangle_count;
+        tipsify_cluster(&s, j->indices + 3 * t0, (int)(t1 - t0));
+    }
+    tipsify_free(&s);
+}
+
+int meshopt_reorder_triangles(unsigned *indices, size_t triangle_count,
+                              const float *positions, size_t vertex_count, uint32_t cluster_triangles) {
+    (void)vertex_count;
+    uint32_t clusters = (uint32_t)((triangle_count + cluster_triangles - 1) / cluster_triangles);
+    if (!clusters) return 0;
+    Patch *patches = malloc(sizeof(Patch) * clusters);
+    uint32_t *order = malloc(sizeof(uint32_t) * 2 * clusters);
+    unsigned *sorted = malloc(sizeof(unsigned) * 3 * triangle_count);
+    int *failed = calloc(clusters, sizeof(int));
+    if (!patches || !order || !sorted || !failed) {
+        free(patches); free(order); free(sorted); free(failed);
+        fprintf(stderr, "out of memory optimising the mesh\n");
+        return -1;
+    }
+
+    PatchJob pj = { indices, positions, triangle_count, cluster_triangles, patches };
+    parallel_for(clusters, 64, patch_range, &pj);
+    OrderJob oj = { patches, clusters, (uint32_t)(triangle_count / cluster_triangles), { 0 }, order, order + clusters };
+    Patch all = { { 0 } };
+    for (uint32_t c = 0; c < clusters; ++c) patch_add(&all, &patches[c]);
+    for (int a = 0; a < 3; ++a) oj.center[a] = all.area > 0 ? all.centroid[a] / all.area : 0;
+    uint32_t size = 1;
+    while (size < clusters) size *= 4;
+    order_block(&oj, 0, size);
+
+    for (uint32_t c = 0; c < clusters; ++c) {
+        size_t src = (size_t)order[c] * cluster_triangles, dst = (size_t)c * cluster_triangles;
+        size_t n = src + cluster_triangles < triangle_count ? cluster_triangles : triangle_count - src;
+        memcpy(sorted + 3 * dst, indices + 3 * src, sizeof(unsigned) * 3 * n);
+    }
+    memcpy(indices, sorted, sizeof(unsigned) * 3 * triangle_count);
+
+    TipsifyJob tj = { indices, triangle_count, cluster_triangles, failed };
+    parallel_for(clusters, 16, tipsify_range, &tj);
+    int r = 0;
+    for (uint32_t c = 0; c < clusters; ++c) r |= failed[c];
+    if (r) fprintf(stderr, "out of memory optimising the mesh\n");
+    free(patches);
+    free(order);
+    free(sorted);
+    free(failed);
+    return r ? -1 : 0;
+}
+
+void meshopt_fetch_remap(unsigned *indices, size_t index_count, size_t vertex_count, unsigned *remap) {
+    const unsigned unset = ~0u;
+    for (size_t v = 0; v < vertex_count; ++v) remap[v] = unset;
+    unsigned next = 0;
+    for (size_t i = 0; i < index_count; ++i) {
+        if (remap[indices[i]] == unset) remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+    for (size_t v = 0; v < vertex_count; ++v)
+        if (remap[v] == unset) remap[v] = next++;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int meshopt_optimize(Mesh *m, uint32_t cluster_triangles, MeshOptStats *stats) {
+    double t0 = now_seconds();
+    size_t nv = m->vertex_count ? m->vertex_count : 1;
+    float acmr_before = meshopt_acmr(m->indices, m->triangle_count, m->vertex_count);
+    if (meshopt_reorder_triangles(m->indices, m->triangle_count, m->positions, m->vertex_count,
+                                  cluster_triangles) != 0)
+        return -1;
+
+    unsigned *remap = malloc(sizeof(unsigned) * nv);
+    float *positions = malloc(sizeof(float) * 3 * nv);
+    float *normals = m->normals ? malloc(sizeof(float) * 3 * nv) : NULL;
+    if (!remap || !positions || (m->normals && !normals)) {
+        free(remap); free(positions); free(normals);
+        fprintf(stderr, "out of memory optimising the mesh\n");
+        return -1;
+    }
+    meshopt_fetch_remap(m->indices, 3 * m->triangle_count, m->vertex_count, remap);
+    for (size_t v = 0; v < m->vertex_count; ++v) {
+        memcpy(positions + 3 * (size_t)remap[v], m->positions + 3 * v, sizeof(float) * 3);
+        if (normals) memcpy(normals + 3 * (size_t)remap[v], m->normals + 3 * v, sizeof(float) * 3);
+    }
+    free(m->positions);
+    free(m->normals);
+    m->positions = positions;
+    m->normals = normals;
+    free(remap);
+
+    if (stats) {
+        stats->acmr_before = acmr_before;
+        stats->acmr_after = meshopt_acmr(m->indices, m->triangle_count, m->vertex_count);
+        stats->seconds = now_seconds() - t0;
+    }
+    return 0;
+}
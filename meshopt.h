@@ -0,0 +1,45 @@
+// meshopt.h
+// Post-load ordering pass for the GPU: makes the index buffer friendly to
+// the post-transform vertex cache and the vertex buffer friendly to fetch,
+// without disturbing the culling clusters (bvh.h) the triangles sit in.
+//
+//   1. Overdraw: clusters are reordered so outward-facing ones draw first,
+//      but only within the aligned blocks of 4, 16, 64, ... clusters that
+//      the BVH and the LOD groups are built over, so every node and group
+//      keeps the same clusters.
+//   2. Vertex cache: each cluster's triangles are reordered with Tipsify
+//      (Sander et al. 2007) for a FIFO cache of MESHOPT_CACHE_SIZE.
+//   3. Fetch: vertices are renumbered in order of first use.
+//
+// The mesh cache runs this once at write time, so cached loads pay nothing.
+#ifndef MESHOPT_H
+#define MESHOPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mesh.h"
+
+#define MESHOPT_CACHE_SIZE 16
+
+typedef struct {
+    float acmr_before, acmr_after;  // vertex cache misses per triangle
+    double seconds;
+} MeshOptStats;
+
+// ACMR of an index buffer through a FIFO cache of MESHOPT_CACHE_SIZE.
+float meshopt_acmr(const unsigned *indices, size_t triangle_count, size_t vertex_count);
+
+// Steps 1 and 2 on triangles already in cluster order (bvh_sort_triangles).
+// positions are xyz per vertex. Returns -1 if out of memory.
+int meshopt_reorder_triangles(unsigned *indices, size_t triangle_count,
+                              const float *positions, size_t vertex_count, uint32_t cluster_triangles);
+
+// Step 3: fills remap[old] = new and rewrites the indices. Unreferenced
+// vertices keep their relative order after all referenced ones.
+void meshopt_fetch_remap(unsigned *indices, size_t index_count, size_t vertex_count, unsigned *remap);
+
+// All three steps on a loaded mesh (positions and normals permuted).
+int meshopt_optimize(Mesh *m, uint32_t cluster_triangles, MeshOptStats *stats);
+
+#endif
@@ -0,0 +1,308 @@
+// normals.c
+#include "normals.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parallel.h"
+
+// Merged into one output vertex when their normals agree this closely
+#define SAME_NORMAL 0.9999f
+
+typedef struct {
+    const NormalsInput *in;
+    NormalsOutput *out;
+    float cos_crease;
+    size_t parts;                   // triangle chunks = vertex buckets
+    float *fx, *fy, *fz;            // per triangle, unit (zero if degenerate)
+    float *angle;                   // per corner
+    size_t *cursor;                 // parts x parts: chunk-major counts, then write cursors
+    size_t *bucket_start;           // parts + 1, into bucketed / sorted
+    unsigned *bucketed, *sorted;    // corner ids
+    size_t *bucket_out;             // output vertices per bucket, then their base
+    float **bucket_normals;         // per bucket, xyz per output vertex
+    unsigned **bucket_source;       // both left NULL by a bucket that ran out of memory
+} Job;
+
+static size_t owner(const Job *j, unsigned v) {
+    return (size_t)((uint64_t)v * j->parts / j->in->vertex_count);
+}
+
+static size_t bucket_first_vertex(const Job *j, size_t o) {
+    return (size_t)(((uint64_t)o * j->in->vertex_count + j->parts - 1) / j->parts);
+}
+
+static void face_range(void *ctx, size_t begin, size_t end) {
+    Job *j = ctx;
+    const NormalsInput *in = j->in;
+    for (size_t t = begin; t < end; ++t) {
+        const unsigned *v = in->indices + 3 * t;
+        float px[3], py[3], pz[3];
+        for (int i = 0; i < 3; ++i) {
+            px[i] = in->x[v[i]];
+            py[i] = in->y[v[i]];
+            pz[i] = in->z[v[i]];
+        }
+        float ux = px[1] - px[0], uy = py[1] - py[0], uz = pz[1] - pz[0];
+        float wx = px[2] - px[0], wy = py[2] - py[0], wz = pz[2] - pz[0];
+        float nx = uy * wz - uz * wy, ny = uz * wx - ux * wz, nz = ux * wy - uy * wx;
+        float len = sqrtf(nx * nx + ny * ny + nz * nz);
+        float inv = len > 0 ? 1.0f / len : 0.0f;
+        j->fx[t] = nx * inv;
+        j->fy[t] = ny * inv;
+        j->fz[t] = nz * inv;
+        // Interior angle at each corner; zero for a degenerate face
+        for (int i = 0; i < 3; ++i) {
+            int a = (i + 1) % 3, b = (i + 2) % 3;
+            float ax = px[a] - px[i], ay = py[a] - py[i], az = pz[a] - pz[i];
+            float bx = px[b] - px[i], by = py[b] - py[i], bz = pz[b] - pz[i];
+            float dot = ax * bx + ay * by + az * bz;
+            j->angle[3 * t + i] = len > 0 ? atan2f(len, dot) : 0.0f;
+        }
+    }
+}
+
+static void chunk_span(const Job *j, size_t p, size_t *t0, size_t *t1) {
+    *t0 = j->in->triangle_count * p / j->parts;
+    *t1 = j->in->triangle_count * (p + 1) / j->parts;
+}
+
+static void count_range(void *ctx, size_t begin, size_t end) {
+    Job *j = ctx;
+    for (size_t p = begin; p < end; ++p) {
+        size_t t0, t1, *hist = j->cursor + p * j->parts;
+        chunk_span(j, p, &t0, &t1);
+        for (size_t c = 3 * t0; c < 3 * t1; ++c) hist[owner(j, j->in->indices[c])]++;
+    }
+}
+
+static void scatter_range(void *ctx, size_t begin, size_t end) {
+    Job *j = ctx;
+    for (size_t p = begin; p < end; ++p) {
+        size_t t0, t1, *cur = j->cursor + p * j->parts;
+        chunk_span(j, p, &t0, &t1);
+        for (size_t c = 3 * t0; c < 3 * t1; ++c) j->bucketed[cur[owner(j, j->in->indices[c])]++] = (unsigned)c;
+    }
+}
+
+// Face normals and corner angles around one vertex, gathered once
+typedef struct {
+    float x[NORMALS_MAX_CREASE_CORNERS], y[NORMALS_MAX_CREASE_CORNERS];
+    float z[NORMALS_MAX_CREASE_CORNERS], w[NORMALS_MAX_CREASE_CORNERS];
+} Fan;
+
+// Smooth normal of corner `self`: the fan's faces within the crease of its own
+static void corner_normal(const Fan *f, float cos_crease, size_t k, size_t self, float n[3]) {
+    float sx = f->x[self], sy = f->y[self], sz = f->z[self];
+    int crease = sx != 0 || sy != 0 || sz != 0;
+    n[0] = n[1] = n[2] = 0;
+    for (size_t d = 0; d < k; ++d) {
+        float w = f->x[d] * sx + f->y[d] * sy + f->z[d] * sz >= cos_crease || !crease ? f->w[d] : 0.0f;
+        n[0] += w * f->x[d];
+        n[1] += w * f->y[d];
+        n[2] += w * f->z[d];
+    }
+    float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len > 0) {
+        n[0] /= len; n[1] /= len; n[2] /= len;
+    } else if (crease && cos_crease >= -1.0f) {
+        corner_normal(f, -2.0f, k, self, n);    // creased faces cancelled out: use them all
+    }
+}
+
+// Angle-weighted sum over all corners, for vertices without crease splitting
+static void smooth_normal(const Job *j, const unsigned *corners, size_t k, float n[3]) {
+    n[0] = n[1] = n[2] = 0;
+    for (size_t d = 0; d < k; ++d) {
+        unsigned t = corners[d] / 3;
+        float w = j->angle[corners[d]];
+        n[0] += w * j->fx[t];
+        n[1] += w * j->fy[t];
+        n[2] += w * j->fz[t];
+    }
+    float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len > 0) {
+        n[0] /= len; n[1] /= len; n[2] /= len;
+    }
+}
+
+// Sorts a bucket's corners by vertex and assigns bucket-local output vertices
+static void bucket_range(void *ctx, size_t begin, size_t end) {
+    Job *j = ctx;
+    for (size_t o = begin; o < end; ++o) {
+        size_t v0 = bucket_first_vertex(j, o), v1 = bucket_first_vertex(j, o + 1), nr = v1 - v0;
+        size_t c0 = j->bucket_start[o], nc = j->bucket_start[o + 1] - c0;
+        size_t *start = calloc(nr + 1, sizeof(size_t));
+        float *normals = malloc(sizeof(float) * 3 * (nc + nr + 1));
+        unsigned *source = malloc(sizeof(unsigned) * (nc + nr + 1));
+        if (!start || !normals || !source) {
+            free(start);
+            free(normals);
+            free(source);
+            continue;
+        }
+        j->bucket_normals[o] = normals;
+        j->bucket_source[o] = source;
+        const unsigned *idx = j->in->indices;
+        for (size_t i = 0; i < nc; ++i) start[idx[j->bucketed[c0 + i]] - v0 + 1]++;
+        for (size_t v = 0; v < nr; ++v) start[v + 1] += start[v];
+        unsigned *sorted = j->sorted + c0;
+        for (size_t i = 0; i < nc; ++i) {
+            unsigned c = j->bucketed[c0 + i];
+            sorted[start[idx[c] - v0]++] = c;
+        }
+        for (size_t v = nr; v > 0; --v) start[v] = start[v - 1];
+        start[0] = 0;
+
+        size_t n_out = 0;
+        Fan fan;
+        for (size_t v = 0; v < nr; ++v) {
+            const unsigned *corners = sorted + start[v];
+            size_t k = start[v + 1] - start[v], first_out = n_out;
+            int crease = j->cos_crease > -1.0f && k <= NORMALS_MAX_CREASE_CORNERS;
+            if (k == 0) {
+                // Unreferenced: keep it so the output covers every input vertex
+                float *n = normals + 3 * n_out;
+                n[0] = n[1] = 0;
+                n[2] = 1;
+                source[n_out++] = (unsigned)(v0 + v);
+                continue;
+            }
+            if (!crease) {
+                float *n = normals + 3 * n_out;
+                smooth_normal(j, corners, k, n);
+                if (n[0] == 0 && n[1] == 0 && n[2] == 0) n[2] = 1;
+                for (size_t i = 0; i < k; ++i) j->out->indices[corners[i]] = (unsigned)n_out;
+                source[n_out++] = (unsigned)(v0 + v);
+                continue;
+            }
+            for (size_t i = 0; i < k; ++i) {
+                unsigned t = corners[i] / 3;
+                fan.x[i] = j->fx[t];
+                fan.y[i] = j->fy[t];
+                fan.z[i] = j->fz[t];
+                fan.w[i] = j->angle[corners[i]];
+            }
+            for (size_t i = 0; i < k; ++i) {
+                float n[3];
+                corner_normal(&fan, j->cos_crease, k, i, n);
+                if (n[0] == 0 && n[1] == 0 && n[2] == 0) n[2] = 1;
+                size_t s = first_out;
+                while (s < n_out && n[0] * normals[3 * s] + n[1] * normals[3 * s + 1] +
+                                    n[2] * normals[3 * s + 2] < SAME_NORMAL) s++;
+                if (s == n_out) {
+                    memcpy(normals + 3 * n_out, n, sizeof(n));
+                    source[n_out++] = (unsigned)(v0 + v);
+                }
+                j->out->indices[corners[i]] = (unsigned)s;
+            }
+        }
+        j->bucket_out[o] = n_out;
+        free(start);
+    }
+}
+
+// Rebases bucket-local indices and copies the bucket's vertices out
+static void gather_range(void *ctx, size_t begin, size_t end) {
+    Job *j = ctx;
+    NormalsOutput *out = j->out;
+    for (size_t o = begin; o < end; ++o) {
+        size_t base = j->bucket_out[o], n = j->bucket_out[o + 1] - base;
+        for (size_t i = j->bucket_start[o]; i < j->bucket_start[o + 1]; ++i)
+            out->indices[j->sorted[i]] += (unsigned)base;
+        const float *normals = j->bucket_normals[o];
+        for (size_t i = 0; i < n; ++i) {
+            out->nx[base + i] = normals[3 * i];
+            out->ny[base + i] = normals[3 * i + 1];
+            out->nz[base + i] = normals[3 * i + 2];
+        }
+        memcpy(out->source + base, j->bucket_source[o], sizeof(unsigned) * n);
+    }
+}
+
+int normals_compute(const NormalsInput *in, float crease_degrees, NormalsOutput *out) {
+    memset(out, 0, sizeof(*out));
+    size_t nt = in->triangle_count, corners = 3 * nt;
+    if (corners > UINT_MAX || in->vertex_count > UINT_MAX / 2) {
+        fprintf(stderr, "mesh too large for normals: %zu triangles\n", nt);
+        return -1;
+    }
+
+    Job j = { in, out };
+    j.cos_crease = crease_degrees >= 180.0f ? -1.0f : cosf(crease_degrees * 3.14159265f / 180.0f);
+    j.parts = (size_t)parallel_threads();
+    if (j.parts > in->vertex_count) j.parts = in->vertex_count ? in->vertex_count : 1;
+    size_t P = j.parts;
+    j.fx = malloc(sizeof(float) * (nt ? nt : 1));
+    j.fy = malloc(sizeof(float) * (nt ? nt : 1));
+    j.fz = malloc(sizeof(float) * (nt ? nt : 1));
+    j.angle = malloc(sizeof(float) * (corners ? corners : 1));
+    j.cursor = calloc(P * P, sizeof(size_t));
+    j.bucket_start = calloc(P + 1, sizeof(size_t));
+    j.bucketed = malloc(sizeof(unsigned) * (corners ? corners : 1));
+    j.sorted = malloc(sizeof(unsigned) * (corners ? corners : 1));
+    j.bucket_out = calloc(P + 1, sizeof(size_t));
+    j.bucket_normals = calloc(P, sizeof(float *));
+    j.bucket_source = calloc(P, sizeof(unsigned *));
+    out->indices = malloc(sizeof(unsigned) * (corners ? corners : 1));
+    int ok = j.fx && j.fy && j.fz && j.angle && j.cursor && j.bucket_start && j.bucketed &&
+             j.sorted && j.bucket_out && j.bucket_normals && j.bucket_source && out->indices;
+
+    if (ok && in->vertex_count) {
+        parallel_for(nt, 4096, face_range, &j);
+        parallel_for(P, 1, count_range, &j);
+        // Reduce: per-bucket totals, then each chunk's private write cursor
+        for (size_t o = 0; o < P; ++o) {
+            size_t at = j.bucket_start[o];
+            for (size_t p = 0; p < P; ++p) {
+                size_t n = j.cursor[p * P + o];
+                j.cursor[p * P + o] = at;
+                at += n;
+            }
+            j.bucket_start[o + 1] = at;
+        }
+        parallel_for(P, 1, scatter_range, &j);
+        parallel_for(P, 1, bucket_range, &j);
+        for (size_t o = 0; o < P; ++o) ok = ok && j.bucket_normals[o] && j.bucket_source[o];
+    }
+    if (ok) {
+        size_t total = 0;
+        for (size_t o = 0; o < P; ++o) {
+            size_t n = j.bucket_out[o];
+            j.bucket_out[o] = total;
+            total += n;
+        }
+        j.bucket_out[P] = total;
+        out->vertex_count = total;
+        out->nx = malloc(sizeof(float) * (total ? total : 1));
+        out->ny = malloc(sizeof(float) * (total ? total : 1));
+        out->nz = malloc(sizeof(float) * (total ? total : 1));
+        out->source = malloc(sizeof(unsigned) * (total ? total : 1));
+        ok = out->nx && out->ny && out->nz && out->source;
+        if (ok && in->vertex_count) parallel_for(P, 1, gather_range, &j);
+    }
+
+    for (size_t o = 0; j.bucket_normals && o < P; ++o) free(j.bucket_normals[o]);
+    for (size_t o = 0; j.bucket_source && o < P; ++o) free(j.bucket_source[o]);
+    free(j.fx); free(j.fy); free(j.fz); free(j.angle); free(j.cursor); free(j.bucket_start);
+    free(j.bucketed); free(j.sorted); free(j.bucket_out); free(j.bucket_normals); free(j.bucket_source);
+    if (!ok) {
+        fprintf(stderr, "out of memory computing normals\n");
+        normals_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void normals_free(NormalsOutput *out) {
+    free(out->nx);
+    free(out->ny);
+    free(out->nz);
+    free(out->source);
+    free(out->indices);
+    memset(out, 0, sizeof(*out));
+}
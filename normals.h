@@ -0,0 +1,41 @@
+// normals.h
+// Smooth vertex normals for meshes without usable ones (STL carries only
+// face normals). Each corner's normal is the angle-weighted sum of the
+// face normals around its vertex that lie within the crease angle of its
+// own face; a vertex whose corners end up with different normals is split
+// into one output vertex per distinct normal, so hard edges stay hard.
+//
+// Works on structure-of-arrays positions and writes SoA normals. The
+// passes run on parallel.h threads without atomics: corners are bucketed
+// by owning vertex range per triangle chunk (private counts, then a prefix
+// reduce), and each vertex range is then finished by a single thread.
+// The result does not depend on the thread count.
+#ifndef NORMALS_H
+#define NORMALS_H
+
+#include <stddef.h>
+
+typedef struct {
+    const float *x, *y, *z;     // per vertex
+    size_t vertex_count;
+    const unsigned *indices;    // 3 per triangle
+    size_t triangle_count;
+} NormalsInput;
+
+typedef struct {
+    float *nx, *ny, *nz;        // per output vertex, unit length
+    unsigned *source;           // output vertex -> input vertex
+    unsigned *indices;          // 3 per triangle, into the output vertices
+    size_t vertex_count;
+} NormalsOutput;
+
+// Vertices with more corners than this get one smooth normal without the
+// crease test (its cost is quadratic in the corner count).
+#define NORMALS_MAX_CREASE_CORNERS 256
+
+// crease_degrees >= 180 gives one smooth normal per vertex. Returns -1
+// (nothing allocated) if out of memory.
+int normals_compute(const NormalsInput *in, float crease_degrees, NormalsOutput *out);
+void normals_free(NormalsOutput *out);
+
+#endif
@@ -0,0 +1,226 @@
+// occlusion.c
+#define GL_GLEXT_PROTOTYPES
+#include "occlusion.h"
+
+#include <GL/glext.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    OCCLUSION_VISIBLE = 1,      // last query (or a conservative guess) saw samples
+    OCCLUSION_PENDING = 2,      // a query is in flight
+    OCCLUSION_RETEST = 4        // query alone next frame (its group's query saw samples)
+};
+
+// Box faces as quads of corners (bit 0 x, bit 1 y, bit 2 z set at the max),
+// counter-clockwise from outside so GL_CULL_FACE halves the fill
+static const unsigned char box_faces[6][4] = {
+    { 0, 4, 6, 2 }, { 1, 3, 7, 5 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 2, 3, 1 }, { 4, 5, 7, 6 }
+};
+
+static GLenum queryTarget(void) {
+    const char *version = (const char *)glGetString(GL_VERSION);
+    const char *ext = (const char *)glGetString(GL_EXTENSIONS);
+    int major = 0, minor = 0;
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) return 0;
+    if (major > 3 || (major == 3 && minor >= 3) || (ext && strstr(ext, "GL_ARB_occlusion_query2")))
+        return GL_ANY_SAMPLES_PASSED;
+    return major > 1 || minor >= 5 ? GL_SAMPLES_PASSED : 0;
+}
+
+int occlusion_init(Occlusion *o, const BvhBox *boxes, uint32_t count, float margin) {
+    memset(o, 0, sizeof(*o));
+    GLenum target = queryTarget();
+    if (!target || !count) return 0;
+    size_t n = count, groups = (n + OCCLUSION_GROUP - 1) / OCCLUSION_GROUP, boxes_total = n + groups;
+    o->box = malloc(sizeof(float) * 6 * n);
+    o->queries = malloc(sizeof(GLuint) * boxes_total);
+    o->state = malloc(n);
+    o->seen_frame = calloc(n, sizeof(uint32_t));
+    o->pending = malloc(sizeof(uint32_t) * boxes_total);
+    o->issue = malloc(sizeof(uint32_t) * boxes_total);
+    float *corners = malloc(sizeof(float) * 24 * boxes_total);
+    GLuint *indices = malloc(sizeof(GLuint) * 36 * boxes_total);
+    if (!o->box || !o->queries || !o->state || !o->seen_frame || !o->pending || !o->issue || !corners || !indices) {
+        fprintf(stderr, "out of memory for occlusion queries; drawing hidden clusters\n");
+        free(corners);
+        free(indices);
+        occlusion_free(o);
+        return -1;
+    }
+    memset(o->state, OCCLUSION_VISIBLE, n);
+
+    // Box c < n is cluster c, box n + g the union of group g
+    for (size_t c = 0; c < boxes_total; ++c) {
+        float lo[3], hi[3];
+        for (int a = 0; a < 3; ++a) {
+            if (c < n) {
+                lo[a] = boxes[c].min[a] - margin;
+                hi[a] = boxes[c].max[a] + margin;
+                o->box[6 * c + a] = 0.5f * (lo[a] + hi[a]);
+                o->box[6 * c + 3 + a] = 0.5f * (hi[a] - lo[a]);
+                continue;
+            }
+            lo[a] = INFINITY;
+            hi[a] = -INFINITY;
+            for (size_t k = (c - n) * OCCLUSION_GROUP; k < n && k < (c - n + 1) * OCCLUSION_GROUP; ++k) {
+                lo[a] = fminf(lo[a], o->box[6 * k + a] - o->box[6 * k + 3 + a]);
+                hi[a] = fmaxf(hi[a], o->box[6 * k + a] + o->box[6 * k + 3 + a]);
+            }
+        }
+        for (int k = 0; k < 8; ++k)
+            for (int a = 0; a < 3; ++a) corners[24 * c + 3 * k + a] = (k >> a & 1) ? hi[a] : lo[a];
+        GLuint *t = indices + 36 * c, base = (GLuint)(8 * c);
+        for (int f = 0; f < 6; ++f) {
+            const unsigned char *q = box_faces[f];
+            GLuint tri[6] = { q[0], q[1], q[2], q[0], q[2], q[3] };
+            for (int k = 0; k < 6; ++k) *t++ = base + tri[k];
+        }
+    }
+    glGenBuffers(1, &o->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, o->vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(sizeof(float) * 24 * boxes_total), corners, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glGenBuffers(1, &o->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, o->index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(sizeof(GLuint) * 36 * boxes_total), indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    free(corners);
+    free(indices);
+    glGenQueries((GLsizei)boxes_total, o->queries);
+    o->target = target;
+    o->count = count;
+    o->group_count = (uint32_t)groups;
+    return 0;
+}
+
+uint32_t occlusion_collect(Occlusion *o) {
+    uint32_t turned = 0, k = 0;
+    // Queries finish in the order they were issued: stop at the first busy one
+    for (; k < o->pending_count; ++k) {
+        uint32_t id = o->pending[k];
+        GLuint ready = 0, samples = 0;
+        glGetQueryObjectuiv(o->queries[id], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) break;
+        glGetQueryObjectuiv(o->queries[id], GL_QUERY_RESULT, &samples);
+        if (id < o->count) {
+            if (samples && !(o->state[id] & OCCLUSION_VISIBLE)) turned++;
+            o->state[id] = samples ? OCCLUSION_VISIBLE : 0;
+            continue;
+        }
+        uint32_t c0 = (id - o->count) * OCCLUSION_GROUP;
+        for (uint32_t c = c0; c < o->count && c < c0 + OCCLUSION_GROUP; ++c) {
+            turned += samples != 0;
+            o->state[c] = samples ? OCCLUSION_VISIBLE | OCCLUSION_RETEST : 0;
+        }
+    }
+    memmove(o->pending, o->pending + k, sizeof(uint32_t) * (o->pending_count - k));
+    o->pending_count -= k;
+    return turned;
+}
+
+// Whole box on the far side of the near plane (a*x + b*y + c*z + d >= 0)
+static int pastNear(const float *box, const float *plane) {
+    float d = plane[0] * box[0] + plane[1] * box[1] + plane[2] * box[2] + plane[3];
+    float r = fabsf(plane[0]) * box[3] + fabsf(plane[1]) * box[4] + fabsf(plane[2]) * box[5];
+    return d > r;
+}
+
+// Queues the hidden clusters of group g that want a query: as one query
+// when they are the whole group
+static void queueHidden(Occlusion *o, uint32_t g, const uint32_t *hidden, uint32_t n) {
+    uint32_t size = o->count - g * OCCLUSION_GROUP;
+    if (size > OCCLUSION_GROUP) size = OCCLUSION_GROUP;
+    if (n > 1 && n == size) {
+        o->issue[o->issue_count++] = o->count + g;
+        return;
+    }
+    for (uint32_t i = 0; i < n; ++i) o->issue[o->issue_count++] = hidden[i];
+}
+
+int occlusion_filter(Occlusion *o, const BvhRange *in, int in_count, const float planes[6][4],
+                     BvhRange *out, uint32_t *occluded) {
+    uint32_t frame = ++o->frame, skipped = 0, group = UINT32_MAX, hidden[OCCLUSION_GROUP], hidden_count = 0;
+    int n = 0;
+    o->issue_count = 0;
+    for (int i = 0; i < in_count; ++i) {
+        for (uint32_t c = in[i].first; c < in[i].first + in[i].count; ++c) {
+            if (c / OCCLUSION_GROUP != group) {
+                if (hidden_count) queueHidden(o, group, hidden, hidden_count);
+                group = c / OCCLUSION_GROUP;
+                hidden_count = 0;
+            }
+            unsigned char *st = &o->state[c];
+            int entered = o->seen_frame[c] + 1 != frame;
+            o->seen_frame[c] = frame;
+            if (!pastNear(o->box + 6 * c, planes[4])) {
+                // The camera may be inside: the box cannot be rasterized whole
+                *st = (*st & OCCLUSION_PENDING) | OCCLUSION_VISIBLE;
+            } else if (!(*st & OCCLUSION_PENDING)) {
+                if (entered) *st = OCCLUSION_VISIBLE;
+                if (!(*st & OCCLUSION_VISIBLE)) {
+                    hidden[hidden_count++] = c;
+                } else if (entered || (*st & OCCLUSION_RETEST) || (c + frame) % OCCLUSION_RETEST_FRAMES == 0) {
+                    o->issue[o->issue_count++] = c;
+                    *st &= ~OCCLUSION_RETEST;
+                }
+            }
+            if (!(*st & OCCLUSION_VISIBLE)) {
+                skipped++;
+                continue;
+            }
+            if (n && out[n - 1].first + out[n - 1].count == c) {
+                out[n - 1].count++;
+            } else {
+                out[n].first = c;
+                out[n++].count = 1;
+            }
+        }
+    }
+    if (hidden_count) queueHidden(o, group, hidden, hidden_count);
+    *occluded = skipped;
+    return n;
+}
+
+uint32_t occlusion_issue(Occlusion *o) {
+    if (!o->issue_count) return 0;
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, o->vertex_buffer);
+    glVertexPointer(3, GL_FLOAT, 0, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, o->index_buffer);
+    for (uint32_t i = 0; i < o->issue_count; ++i) {
+        uint32_t id = o->issue[i];
+        glBeginQuery(o->target, o->queries[id]);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (const void *)(sizeof(GLuint) * 36 * (size_t)id));
+        glEndQuery(o->target);
+        uint32_t c0 = id < o->count ? id : (id - o->count) * OCCLUSION_GROUP;
+        uint32_t c1 = id < o->count ? id + 1 : c0 + OCCLUSION_GROUP;
+        for (uint32_t c = c0; c < c1 && c < o->count; ++c) o->state[c] |= OCCLUSION_PENDING;
+        o->pending[o->pending_count++] = id;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    uint32_t issued = o->issue_count;
+    o->issue_count = 0;
+    return issued;
+}
+
+void occlusion_free(Occlusion *o) {
+    if (o->queries && o->target) glDeleteQueries((GLsizei)(o->count + o->group_count), o->queries);
+    if (o->vertex_buffer) glDeleteBuffers(1, &o->vertex_buffer);
+    if (o->index_buffer) glDeleteBuffers(1, &o->index_buffer);
+    free(o->box);
+    free(o->queries);
+    free(o->state);
+    free(o->seen_frame);
+    free(o->pending);
+    free(o->issue);
+    memset(o, 0, sizeof(*o));
+}
@@ -0,0 +1,71 @@
+// occlusion.h
+// Occlusion culling for loaded meshes with hardware queries and temporal
+// coherence. Each cluster keeps the visibility its last query returned:
+// clusters found hidden are skipped, and their bounding boxes are drawn
+// (colour and depth writes off) inside a GL_ANY_SAMPLES_PASSED query after
+// the frame's geometry, until one reports samples again. Visible clusters
+// are re-queried every OCCLUSION_RETEST_FRAMES frames, staggered so only a
+// share of them is tested per frame. When all OCCLUSION_GROUP clusters of a
+// run (a BVH leaf: Morton-adjacent, so spatially close) are hidden, one
+// query on their joint box stands for them; if it sees samples they are
+// drawn and queried one by one in the next frame.
+//
+// Results are read only once GL_QUERY_RESULT_AVAILABLE says so, so a frame
+// never waits on the GPU; the price is that a cluster coming into view
+// may show up a frame late. Hosts that redraw only on events should call
+// occlusion_collect between frames and draw again when it returns > 0.
+// A cluster that enters the frustum, or whose box crosses the near plane,
+// counts as visible and is drawn.
+//
+// Falls back to GL_SAMPLES_PASSED (GL 1.5) without GL 3.3 or
+// ARB_occlusion_query2.
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <GL/gl.h>
+#include <stdint.h>
+
+#include "bvh.h"
+
+#define OCCLUSION_RETEST_FRAMES 8
+#define OCCLUSION_GROUP 4
+
+typedef struct {
+    GLenum target;              // query target; 0 when the context has no occlusion queries
+    uint32_t count, group_count;
+    float *box;                 // per cluster: centre xyz, half extent xyz (margin included)
+    GLuint *queries;            // per cluster, then per group
+    unsigned char *state;       // OCCLUSION_* bits, see occlusion.c
+    uint32_t *seen_frame;       // frame the cluster was last in the frustum
+    uint32_t *pending;          // queries in flight: cluster c, or group g as count + g
+    uint32_t pending_count;
+    uint32_t *issue;            // per-frame scratch: queries to issue after the draw, as pending
+    uint32_t issue_count;
+    GLuint vertex_buffer, index_buffer;     // 8 corners and 36 indices per box, clusters then groups
+    uint32_t frame;
+} Occlusion;
+
+// Boxes in the units meshgl_draw culls in, each grown by `margin` on every
+// side so a box never loses the depth test to its own cluster's surface.
+// Needs a current context. Leaves target 0 (and everything drawn) when
+// the context has no occlusion queries.
+int occlusion_init(Occlusion *o, const BvhBox *boxes, uint32_t count, float margin);
+
+// Reads every query result that is ready, without waiting. Returns the
+// number of clusters that turned visible.
+uint32_t occlusion_collect(Occlusion *o);
+
+// Starts a frame: writes the clusters of `in` that may be visible to
+// `out` (room for one range per cluster) and returns the range count.
+// planes are the frustum planes (bvh_planes_from_matrix) in the boxes'
+// units. *occluded gets the number of clusters skipped.
+int occlusion_filter(Occlusion *o, const BvhRange *in, int in_count, const float planes[6][4],
+                     BvhRange *out, uint32_t *occluded);
+
+// Queries the boxes chosen by occlusion_filter; call after the frame's
+// geometry, with the modelview in the boxes' units. Returns the query count.
+uint32_t occlusion_issue(Occlusion *o);
+
+void occlusion_free(Occlusion *o);
+
+#endif
@@ -0,0 +1,52 @@
+// parallel.c
+#include "parallel.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+static int thread_setting = 0;
+
+void parallel_set_threads(int n) {
+    thread_setting = n < 0 ? 0 : n > PARALLEL_MAX_THREADS ? PARALLEL_MAX_THREADS : n;
+}
+
+int parallel_threads(void) {
+    if (thread_setting > 0) return thread_setting;
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : n > PARALLEL_MAX_THREADS ? PARALLEL_MAX_THREADS : (int)n;
+}
+
+typedef struct {
+    void (*fn)(void *, size_t, size_t);
+    void *ctx;
+    size_t begin, end;
+} Range;
+
+static void *range_main(void *p) {
+    Range *r = p;
+    r->fn(r->ctx, r->begin, r->end);
+    return NULL;
+}
+
+void parallel_for(size_t n, size_t grain, void (*fn)(void *ctx, size_t begin, size_t end), void *ctx) {
+    if (grain < 1) grain = 1;
+    size_t parts = (size_t)parallel_threads();
+    if (parts > n / grain) parts = n / grain;
+    if (parts <= 1) {
+        if (n) fn(ctx, 0, n);
+        return;
+    }
+
+    pthread_t tid[PARALLEL_MAX_THREADS];
+    Range ranges[PARALLEL_MAX_THREADS];
+    int started[PARALLEL_MAX_THREADS] = {0};
+    for (size_t i = 0; i < parts; ++i) {
+        ranges[i] = (Range){ fn, ctx, n * i / parts, n * (i + 1) / parts };
+        if (i == 0) continue;
+        started[i] = pthread_create(&tid[i], NULL, range_main, &ranges[i]) == 0;
+        if (!started[i]) range_main(&ranges[i]);   // out of threads: run inline
+    }
+    range_main(&ranges[0]);
+    for (size_t i = 1; i < parts; ++i)
+        if (started[i]) pthread_join(tid[i], NULL);
+}
@@ -0,0 +1,20 @@
+// parallel.h
+// Minimal fork-join helper for the mesh pipeline: splits [0, n) into
+// contiguous ranges, one per worker thread, and waits for all of them.
+// The calling thread runs the first range. No pool: the loads and builds
+// this serves run once per model, so thread start-up cost is noise.
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+#define PARALLEL_MAX_THREADS 64     // bound on parallel_threads(), for per-part arrays
+
+void parallel_set_threads(int n);   // 0 (default): one per online CPU
+int parallel_threads(void);
+
+// fn(ctx, begin, end) on up to parallel_threads() ranges; ranges are at
+// least `grain` items, so small inputs stay on the calling thread.
+void parallel_for(size_t n, size_t grain, void (*fn)(void *ctx, size_t begin, size_t end), void *ctx);
+
+#endif
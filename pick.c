@@ -0,0 +1,392 @@
+// pick.c
+// 原 libviewcube.c 的 hover 判斷與 cube_chars.c 的 pickCubeFace，改為不依賴 GL。
+#include "pick.h"
+
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define FACE_SUBDIV_X 3
+#define FACE_SUBDIV_Y 3
+#define FACE_CELLS (FACE_SUBDIV_X * FACE_SUBDIV_Y)
+
+// 與 libviewcube.c 的細分比例相同
+static const float subdiv_ratios[4] = { 0.0f, 0.1f, 0.9f, 1.0f };
+
+// v = (Rz * Rx * Ry)^-1 * v，角度為度
+static void inverseRotate(const float rot[3], double v[3]) {
+    double az = -rot[2] * M_PI / 180.0;
+    double ax = -rot[0] * M_PI / 180.0;
+    double ay = -rot[1] * M_PI / 180.0;
+    double x = v[0], y = v[1], z = v[2], t;
+
+    t = x * cos(az) - y * sin(az); y = x * sin(az) + y * cos(az); x = t;   // Z
+    t = y * cos(ax) - z * sin(ax); z = y * sin(ax) + z * cos(ax); y = t;   // X
+    t = x * cos(ay) + z * sin(ay); z = -x * sin(ay) + z * cos(ay); x = t;  // Y
+    v[0] = x; v[1] = y; v[2] = z;
+}
+
+// --- libviewcube hover ---
+//
+// 等同 libviewcube 的 gluPerspective(30, 1, 1, 10) 與 gluLookAt(0, 0, 5, ...)：
+// 由視點經過像素中心的射線，轉到方塊座標後與半邊長 0.5 的方塊做平板（slab）
+// 測試，取進入的面，再以 face_vertices 的 u（v0->v1）、v（v0->v3）分 cell。
+// 每個方位的三角函數只算一次，單點與批次共用。
+
+typedef struct {
+    int vx, vy, size;
+    float tan_half_fov;
+    float m[3][3];                    // (Rz * Rx * Ry)^-1
+    float o[3];                       // 視點 (0, 0, 5) 在方塊座標的位置
+    float lo[3], hi[3];               // 各軸 -0.5 - o 與 0.5 - o
+    float cut0, cut1;                 // cell 0/1 與 1/2 的分界
+} HoverSetup;
+
+static void hoverSetup(const float rot[3], int vx, int vy, int size, HoverSetup *b) {
+    const float eye_z = 5.0f, half = 0.5f;
+
+    b->vx = vx; b->vy = vy; b->size = size;
+    b->tan_half_fov = tanf(30.0f * M_PI / 360.0f);
+
+    // 與 inverseRotate 相同：先 Z、再 X、最後 Y，作用在三個基底向量上
+    float az = -rot[2] * M_PI / 180.0f, ax = -rot[0] * M_PI / 180.0f, ay = -rot[1] * M_PI / 180.0f;
+    float cz = cosf(az), sz = sinf(az), cx = cosf(ax), sx = sinf(ax), cy = cosf(ay), sy = sinf(ay);
+    for (int j = 0; j < 3; ++j) {
+        float x = j == 0, y = j == 1, z = j == 2, t;
+        t = x * cz - y * sz; y = x * sz + y * cz; x = t;
+        t = y * cx - z * sx; z = y * sx + z * cx; y = t;
+        t = x * cy + z * sy; z = -x * sy + z * cy; x = t;
+        b->m[0][j] = x; b->m[1][j] = y; b->m[2][j] = z;
+    }
+    for (int k = 0; k < 3; ++k) {
+        b->o[k] = eye_z * b->m[k][2];
+        b->lo[k] = -half - b->o[k];
+        b->hi[k] = half - b->o[k];
+    }
+    b->cut0 = subdiv_ratios[1];
+    b->cut1 = subdiv_ratios[2];
+}
+
+// 射線方向（未單位化）；批次版本依相同順序運算
+static void hoverRay(const HoverSetup *b, int x, int y, float d[3]) {
+    float fx = ((float)(x - b->vx) + 0.5f) * 2.0f / (float)b->size - 1.0f;
+    float fy = ((float)(y - b->vy) + 0.5f) * 2.0f / (float)b->size - 1.0f;
+    float sx = fx * b->tan_half_fov, sy = fy * b->tan_half_fov;
+    for (int k = 0; k < 3; ++k)
+        d[k] = b->m[k][0] * sx + b->m[k][1] * sy - b->m[k][2];
+}
+
+// face * 9 + cell，沒有命中為 -1
+static int hoverOne(const HoverSetup *b, int x, int y) {
+    if (x < b->vx || x > b->vx + b->size || y < b->vy || y > b->vy + b->size) return -1;
+
+    float d[3];
+    hoverRay(b, x, y, d);
+
+    // 平板測試；d 為 0 時 1/d 為無限大，該軸的區間即為整條射線
+    float t_in = 0.0f, t_out = 0.0f;
+    int face = -1;
+    for (int k = 0; k < 3; ++k) {
+        float inv = 1.0f / d[k];
+        float tl = b->lo[k] * inv, th = b->hi[k] * inv;
+        float t_near = th < tl ? th : tl;
+        float t_far = tl > th ? tl : th;
+        int f = th < tl ? 2 * k : 2 * k + 1;      // 從 + 面或 - 面進入
+        if (k == 0) {
+            t_in = t_near; t_out = t_far; face = f;
+            continue;
+        }
+        if (t_near > t_in) { t_in = t_near; face = f; }
+        if (t_far < t_out) t_out = t_far;
+    }
+    if (!(t_in <= t_out)) return -1;
+
+    float p[3];
+    for (int k = 0; k < 3; ++k) p[k] = b->o[k] + t_in * d[k];
+
+    // UV：+X (y, z) -X (y, -z) +Y (x, z) -Y (x, -z) +Z (x, y) -Z (-x, y)
+    float u = face < 2 ? p[1] : p[0];
+    float v = face < 4 ? p[2] : p[1];
+    if (face == 5) u = -u;
+    if (face == 1 || face == 3) v = -v;
+    u = u + 0.5f;
+    v = v + 0.5f;
+
+    int cell_x = (u >= b->cut0) + (u >= b->cut1);
+    int cell_y = (v >= b->cut0) + (v >= b->cut1);
+    return face * FACE_CELLS + cell_y * FACE_SUBDIV_X + cell_x;
+}
+
+void pick_screen_to_local(const float rot[3], int vx, int vy, int size,
+                          int x, int y, float out[3]) {
+    HoverSetup b;
+    hoverSetup(rot, vx, vy, size, &b);
+    hoverRay(&b, x, y, out);
+    float len = sqrtf(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+    for (int k = 0; k < 3; ++k) out[k] /= len;
+}
+
+// hover 判斷；x, y 為 OpenGL 座標（左下為原點）
+void pick_viewcube_hover(const float rot[3], int vx, int vy, int size,
+                         int x, int y, PickHover *out) {
+    HoverSetup b;
+    hoverSetup(rot, vx, vy, size, &b);
+    int id = hoverOne(&b, x, y);
+
+    // 其他類型的 hover 檢測（邊和角）可以在這裡添加
+    out->id = id;
+    out->type = id >= 0;
+    out->face = id >= 0 ? id / FACE_CELLS : -1;
+    out->cell = id >= 0 ? id % FACE_CELLS : -1;
+}
+
+int pick_cube_face(int mx, int my, int cube_x, int cube_y, int cube_size,
+                   const float rot[3]) {
+    if (mx < cube_x || mx > cube_x + cube_size ||
+        my < cube_y || my > cube_y + cube_size)
+        return -1;
+
+    // 與 drawViewCube 相同：gluPerspective(30, 1, 1, 100)、glTranslatef(0, 0, -8)、
+    // Rz * Rx * Ry，面在 ±0.7。由視點經過像素中心的射線轉到方塊座標做平板測試
+    const double eye_dist = 8.0, s = 0.7;
+    double tan_half = tan(30.0 * M_PI / 360.0);
+    double ndcX = (mx + 0.5 - cube_x) / (double)cube_size * 2.0 - 1.0;
+    double ndcY = (my + 0.5 - cube_y) / (double)cube_size * 2.0 - 1.0;
+
+    double o[3] = { 0, 0, eye_dist };
+    double d[3] = { ndcX * tan_half, ndcY * tan_half, -1.0 };
+    inverseRotate(rot, o);
+    inverseRotate(rot, d);
+
+    // 面的順序 +X -X +Y -Y +Z -Z（方塊座標軸）
+    double t_in = -INFINITY, t_out = INFINITY;
+    int hitFace = -1;
+    for (int k = 0; k < 3; ++k) {
+        if (fabs(d[k]) < 1e-15) {
+            if (fabs(o[k]) > s) return -1;
+            continue;
+        }
+        double t0 = (-s - o[k]) / d[k], t1 = (s - o[k]) / d[k];
+        int f0 = 2 * k + 1, f1 = 2 * k;     // 從 -s 或 +s 進入
+        if (t0 > t1) {
+            double t = t0; t0 = t1; t1 = t;
+            int f = f0; f0 = f1; f1 = f;
+        }
+        if (t0 > t_in) { t_in = t0; hitFace = f0; }
+        if (t1 < t_out) t_out = t1;
+    }
+    if (t_in > t_out || t_out < 0) return -1;
+    return hitFace;
+}
+
+// --- 批次 hover（SIMD）---
+//
+// 與 hoverOne 完全相同的運算順序，只是一次處理 4 / 8 個點。比較後選值的
+// 寫法對應 min/max 指令（a < b ? a : b），NaN 時兩邊結果也相同。
+
+static void batchScalar(const HoverSetup *b, const int *x, const int *y, int n, int *ids) {
+    for (int i = 0; i < n; ++i)
+        ids[i] = hoverOne(b, x[i], y[i]);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PICK_HAVE_X86 1
+#endif
+
+#if defined(PICK_HAVE_X86) && defined(__SSE2__)
+static inline __m128 sel128(__m128 mask, __m128 a, __m128 b) {   // mask ? a : b
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void batchSSE2(const HoverSetup *b, const int *x, const int *y, int n, int *ids) {
+    const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), half = _mm_set1_ps(0.5f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 size = _mm_set1_ps((float)b->size), tanh = _mm_set1_ps(b->tan_half_fov);
+    const __m128 cut0 = _mm_set1_ps(b->cut0), cut1 = _mm_set1_ps(b->cut1);
+    const __m128i vx = _mm_set1_epi32(b->vx), vy = _mm_set1_epi32(b->vy);
+    const __m128i x_hi = _mm_set1_epi32(b->vx + b->size), y_hi = _mm_set1_epi32(b->vy + b->size);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i xi = _mm_loadu_si128((const __m128i *)(x + i));
+        __m128i yi = _mm_loadu_si128((const __m128i *)(y + i));
+        __m128i outside = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(xi, vx), _mm_cmpgt_epi32(xi, x_hi)),
+                                       _mm_or_si128(_mm_cmplt_epi32(yi, vy), _mm_cmpgt_epi32(yi, y_hi)));
+
+        // 射線方向
+        __m128 fx = _mm_sub_ps(_mm_div_ps(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_sub_epi32(xi, vx)), half),
+                                                     two), size), one);
+        __m128 fy = _mm_sub_ps(_mm_div_ps(_mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(_mm_sub_epi32(yi, vy)), half),
+                                                     two), size), one);
+        __m128 sx = _mm_mul_ps(fx, tanh), sy = _mm_mul_ps(fy, tanh);
+
+        // 平板測試
+        __m128 d[3], t_in = _mm_setzero_ps(), t_out = t_in, face = t_in;
+        for (int k = 0; k < 3; ++k) {
+            d[k] = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(b->m[k][0]), sx),
+                                         _mm_mul_ps(_mm_set1_ps(b->m[k][1]), sy)),
+                              _mm_set1_ps(b->m[k][2]));
+            __m128 inv = _mm_div_ps(one, d[k]);
+            __m128 tl = _mm_mul_ps(_mm_set1_ps(b->lo[k]), inv), th = _mm_mul_ps(_mm_set1_ps(b->hi[k]), inv);
+            __m128 t_near = _mm_min_ps(th, tl), t_far = _mm_max_ps(tl, th);
+            __m128 f = sel128(_mm_cmplt_ps(th, tl), _mm_set1_ps(2 * k), _mm_set1_ps(2 * k + 1));
+            if (k == 0) {
+                t_in = t_near; t_out = t_far; face = f;
+                continue;
+            }
+            face = sel128(_mm_cmpgt_ps(t_near, t_in), f, face);
+            t_in = _mm_max_ps(t_near, t_in);
+            t_out = _mm_min_ps(t_far, t_out);
+        }
+        __m128 hit = _mm_cmple_ps(t_in, t_out);
+        __m128 px = _mm_add_ps(_mm_set1_ps(b->o[0]), _mm_mul_ps(t_in, d[0]));
+        __m128 py = _mm_add_ps(_mm_set1_ps(b->o[1]), _mm_mul_ps(t_in, d[1]));
+        __m128 pz = _mm_add_ps(_mm_set1_ps(b->o[2]), _mm_mul_ps(t_in, d[2]));
+
+        // UV：+X (y, z) -X (y, -z) +Y (x, z) -Y (x, -z) +Z (x, y) -Z (-x, y)
+        __m128 u = sel128(_mm_cmplt_ps(face, _mm_set1_ps(2)), py, px);
+        __m128 v = sel128(_mm_cmplt_ps(face, _mm_set1_ps(4)), pz, py);
+        __m128 neg_u = _mm_cmpeq_ps(face, _mm_set1_ps(5));
+        __m128 neg_v = _mm_or_ps(_mm_cmpeq_ps(face, one), _mm_cmpeq_ps(face, _mm_set1_ps(3)));
+        u = _mm_add_ps(_mm_xor_ps(u, _mm_and_ps(neg_u, sign)), half);
+        v = _mm_add_ps(_mm_xor_ps(v, _mm_and_ps(neg_v, sign)), half);
+
+        __m128 cell_x = _mm_add_ps(_mm_and_ps(_mm_cmpge_ps(u, cut0), one), _mm_and_ps(_mm_cmpge_ps(u, cut1), one));
+        __m128 cell_y = _mm_add_ps(_mm_and_ps(_mm_cmpge_ps(v, cut0), one), _mm_and_ps(_mm_cmpge_ps(v, cut1), one));
+        __m128 id = _mm_add_ps(_mm_mul_ps(face, _mm_set1_ps(FACE_CELLS)),
+                               _mm_add_ps(_mm_mul_ps(cell_y, _mm_set1_ps(FACE_SUBDIV_X)), cell_x));
+
+        __m128i idi = _mm_cvtps_epi32(id);
+        __m128i keep = _mm_andnot_si128(outside, _mm_castps_si128(hit));
+        idi = _mm_or_si128(_mm_and_si128(keep, idi), _mm_andnot_si128(keep, _mm_set1_epi32(-1)));
+        _mm_storeu_si128((__m128i *)(ids + i), idi);
+    }
+    batchScalar(b, x + i, y + i, n - i, ids + i);
+}
+#endif
+
+#ifdef PICK_HAVE_X86
+__attribute__((target("avx2")))
+static void batchAVX2(const HoverSetup *b, const int *x, const int *y, int n, int *ids) {
+    const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), half = _mm256_set1_ps(0.5f);
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 size = _mm256_set1_ps((float)b->size), tanh = _mm256_set1_ps(b->tan_half_fov);
+    const __m256 cut0 = _mm256_set1_ps(b->cut0), cut1 = _mm256_set1_ps(b->cut1);
+    const __m256i vx = _mm256_set1_epi32(b->vx), vy = _mm256_set1_epi32(b->vy);
+    const __m256i x_hi = _mm256_set1_epi32(b->vx + b->size), y_hi = _mm256_set1_epi32(b->vy + b->size);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i xi = _mm256_loadu_si256((const __m256i *)(x + i));
+        __m256i yi = _mm256_loadu_si256((const __m256i *)(y + i));
+        __m256i outside = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpgt_epi32(vx, xi), _mm256_cmpgt_epi32(xi, x_hi)),
+            _mm256_or_si256(_mm256_cmpgt_epi32(vy, yi), _mm256_cmpgt_epi32(yi, y_hi)));
+
+        __m256 fx = _mm256_sub_ps(_mm256_div_ps(_mm256_mul_ps(_mm256_add_ps(
+            _mm256_cvtepi32_ps(_mm256_sub_epi32(xi, vx)), half), two), size), one);
+        __m256 fy = _mm256_sub_ps(_mm256_div_ps(_mm256_mul_ps(_mm256_add_ps(
+            _mm256_cvtepi32_ps(_mm256_sub_epi32(yi, vy)), half), two), size), one);
+        __m256 sx = _mm256_mul_ps(fx, tanh), sy = _mm256_mul_ps(fy, tanh);
+
+        __m256 d[3], t_in = _mm256_setzero_ps(), t_out = t_in, face = t_in;
+        for (int k = 0; k < 3; ++k) {
+            d[k] = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(b->m[k][0]), sx),
+                                               _mm256_mul_ps(_mm256_set1_ps(b->m[k][1]), sy)),
+                                 _mm256_set1_ps(b->m[k][2]));
+            __m256 inv = _mm256_div_ps(one, d[k]);
+            __m256 tl = _mm256_mul_ps(_mm256_set1_ps(b->lo[k]), inv);
+            __m256 th = _mm256_mul_ps(_mm256_set1_ps(b->hi[k]), inv);
+            __m256 t_near = _mm256_min_ps(th, tl), t_far = _mm256_max_ps(tl, th);
+            __m256 f = _mm256_blendv_ps(_mm256_set1_ps(2 * k + 1), _mm256_set1_ps(2 * k),
+                                        _mm256_cmp_ps(th, tl, _CMP_LT_OQ));
+            if (k == 0) {
+                t_in = t_near; t_out = t_far; face = f;
+                continue;
+            }
+            face = _mm256_blendv_ps(face, f, _mm256_cmp_ps(t_near, t_in, _CMP_GT_OQ));
+            t_in = _mm256_max_ps(t_near, t_in);
+            t_out = _mm256_min_ps(t_far, t_out);
+        }
+        __m256 hit = _mm256_cmp_ps(t_in, t_out, _CMP_LE_OQ);
+        __m256 px = _mm256_add_ps(_mm256_set1_ps(b->o[0]), _mm256_mul_ps(t_in, d[0]));
+        __m256 py = _mm256_add_ps(_mm256_set1_ps(b->o[1]), _mm256_mul_ps(t_in, d[1]));
+        __m256 pz = _mm256_add_ps(_mm256_set1_ps(b->o[2]), _mm256_mul_ps(t_in, d[2]));
+
+        __m256 u = _mm256_blendv_ps(px, py, _mm256_cmp_ps(face, _mm256_set1_ps(2), _CMP_LT_OQ));
+        __m256 v = _mm256_blendv_ps(py, pz, _mm256_cmp_ps(face, _mm256_set1_ps(4), _CMP_LT_OQ));
+        __m256 neg_u = _mm256_cmp_ps(face, _mm256_set1_ps(5), _CMP_EQ_OQ);
+        __m256 neg_v = _mm256_or_ps(_mm256_cmp_ps(face, one, _CMP_EQ_OQ),
+                                    _mm256_cmp_ps(face, _mm256_set1_ps(3), _CMP_EQ_OQ));
+        u = _mm256_add_ps(_mm256_xor_ps(u, _mm256_and_ps(neg_u, sign)), half);
+        v = _mm256_add_ps(_mm256_xor_ps(v, _mm256_and_ps(neg_v, sign)), half);
+
+        __m256 cell_x = _mm256_add_ps(_mm256_and_ps(_mm256_cmp_ps(u, cut0, _CMP_GE_OQ), one),
+                                      _mm256_and_ps(_mm256_cmp_ps(u, cut1, _CMP_GE_OQ), one));
+        __m256 cell_y = _mm256_add_ps(_mm256_and_ps(_mm256_cmp_ps(v, cut0, _CMP_GE_OQ), one),
+                                      _mm256_and_ps(_mm256_cmp_ps(v, cut1, _CMP_GE_OQ), one));
+        __m256 id = _mm256_add_ps(_mm256_mul_ps(face, _mm256_set1_ps(FACE_CELLS)),
+                                  _mm256_add_ps(_mm256_mul_ps(cell_y, _mm256_set1_ps(FACE_SUBDIV_X)), cell_x));
+
+        __m256i idi = _mm256_cvtps_epi32(id);
+        __m256i keep = _mm256_andnot_si256(outside, _mm256_castps_si256(hit));
+        idi = _mm256_blendv_epi8(_mm256_set1_epi32(-1), idi, keep);
+        _mm256_storeu_si256((__m256i *)(ids + i), idi);
+    }
+    batchScalar(b, x + i, y + i, n - i, ids + i);
+}
+#endif
+
+typedef void (*BatchFn)(const HoverSetup *b, const int *x, const int *y, int n, int *ids);
+
+static PickImpl batch_impl = PICK_IMPL_AUTO;
+static BatchFn batch_fn;
+
+static int implAvailable(PickImpl impl) {
+    switch (impl) {
+    case PICK_IMPL_SCALAR: return 1;
+#if defined(PICK_HAVE_X86) && defined(__SSE2__)
+    case PICK_IMPL_SSE2: return 1;
+#endif
+#ifdef PICK_HAVE_X86
+    case PICK_IMPL_AVX2: return __builtin_cpu_supports("avx2");
+#endif
+    default: return 0;
+    }
+}
+
+int pick_set_impl(PickImpl impl) {
+    if (impl == PICK_IMPL_AUTO) {
+        impl = implAvailable(PICK_IMPL_AVX2) ? PICK_IMPL_AVX2 :
+               implAvailable(PICK_IMPL_SSE2) ? PICK_IMPL_SSE2 : PICK_IMPL_SCALAR;
+    } else if (!implAvailable(impl)) {
+        return -1;
+    }
+    batch_impl = impl;
+    switch (impl) {
+#ifdef PICK_HAVE_X86
+    case PICK_IMPL_AVX2: batch_fn = batchAVX2; break;
+#endif
+#if defined(PICK_HAVE_X86) && defined(__SSE2__)
+    case PICK_IMPL_SSE2: batch_fn = batchSSE2; break;
+#endif
+    default: batch_fn = batchScalar; break;
+    }
+    return 0;
+}
+
+const char *pick_impl_name(void) {
+    static const char *names[] = { "auto", "scalar", "sse2", "avx2" };
+    return names[batch_impl];
+}
+
+void pick_viewcube_hover_batch(const float rot[3], int vx, int vy, int size,
+                               const int *x, const int *y, int n, int *ids) {
+    HoverSetup b;
+    if (!batch_fn) pick_set_impl(PICK_IMPL_AUTO);
+    hoverSetup(rot, vx, vy, size, &b);
+    batch_fn(&b, x, y, n, ids);
+}
@@ -0,0 +1,42 @@
+// pick.h
+// GL-free ViewCube hit tests. libviewcube's hover and cube_chars' face pick
+// call these, so they can be benchmarked and checked without a context.
+//
+// Rectangles and points are in GL window pixels (origin bottom-left);
+// rot is the cube orientation in degrees, R = Rz * Rx * Ry.
+#ifndef PICK_H
+#define PICK_H
+
+typedef struct {
+    int type;       // VIEWCUBE_HOVER_* numbering: 0 none, 1 face
+    int id;         // face * 9 + cell, -1 for none
+    int face;       // 0..5: +X -X +Y -Y +Z -Z, -1 for none
+    int cell;       // 0..8 (3x3, row-major), -1 for none
+} PickHover;
+
+// libviewcube: view ray through the centre of pixel (x, y), rotated into
+// cube space (unit vector).
+void pick_screen_to_local(const float rot[3], int vx, int vy, int size,
+                          int x, int y, float out[3]);
+
+// libviewcube: hovered face cell under (x, y), i.e. the cell where that
+// ray enters the cube, as drawn.
+void pick_viewcube_hover(const float rot[3], int vx, int vy, int size,
+                         int x, int y, PickHover *out);
+
+// Batched pick_viewcube_hover: ids[i] = face * 9 + cell for (x[i], y[i]),
+// -1 for none. Same results as the single-point call, computed 4 (SSE2) or
+// 8 (AVX2) points at a time with the orientation's trig done once.
+void pick_viewcube_hover_batch(const float rot[3], int vx, int vy, int size,
+                               const int *x, const int *y, int n, int *ids);
+
+// Batch implementation; AUTO (the default) picks the widest the CPU has.
+typedef enum { PICK_IMPL_AUTO, PICK_IMPL_SCALAR, PICK_IMPL_SSE2, PICK_IMPL_AVX2 } PickImpl;
+int pick_set_impl(PickImpl impl);      // -1 if unavailable on this CPU/build
+const char *pick_impl_name(void);
+
+// cube_chars: face under (mx, my), in FaceID numbering (-1 for none).
+int pick_cube_face(int mx, int my, int cube_x, int cube_y, int cube_size,
+                   const float rot[3]);
+
+#endif
@@ -0,0 +1,103 @@
+// ply.c
+#include "ply.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct { const char *name; PlyType type; } ply_types[] = {
+    { "char", PLY_I8 }, { "int8", PLY_I8 }, { "uchar", PLY_U8 }, { "uint8", PLY_U8 },
+    { "short", PLY_I16 }, { "int16", PLY_I16 }, { "ushort", PLY_U16 }, { "uint16", PLY_U16 },
+    { "int", PLY_I32 }, { "int32", PLY_I32 }, { "uint", PLY_U32 }, { "uint32", PLY_U32 },
+    { "float", PLY_F32 }, { "float32", PLY_F32 }, { "double", PLY_F64 }, { "float64", PLY_F64 },
+};
+
+const int ply_size[PLY_BAD] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+static PlyType ply_type(const char *s) {
+    for (size_t i = 0; i < sizeof(ply_types) / sizeof(ply_types[0]); ++i)
+        if (strcmp(s, ply_types[i].name) == 0) return ply_types[i].type;
+    return PLY_BAD;
+}
+
+int ply_parse_header(const char *data, size_t size, PlyHeader *h) {
+    memset(h, 0, sizeof(*h));
+    const char *p = data, *end = data + size;
+    char line[256];
+    PlyElement *cur = NULL;
+
+    while (p < end) {
+        const char *e = memchr(p, '\n', (size_t)(end - p));
+        if (!e) e = end;
+        size_t len = (size_t)(e - p) < sizeof(line) - 1 ? (size_t)(e - p) : sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = 0;
+        if (len && line[len - 1] == '\r') line[len - 1] = 0;
+        p = e + 1;
+
+        char a[32], b[32], c[32], d[32];
+        unsigned long long count;
+        if (strncmp(line, "end_header", 10) == 0) {
+            h->header_size = (size_t)(p - data);
+            return 0;
+        } else if (sscanf(line, "format %31s", a) == 1) {
+            if (strcmp(a, "ascii") == 0) h->format = 0;
+            else if (strcmp(a, "binary_little_endian") == 0) h->format = 1;
+            else if (strcmp(a, "binary_big_endian") == 0) h->format = 2;
+            else return -1;
+        } else if (sscanf(line, "element %31s %llu", a, &count) == 2) {
+            if (h->nelements == PLY_MAX_ELEMENTS) return -1;
+            cur = &h->elements[h->nelements++];
+            snprintf(cur->name, sizeof(cur->name), "%s", a);
+            cur->count = (size_t)count;
+        } else if (sscanf(line, "property list %31s %31s %31s", a, b, c) == 3) {
+            if (!cur || cur->nprops == PLY_MAX_PROPS) return -1;
+            cur->props[cur->nprops].count_type = ply_type(a);
+            cur->props[cur->nprops].type = ply_type(b);
+            snprintf(cur->props[cur->nprops].name, 32, "%s", c);
+            if (cur->props[cur->nprops].type == PLY_BAD || cur->props[cur->nprops].count_type == PLY_BAD) return -1;
+            cur->nprops++;
+        } else if (sscanf(line, "property %31s %31s", a, d) == 2) {
+            if (!cur || cur->nprops == PLY_MAX_PROPS) return -1;
+            cur->props[cur->nprops].type = ply_type(a);
+            cur->props[cur->nprops].count_type = PLY_BAD;
+            snprintf(cur->props[cur->nprops].name, 32, "%s", d);
+            if (cur->props[cur->nprops].type == PLY_BAD) return -1;
+            cur->nprops++;
+        }
+    }
+    return -1;
+}
+
+int ply_swap(const PlyHeader *h) {
+    return h->format != 0 && (h->format == 2) != (*(const unsigned char *)&(uint16_t){ 1 } == 0);
+}
+
+double ply_read(const unsigned char *p, PlyType t, int swap) {
+    unsigned char b[8];
+    int n = ply_size[t];
+    for (int i = 0; i < n; ++i) b[i] = swap ? p[n - 1 - i] : p[i];
+    switch (t) {
+        case PLY_I8:  return (int8_t)b[0];
+        case PLY_U8:  return b[0];
+        case PLY_I16: { int16_t v; memcpy(&v, b, 2); return v; }
+        case PLY_U16: { uint16_t v; memcpy(&v, b, 2); return v; }
+        case PLY_I32: { int32_t v; memcpy(&v, b, 4); return v; }
+        case PLY_U32: { uint32_t v; memcpy(&v, b, 4); return v; }
+        case PLY_F32: { float v; memcpy(&v, b, 4); return v; }
+        case PLY_F64: { double v; memcpy(&v, b, 8); return v; }
+        default: return 0;
+    }
+}
+
+int grow(void **data, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    size_t c = *cap ? *cap * 2 : 64;
+    while (c < need) c *= 2;
+    void *p = realloc(*data, c * elem);
+    if (!p) return -1;
+    *data = p;
+    *cap = c;
+    return 0;
+}
@@ -0,0 +1,51 @@
+// ply.h
+// PLY header and binary value decoding shared by the mesh loader (mesh.c)
+// and the point cloud converter (pointcloud.c). The header is read into a
+// fixed table of elements and their properties; each reader then picks
+// the elements it understands and walks the body itself. Also home to the
+// growable-array helper both readers build their output with.
+#ifndef PLY_H
+#define PLY_H
+
+#include <stddef.h>
+
+typedef enum { PLY_I8, PLY_U8, PLY_I16, PLY_U16, PLY_I32, PLY_U32, PLY_F32, PLY_F64, PLY_BAD } PlyType;
+
+extern const int ply_size[PLY_BAD];    // bytes per value
+
+#define PLY_MAX_PROPS 32
+#define PLY_MAX_ELEMENTS 8
+
+typedef struct {
+    char name[32];
+    size_t count;
+    int nprops;
+    struct {
+        char name[32];
+        PlyType type;
+        PlyType count_type;     // PLY_BAD unless a list
+    } props[PLY_MAX_PROPS];
+} PlyElement;
+
+typedef struct {
+    int format;                 // 0 ascii, 1 binary little endian, 2 binary big endian
+    int nelements;
+    PlyElement elements[PLY_MAX_ELEMENTS];
+    size_t header_size;         // bytes up to and including the end_header line
+} PlyHeader;
+
+// 0 on success; -1 for a missing end_header, an unknown format or type,
+// or more elements or properties than the table holds.
+int ply_parse_header(const char *data, size_t size, PlyHeader *h);
+
+// 1 if the binary body's byte order differs from this machine's
+int ply_swap(const PlyHeader *h);
+
+// Binary value of type t at p
+double ply_read(const unsigned char *p, PlyType t, int swap);
+
+// Grows *data to hold at least `need` elements of `elem` bytes, doubling
+// the capacity. -1 when out of memory, *data is then unchanged.
+int grow(void **data, size_t *cap, size_t need, size_t elem);
+
+#endif
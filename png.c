@@ -0,0 +1,81 @@
+// png.c
+#include "png.h"
+#include "stb_image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+static void put_u32(unsigned char *p, unsigned long v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// length, type, data, CRC over type + data
+static void write_chunk(FILE *f, const char *type, const unsigned char *data, unsigned long len) {
+    unsigned char hdr[8];
+    put_u32(hdr, len);
+    memcpy(hdr + 4, type, 4);
+    fwrite(hdr, 1, 8, f);
+    if (len) fwrite(data, 1, len, f);
+
+    uLong crc = crc32(0L, (const Bytef *)type, 4);
+    if (len) crc = crc32(crc, data, (uInt)len);
+    unsigned char tail[4];
+    put_u32(tail, crc);
+    fwrite(tail, 1, 4, f);
+}
+
+int png_write_rgba(const char *path, int width, int height, const unsigned char *rgba) {
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    size_t row = (size_t)width * 4;
+
+    // Every scanline is prefixed with its filter type (0: none)
+    uLong raw_len = (uLong)((row + 1) * height);
+    unsigned char *raw = malloc(raw_len);
+    uLongf packed_len = compressBound(raw_len);
+    unsigned char *packed = malloc(packed_len);
+    if (!raw || !packed) {
+        free(raw);
+        free(packed);
+        return -1;
+    }
+    for (int y = 0; y < height; ++y) {
+        raw[y * (row + 1)] = 0;
+        memcpy(raw + y * (row + 1) + 1, rgba + y * row, row);
+    }
+    int zerr = compress2(packed, &packed_len, raw, raw_len, 9);
+    free(raw);
+    if (zerr != Z_OK) {
+        free(packed);
+        return -1;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        free(packed);
+        return -1;
+    }
+    unsigned char ihdr[13];
+    put_u32(ihdr, width);
+    put_u32(ihdr + 4, height);
+    ihdr[8] = 8;    // bit depth
+    ihdr[9] = 6;    // RGBA
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+    fwrite(signature, 1, 8, f);
+    write_chunk(f, "IHDR", ihdr, 13);
+    write_chunk(f, "IDAT", packed, packed_len);
+    write_chunk(f, "IEND", NULL, 0);
+    free(packed);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+unsigned char *png_read_rgba(const char *path, int *width, int *height) {
+    int channels;
+    return stbi_load(path, width, height, &channels, 4);
+}
@@ -0,0 +1,12 @@
+// png.h
+// Minimal PNG I/O for the offscreen tools: 8-bit RGBA, rows top first.
+// Writing uses zlib; reading goes through stb_image.
+#ifndef PNG_H
+#define PNG_H
+
+int png_write_rgba(const char *path, int width, int height, const unsigned char *rgba);  // 0 on success
+
+// Returns a malloc'd RGBA buffer (free with free()), or NULL.
+unsigned char *png_read_rgba(const char *path, int *width, int *height);
+
+#endif
@@ -0,0 +1,1010 @@
+// pointcloud.c
+#include "pointcloud.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parallel.h"
+#include "ply.h"
+
+static const char cloud_magic[8] = "VCPTS";
+
+#define ALIGN64(x) (((x) + 63) & ~(uint64_t)63)
+#define SCAN_BATCH 65536            // points per sink call
+#define STAGE_POINTS (1u << 20)     // distribution buffer
+#define SAMPLE_GRID 128             // finest subsampling grid per node
+#define COPY_POINTS (POINTCLOUD_NODE_POINTS / 4)  // kept for the parent's sample
+
+int pointcloud_path(const char *source, char *out, size_t n) {
+    int r = snprintf(out, n, "%s.vcpts", source);
+    return r < 0 || (size_t)r >= n ? -1 : 0;
+}
+
+static int has_ext(const char *path, const char *ext) {
+    size_t n = strlen(path), e = strlen(ext);
+    return n >= e && strcasecmp(path + n - e, ext) == 0;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int write_all(int fd, const void *data, size_t n, uint64_t offset) {
+    const char *p = data;
+    while (n) {
+        ssize_t w = pwrite(fd, p, n, (off_t)offset);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return -1;
+        p += w;
+        n -= (size_t)w;
+        offset += (uint64_t)w;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *data, size_t n, uint64_t offset) {
+    char *p = data;
+    while (n) {
+        ssize_t r = pread(fd, p, n, (off_t)offset);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        n -= (size_t)r;
+        offset += (uint64_t)r;
+    }
+    return 0;
+}
+
+// --- Sources ---
+// Each format is scanned front to back in batches of double positions and
+// rgba, straight from a read-only mapping that the kernel can page out.
+
+typedef enum { SRC_LAS, SRC_PLY, SRC_XYZ } SourceFormat;
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    SourceFormat format;
+    const char *name;
+    uint64_t count;             // LAS and PLY; XYZ counts as it goes
+    int has_bounds, has_color;
+    double bmin[3], bmax[3];
+
+    // LAS
+    size_t first, stride;
+    double scale[3], offset[3];
+    int color_at, color_shift;
+
+    // PLY
+    int ascii, swap;
+    size_t body, record;
+    int prop_count;
+    PlyType prop_type[PLY_MAX_PROPS];
+    int prop_at[PLY_MAX_PROPS];
+    int xyz_prop[3], rgb_prop[3];
+} Source;
+
+typedef void (*PointSink)(void *ctx, const double *xyz, const uint8_t *rgba, size_t n);
+
+static uint16_t le16(const unsigned char *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t le32(const unsigned char *p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint64_t le64(const unsigned char *p) { return le32(p) | (uint64_t)le32(p + 4) << 32; }
+static double led(const unsigned char *p) {
+    uint64_t u = le64(p);
+    double d;
+    memcpy(&d, &u, 8);
+    return d;
+}
+
+static int open_las(Source *s) {
+    const unsigned char *d = s->data;
+    if (s->size < 227 || memcmp(d, "LASF", 4) != 0) {
+        fprintf(stderr, "%s: not a LAS file\n", s->name);
+        return -1;
+    }
+    int minor = d[25], format = d[104];
+    if (format & 0xc0) {
+        fprintf(stderr, "%s: compressed (LAZ) point data is not supported\n", s->name);
+        return -1;
+    }
+    s->first = le32(d + 96);
+    s->stride = le16(d + 105);
+    s->count = le32(d + 107);
+    if (s->count == 0 && minor >= 4 && s->size >= 255) s->count = le64(d + 247);
+    for (int a = 0; a < 3; ++a) {
+        s->scale[a] = led(d + 131 + 8 * a);
+        s->offset[a] = led(d + 155 + 8 * a);
+        s->bmax[a] = led(d + 179 + 16 * a);
+        s->bmin[a] = led(d + 187 + 16 * a);
+    }
+    s->has_bounds = s->bmin[0] <= s->bmax[0] && s->bmin[1] <= s->bmax[1] && s->bmin[2] <= s->bmax[2];
+    static const int color_offset[11] = { -1, -1, 20, 28, -1, 28, -1, 30, 30, -1, 30 };
+    s->color_at = format <= 10 ? color_offset[format] : -1;
+    if (s->stride < 12 || s->first > s->size || (s->size - s->first) / s->stride < s->count ||
+        (s->color_at >= 0 && (size_t)s->color_at + 6 > s->stride)) {
+        fprintf(stderr, "%s: truncated or inconsistent LAS header\n", s->name);
+        return -1;
+    }
+    // Colours are 16-bit by the spec, but plenty of writers store 8-bit values
+    s->has_color = s->color_at >= 0;
+    s->color_shift = 0;
+    for (uint64_t i = 0; s->has_color && i < s->count && i < 65536; ++i) {
+        const unsigned char *c = d + s->first + i * s->stride + s->color_at;
+        if (le16(c) > 255 || le16(c + 2) > 255 || le16(c + 4) > 255) {
+            s->color_shift = 8;
+            break;
+        }
+    }
+    return 0;
+}
+
+static int open_ply(Source *s) {
+    PlyHeader h;
+    if (s->size < 4 || memcmp(s->data, "ply", 3) != 0) {
+        fprintf(stderr, "%s: not a PLY file\n", s->name);
+        return -1;
+    }
+    if (ply_parse_header((const char *)s->data, s->size, &h) != 0) {
+        fprintf(stderr, "%s: unsupported or malformed PLY header\n", s->name);
+        return -1;
+    }
+    if (h.nelements == 0 || strcmp(h.elements[0].name, "vertex") != 0) {
+        fprintf(stderr, "%s: the first PLY element must be vertex\n", s->name);
+        return -1;
+    }
+    const PlyElement *el = &h.elements[0];
+    int at = 0;
+    s->ascii = h.format == 0;
+    s->swap = ply_swap(&h);
+    s->body = h.header_size;
+    s->count = el->count;
+    s->prop_count = el->nprops;
+    for (int i = 0; i < 3; ++i) s->xyz_prop[i] = s->rgb_prop[i] = -1;
+    for (int i = 0; i < el->nprops; ++i) {
+        if (el->props[i].count_type != PLY_BAD) {
+            fprintf(stderr, "%s: list properties on PLY vertices are not supported\n", s->name);
+            return -1;
+        }
+        s->prop_type[i] = el->props[i].type;
+        s->prop_at[i] = at;
+        at += ply_size[el->props[i].type];
+        static const char *names[6] = { "x", "y", "z", "red", "green", "blue" };
+        for (int q = 0; q < 6; ++q)
+            if (strcmp(el->props[i].name, names[q]) == 0) {
+                if (q < 3) s->xyz_prop[q] = i;
+                else s->rgb_prop[q - 3] = i;
+            }
+    }
+    s->record = (size_t)at;
+    if (s->xyz_prop[0] < 0 || s->xyz_prop[1] < 0 || s->xyz_prop[2] < 0) {
+        fprintf(stderr, "%s: PLY vertices without x/y/z\n", s->name);
+        return -1;
+    }
+    if (!s->ascii && (s->size - s->body) / s->record < s->count) {
+        fprintf(stderr, "%s: truncated PLY vertex data\n", s->name);
+        return -1;
+    }
+    s->has_color = s->rgb_prop[0] >= 0 && s->rgb_prop[1] >= 0 && s->rgb_prop[2] >= 0;
+    return 0;
+}
+
+// Colour channel in the property's own range to 0..255
+static uint8_t to_byte(double v, PlyType t) {
+    if (t == PLY_F32 || t == PLY_F64) v *= 255;
+    else if (t == PLY_U16 || t == PLY_I16) v /= 257;
+    return v <= 0 ? 0 : v >= 255 ? 255 : (uint8_t)(v + 0.5);
+}
+
+// Next number on the line, or NULL at the end of the line or on text
+static const char *next_number(const char *p, const char *end, double *out) {
+    char buf[64];
+    size_t n = 0;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == ',' || *p == ';' || *p == '\r')) ++p;
+    if (p >= end || *p == '\n') return NULL;
+    const char *start = p;
+    while (p < end && !isspace((unsigned char)*p) && *p != ',' && *p != ';') {
+        if (n < sizeof(buf) - 1) buf[n++] = *p;
+        ++p;
+    }
+    buf[n] = 0;
+    char *e;
+    *out = strtod(buf, &e);
+    return e == buf || p == start ? NULL : p;
+}
+
+static const char *next_line(const char *p, const char *end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    return nl ? nl + 1 : end;
+}
+
+// Drops the mapped pages before `upto` once a batch is through, so a scan
+// holds on to no more of the file than the batch it is in
+static void release(const Source *s, size_t upto, size_t *released) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    upto -= upto % page;
+    if (upto <= *released) return;
+    madvise((void *)(s->data + *released), upto - *released, MADV_DONTNEED);
+    *released = upto;
+}
+
+static int scan(Source *s, PointSink sink, void *ctx) {
+    double *xyz = malloc(sizeof(double) * 3 * SCAN_BATCH);
+    uint8_t *rgba = malloc(4 * SCAN_BATCH);
+    if (!xyz || !rgba) {
+        free(xyz);
+        free(rgba);
+        fprintf(stderr, "out of memory reading %s\n", s->name);
+        return -1;
+    }
+    size_t n = 0, released = 0;
+    uint64_t total = 0;
+// Non-finite positions are dropped
+#define EMIT(pos)                                                                       \
+    do {                                                                                \
+        if (isfinite(xyz[3 * n]) && isfinite(xyz[3 * n + 1]) && isfinite(xyz[3 * n + 2])) { \
+            ++total;                                                                    \
+            if (++n == SCAN_BATCH) {                                                    \
+                sink(ctx, xyz, rgba, n);                                                \
+                n = 0;                                                                  \
+                release(s, (pos), &released);                                           \
+            }                                                                           \
+        }                                                                               \
+    } while (0)
+
+    if (s->format == SRC_LAS) {
+        for (uint64_t i = 0; i < s->count; ++i) {
+            const unsigned char *r = s->data + s->first + i * s->stride;
+            for (int a = 0; a < 3; ++a) xyz[3 * n + a] = (int32_t)le32(r + 4 * a) * s->scale[a] + s->offset[a];
+            for (int a = 0; a < 3; ++a)
+                rgba[4 * n + a] = s->has_color ? (uint8_t)(le16(r + s->color_at + 2 * a) >> s->color_shift) : 255;
+            rgba[4 * n + 3] = 255;
+            EMIT((size_t)(r - s->data));
+        }
+    } else if (s->format == SRC_PLY && !s->ascii) {
+        for (uint64_t i = 0; i < s->count; ++i) {
+            const unsigned char *r = s->data + s->body + i * s->record;
+            for (int a = 0; a < 3; ++a) {
+                int q = s->xyz_prop[a];
+                xyz[3 * n + a] = ply_read(r + s->prop_at[q], s->prop_type[q], s->swap);
+                q = s->rgb_prop[a];
+                rgba[4 * n + a] = s->has_color ? to_byte(ply_read(r + s->prop_at[q], s->prop_type[q], s->swap),
+                                                         s->prop_type[q]) : 255;
+            }
+            rgba[4 * n + 3] = 255;
+            EMIT((size_t)(r - s->data));
+        }
+    } else {
+        // ASCII PLY: one vertex per line. XYZ: "x y z", optionally followed by
+        // "r g b" (0..255) or "intensity r g b"; lines that do not start with
+        // three numbers are skipped.
+        const char *p = (const char *)s->data + (s->format == SRC_PLY ? s->body : 0);
+        const char *end = (const char *)s->data + s->size;
+        uint64_t lines = 0;
+        while (p < end && (s->format == SRC_XYZ || lines < s->count)) {
+            const char *q = p;
+            double v[PLY_MAX_PROPS];
+            int k = 0;
+            while (k < PLY_MAX_PROPS && (q = next_number(q, end, &v[k])) != NULL) ++k;
+            p = next_line(p, end);
+            if (s->format == SRC_PLY) {
+                if (k < s->prop_count) continue;
+                ++lines;
+                for (int a = 0; a < 3; ++a) {
+                    xyz[3 * n + a] = v[s->xyz_prop[a]];
+                    rgba[4 * n + a] = s->has_color ? to_byte(v[s->rgb_prop[a]], s->prop_type[s->rgb_prop[a]]) : 255;
+                }
+            } else {
+                if (k < 3) continue;
+                int c = k >= 7 ? 4 : k >= 6 ? 3 : -1;
+                if (c >= 0) s->has_color = 1;
+                for (int a = 0; a < 3; ++a) {
+                    xyz[3 * n + a] = v[a];
+                    rgba[4 * n + a] = c >= 0 ? to_byte(v[c + a], PLY_U8) : 255;
+                }
+            }
+            rgba[4 * n + 3] = 255;
+            EMIT((size_t)(p - (const char *)s->data));
+        }
+    }
+#undef EMIT
+    if (n) sink(ctx, xyz, rgba, n);
+    s->count = total;
+    free(xyz);
+    free(rgba);
+    return 0;
+}
+
+static void bounds_sink(void *ctx, const double *xyz, const uint8_t *rgba, size_t n) {
+    Source *s = ctx;
+    (void)rgba;
+    for (size_t i = 0; i < n; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            double v = xyz[3 * i + a];
+            if (v < s->bmin[a]) s->bmin[a] = v;
+            if (v > s->bmax[a]) s->bmax[a] = v;
+        }
+    }
+}
+
+// --- Conversion ---
+
+typedef struct {
+    uint32_t node;              // its root in the node table
+    uint64_t first, count;      // records in the temporary file
+    uint64_t written;
+} Chunk;
+
+typedef struct {
+    Source src;
+    double origin[3];
+    float half, cell_scale;     // root cube half size; grid cells per unit
+
+    uint64_t *counts[POINTCLOUD_GRID_LEVELS + 1];   // pyramid, level l is (2^l)^3
+    uint32_t *cell_chunk;       // finest cell -> chunk
+
+    PointNode *nodes;
+    size_t node_count, node_cap;
+    Chunk *chunks;
+    size_t chunk_count, chunk_cap;
+    uint32_t *upper;            // nodes above the chunks, parents first
+    size_t upper_count, upper_cap;
+
+    int tmp_fd, out_fd;
+    PointRecord *stage;
+    uint32_t *stage_chunk, *stage_offsets;
+    PointRecord *stage_sorted;
+    size_t staged;
+    uint64_t cursor, records;
+    float bmin[3], bmax[3];
+    int failed;
+} Convert;
+
+static int push_node(Convert *cv, const float center[3], float half, uint32_t level) {
+    if (grow((void **)&cv->nodes, &cv->node_cap, cv->node_count + 1, sizeof(PointNode)) != 0) return -1;
+    PointNode *n = &cv->nodes[cv->node_count];
+    memset(n, 0, sizeof(*n));
+    memcpy(n->center, center, sizeof(n->center));
+    n->half = half;
+    n->level = level;
+    for (int o = 0; o < 8; ++o) n->child[o] = -1;
+    return (int)cv->node_count++;
+}
+
+static void relative(const Convert *cv, const double *xyz, float out[3]) {
+    for (int a = 0; a < 3; ++a) out[a] = (float)(xyz[a] - cv->origin[a]);
+}
+
+static uint32_t grid_cell(const Convert *cv, const float p[3]) {
+    int c[3];
+    for (int a = 0; a < 3; ++a) {
+        c[a] = (int)((p[a] + cv->half) * cv->cell_scale);
+        if (c[a] < 0) c[a] = 0;
+        if (c[a] >= POINTCLOUD_GRID) c[a] = POINTCLOUD_GRID - 1;
+    }
+    return ((uint32_t)c[2] * POINTCLOUD_GRID + (uint32_t)c[1]) * POINTCLOUD_GRID + (uint32_t)c[0];
+}
+
+static void count_sink(void *ctx, const double *xyz, const uint8_t *rgba, size_t n) {
+    Convert *cv = ctx;
+    uint64_t *cells = cv->counts[POINTCLOUD_GRID_LEVELS];
+    (void)rgba;
+    for (size_t i = 0; i < n; ++i) {
+        float p[3];
+        relative(cv, xyz + 3 * i, p);
+        for (int a = 0; a < 3; ++a) {
+            if (p[a] < cv->bmin[a]) cv->bmin[a] = p[a];
+            if (p[a] > cv->bmax[a]) cv->bmax[a] = p[a];
+        }
+        cells[grid_cell(cv, p)]++;
+    }
+}
+
+// Cuts the octree top-down at the first level where a cube holds at most
+// POINTCLOUD_CHUNK_POINTS points (or at the grid's cells)
+static int cut(Convert *cv, int level, int ix, int iy, int iz) {
+    int side = 1 << level;
+    uint64_t n = cv->counts[level][((size_t)iz * side + iy) * side + ix];
+    float size = 2 * cv->half / side;
+    float center[3] = { -cv->half + (ix + 0.5f) * size, -cv->half + (iy + 0.5f) * size, -cv->half + (iz + 0.5f) * size };
+    int node = push_node(cv, center, 0.5f * size, (uint32_t)level);
+    if (node < 0) return -1;
+    if (n <= POINTCLOUD_CHUNK_POINTS || level == POINTCLOUD_GRID_LEVELS) {
+        if (grow((void **)&cv->chunks, &cv->chunk_cap, cv->chunk_count + 1, sizeof(Chunk)) != 0) return -1;
+        uint32_t id = (uint32_t)cv->chunk_count++;
+        Chunk *c = &cv->chunks[id];
+        c->node = (uint32_t)node;
+        c->count = n;
+        c->written = 0;
+        int span = POINTCLOUD_GRID >> level;
+        for (int z = iz * span; z < (iz + 1) * span; ++z)
+            for (int y = iy * span; y < (iy + 1) * span; ++y)
+                for (int x = ix * span; x < (ix + 1) * span; ++x)
+                    cv->cell_chunk[((size_t)z * POINTCLOUD_GRID + y) * POINTCLOUD_GRID + x] = id;
+        return node;
+    }
+    if (grow((void **)&cv->upper, &cv->upper_cap, cv->upper_count + 1, sizeof(uint32_t)) != 0) return -1;
+    cv->upper[cv->upper_count++] = (uint32_t)node;
+    int cside = side * 2;
+    for (int o = 0; o < 8; ++o) {
+        int cx = 2 * ix + (o & 1), cy = 2 * iy + (o >> 1 & 1), cz = 2 * iz + (o >> 2 & 1);
+        if (!cv->counts[level + 1][((size_t)cz * cside + cy) * cside + cx]) continue;
+        int child = cut(cv, level + 1, cx, cy, cz);
+        if (child < 0) return -1;
+        cv->nodes[node].child[o] = child;
+    }
+    return node;
+}
+
+// Sorts the staged points by chunk and appends each run to its chunk
+static int flush_stage(Convert *cv) {
+    uint32_t *off = cv->stage_offsets;
+    memset(off, 0, sizeof(uint32_t) * (cv->chunk_count + 1));
+    for (size_t i = 0; i < cv->staged; ++i) off[cv->stage_chunk[i] + 1]++;
+    for (size_t c = 0; c < cv->chunk_count; ++c) off[c + 1] += off[c];
+    for (size_t i = 0; i < cv->staged; ++i) cv->stage_sorted[off[cv->stage_chunk[i]]++] = cv->stage[i];
+    size_t begin = 0;
+    for (size_t c = 0; c < cv->chunk_count; ++c) {
+        size_t end = off[c];
+        if (end == begin) continue;
+        Chunk *ch = &cv->chunks[c];
+        if (ch->written + (end - begin) > ch->count ||
+            write_all(cv->tmp_fd, cv->stage_sorted + begin, sizeof(PointRecord) * (end - begin),
+                      sizeof(PointRecord) * (ch->first + ch->written)) != 0)
+            return -1;
+        ch->written += end - begin;
+        begin = end;
+    }
+    cv->staged = 0;
+    return 0;
+}
+
+static void distribute_sink(void *ctx, const double *xyz, const uint8_t *rgba, size_t n) {
+    Convert *cv = ctx;
+    for (size_t i = 0; i < n && !cv->failed; ++i) {
+        PointRecord *r = &cv->stage[cv->staged];
+        relative(cv, xyz + 3 * i, r->xyz);
+        memcpy(r->rgba, rgba + 4 * i, 4);
+        cv->stage_chunk[cv->staged] = cv->cell_chunk[grid_cell(cv, r->xyz)];
+        if (++cv->staged == STAGE_POINTS && flush_stage(cv) != 0) cv->failed = 1;
+    }
+}
+
+// Moves a grid subsample of p (first point per cell, at most max_keep) to
+// the front, keeping order, and returns its size. The grid is as fine as
+// SAMPLE_GRID allows while staying under max_keep.
+static size_t grid_sample(PointRecord *p, PointRecord *tmp, size_t n, const float c[3], float half,
+                          size_t max_keep, unsigned char *bits) {
+    if (n <= max_keep) return n;
+    int side = SAMPLE_GRID;
+    size_t kept;
+    for (;;) {
+        float scale = side / (2 * half);
+        memset(bits, 0, ((size_t)side * side * side + 7) / 8);
+        kept = 0;
+        for (size_t i = 0; i < n; ++i) {
+            int g[3];
+            for (int a = 0; a < 3; ++a) {
+                g[a] = (int)((p[i].xyz[a] - c[a] + half) * scale);
+                if (g[a] < 0) g[a] = 0;
+                if (g[a] >= side) g[a] = side - 1;
+            }
+            size_t cell = ((size_t)g[2] * side + g[1]) * side + g[0];
+            if (bits[cell >> 3] & (1u << (cell & 7))) continue;
+            bits[cell >> 3] |= (unsigned char)(1u << (cell & 7));
+            tmp[kept++] = p[i];
+        }
+        if (kept <= max_keep || side == 1) break;
+        side /= 2;
+    }
+    // tmp holds the kept points; the pass is repeated to append the rest
+    float scale = side / (2 * half);
+    memset(bits, 0, ((size_t)side * side * side + 7) / 8);
+    size_t rest = kept;
+    for (size_t i = 0; i < n; ++i) {
+        int g[3];
+        for (int a = 0; a < 3; ++a) {
+            g[a] = (int)((p[i].xyz[a] - c[a] + half) * scale);
+            if (g[a] < 0) g[a] = 0;
+            if (g[a] >= side) g[a] = side - 1;
+        }
+        size_t cell = ((size_t)g[2] * side + g[1]) * side + g[0];
+        if (bits[cell >> 3] & (1u << (cell & 7))) {
+            tmp[rest++] = p[i];
+            continue;
+        }
+        bits[cell >> 3] |= (unsigned char)(1u << (cell & 7));
+    }
+    memcpy(p, tmp, sizeof(PointRecord) * n);
+    return kept;
+}
+
+typedef struct {
+    PointRecord *points, *tmp;
+    size_t count;
+    PointNode *nodes;           // local: offsets are record indices, children local
+    size_t node_count, node_cap;
+    PointRecord *copy;          // the root's sample for its parent
+    size_t copy_count;
+    unsigned char *bits;
+    int failed;
+} ChunkBuild;
+
+static int split(ChunkBuild *b, size_t begin, size_t n, const float c[3], float half, uint32_t level) {
+    if (grow((void **)&b->nodes, &b->node_cap, b->node_count + 1, sizeof(PointNode)) != 0) return -1;
+    int id = (int)b->node_count++;
+    PointNode *node = &b->nodes[id];
+    memset(node, 0, sizeof(*node));
+    memcpy(node->center, c, sizeof(node->center));
+    node->half = half;
+    node->level = level;
+    node->offset = begin;
+    for (int o = 0; o < 8; ++o) node->child[o] = -1;
+    PointRecord *p = b->points + begin;
+    size_t kept = level >= POINTCLOUD_MAX_DEPTH ? n
+                : grid_sample(p, b->tmp, n, c, half, POINTCLOUD_NODE_POINTS, b->bits);
+    b->nodes[id].count = (uint32_t)kept;
+    if (kept == n) return id;
+
+    // The rest goes to the octants, counting sort through tmp
+    size_t start[9] = { 0 };
+    for (size_t i = kept; i < n; ++i) {
+        int o = (p[i].xyz[0] >= c[0]) | (p[i].xyz[1] >= c[1]) << 1 | (p[i].xyz[2] >= c[2]) << 2;
+        start[o + 1]++;
+    }
+    for (int o = 0; o < 8; ++o) start[o + 1] += start[o];
+    size_t fill[8];
+    memcpy(fill, start, sizeof(fill));
+    for (size_t i = kept; i < n; ++i) {
+        int o = (p[i].xyz[0] >= c[0]) | (p[i].xyz[1] >= c[1]) << 1 | (p[i].xyz[2] >= c[2]) << 2;
+        b->tmp[fill[o]++] = p[i];
+    }
+    memcpy(p + kept, b->tmp, sizeof(PointRecord) * (n - kept));
+    for (int o = 0; o < 8; ++o) {
+        size_t m = start[o + 1] - start[o];
+        if (!m) continue;
+        float q = 0.5f * half;
+        float cc[3] = { c[0] + (o & 1 ? q : -q), c[1] + (o & 2 ? q : -q), c[2] + (o & 4 ? q : -q) };
+        int child = split(b, begin + kept + start[o], m, cc, q, level + 1);
+        if (child < 0) return -1;
+        b->nodes[id].child[o] = child;
+    }
+    return id;
+}
+
+// Keeps a subsample of count records (in tmp) as the parent's share
+static int keep_copy(PointRecord **copy, size_t *copy_count, const PointRecord *p, size_t count,
+                     PointRecord *tmp, const PointNode *n, unsigned char *bits) {
+    PointRecord *work = malloc(sizeof(PointRecord) * (count ? count : 1));
+    if (!work) return -1;
+    memcpy(work, p, sizeof(PointRecord) * count);
+    size_t kept = grid_sample(work, tmp, count, n->center, n->half, COPY_POINTS, bits);
+    *copy = realloc(work, sizeof(PointRecord) * (kept ? kept : 1));
+    if (!*copy) *copy = work;
+    *copy_count = kept;
+    return 0;
+}
+
+typedef struct {
+    Convert *cv;
+    ChunkBuild *builds;
+    size_t first;
+} BuildJob;
+
+static void build_range(void *ctx, size_t begin, size_t end) {
+    BuildJob *j = ctx;
+    for (size_t i = begin; i < end; ++i) {
+        ChunkBuild *b = &j->builds[i];
+        const Chunk *ch = &j->cv->chunks[j->first + i];
+        const PointNode *root = &j->cv->nodes[ch->node];
+        memset(b, 0, sizeof(*b));
+        b->count = ch->count;
+        b->points = malloc(sizeof(PointRecord) * b->count);
+        b->tmp = malloc(sizeof(PointRecord) * b->count);
+        b->bits = malloc(((size_t)SAMPLE_GRID * SAMPLE_GRID * SAMPLE_GRID + 7) / 8);
+        if (!b->points || !b->tmp || !b->bits ||
+            read_all(j->cv->tmp_fd, b->points, sizeof(PointRecord) * b->count,
+                     sizeof(PointRecord) * ch->first) != 0 ||
+            split(b, 0, b->count, root->center, root->half, root->level) < 0 ||
+            keep_copy(&b->copy, &b->copy_count, b->points, b->nodes[0].count, b->tmp, &b->nodes[0], b->bits) != 0)
+            b->failed = 1;
+        free(b->tmp);
+        free(b->bits);
+        b->tmp = NULL;
+        b->bits = NULL;
+    }
+}
+
+static int append_records(Convert *cv, const PointRecord *p, size_t n, uint64_t *offset) {
+    *offset = cv->cursor;
+    if (write_all(cv->out_fd, p, sizeof(PointRecord) * n, cv->cursor) != 0) return -1;
+    cv->cursor += sizeof(PointRecord) * n;
+    cv->records += n;
+    return 0;
+}
+
+// Writes a built chunk and links its nodes into the table
+static int merge_chunk(Convert *cv, const Chunk *ch, ChunkBuild *b) {
+    uint64_t base;
+    if (append_records(cv, b->points, b->count, &base) != 0) return -1;
+    size_t first = cv->node_count;
+    if (grow((void **)&cv->nodes, &cv->node_cap, cv->node_count + b->node_count - 1, sizeof(PointNode)) != 0)
+        return -1;
+    cv->node_count += b->node_count - 1;
+    for (size_t k = 0; k < b->node_count; ++k) {
+        PointNode n = b->nodes[k];
+        n.offset = base + n.offset * sizeof(PointRecord);
+        for (int o = 0; o < 8; ++o)
+            if (n.child[o] >= 0) n.child[o] = (int32_t)(first + n.child[o] - 1);
+        cv->nodes[k ? first + k - 1 : ch->node] = n;
+    }
+    return 0;
+}
+
+static int write_tree(Convert *cv) {
+    int threads = parallel_threads();
+    ChunkBuild *builds = calloc((size_t)threads, sizeof(ChunkBuild));
+    PointRecord **copy = calloc(cv->node_count, sizeof(PointRecord *));
+    size_t *copy_count = calloc(cv->node_count, sizeof(size_t)), table_nodes = cv->node_count;
+    unsigned char *bits = malloc(((size_t)SAMPLE_GRID * SAMPLE_GRID * SAMPLE_GRID + 7) / 8);
+    int r = -1;
+    if (!builds || !copy || !copy_count || !bits) goto done;
+
+    // Chunks, a batch of one per thread at a time, written in order
+    for (size_t first = 0; first < cv->chunk_count; first += (size_t)threads) {
+        size_t n = cv->chunk_count - first < (size_t)threads ? cv->chunk_count - first : (size_t)threads;
+        BuildJob job = { cv, builds, first };
+        parallel_for(n, 1, build_range, &job);
+        int failed = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const Chunk *ch = &cv->chunks[first + i];
+            if (!failed && (builds[i].failed || merge_chunk(cv, ch, &builds[i]) != 0)) failed = 1;
+            if (!failed) {
+                copy[ch->node] = builds[i].copy;
+                copy_count[ch->node] = builds[i].copy_count;
+            } else {
+                free(builds[i].copy);
+            }
+            free(builds[i].points);
+            free(builds[i].nodes);
+        }
+        if (failed) goto done;
+    }
+
+    // Upper nodes, children first, from their children's copies
+    for (size_t u = cv->upper_count; u-- > 0;) {
+        uint32_t id = cv->upper[u];
+        size_t total = 0;
+        for (int o = 0; o < 8; ++o)
+            if (cv->nodes[id].child[o] >= 0) total += copy_count[cv->nodes[id].child[o]];
+        PointRecord *p = malloc(sizeof(PointRecord) * (total ? total : 1));
+        PointRecord *tmp = malloc(sizeof(PointRecord) * (total ? total : 1));
+        if (!p || !tmp) {
+            free(p);
+            free(tmp);
+            goto done;
+        }
+        size_t at = 0;
+        for (int o = 0; o < 8; ++o) {
+            int c = cv->nodes[id].child[o];
+            if (c < 0) continue;
+            memcpy(p + at, copy[c], sizeof(PointRecord) * copy_count[c]);
+            at += copy_count[c];
+            free(copy[c]);
+            copy[c] = NULL;
+        }
+        PointNode *n = &cv->nodes[id];
+        size_t kept = grid_sample(p, tmp, total, n->center, n->half, POINTCLOUD_NODE_POINTS, bits);
+        n->count = (uint32_t)kept;
+        int failed = append_records(cv, p, kept, &n->offset) != 0 ||
+                     keep_copy(&copy[id], &copy_count[id], p, kept, tmp, n, bits) != 0;
+        free(p);
+        free(tmp);
+        if (failed) goto done;
+    }
+    r = 0;
+done:
+    if (r != 0) fprintf(stderr, "%s: out of memory or write error building the octree\n", cv->src.name);
+    if (copy)
+        for (size_t i = 0; i < table_nodes; ++i) free(copy[i]);
+    free(copy);
+    free(copy_count);
+    free(builds);
+    free(bits);
+    return r;
+}
+
+static int map_source(const char *path, Source *s, struct stat *st) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, st) != 0 || st->st_size == 0) {
+        fprintf(stderr, "%s: cannot open or empty\n", path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap failed\n", path);
+        return -1;
+    }
+    madvise(map, (size_t)st->st_size, MADV_SEQUENTIAL);
+    s->data = map;
+    s->size = (size_t)st->st_size;
+    s->name = path;
+    return 0;
+}
+
+int pointcloud_convert(const char *source, PointCloudStats *stats) {
+    double t0 = now_seconds();
+    char out_path[4096], part_path[4096 + 8];
+    if (pointcloud_path(source, out_path, sizeof(out_path)) != 0) {
+        fprintf(stderr, "%s: path too long\n", source);
+        return -1;
+    }
+    snprintf(part_path, sizeof(part_path), "%s.part", out_path);
+
+    Convert *cv = calloc(1, sizeof(Convert));
+    struct stat st;
+    if (!cv) return -1;
+    cv->tmp_fd = cv->out_fd = -1;
+    Source *s = &cv->src;
+    int r = -1;
+    const char *format = NULL;
+    if (map_source(source, s, &st) != 0) goto done;
+    if (has_ext(source, ".las")) {
+        s->format = SRC_LAS;
+        format = "las";
+        if (open_las(s) != 0) goto done;
+    } else if (has_ext(source, ".ply")) {
+        s->format = SRC_PLY;
+        format = "ply";
+        if (open_ply(s) != 0) goto done;
+    } else if (has_ext(source, ".xyz") || has_ext(source, ".txt") || has_ext(source, ".pts")) {
+        s->format = SRC_XYZ;
+        format = "xyz";
+    } else {
+        fprintf(stderr, "%s: unknown point cloud format (expected .las, .ply or .xyz)\n", source);
+        goto done;
+    }
+
+    // Pass 1: bounds, and the root cube around them
+    if (!s->has_bounds) {
+        for (int a = 0; a < 3; ++a) {
+            s->bmin[a] = INFINITY;
+            s->bmax[a] = -INFINITY;
+        }
+        if (scan(s, bounds_sink, s) != 0) goto done;
+    }
+    if (s->count == 0 || !(s->bmin[0] <= s->bmax[0])) {
+        fprintf(stderr, "%s: no points\n", source);
+        goto done;
+    }
+    double side = 0;
+    for (int a = 0; a < 3; ++a) {
+        cv->origin[a] = 0.5 * (s->bmin[a] + s->bmax[a]);
+        if (s->bmax[a] - s->bmin[a] > side) side = s->bmax[a] - s->bmin[a];
+    }
+    cv->half = (float)(0.5 * side * (1 + 1e-6)) + 1e-6f;
+    cv->cell_scale = POINTCLOUD_GRID / (2 * cv->half);
+
+    // Pass 2: counts, and the chunks cut from them
+    for (int l = 0; l <= POINTCLOUD_GRID_LEVELS; ++l) {
+        cv->counts[l] = calloc((size_t)1 << (3 * l), sizeof(uint64_t));
+        if (!cv->counts[l]) goto oom;
+    }
+    cv->cell_chunk = malloc(sizeof(uint32_t) * POINTCLOUD_GRID * POINTCLOUD_GRID * POINTCLOUD_GRID);
+    if (!cv->cell_chunk) goto oom;
+    for (int a = 0; a < 3; ++a) {
+        cv->bmin[a] = INFINITY;
+        cv->bmax[a] = -INFINITY;
+    }
+    if (scan(s, count_sink, cv) != 0) goto done;
+    for (int l = POINTCLOUD_GRID_LEVELS; l > 0; --l) {
+        int side_c = 1 << l, side_p = side_c / 2;
+        for (int z = 0; z < side_c; ++z)
+            for (int y = 0; y < side_c; ++y)
+                for (int x = 0; x < side_c; ++x)
+                    cv->counts[l - 1][((size_t)(z / 2) * side_p + y / 2) * side_p + x / 2] +=
+                        cv->counts[l][((size_t)z * side_c + y) * side_c + x];
+    }
+    if (cut(cv, 0, 0, 0, 0) != 0) goto oom;    // the root is node 0
+    uint64_t first = 0;
+    for (size_t c = 0; c < cv->chunk_count; ++c) {
+        cv->chunks[c].first = first;
+        first += cv->chunks[c].count;
+    }
+    for (int l = 0; l <= POINTCLOUD_GRID_LEVELS; ++l) {
+        free(cv->counts[l]);
+        cv->counts[l] = NULL;
+    }
+
+    // Pass 3: points into the temporary file, grouped by chunk
+    cv->tmp_fd = open(part_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (cv->tmp_fd < 0) {
+        fprintf(stderr, "%s: cannot create\n", part_path);
+        goto done;
+    }
+    unlink(part_path);      // anonymous from here on; the space goes with the descriptor
+    cv->stage = malloc(sizeof(PointRecord) * STAGE_POINTS);
+    cv->stage_sorted = malloc(sizeof(PointRecord) * STAGE_POINTS);
+    cv->stage_chunk = malloc(sizeof(uint32_t) * STAGE_POINTS);
+    cv->stage_offsets = malloc(sizeof(uint32_t) * (cv->chunk_count + 1));
+    if (!cv->stage || !cv->stage_sorted || !cv->stage_chunk || !cv->stage_offsets) goto oom;
+    if (scan(s, distribute_sink, cv) != 0) goto done;
+    if (cv->failed || (cv->staged && flush_stage(cv) != 0)) {
+        fprintf(stderr, "%s: writing the temporary octree data failed\n", source);
+        goto done;
+    }
+    for (size_t c = 0; c < cv->chunk_count; ++c)
+        if (cv->chunks[c].written != cv->chunks[c].count) {
+            fprintf(stderr, "%s: the file changed while it was converted\n", source);
+            goto done;
+        }
+    free(cv->stage);
+    free(cv->stage_sorted);
+    free(cv->stage_chunk);
+    free(cv->stage_offsets);
+    cv->stage = cv->stage_sorted = NULL;
+    cv->stage_chunk = cv->stage_offsets = NULL;
+    free(cv->cell_chunk);
+    cv->cell_chunk = NULL;
+
+    // Build the nodes into the output, then the table and the header
+    cv->out_fd = open(part_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (cv->out_fd < 0) {
+        fprintf(stderr, "%s: cannot create\n", part_path);
+        goto done;
+    }
+    cv->cursor = ALIGN64(sizeof(PointCloudHeader));
+    if (write_tree(cv) != 0) goto done;
+
+    PointCloudHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, cloud_magic, sizeof(h.magic));
+    h.version = POINTCLOUD_VERSION;
+    h.byte_order = 0x01020304;
+    h.source_size = (uint64_t)st.st_size;
+    h.source_mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    h.point_count = s->count;
+    h.record_count = cv->records;
+    h.node_count = cv->node_count;
+    h.nodes_offset = ALIGN64(cv->cursor);
+    memcpy(h.origin, cv->origin, sizeof(h.origin));
+    memcpy(h.bounds_min, cv->bmin, sizeof(h.bounds_min));
+    memcpy(h.bounds_max, cv->bmax, sizeof(h.bounds_max));
+    h.has_color = (uint32_t)s->has_color;
+    h.file_size = h.nodes_offset + sizeof(PointNode) * cv->node_count;
+    if (write_all(cv->out_fd, cv->nodes, sizeof(PointNode) * cv->node_count, h.nodes_offset) != 0 ||
+        write_all(cv->out_fd, &h, sizeof(h), 0) != 0 || close(cv->out_fd) != 0) {
+        cv->out_fd = -1;
+        fprintf(stderr, "%s: write failed\n", part_path);
+        unlink(part_path);
+        goto done;
+    }
+    cv->out_fd = -1;
+    if (rename(part_path, out_path) != 0) {
+        fprintf(stderr, "%s: cannot rename to %s\n", part_path, out_path);
+        unlink(part_path);
+        goto done;
+    }
+    if (stats) {
+        stats->format = format;
+        stats->points = s->count;
+        stats->bytes = s->size;
+        stats->seconds = now_seconds() - t0;
+        stats->threads = parallel_threads();
+    }
+    r = 0;
+    goto done;
+oom:
+    fprintf(stderr, "out of memory converting %s\n", source);
+done:
+    if (cv->out_fd >= 0) {
+        close(cv->out_fd);
+        unlink(part_path);
+    }
+    if (cv->tmp_fd >= 0) close(cv->tmp_fd);
+    if (s->data) munmap((void *)s->data, s->size);
+    for (int l = 0; l <= POINTCLOUD_GRID_LEVELS; ++l) free(cv->counts[l]);
+    free(cv->cell_chunk);
+    free(cv->nodes);
+    free(cv->chunks);
+    free(cv->upper);
+    free(cv->stage);
+    free(cv->stage_sorted);
+    free(cv->stage_chunk);
+    free(cv->stage_offsets);
+    free(cv);
+    return r;
+}
+
+// --- Reading ---
+
+int pointcloud_open(const char *source, PointCloud *pc) {
+    char path[4096];
+    struct stat src;
+    int direct = has_ext(source, ".vcpts");
+    memset(pc, 0, sizeof(*pc));
+    pc->fd = -1;
+    if (!direct && (pointcloud_path(source, path, sizeof(path)) != 0 || stat(source, &src) != 0)) return -1;
+    int fd = open(direct ? source : path, O_RDONLY);
+    if (fd < 0) return -1;
+    PointCloudHeader *h = &pc->header;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || read_all(fd, h, sizeof(*h), 0) != 0 ||
+        memcmp(h->magic, cloud_magic, sizeof(h->magic)) != 0 || h->version != POINTCLOUD_VERSION ||
+        h->byte_order != 0x01020304 || h->file_size != (uint64_t)st.st_size || h->node_count == 0 ||
+        h->nodes_offset + sizeof(PointNode) * h->node_count != h->file_size ||
+        (!direct && (h->source_size != (uint64_t)src.st_size ||
+                     h->source_mtime_ns != (int64_t)src.st_mtim.tv_sec * 1000000000 + src.st_mtim.tv_nsec))) {
+        close(fd);
+        return -1;
+    }
+    pc->nodes = malloc(sizeof(PointNode) * h->node_count);
+    if (!pc->nodes || read_all(fd, pc->nodes, sizeof(PointNode) * h->node_count, h->nodes_offset) != 0) {
+        free(pc->nodes);
+        pc->nodes = NULL;
+        close(fd);
+        return -1;
+    }
+    for (uint64_t i = 0; i < h->node_count; ++i) {
+        const PointNode *n = &pc->nodes[i];
+        int bad = n->offset + sizeof(PointRecord) * (uint64_t)n->count > h->nodes_offset;
+        for (int o = 0; o < 8; ++o) bad |= n->child[o] >= 0 && (uint64_t)n->child[o] >= h->node_count;
+        if (bad) {
+            fprintf(stderr, "%s: corrupt node table\n", direct ? source : path);
+            free(pc->nodes);
+            pc->nodes = NULL;
+            close(fd);
+            return -1;
+        }
+    }
+    pc->fd = fd;
+    return 0;
+}
+
+int pointcloud_load(const char *source, PointCloud *pc, PointCloudStats *stats) {
+    double t0 = now_seconds();
+    if (pointcloud_open(source, pc) == 0) {
+        if (stats) {
+            stats->format = "cache";
+            stats->points = pc->header.point_count;
+            stats->bytes = pc->header.file_size;
+            stats->seconds = now_seconds() - t0;
+            stats->threads = 1;
+        }
+        return 0;
+    }
+    if (has_ext(source, ".vcpts")) {
+        fprintf(stderr, "%s: not a valid point cloud octree\n", source);
+        return -1;
+    }
+    if (pointcloud_convert(source, stats) != 0) return -1;
+    if (pointcloud_open(source, pc) != 0) {
+        fprintf(stderr, "%s: the converted octree cannot be opened\n", source);
+        return -1;
+    }
+    return 0;
+}
+
+int pointcloud_read_node(const PointCloud *pc, uint32_t node, PointRecord *out) {
+    const PointNode *n = &pc->nodes[node];
+    return read_all(pc->fd, out, sizeof(PointRecord) * n->count, n->offset);
+}
+
+void pointcloud_close(PointCloud *pc) {
+    if (pc->fd >= 0) close(pc->fd);
+    free(pc->nodes);
+    memset(pc, 0, sizeof(*pc));
+    pc->fd = -1;
+}
@@ -0,0 +1,100 @@
+// pointcloud.h
+// Out-of-core point clouds: converts LAS, PLY and XYZ files into an octree
+// on disk (<source>.vcpts) without holding the input in memory, and reads
+// single nodes back for streaming (pointgl.h).
+//
+// Conversion streams the source at most three times with fixed memory:
+//   1. bounds (LAS headers carry them, so LAS skips this pass),
+//   2. counts in a POINTCLOUD_GRID^3 grid over the bounding cube, from
+//      which the top of the octree is cut into chunks of at most
+//      POINTCLOUD_CHUNK_POINTS points (a chunk is never smaller than one
+//      grid cell, so only a cell denser than that goes over),
+//   3. distribution of the points into a temporary file, chunk by chunk.
+// Chunks are then read back and split in memory, several in parallel: a
+// node keeps a grid subsample of at most POINTCLOUD_NODE_POINTS points
+// and hands the rest to its children. Nodes above the chunks hold copies
+// subsampled from their children, so every level is a coarse whole.
+//
+// Layout (native endianness): header, point records, node table. Records
+// are xyz relative to the header's double origin, which keeps survey
+// coordinates precise in float. A cache is used only if its magic,
+// version and byte order check out and the source size and mtime match;
+// a .vcpts path is opened as is. Errors are reported on stderr and the
+// call returns -1.
+#ifndef POINTCLOUD_H
+#define POINTCLOUD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define POINTCLOUD_VERSION 1
+#define POINTCLOUD_GRID_LEVELS 7            // counting grid is 2^7 cells a side
+#define POINTCLOUD_GRID (1 << POINTCLOUD_GRID_LEVELS)
+#define POINTCLOUD_CHUNK_POINTS (1u << 20)
+#define POINTCLOUD_NODE_POINTS 16384
+#define POINTCLOUD_MAX_DEPTH 24
+
+typedef struct {
+    float xyz[3];
+    uint8_t rgba[4];
+} PointRecord;
+
+typedef struct {
+    float center[3], half;      // node cube, relative to the origin
+    uint64_t offset;            // file offset of the first record
+    uint32_t count;
+    uint32_t level;             // 0 at the root
+    int32_t child[8];           // node index, -1 when absent; octant bit 0 = +x, 1 = +y, 2 = +z
+} PointNode;
+
+typedef struct {
+    char magic[8];              // "VCPTS\0\0\0"
+    uint32_t version;
+    uint32_t byte_order;        // 0x01020304 as written
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t point_count;       // in the source
+    uint64_t record_count;      // stored, including the upper levels' copies
+    uint64_t node_count;
+    uint64_t nodes_offset;
+    double origin[3];
+    float bounds_min[3], bounds_max[3];  // relative to the origin
+    uint32_t has_color;
+    uint32_t reserved;
+    uint64_t file_size;
+} PointCloudHeader;
+
+typedef struct {
+    int fd;
+    PointCloudHeader header;
+    PointNode *nodes;           // node 0 is the root
+} PointCloud;
+
+typedef struct {
+    const char *format;         // "las", "ply", "xyz" or "cache"
+    uint64_t points;
+    size_t bytes;               // source (or cache) file size
+    double seconds;             // conversion or open, wall clock
+    int threads;
+} PointCloudStats;
+
+// "<source>.vcpts"; -1 if it does not fit.
+int pointcloud_path(const char *source, char *out, size_t n);
+
+// Writes the octree for source. stats may be NULL.
+int pointcloud_convert(const char *source, PointCloudStats *stats);
+
+// Opens the up-to-date octree for source. Returns -1 (quietly) when there
+// is none or it is stale.
+int pointcloud_open(const char *source, PointCloud *pc);
+
+// Opens, converting first when needed. stats may be NULL.
+int pointcloud_load(const char *source, PointCloud *pc, PointCloudStats *stats);
+
+// Reads a node's records into out (node count entries). Safe to call from
+// several threads at once.
+int pointcloud_read_node(const PointCloud *pc, uint32_t node, PointRecord *out);
+
+void pointcloud_close(PointCloud *pc);
+
+#endif
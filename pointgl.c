@@ -0,0 +1,419 @@
+// pointgl.c
+#define GL_GLEXT_PROTOTYPES
+#include "pointgl.h"
+
+#include <GL/glext.h>
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "fit.h"
+#include "glstate.h"
+
+// --- Loader threads ---
+
+enum { NODE_ABSENT, NODE_QUEUED, NODE_LOADING, NODE_ARRIVED, NODE_RESIDENT, NODE_FAILED };
+
+typedef struct {
+    uint32_t node;
+    PointRecord *records;
+} Arrival;
+
+struct PointLoader {
+    const PointCloud *cloud;
+    pthread_t threads[POINTGL_LOADER_THREADS];
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    unsigned char *state;       // per node, guarded by lock
+    uint32_t *queue;            // requested nodes, best first
+    size_t queue_count, queue_next;
+    Arrival *done, *taken;      // arrivals, and the main thread's share of them
+    size_t done_count;
+    int loading;                // nodes being read right now
+    int quit;
+};
+
+static void *loader_main(void *arg) {
+    PointLoader *l = arg;
+    pthread_mutex_lock(&l->lock);
+    for (;;) {
+        while (!l->quit && l->queue_next == l->queue_count) pthread_cond_wait(&l->wake, &l->lock);
+        if (l->quit) break;
+        uint32_t id = l->queue[l->queue_next++];
+        if (l->state[id] != NODE_QUEUED) continue;
+        l->state[id] = NODE_LOADING;
+        l->loading++;
+        pthread_mutex_unlock(&l->lock);
+
+        uint32_t count = l->cloud->nodes[id].count;
+        PointRecord *r = malloc(sizeof(PointRecord) * (count ? count : 1));
+        int ok = r && pointcloud_read_node(l->cloud, id, r) == 0;
+
+        pthread_mutex_lock(&l->lock);
+        l->loading--;
+        if (!ok) {
+            fprintf(stderr, "point cloud node %u: read failed\n", id);
+            free(r);
+            l->state[id] = NODE_FAILED;
+            continue;
+        }
+        l->done[l->done_count++] = (Arrival){ id, r };  // a node is in flight at most once
+        l->state[id] = NODE_ARRIVED;
+    }
+    pthread_mutex_unlock(&l->lock);
+    return NULL;
+}
+
+static void loader_stop(PointLoader *l) {
+    pthread_mutex_lock(&l->lock);
+    l->quit = 1;
+    pthread_cond_broadcast(&l->wake);
+    pthread_mutex_unlock(&l->lock);
+    for (int i = 0; i < l->thread_count; ++i) pthread_join(l->threads[i], NULL);
+    for (size_t i = 0; i < l->done_count; ++i) free(l->done[i].records);
+    pthread_mutex_destroy(&l->lock);
+    pthread_cond_destroy(&l->wake);
+    free(l->state);
+    free(l->queue);
+    free(l->done);
+    free(l->taken);
+    free(l);
+}
+
+static PointLoader *loader_start(const PointCloud *cloud) {
+    size_t n = cloud->header.node_count;
+    PointLoader *l = calloc(1, sizeof(PointLoader));
+    if (!l) return NULL;
+    l->cloud = cloud;
+    l->state = calloc(n, 1);
+    l->queue = malloc(sizeof(uint32_t) * n);
+    l->done = malloc(sizeof(Arrival) * n);
+    l->taken = malloc(sizeof(Arrival) * n);
+    pthread_mutex_init(&l->lock, NULL);
+    pthread_cond_init(&l->wake, NULL);
+    if (!l->state || !l->queue || !l->done || !l->taken) {
+        loader_stop(l);
+        return NULL;
+    }
+    for (int i = 0; i < POINTGL_LOADER_THREADS; ++i) {
+        if (pthread_create(&l->threads[i], NULL, loader_main, l) != 0) break;
+        l->thread_count++;
+    }
+    if (!l->thread_count) {
+        loader_stop(l);
+        return NULL;
+    }
+    return l;
+}
+
+// Replaces the queue with this frame's wanted nodes
+static void loader_request(PointLoader *l, const uint32_t *wanted, size_t count) {
+    pthread_mutex_lock(&l->lock);
+    for (size_t i = l->queue_next; i < l->queue_count; ++i)
+        if (l->state[l->queue[i]] == NODE_QUEUED) l->state[l->queue[i]] = NODE_ABSENT;
+    l->queue_count = l->queue_next = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (l->state[wanted[i]] != NODE_ABSENT) continue;
+        l->state[wanted[i]] = NODE_QUEUED;
+        l->queue[l->queue_count++] = wanted[i];
+    }
+    if (l->queue_count) pthread_cond_broadcast(&l->wake);
+    pthread_mutex_unlock(&l->lock);
+}
+
+// --- Residency ---
+
+static void lru_unlink(PointGL *g, int32_t id) {
+    int32_t p = g->lru_prev[id], n = g->lru_next[id];
+    if (p >= 0) g->lru_next[p] = n;
+    else g->lru_head = n;
+    if (n >= 0) g->lru_prev[n] = p;
+    else g->lru_tail = p;
+    g->lru_prev[id] = g->lru_next[id] = -1;
+}
+
+static void lru_push_front(PointGL *g, int32_t id) {
+    g->lru_prev[id] = -1;
+    g->lru_next[id] = g->lru_head;
+    if (g->lru_head >= 0) g->lru_prev[g->lru_head] = id;
+    else g->lru_tail = id;
+    g->lru_head = id;
+}
+
+static void evict(PointGL *g, int32_t id) {
+    lru_unlink(g, id);
+    glDeleteBuffers(1, &g->buffers[id]);
+    g->buffers[id] = 0;
+    g->resident_points -= g->cloud.nodes[id].count;
+    pthread_mutex_lock(&g->loader->lock);
+    g->loader->state[id] = NODE_ABSENT;
+    pthread_mutex_unlock(&g->loader->lock);
+}
+
+// Uploads what the loaders finished, up to POINTGL_UPLOAD_POINTS. Room is
+// made by evicting from the LRU tail, stopping at nodes drawn last frame.
+static void uploadArrivals(PointGL *g, PointDrawStats *stats) {
+    PointLoader *l = g->loader;
+    size_t n = 0, points = 0;
+    pthread_mutex_lock(&l->lock);
+    while (n < l->done_count && (n == 0 || points + g->cloud.nodes[l->done[n].node].count <= POINTGL_UPLOAD_POINTS))
+        points += g->cloud.nodes[l->done[n++].node].count;
+    memcpy(l->taken, l->done, sizeof(Arrival) * n);
+    memmove(l->done, l->done + n, sizeof(Arrival) * (l->done_count - n));
+    l->done_count -= n;
+    pthread_mutex_unlock(&l->lock);
+
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t id = l->taken[i].node;
+        uint32_t count = g->cloud.nodes[id].count;
+        while (g->resident_points + count > g->budget && g->lru_tail >= 0 &&
+               g->drawn_frame[g->lru_tail] + 1 < g->frame) {
+            evict(g, g->lru_tail);
+            if (stats) stats->evictions++;
+        }
+        int state = NODE_ABSENT;
+        if (g->resident_points + count <= g->budget) {
+            glGenBuffers(1, &g->buffers[id]);
+            glBindBuffer(GL_ARRAY_BUFFER, g->buffers[id]);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(PointRecord) * count, l->taken[i].records, GL_STATIC_DRAW);
+            g->resident_points += count;
+            g->drawn_frame[id] = g->frame;     // not evicted again before it is drawn
+            lru_push_front(g, (int32_t)id);
+            state = NODE_RESIDENT;
+            if (stats) stats->uploads++;
+        }
+        free(l->taken[i].records);
+        pthread_mutex_lock(&l->lock);
+        l->state[id] = (unsigned char)state;
+        pthread_mutex_unlock(&l->lock);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// --- Public ---
+
+int pointgl_open(PointGL *g, const char *source, size_t budget, PointCloudStats *stats) {
+    memset(g, 0, sizeof(*g));
+    if (pointcloud_load(source, &g->cloud, stats) != 0) return -1;
+    const PointCloudHeader *h = &g->cloud.header;
+    size_t n = h->node_count;
+    g->extent = 0;
+    for (int a = 0; a < 3; ++a) {
+        g->center[a] = 0.5f * (h->bounds_min[a] + h->bounds_max[a]);
+        float e = h->bounds_max[a] - h->bounds_min[a];
+        if (e > g->extent) g->extent = e;
+    }
+    if (g->extent <= 0) g->extent = 1;
+    g->budget = budget ? budget : POINTGL_DEFAULT_BUDGET;
+    g->min_node_pixels = 100.0f;
+    g->point_size = 2.0f;
+    g->lru_head = g->lru_tail = -1;
+    g->buffers = calloc(n, sizeof(GLuint));
+    g->lru_prev = malloc(sizeof(int32_t) * n);
+    g->lru_next = malloc(sizeof(int32_t) * n);
+    g->drawn_frame = calloc(n, sizeof(uint32_t));
+    g->heap = malloc(sizeof(uint32_t) * n);
+    g->heap_key = malloc(sizeof(float) * n);
+    g->selected = malloc(sizeof(uint32_t) * n);
+    g->wanted = malloc(sizeof(uint32_t) * n);
+    if (!g->buffers || !g->lru_prev || !g->lru_next || !g->drawn_frame || !g->heap || !g->heap_key ||
+        !g->selected || !g->wanted || !(g->loader = loader_start(&g->cloud))) {
+        fprintf(stderr, "out of memory opening %s\n", source);
+        pointgl_free(g);
+        return -1;
+    }
+    for (size_t i = 0; i < n; ++i) g->lru_prev[i] = g->lru_next[i] = -1;
+    return 0;
+}
+
+static void heap_push(PointGL *g, size_t *size, uint32_t id, float key) {
+    size_t i = (*size)++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (g->heap_key[parent] >= key) break;
+        g->heap[i] = g->heap[parent];
+        g->heap_key[i] = g->heap_key[parent];
+        i = parent;
+    }
+    g->heap[i] = id;
+    g->heap_key[i] = key;
+}
+
+static uint32_t heap_pop(PointGL *g, size_t *size) {
+    uint32_t top = g->heap[0];
+    uint32_t id = g->heap[--*size];
+    float key = g->heap_key[*size];
+    size_t i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= *size) break;
+        if (c + 1 < *size && g->heap_key[c + 1] > g->heap_key[c]) ++c;
+        if (g->heap_key[c] <= key) break;
+        g->heap[i] = g->heap[c];
+        g->heap_key[i] = g->heap_key[c];
+        i = c;
+    }
+    g->heap[i] = id;
+    g->heap_key[i] = key;
+    return top;
+}
+
+typedef struct {
+    float planes[6][4];
+    float mv[16];
+    float px_per_unit, mv_scale;
+    int perspective;
+} View;
+
+static int nodeVisible(const View *v, const PointNode *n) {
+    for (int p = 0; p < 6; ++p) {
+        const float *q = v->planes[p];
+        float d = q[0] * n->center[0] + q[1] * n->center[1] + q[2] * n->center[2] + q[3];
+        if (d + n->half * (fabsf(q[0]) + fabsf(q[1]) + fabsf(q[2])) < 0) return 0;
+    }
+    return 1;
+}
+
+// Pixels across the node's bounding sphere
+static float nodePixels(const View *v, const PointNode *n) {
+    float r = n->half * 1.7320508f;
+    if (!v->perspective) return r * v->px_per_unit;
+    float e[3];
+    for (int a = 0; a < 3; ++a)
+        e[a] = v->mv[a] * n->center[0] + v->mv[4 + a] * n->center[1] + v->mv[8 + a] * n->center[2] + v->mv[12 + a];
+    float dist = sqrtf(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]) - r * v->mv_scale;
+    if (dist < 1e-3f) dist = 1e-3f;
+    return r * v->px_per_unit / dist;
+}
+
+void pointgl_draw(PointGL *g, float size, PointDrawStats *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!g->loader) return;
+    g->frame++;
+    uploadArrivals(g, stats);
+
+    glPushMatrix();
+    float s = size / g->extent;
+    glScalef(s, s, s);
+    glTranslatef(-g->center[0], -g->center[1], -g->center[2]);
+
+    View v;
+    GLfloat proj[16], clip[16];
+    GLint vp[4];
+    glGetFloatv(GL_PROJECTION_MATRIX, proj);
+    glGetFloatv(GL_MODELVIEW_MATRIX, v.mv);
+    glGetIntegerv(GL_VIEWPORT, vp);
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            clip[4 * c + r] = proj[r] * v.mv[4 * c] + proj[4 + r] * v.mv[4 * c + 1] +
+                              proj[8 + r] * v.mv[4 * c + 2] + proj[12 + r] * v.mv[4 * c + 3];
+    bvh_planes_from_matrix(clip, v.planes);
+    v.mv_scale = sqrtf(v.mv[0] * v.mv[0] + v.mv[1] * v.mv[1] + v.mv[2] * v.mv[2]);
+    v.px_per_unit = proj[5] * vp[3] * 0.5f * v.mv_scale;
+    v.perspective = proj[11] != 0;
+
+    // Best first until the budget is spent
+    const PointNode *nodes = g->cloud.nodes;
+    size_t heap_size = 0, selected = 0, wanted = 0, points = 0;
+    if (nodeVisible(&v, &nodes[0])) heap_push(g, &heap_size, 0, nodePixels(&v, &nodes[0]));
+    while (heap_size) {
+        float pixels = g->heap_key[0];
+        uint32_t id = heap_pop(g, &heap_size);
+        const PointNode *n = &nodes[id];
+        if (points + n->count > g->budget) break;
+        points += n->count;
+        if (!g->buffers[id]) {
+            g->wanted[wanted++] = id;
+            continue;
+        }
+        g->selected[selected++] = id;
+        if (pixels <= g->min_node_pixels) continue;
+        for (int o = 0; o < 8; ++o) {
+            int c = n->child[o];
+            if (c >= 0 && nodeVisible(&v, &nodes[c])) heap_push(g, &heap_size, (uint32_t)c, nodePixels(&v, &nodes[c]));
+        }
+    }
+    loader_request(g->loader, g->wanted, wanted);
+
+    gls_disable(GL_LIGHTING);
+    gls_point_size(g->point_size);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    if (g->cloud.header.has_color) glEnableClientState(GL_COLOR_ARRAY);
+    size_t drawn = 0;
+    for (size_t i = 0; i < selected; ++i) {
+        uint32_t id = g->selected[i];
+        glBindBuffer(GL_ARRAY_BUFFER, g->buffers[id]);
+        glVertexPointer(3, GL_FLOAT, sizeof(PointRecord), 0);
+        if (g->cloud.header.has_color)
+            glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(PointRecord), (const void *)offsetof(PointRecord, rgba));
+        glDrawArrays(GL_POINTS, 0, (GLsizei)nodes[id].count);
+        drawn += nodes[id].count;
+        g->drawn_frame[id] = g->frame;
+        lru_unlink(g, (int32_t)id);
+        lru_push_front(g, (int32_t)id);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopMatrix();
+
+    if (stats) {
+        stats->nodes_drawn = (unsigned)selected;
+        stats->nodes_wanted = (unsigned)wanted;
+        stats->points_drawn = drawn;
+        stats->points_resident = g->resident_points;
+        for (int32_t i = g->lru_head; i >= 0; i = g->lru_next[i]) stats->nodes_resident++;
+        pthread_mutex_lock(&g->loader->lock);
+        stats->pending = g->loader->queue_next < g->loader->queue_count || g->loader->loading > 0 ||
+                         g->loader->done_count > 0;
+        pthread_mutex_unlock(&g->loader->lock);
+    }
+}
+
+int pointgl_poll(PointGL *g) {
+    PointLoader *l = g->loader;
+    if (!l) return -1;
+    pthread_mutex_lock(&l->lock);
+    int r = l->done_count > 0 ? 1 : l->queue_next < l->queue_count || l->loading > 0 ? 0 : -1;
+    pthread_mutex_unlock(&l->lock);
+    return r;
+}
+
+void pointgl_view_extent(const PointGL *g, float size, const float rot[9], float min[3], float max[3]) {
+    const PointCloudHeader *h = &g->cloud.header;
+    float corners[24], lo[3] = { INFINITY, INFINITY, INFINITY }, hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (int i = 0; i < 8; ++i) {
+        corners[3 * i] = (i & 1) ? h->bounds_max[0] : h->bounds_min[0];
+        corners[3 * i + 1] = (i & 2) ? h->bounds_max[1] : h->bounds_min[1];
+        corners[3 * i + 2] = (i & 4) ? h->bounds_max[2] : h->bounds_min[2];
+    }
+    fit_extent_points(corners, 8, rot, lo, hi);
+    float s = size / g->extent;
+    for (int a = 0; a < 3; ++a) {
+        float c = rot[3 * a] * g->center[0] + rot[3 * a + 1] * g->center[1] + rot[3 * a + 2] * g->center[2];
+        min[a] = s * (lo[a] - c);
+        max[a] = s * (hi[a] - c);
+    }
+}
+
+void pointgl_free(PointGL *g) {
+    if (g->loader) loader_stop(g->loader);
+    if (g->buffers)
+        for (uint64_t i = 0; i < g->cloud.header.node_count; ++i)
+            if (g->buffers[i]) glDeleteBuffers(1, &g->buffers[i]);
+    if (g->cloud.nodes) pointcloud_close(&g->cloud);
+    free(g->buffers);
+    free(g->lru_prev);
+    free(g->lru_next);
+    free(g->drawn_frame);
+    free(g->heap);
+    free(g->heap_key);
+    free(g->selected);
+    free(g->wanted);
+    memset(g, 0, sizeof(*g));
+}
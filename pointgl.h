@@ -0,0 +1,77 @@
+// pointgl.h
+// GL side of pointcloud.h: streams octree nodes into vertex buffers on
+// demand and draws them as points, scaled like meshgl.h so the cloud's
+// bounding box fits a cube of the given edge length centred on the origin.
+//
+// Each draw walks the octree from the root, largest projected node first,
+// skipping nodes outside the view frustum. A node's children are visited
+// only while it projects larger than min_node_pixels, and the walk stops
+// once the selected nodes hold `budget` points. Selected nodes that are not
+// resident are queued, best first, for POINTGL_LOADER_THREADS background
+// readers and drawn once they arrive; the walk does not go below a node
+// that is still missing. Resident nodes are kept in LRU order, and an
+// arrival that would go over the budget evicts the least recently drawn
+// nodes, never those drawn last frame. GPU memory thus stays within budget
+// points (and in-flight reads within as many again) for any file size.
+// Needs a current context with GL 1.5 buffer objects.
+#ifndef POINTGL_H
+#define POINTGL_H
+
+#include <GL/gl.h>
+#include <stdint.h>
+
+#include "pointcloud.h"
+
+#define POINTGL_LOADER_THREADS 2
+#define POINTGL_UPLOAD_POINTS (1u << 20)    // per frame, so streaming never stalls a frame for long
+#define POINTGL_DEFAULT_BUDGET (8u << 20)
+
+typedef struct PointLoader PointLoader;
+
+typedef struct {
+    PointCloud cloud;
+    float center[3];            // relative to the cloud's origin
+    float extent;               // largest bounding-box side
+    size_t budget;              // points resident or selected
+    float min_node_pixels;      // 100 px default
+    float point_size;           // 2 px default
+
+    GLuint *buffers;            // per node, 0 when not resident
+    int32_t *lru_prev, *lru_next;   // resident nodes, most recently drawn at the head
+    int32_t lru_head, lru_tail;
+    uint32_t *drawn_frame;
+    uint32_t frame;
+    size_t resident_points;
+
+    PointLoader *loader;
+    uint32_t *heap;             // per-frame scratch, one entry per node each
+    float *heap_key;
+    uint32_t *selected, *wanted;
+} PointGL;
+
+typedef struct {
+    unsigned nodes_drawn, nodes_resident, nodes_wanted;
+    size_t points_drawn, points_resident;
+    unsigned uploads, evictions;
+    int pending;                // nodes are still on their way: draw again soon
+} PointDrawStats;
+
+// Opens source through pointcloud_load (converting on the first open) and
+// starts the loader threads. budget 0 means POINTGL_DEFAULT_BUDGET.
+int pointgl_open(PointGL *g, const char *source, size_t budget, PointCloudStats *stats);
+
+// stats may be NULL.
+void pointgl_draw(PointGL *g, float size, PointDrawStats *stats);
+
+// For hosts that redraw only on events: 1 when nodes have arrived since
+// the last draw (draw again), 0 while reads are under way, -1 when
+// nothing is in flight.
+int pointgl_poll(PointGL *g);
+
+// Extent of the cloud, as pointgl_draw places it for `size`, along the
+// rows of the view rotation rot (fit.h).
+void pointgl_view_extent(const PointGL *g, float size, const float rot[9], float min[3], float max[3]);
+
+void pointgl_free(PointGL *g);
+
+#endif
@@ -0,0 +1,136 @@
+// renderthread.c
+#include "renderthread.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define RT_TRIPLE_FRESH 4
+
+void rt_queue_init(RtQueue *q) {
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+int rt_queue_push(RtQueue *q, const RtEvent *e) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&q->head, memory_order_acquire) == RT_QUEUE_SIZE) return 0;
+    q->events[tail & (RT_QUEUE_SIZE - 1)] = *e;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+int rt_queue_pop(RtQueue *q, RtEvent *e) {
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&q->tail, memory_order_acquire)) return 0;
+    *e = q->events[head & (RT_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return 1;
+}
+
+void rt_triple_init(RtTriple *t, void *front, void *middle, void *back) {
+    t->slot[0] = front;
+    t->slot[1] = middle;
+    t->slot[2] = back;
+    t->front = 0;
+    t->back = 2;
+    atomic_init(&t->middle, 1);
+}
+
+void *rt_triple_back(RtTriple *t) {
+    return t->slot[t->back];
+}
+
+int rt_triple_publish(RtTriple *t) {
+    // Release the filled slot; acquire the one the consumer last let go of
+    int old = atomic_exchange_explicit(&t->middle, t->back | RT_TRIPLE_FRESH, memory_order_acq_rel);
+    t->back = old & ~RT_TRIPLE_FRESH;
+    return (old & RT_TRIPLE_FRESH) != 0;
+}
+
+int rt_triple_acquire(RtTriple *t) {
+    if (!(atomic_load_explicit(&t->middle, memory_order_relaxed) & RT_TRIPLE_FRESH)) return 0;
+    // Only the consumer clears FRESH, so the slot is still a fresh one
+    int old = atomic_exchange_explicit(&t->middle, t->front, memory_order_acq_rel);
+    t->front = old & ~RT_TRIPLE_FRESH;
+    return 1;
+}
+
+void *rt_triple_front(RtTriple *t) {
+    return t->slot[t->front];
+}
+
+static void *renderMain(void *arg) {
+    RenderThread *rt = arg;
+    rt->begin_result = rt->begin ? rt->begin(rt->user) : 0;
+    sem_post(&rt->ready);
+    if (rt->begin_result != 0) return NULL;
+
+    int again = 1;      // the first frame needs no wake
+    while (!atomic_load(&rt->quit)) {
+        if (again && !atomic_load(&rt->wake_posted)) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += RENDERTHREAD_POLL_MS * 1000000L;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            while (sem_timedwait(&rt->wake, &ts) != 0 && errno == EINTR) {}
+        } else {
+            while (sem_wait(&rt->wake) != 0 && errno == EINTR) {}
+        }
+        if (atomic_load(&rt->quit)) break;
+        // Wakes from here on ask for the next frame
+        atomic_store(&rt->wake_posted, 0);
+        again = rt->frame(rt->user);
+    }
+    if (rt->end) rt->end(rt->user);
+    return NULL;
+}
+
+int renderthread_start(RenderThread *rt, int (*begin)(void *user), int (*frame)(void *user),
+                       void (*end)(void *user), void *user) {
+    rt->begin = begin;
+    rt->frame = frame;
+    rt->end = end;
+    rt->user = user;
+    rt->begin_result = 0;
+    atomic_init(&rt->wake_posted, 0);
+    atomic_init(&rt->quit, 0);
+    if (sem_init(&rt->wake, 0, 0) != 0 || sem_init(&rt->ready, 0, 0) != 0) {
+        fprintf(stderr, "render thread: sem_init failed: %s\n", strerror(errno));
+        return -1;
+    }
+    // Run one frame as soon as begin returns
+    atomic_store(&rt->wake_posted, 1);
+    sem_post(&rt->wake);
+    int err = pthread_create(&rt->thread, NULL, renderMain, rt);
+    if (err != 0) {
+        fprintf(stderr, "render thread: pthread_create failed: %s\n", strerror(err));
+        sem_destroy(&rt->wake);
+        sem_destroy(&rt->ready);
+        return -1;
+    }
+    while (sem_wait(&rt->ready) != 0 && errno == EINTR) {}
+    if (rt->begin_result != 0) {
+        pthread_join(rt->thread, NULL);
+        sem_destroy(&rt->wake);
+        sem_destroy(&rt->ready);
+        return -1;
+    }
+    return 0;
+}
+
+void renderthread_wake(RenderThread *rt) {
+    if (!atomic_exchange(&rt->wake_posted, 1)) sem_post(&rt->wake);
+}
+
+void renderthread_stop(RenderThread *rt) {
+    atomic_store(&rt->quit, 1);
+    sem_post(&rt->wake);
+    pthread_join(rt->thread, NULL);
+    sem_destroy(&rt->wake);
+    sem_destroy(&rt->ready);
+}
@@ -0,0 +1,90 @@
+// renderthread.h
+// Rendering on its own thread, decoupled from the thread that handles
+// input. The input side never waits on the renderer:
+//
+//  - RtQueue: a lock-free single-producer / single-consumer ring of small
+//    event records, for commands that must run where the GL context is
+//    (toggling renderer options, printing frame statistics).
+//  - RtTriple: a wait-free triple buffer for view state. The producer
+//    fills the back slot and publishes it; the consumer picks up the most
+//    recently published slot, if any. Each side owns one slot outright and
+//    the third is exchanged atomically, so neither ever sees a half-written
+//    snapshot and intermediate snapshots are simply dropped.
+//  - RenderThread: a thread that runs a frame callback whenever it is
+//    woken, and every RENDERTHREAD_POLL_MS while the callback reports work
+//    still in flight (streamed points, occlusion queries, LOD builds).
+//
+// Handing the GL context over is the host's business (its begin callback
+// makes the context current on the render thread); see ViewCube.c.
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#define RT_QUEUE_SIZE 256           // power of two
+#define RENDERTHREAD_POLL_MS 16
+
+typedef struct {
+    int type;                       // host-defined
+    int a, b;
+    double t;
+} RtEvent;
+
+typedef struct {
+    RtEvent events[RT_QUEUE_SIZE];
+    atomic_uint head;               // next slot to read; written by the consumer
+    atomic_uint tail;               // next slot to write; written by the producer
+} RtQueue;
+
+void rt_queue_init(RtQueue *q);
+// Producer side. Returns 0 when the queue is full (the event is dropped).
+int rt_queue_push(RtQueue *q, const RtEvent *e);
+// Consumer side. Returns 0 when the queue is empty.
+int rt_queue_pop(RtQueue *q, RtEvent *e);
+
+typedef struct {
+    void *slot[3];
+    int back;                       // producer's slot
+    int front;                      // consumer's slot
+    atomic_int middle;              // slot index, | RT_TRIPLE_FRESH when not yet acquired
+} RtTriple;
+
+// `front` is what the consumer sees before the first publish
+void rt_triple_init(RtTriple *t, void *front, void *middle, void *back);
+
+// Producer side: the slot to fill, then publish it. publish returns 1 when
+// it replaced a snapshot the consumer never acquired.
+void *rt_triple_back(RtTriple *t);
+int rt_triple_publish(RtTriple *t);
+
+// Consumer side: takes the latest published snapshot, if there is one it
+// has not seen (returns 1), then read it through rt_triple_front.
+int rt_triple_acquire(RtTriple *t);
+void *rt_triple_front(RtTriple *t);
+
+typedef struct {
+    int (*begin)(void *user);       // on the new thread, before the first frame; nonzero aborts
+    int (*frame)(void *user);       // nonzero: call again in RENDERTHREAD_POLL_MS even unwoken
+    void (*end)(void *user);        // on the thread after the last frame (may be NULL)
+    void *user;
+    pthread_t thread;
+    sem_t wake, ready;
+    atomic_int wake_posted, quit;
+    int begin_result;
+} RenderThread;
+
+// Starts the thread and waits for begin to return. Returns -1 (with no
+// thread left running) when the thread cannot start or begin fails.
+int renderthread_start(RenderThread *rt, int (*begin)(void *user), int (*frame)(void *user),
+                       void (*end)(void *user), void *user);
+
+// Asks for a frame. Cheap and non-blocking; wakes that arrive before the
+// thread gets to run are merged into one frame.
+void renderthread_wake(RenderThread *rt);
+
+// Lets the current frame finish, runs end and joins the thread.
+void renderthread_stop(RenderThread *rt);
+
+#endif
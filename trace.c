@@ -0,0 +1,105 @@
+// trace.c
+#define _POSIX_C_SOURCE 199309L
+#include "trace.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    const char *name;   // string literal, never freed
+    uint64_t ts_ns;
+    char phase;         // 'B' or 'E'
+} TraceEvent;
+
+typedef struct TraceRing {
+    struct TraceRing *next;
+    int tid;
+    uint64_t head;      // total events written; only the owner writes it
+    TraceEvent events[TRACE_RING_SIZE];
+} TraceRing;
+
+volatile int trace_recording = 0;
+
+static TraceRing *rings = NULL;  // lock-free list, push only
+static int next_tid = 1;
+static __thread TraceRing *tls_ring = NULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static TraceRing *thread_ring(void) {
+    if (tls_ring) return tls_ring;
+
+    TraceRing *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->tid = __atomic_fetch_add(&next_tid, 1, __ATOMIC_RELAXED);
+    r->next = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&rings, &r->next, r, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        ;
+    tls_ring = r;
+    return r;
+}
+
+static void record(const char *name, char phase) {
+    TraceRing *r = thread_ring();
+    if (!r) return;
+    uint64_t h = r->head;
+    TraceEvent *e = &r->events[h & (TRACE_RING_SIZE - 1)];
+    e->name = name;
+    e->ts_ns = now_ns();
+    e->phase = phase;
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void trace_set_recording(int on) {
+    trace_recording = on;
+}
+
+const char *trace_begin_slow(const char *name) {
+    record(name, 'B');
+    return name;
+}
+
+void trace_end_slow(const char *name) {
+    record(name, 'E');
+}
+
+void trace_clear(void) {
+    for (TraceRing *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next)
+        __atomic_store_n(&r->head, 0, __ATOMIC_RELEASE);
+}
+
+int trace_dump_json(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return -1;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    int first = 1;
+    for (TraceRing *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        uint64_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        uint64_t start = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+        // If the ring wrapped, drop leading 'E' events whose 'B' was overwritten
+        int depth = 0;
+        for (uint64_t i = start; i < head; ++i) {
+            const TraceEvent *e = &r->events[i & (TRACE_RING_SIZE - 1)];
+            if (e->phase == 'E' && depth == 0) continue;
+            depth += e->phase == 'B' ? 1 : -1;
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                    first ? "" : ",\n", e->name, e->phase, e->ts_ns / 1000.0, r->tid);
+            first = 0;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return 0;
+}
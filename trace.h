@@ -0,0 +1,60 @@
+// trace.h
+// Scoped begin/end tracing into per-thread ring buffers, dumped as Chrome
+// trace event JSON (open in Perfetto or chrome://tracing).
+//
+//   void display(void) {
+//       TRACE_SCOPE("display");
+//       ...
+//   }
+//
+// Each thread writes only to its own ring, so recording takes no locks;
+// rings are linked into a global list with a CAS the first time a thread
+// records. When recording is off a scope costs one predictable branch.
+// Build with -DVIEWCUBE_TRACE=0 to compile the hooks out entirely.
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifndef VIEWCUBE_TRACE
+#define VIEWCUBE_TRACE 1
+#endif
+
+#define TRACE_RING_SIZE 65536   // events per thread, power of two
+
+extern volatile int trace_recording;
+
+void trace_set_recording(int on);
+
+// Returns `name` if the event was recorded, NULL otherwise.
+const char *trace_begin_slow(const char *name);
+void trace_end_slow(const char *name);
+
+// Write every thread's events as {"traceEvents": [...]}. Stop recording
+// first; events being written while dumping may be missing.
+int trace_dump_json(const char *path);
+
+// Forget all recorded events.
+void trace_clear(void);
+
+#if VIEWCUBE_TRACE
+
+static inline const char *trace_begin(const char *name) {
+    return __builtin_expect(trace_recording, 0) ? trace_begin_slow(name) : 0;
+}
+
+static inline void trace__scope_end(const char **name) {
+    if (*name) trace_end_slow(*name);
+}
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+#define TRACE_SCOPE(name) \
+    const char *TRACE_CAT(trace_scope_, __LINE__) \
+        __attribute__((cleanup(trace__scope_end))) = trace_begin(name)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,149 @@
+// viewcube.h
+// libviewcube: embeddable ViewCube widget.
+//
+// Every viewcube_t owns its own orientation, hover, drag and animation
+// state, so any number of cubes can live in one process. Geometry (display
+// lists) is shared by all instances and created lazily on the first render,
+// so it needs the instances to render in one context or in contexts that
+// share objects. viewcube_render and the last viewcube_destroy must be
+// called with that context current.
+#ifndef VIEWCUBE_H
+#define VIEWCUBE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct viewcube viewcube_t;
+
+// Hover region types (same numbering as the original ViewCube.c)
+enum {
+    VIEWCUBE_HOVER_NONE   = 0,
+    VIEWCUBE_HOVER_FACE   = 1,
+    VIEWCUBE_HOVER_EDGE   = 2,
+    VIEWCUBE_HOVER_CORNER = 3
+};
+
+// Result bits returned by the pointer and tick functions
+enum {
+    VIEWCUBE_EVENT_CONSUMED    = 1 << 0, // the cube handled the event
+    VIEWCUBE_EVENT_REDRAW      = 1 << 1, // something visible changed
+    VIEWCUBE_EVENT_ORIENTATION = 1 << 2, // orientation changed
+    VIEWCUBE_EVENT_ANIMATING   = 1 << 3  // keep calling viewcube_tick
+};
+
+// Pointer modifiers
+enum {
+    VIEWCUBE_MOD_SHIFT = 1 << 0
+};
+
+viewcube_t *viewcube_create(void);
+void viewcube_destroy(viewcube_t *vc);
+
+// Copies all of src's state (orientation, layout, hover, drag, animations,
+// text renderer) into dst. For hosts that render on another thread: the
+// input thread keeps updating src and hands copies to the renderer.
+void viewcube_copy(viewcube_t *dst, const viewcube_t *src);
+
+// Window size in pixels. The cube sits in the top-right corner,
+// `size` pixels square, `margin` pixels from the edges.
+void viewcube_resize(viewcube_t *vc, int win_w, int win_h);
+void viewcube_set_layout(viewcube_t *vc, int size, int margin);
+
+// Orientation as Euler angles in degrees, applied as Rz * Rx * Ry.
+// Setting the orientation cancels any running animation or coasting.
+void viewcube_set_orientation(viewcube_t *vc, float rx, float ry, float rz);
+void viewcube_get_orientation(const viewcube_t *vc, float out[3]);
+
+// Face-snap animation and momentum after drag release.
+void viewcube_set_snap_duration(viewcube_t *vc, double seconds);
+
+// While a face snap runs: its target orientation and eased progress (0..1)
+// at `now`, so the host can move other view state in step. Returns 0 when
+// no snap is running (it finished or was cancelled).
+int viewcube_get_snap(const viewcube_t *vc, double now, float target[3], float *progress);
+void viewcube_set_momentum(viewcube_t *vc, int enabled);
+
+void viewcube_get_hover(const viewcube_t *vc, int *type, int *id);
+
+// Hover ids for n pointer positions (top-left origin) against the current
+// orientation and layout, without changing the hover state: face * 9 + cell
+// of a face hit, -1 otherwise. SIMD where available; for replaying
+// recorded pointer streams.
+void viewcube_hit_test_batch(const viewcube_t *vc, const int *x, const int *y, int n, int *ids);
+
+// Pointer events in window pixels with the origin at the top-left, as
+// delivered by GLUT. Return a mask of VIEWCUBE_EVENT_* bits.
+int viewcube_pointer_move(viewcube_t *vc, int x, int y);
+int viewcube_pointer_down(viewcube_t *vc, int x, int y, int mods);
+int viewcube_pointer_up(viewcube_t *vc, int x, int y);
+
+// Advance animations to `now` (seconds, monotonic). Returns
+// VIEWCUBE_EVENT_ANIMATING while further ticks are needed.
+int viewcube_tick(viewcube_t *vc, double now);
+
+// Face labels are drawn at the current raster position. By default they use
+// GLUT bitmap fonts, which need glutInit; hosts without GLUT can install
+// viewcube_text_builtin (A-Z only) or their own renderer. NULL restores
+// the default.
+typedef void (*viewcube_text_fn)(const char *utf8, void *user);
+void viewcube_set_text_renderer(viewcube_t *vc, viewcube_text_fn fn, void *user);
+void viewcube_text_builtin(const char *utf8, void *user);
+
+// Draw the cube into the top-right corner of the current framebuffer.
+// Leaves the viewport set to the full window.
+void viewcube_render(viewcube_t *vc);
+
+// --- Embedding into a host-owned context ---
+//
+// The host describes the GL state it currently has bound in a
+// viewcube_gl_state block (it is expected to track this itself anyway).
+// viewcube_render_embedded compares against the block instead of calling
+// glGet or glPushAttrib, changes only what differs, and puts back only what
+// it changed. The returned VIEWCUBE_STATE_* mask says what was touched.
+
+typedef struct {
+    unsigned int framebuffer;   // bound GL_FRAMEBUFFER
+    int viewport[4];
+    int matrix_mode;            // GL_MODELVIEW / GL_PROJECTION / ...
+    int depth_test, texture_2d, blend, lighting, cull_face;
+    float line_width, point_size;
+    float color[4];             // current glColor
+} viewcube_gl_state;
+
+enum {
+    VIEWCUBE_STATE_FRAMEBUFFER = 1 << 0,
+    VIEWCUBE_STATE_VIEWPORT    = 1 << 1,
+    VIEWCUBE_STATE_MATRICES    = 1 << 2,  // pushed and popped, never lost
+    VIEWCUBE_STATE_DEPTH_TEST  = 1 << 3,
+    VIEWCUBE_STATE_TEXTURE_2D  = 1 << 4,
+    VIEWCUBE_STATE_BLEND       = 1 << 5,
+    VIEWCUBE_STATE_LIGHTING    = 1 << 6,
+    VIEWCUBE_STATE_CULL_FACE   = 1 << 7,
+    VIEWCUBE_STATE_LINE_WIDTH  = 1 << 8,
+    VIEWCUBE_STATE_POINT_SIZE  = 1 << 9,
+    VIEWCUBE_STATE_COLOR       = 1 << 10
+};
+
+// Render flags
+enum {
+    // Leave the cube's state bound and update *host to match, for hosts
+    // that will set their own state next anyway.
+    VIEWCUBE_EMBED_NO_RESTORE = 1 << 0
+};
+
+// Fill with the GL initial values (default framebuffer, depth test off...).
+void viewcube_gl_state_init(viewcube_gl_state *s);
+
+// Render into framebuffer `fbo` (0 = default) inside the rectangle x, y, w, h
+// (GL window coordinates, origin bottom-left). The cube is a centred square
+// and this rectangle also becomes the area used for pointer hit-testing.
+unsigned viewcube_render_embedded(viewcube_t *vc, viewcube_gl_state *host,
+                                  unsigned fbo, int x, int y, int w, int h,
+                                  unsigned flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif